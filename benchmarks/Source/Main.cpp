@@ -0,0 +1,59 @@
+
+#include <JuceHeader.h>
+
+// Every allocation the process makes is counted, so the benchmarks can show
+// how many are made while discovering and resolving
+static std::atomic<juce::int64> numAllocations {0};
+
+void* operator new (size_t size)
+{
+    ++numAllocations;
+
+    if (auto* memory {std::malloc (size == 0 ? 1 : size)})
+        return memory;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete (void* memory) noexcept
+{
+    std::free (memory);
+}
+
+void operator delete (void* memory, size_t) noexcept
+{
+    std::free (memory);
+}
+
+// Usage: benchmarks [--daemon] [--iterations <count>] [--output <file>]
+//
+// Runs against an in-process loopback responder unless --daemon is given,
+// and writes the results as JSON to the output file or to stdout.
+int main (int argc, char* argv[])
+{
+    juce::StringArray arguments;
+
+    for (auto index {1}; index < argc; ++index)
+        arguments.add (argv[index]);
+
+    jucey::BonjourBenchmarks::Options options;
+    options.useLoopbackResponder = ! arguments.contains ("--daemon");
+    options.getNumAllocations = [] { return numAllocations.load(); };
+
+    const auto iterationsIndex {arguments.indexOf ("--iterations")};
+
+    if (iterationsIndex >= 0)
+        options.numIterations = std::max (1, arguments[iterationsIndex + 1].getIntValue());
+
+    const auto results {juce::JSON::toString (jucey::BonjourBenchmarks::run (options))};
+    const auto outputIndex {arguments.indexOf ("--output")};
+
+    if (outputIndex >= 0)
+    {
+        const auto outputFile {juce::File::getCurrentWorkingDirectory().getChildFile (arguments[outputIndex + 1])};
+        return outputFile.replaceWithText (results) ? 0 : 1;
+    }
+
+    std::cout << results << std::endl;
+    return 0;
+}
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+
+# clone the JUCE repo
+rm -rf JUCE
+git clone --depth 1 https://github.com/juce-framework/JUCE.git
+
+# build the projucer
+xcodebuild -project ./JUCE/extras/Projucer/Builds/MacOSX/Projucer.xcodeproj
+
+# generate the benchmarks xcode project using the projucer
+./JUCE/extras/Projucer/Builds/MacOSX/build/Debug/Projucer.app/Contents/MacOS/Projucer --resave ./benchmarks.jucer
+
+# build the benchmarks project, optimised
+xcodebuild -project ./Builds/MacOSX/benchmarks.xcodeproj -configuration Release
+
+# run the benchmarks against the loopback responder, pass --daemon to measure
+# against the DNS service daemon instead
+./Builds/MacOSX/build/Release/benchmarks --output benchmarks.json "$@"
@@ -0,0 +1,251 @@
+
+// Everything the module asks of DNS-SD goes through a backend, so operations
+// can be answered by something other than the daemon. Each function has the
+// same contract as the dns_sd function it's named after. Operations hold on
+// to the backend they were started with, so changing the backend only
+// affects operations started afterwards.
+class BonjourBackend
+{
+public:
+    virtual ~BonjourBackend() = default;
+
+    // The installed backend, or the default backend if none is installed
+    static BonjourBackend& getCurrent();
+
+    // Only one backend can be installed at a time, pass nullptr to go back to
+    // using the default backend
+    static void install (BonjourBackend* backendToInstall);
+
+    virtual dnssd_sock_t refSockFD (DNSServiceRef ref) = 0;
+    virtual DNSServiceErrorType processResult (DNSServiceRef ref) = 0;
+    virtual void refDeallocate (DNSServiceRef ref) = 0;
+
+    virtual DNSServiceErrorType createConnection (DNSServiceRef* ref) = 0;
+
+    virtual DNSServiceErrorType browse (DNSServiceRef* ref,
+                                        DNSServiceFlags flags,
+                                        uint32_t interfaceIndex,
+                                        const char* regtype,
+                                        const char* domain,
+                                        DNSServiceBrowseReply callBack,
+                                        void* context) = 0;
+
+    virtual DNSServiceErrorType resolve (DNSServiceRef* ref,
+                                         DNSServiceFlags flags,
+                                         uint32_t interfaceIndex,
+                                         const char* name,
+                                         const char* regtype,
+                                         const char* domain,
+                                         DNSServiceResolveReply callBack,
+                                         void* context) = 0;
+
+    virtual DNSServiceErrorType registerService (DNSServiceRef* ref,
+                                                 DNSServiceFlags flags,
+                                                 uint32_t interfaceIndex,
+                                                 const char* name,
+                                                 const char* regtype,
+                                                 const char* domain,
+                                                 const char* host,
+                                                 uint16_t port,
+                                                 uint16_t txtLen,
+                                                 const void* txtRecord,
+                                                 DNSServiceRegisterReply callBack,
+                                                 void* context) = 0;
+
+    virtual DNSServiceErrorType updateRecord (DNSServiceRef ref,
+                                              DNSRecordRef recordRef,
+                                              DNSServiceFlags flags,
+                                              uint16_t rdlen,
+                                              const void* rdata,
+                                              uint32_t ttl) = 0;
+
+    virtual DNSServiceErrorType getAddrInfo (DNSServiceRef* ref,
+                                             DNSServiceFlags flags,
+                                             uint32_t interfaceIndex,
+                                             DNSServiceProtocol protocol,
+                                             const char* hostname,
+                                             DNSServiceGetAddrInfoReply callBack,
+                                             void* context) = 0;
+
+    virtual DNSServiceErrorType queryRecord (DNSServiceRef* ref,
+                                             DNSServiceFlags flags,
+                                             uint32_t interfaceIndex,
+                                             const char* fullname,
+                                             uint16_t rrtype,
+                                             uint16_t rrclass,
+                                             DNSServiceQueryRecordReply callBack,
+                                             void* context) = 0;
+
+    // Records are registered on a connection made with createConnection(),
+    // and are all removed when the connection is deallocated
+    virtual DNSServiceErrorType registerRecord (DNSServiceRef ref,
+                                                DNSRecordRef* recordRef,
+                                                DNSServiceFlags flags,
+                                                uint32_t interfaceIndex,
+                                                const char* fullname,
+                                                uint16_t rrtype,
+                                                uint16_t rrclass,
+                                                uint16_t rdlen,
+                                                const void* rdata,
+                                                uint32_t ttl,
+                                                DNSServiceRegisterRecordReply callBack,
+                                                void* context) = 0;
+
+    virtual DNSServiceErrorType removeRecord (DNSServiceRef ref,
+                                              DNSRecordRef recordRef,
+                                              DNSServiceFlags flags) = 0;
+
+private:
+    // The dns_sd backend, or the native mDNS backend if JUCEY_NATIVE_MDNS is
+    // enabled
+    static BonjourBackend& getDefault();
+
+    static inline std::atomic<BonjourBackend*> installedBackend {nullptr};
+};
+
+#if ! JUCEY_NATIVE_MDNS
+
+// Passes everything straight through to the daemon
+class BonjourDnsSdBackend : public BonjourBackend
+{
+public:
+    dnssd_sock_t refSockFD (DNSServiceRef ref) override
+    {
+        return DNSServiceRefSockFD (ref);
+    }
+
+    DNSServiceErrorType processResult (DNSServiceRef ref) override
+    {
+        return DNSServiceProcessResult (ref);
+    }
+
+    void refDeallocate (DNSServiceRef ref) override
+    {
+        DNSServiceRefDeallocate (ref);
+    }
+
+    DNSServiceErrorType createConnection (DNSServiceRef* ref) override
+    {
+        return DNSServiceCreateConnection (ref);
+    }
+
+    DNSServiceErrorType browse (DNSServiceRef* ref,
+                                DNSServiceFlags flags,
+                                uint32_t interfaceIndex,
+                                const char* regtype,
+                                const char* domain,
+                                DNSServiceBrowseReply callBack,
+                                void* context) override
+    {
+        return DNSServiceBrowse (ref, flags, interfaceIndex, regtype, domain, callBack, context);
+    }
+
+    DNSServiceErrorType resolve (DNSServiceRef* ref,
+                                 DNSServiceFlags flags,
+                                 uint32_t interfaceIndex,
+                                 const char* name,
+                                 const char* regtype,
+                                 const char* domain,
+                                 DNSServiceResolveReply callBack,
+                                 void* context) override
+    {
+        return DNSServiceResolve (ref, flags, interfaceIndex, name, regtype, domain, callBack, context);
+    }
+
+    DNSServiceErrorType registerService (DNSServiceRef* ref,
+                                         DNSServiceFlags flags,
+                                         uint32_t interfaceIndex,
+                                         const char* name,
+                                         const char* regtype,
+                                         const char* domain,
+                                         const char* host,
+                                         uint16_t port,
+                                         uint16_t txtLen,
+                                         const void* txtRecord,
+                                         DNSServiceRegisterReply callBack,
+                                         void* context) override
+    {
+        return DNSServiceRegister (ref, flags, interfaceIndex, name, regtype, domain, host, port, txtLen, txtRecord, callBack, context);
+    }
+
+    DNSServiceErrorType updateRecord (DNSServiceRef ref,
+                                      DNSRecordRef recordRef,
+                                      DNSServiceFlags flags,
+                                      uint16_t rdlen,
+                                      const void* rdata,
+                                      uint32_t ttl) override
+    {
+        return DNSServiceUpdateRecord (ref, recordRef, flags, rdlen, rdata, ttl);
+    }
+
+    DNSServiceErrorType getAddrInfo (DNSServiceRef* ref,
+                                     DNSServiceFlags flags,
+                                     uint32_t interfaceIndex,
+                                     DNSServiceProtocol protocol,
+                                     const char* hostname,
+                                     DNSServiceGetAddrInfoReply callBack,
+                                     void* context) override
+    {
+        return DNSServiceGetAddrInfo (ref, flags, interfaceIndex, protocol, hostname, callBack, context);
+    }
+
+    DNSServiceErrorType queryRecord (DNSServiceRef* ref,
+                                     DNSServiceFlags flags,
+                                     uint32_t interfaceIndex,
+                                     const char* fullname,
+                                     uint16_t rrtype,
+                                     uint16_t rrclass,
+                                     DNSServiceQueryRecordReply callBack,
+                                     void* context) override
+    {
+        return DNSServiceQueryRecord (ref, flags, interfaceIndex, fullname, rrtype, rrclass, callBack, context);
+    }
+
+    DNSServiceErrorType registerRecord (DNSServiceRef ref,
+                                        DNSRecordRef* recordRef,
+                                        DNSServiceFlags flags,
+                                        uint32_t interfaceIndex,
+                                        const char* fullname,
+                                        uint16_t rrtype,
+                                        uint16_t rrclass,
+                                        uint16_t rdlen,
+                                        const void* rdata,
+                                        uint32_t ttl,
+                                        DNSServiceRegisterRecordReply callBack,
+                                        void* context) override
+    {
+        return DNSServiceRegisterRecord (ref, recordRef, flags, interfaceIndex, fullname, rrtype, rrclass, rdlen, rdata, ttl, callBack, context);
+    }
+
+    DNSServiceErrorType removeRecord (DNSServiceRef ref,
+                                      DNSRecordRef recordRef,
+                                      DNSServiceFlags flags) override
+    {
+        return DNSServiceRemoveRecord (ref, recordRef, flags);
+    }
+};
+
+BonjourBackend& BonjourBackend::getDefault()
+{
+    static BonjourDnsSdBackend dnsSdBackend;
+    return dnsSdBackend;
+}
+
+#endif // ! JUCEY_NATIVE_MDNS
+
+BonjourBackend& BonjourBackend::getCurrent()
+{
+    if (auto* backend {installedBackend.load()})
+        return *backend;
+
+    return getDefault();
+}
+
+void BonjourBackend::install (BonjourBackend* backendToInstall)
+{
+    const auto* previousBackend {installedBackend.exchange (backendToInstall)};
+
+    // Only one backend can be installed at a time!
+    jassert (previousBackend == nullptr || backendToInstall == nullptr);
+    juce::ignoreUnused (previousBackend);
+}
@@ -0,0 +1,974 @@
+
+#if JUCEY_BENCHMARKS
+
+// Answers browses and resolves from a fixed set of refs, with every name and
+// record built up front, so it never allocates once it's been constructed.
+// Any allocations made while it's installed are made by the module itself.
+// Everything else is unsupported.
+class BonjourBenchmarkBackend : public BonjourBackend
+{
+public:
+    BonjourBenchmarkBackend (const juce::String& serviceType, int numInstances)
+        : type {serviceType.toStdString()}
+    {
+        for (auto index {0}; index < numInstances; ++index)
+            instanceNames.push_back ("JUCEY " + std::to_string (index));
+
+        for (auto index {0}; index < 8; ++index)
+            BonjourDnsTxtData::appendString (txtRecord, {"key" + std::to_string (index), "=", "value" + std::to_string (index)});
+    }
+
+    ~BonjourBenchmarkBackend() override
+    {
+        // Every operation should have been stopped before the backend is
+        // destroyed!
+        jassert (getNumActiveOperations() == 0);
+    }
+
+    int getNumActiveOperations() const
+    {
+        return (int) std::count_if (refs.begin(), refs.end(), [](const Ref& ref) { return ref.isInUse.load(); });
+    }
+
+    // Sends every browse a burst of replies, in which each instance appears
+    // if it went in the last burst or goes if it appeared
+    void sendBrowseBurst()
+    {
+        for (auto& ref : refs)
+        {
+            if (ref.isInUse && ref.browseReply != nullptr)
+            {
+                ++ref.numRepliesPending;
+                ref.signal.signal();
+            }
+        }
+    }
+
+    const std::string& getInstanceName (size_t index) const
+    {
+        return instanceNames[index];
+    }
+
+    dnssd_sock_t refSockFD (DNSServiceRef sdRef) override
+    {
+        if (auto* ref {findRef (sdRef)})
+            return ref->signal.getFd();
+
+        return (dnssd_sock_t) -1;
+    }
+
+    DNSServiceErrorType processResult (DNSServiceRef sdRef) override
+    {
+        auto* ref {findRef (sdRef)};
+
+        if (ref == nullptr)
+            return kDNSServiceErr_BadReference;
+
+        ref->signal.clear();
+
+        for (; ref->numRepliesPending > 0; --ref->numRepliesPending)
+        {
+            if (ref->resolveReply != nullptr)
+            {
+                ref->resolveReply (sdRef,
+                                   0,
+                                   interfaceIndex,
+                                   kDNSServiceErr_NoError,
+                                   nullptr,
+                                   hostName,
+                                   htons ((uint16_t) 50000),
+                                   (uint16_t) txtRecord.size(),
+                                   txtRecord.data(),
+                                   ref->context);
+
+                continue;
+            }
+
+            const DNSServiceFlags flags {ref->isAdding ? (DNSServiceFlags) kDNSServiceFlagsAdd : 0};
+            ref->isAdding = ! ref->isAdding;
+
+            for (size_t index {0}; index < instanceNames.size(); ++index)
+            {
+                const auto isMoreComing {index + 1 < instanceNames.size()};
+
+                ref->browseReply (sdRef,
+                                  flags | (isMoreComing ? (DNSServiceFlags) kDNSServiceFlagsMoreComing : 0),
+                                  interfaceIndex,
+                                  kDNSServiceErr_NoError,
+                                  instanceNames[index].c_str(),
+                                  type.c_str(),
+                                  "local.",
+                                  ref->context);
+            }
+        }
+
+        return kDNSServiceErr_NoError;
+    }
+
+    void refDeallocate (DNSServiceRef sdRef) override
+    {
+        if (auto* ref {findRef (sdRef)})
+        {
+            ref->browseReply = nullptr;
+            ref->resolveReply = nullptr;
+            ref->context = nullptr;
+            ref->numRepliesPending = 0;
+            ref->signal.clear();
+            ref->isInUse = false;
+        }
+    }
+
+    DNSServiceErrorType createConnection (DNSServiceRef*) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType browse (DNSServiceRef* sdRef,
+                                DNSServiceFlags,
+                                uint32_t,
+                                const char*,
+                                const char*,
+                                DNSServiceBrowseReply callBack,
+                                void* context) override
+    {
+        auto* ref {claimRef (sdRef)};
+
+        if (ref == nullptr)
+            return kDNSServiceErr_NoMemory;
+
+        ref->browseReply = callBack;
+        ref->context = context;
+        ref->isAdding = true;
+        return kDNSServiceErr_NoError;
+    }
+
+    DNSServiceErrorType resolve (DNSServiceRef* sdRef,
+                                 DNSServiceFlags,
+                                 uint32_t,
+                                 const char*,
+                                 const char*,
+                                 const char*,
+                                 DNSServiceResolveReply callBack,
+                                 void* context) override
+    {
+        auto* ref {claimRef (sdRef)};
+
+        if (ref == nullptr)
+            return kDNSServiceErr_NoMemory;
+
+        // Answered straight away
+        ref->resolveReply = callBack;
+        ref->context = context;
+        ref->numRepliesPending = 1;
+        ref->signal.signal();
+        return kDNSServiceErr_NoError;
+    }
+
+    DNSServiceErrorType registerService (DNSServiceRef*,
+                                         DNSServiceFlags,
+                                         uint32_t,
+                                         const char*,
+                                         const char*,
+                                         const char*,
+                                         const char*,
+                                         uint16_t,
+                                         uint16_t,
+                                         const void*,
+                                         DNSServiceRegisterReply,
+                                         void*) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType updateRecord (DNSServiceRef,
+                                      DNSRecordRef,
+                                      DNSServiceFlags,
+                                      uint16_t,
+                                      const void*,
+                                      uint32_t) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType getAddrInfo (DNSServiceRef*,
+                                     DNSServiceFlags,
+                                     uint32_t,
+                                     DNSServiceProtocol,
+                                     const char*,
+                                     DNSServiceGetAddrInfoReply,
+                                     void*) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType queryRecord (DNSServiceRef*,
+                                     DNSServiceFlags,
+                                     uint32_t,
+                                     const char*,
+                                     uint16_t,
+                                     uint16_t,
+                                     DNSServiceQueryRecordReply,
+                                     void*) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType registerRecord (DNSServiceRef,
+                                        DNSRecordRef*,
+                                        DNSServiceFlags,
+                                        uint32_t,
+                                        const char*,
+                                        uint16_t,
+                                        uint16_t,
+                                        uint16_t,
+                                        const void*,
+                                        uint32_t,
+                                        DNSServiceRegisterRecordReply,
+                                        void*) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType removeRecord (DNSServiceRef,
+                                      DNSRecordRef,
+                                      DNSServiceFlags) override
+    {
+        return kDNSServiceErr_Unsupported;
+    }
+
+private:
+    struct Ref
+    {
+        BonjourWakeupSignal signal;
+        std::atomic<bool> isInUse {false};
+        std::atomic<int> numRepliesPending {0};
+        DNSServiceBrowseReply browseReply {nullptr};
+        DNSServiceResolveReply resolveReply {nullptr};
+        void* context {nullptr};
+        bool isAdding {true};
+    };
+
+    Ref* claimRef (DNSServiceRef* sdRef)
+    {
+        for (auto& ref : refs)
+        {
+            auto isInUse {false};
+
+            if (ref.isInUse.compare_exchange_strong (isInUse, true))
+            {
+                *sdRef = reinterpret_cast<DNSServiceRef> (&ref);
+                return &ref;
+            }
+        }
+
+        return nullptr;
+    }
+
+    Ref* findRef (DNSServiceRef sdRef)
+    {
+        for (auto& ref : refs)
+            if (reinterpret_cast<DNSServiceRef> (&ref) == sdRef && ref.isInUse)
+                return &ref;
+
+        return nullptr;
+    }
+
+    static constexpr uint32_t interfaceIndex {1};
+    static constexpr const char* hostName {"jucey-benchmark.local."};
+
+    const std::string type;
+    std::vector<std::string> instanceNames;
+    std::vector<uint8_t> txtRecord;
+    std::array<Ref, 4> refs;
+
+    JUCE_DECLARE_NON_COPYABLE (BonjourBenchmarkBackend)
+};
+
+class BonjourBenchmarkRunner
+{
+public:
+    explicit BonjourBenchmarkRunner (const jucey::BonjourBenchmarks::Options& options)
+        : options {options}
+    {
+
+    }
+
+    ~BonjourBenchmarkRunner()
+    {
+
+    }
+
+    juce::var run()
+    {
+        std::unique_ptr<jucey::BonjourLoopbackResponder> responder {nullptr};
+
+        if (options.useLoopbackResponder)
+            responder = std::make_unique<jucey::BonjourLoopbackResponder>();
+
+        jucey::BonjourService::clearResolveCache();
+
+        juce::DynamicObject::Ptr results {new juce::DynamicObject{}};
+        results->setProperty ("registerDiscoverLatencyMs", runRegisterDiscoverLatencyBenchmark());
+        results->setProperty ("discoverBurstThroughput", runDiscoverBurstThroughputBenchmark());
+        results->setProperty ("resolveLatencyMs", runResolveLatencyBenchmark());
+        results->setProperty ("txtRecord", runTxtRecordBenchmarks());
+        results->setProperty ("serviceCopy", runServiceCopyBenchmarks());
+        results->setProperty ("dnsCodec", runDnsCodecBenchmarks());
+        results->setProperty ("resourceUsage", runResourceUsageBenchmarks());
+
+        jucey::BonjourService::clearResolveCache();
+
+        // Operations stopped on the event loop thread are released shortly
+        // after, the responder must outlive all of them
+        if (responder != nullptr)
+            for (auto attempt {0}; responder->getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+        // These install a backend of their own, so have to wait until the
+        // responder has gone
+        responder.reset();
+
+        if (options.getNumAllocations != nullptr)
+            results->setProperty ("allocations", runAllocationBenchmarks());
+
+        juce::DynamicObject::Ptr report {new juce::DynamicObject{}};
+        report->setProperty ("backend", options.useLoopbackResponder ? "loopback" : "daemon");
+        report->setProperty ("platform", juce::SystemStats::getOperatingSystemName());
+        report->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+        report->setProperty ("options", getOptionsAsVar());
+        report->setProperty ("results", results.get());
+        report->setProperty ("checksum", (juce::int64) checksum);
+        return report.get();
+    }
+
+private:
+    static double millisecondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    }
+
+    // Times a tight loop and returns the average nanoseconds per iteration
+    template <typename Function>
+    static double nanosecondsPerIteration (int numIterations, Function&& function)
+    {
+        const auto startTicks {juce::Time::getHighResolutionTicks()};
+
+        for (auto iteration {0}; iteration < numIterations; ++iteration)
+            function();
+
+        return millisecondsSince (startTicks) * 1.0e6 / std::max (1, numIterations);
+    }
+
+    static juce::var summariseSamples (std::vector<double> samples, int numTimeouts)
+    {
+        juce::DynamicObject::Ptr summary {new juce::DynamicObject{}};
+        summary->setProperty ("count", (int) samples.size());
+        summary->setProperty ("timeouts", numTimeouts);
+
+        if (samples.empty())
+            return summary.get();
+
+        std::sort (samples.begin(), samples.end());
+
+        const auto percentile = [&samples](double fraction)
+        {
+            return samples[(size_t) std::lround (fraction * (double) (samples.size() - 1))];
+        };
+
+        summary->setProperty ("min", samples.front());
+        summary->setProperty ("mean", std::accumulate (samples.begin(), samples.end(), 0.0) / (double) samples.size());
+        summary->setProperty ("p50", percentile (0.5));
+        summary->setProperty ("p90", percentile (0.9));
+        summary->setProperty ("p99", percentile (0.99));
+        summary->setProperty ("max", samples.back());
+        return summary.get();
+    }
+
+    static int getNumThreadsInProcess()
+    {
+       #if JUCE_LINUX
+        juce::StringArray lines;
+        juce::File {"/proc/self/status"}.readLines (lines);
+
+        for (const auto& line : lines)
+            if (line.startsWith ("Threads:"))
+                return line.fromFirstOccurrenceOf (":", false, false).trim().getIntValue();
+
+        return -1;
+       #elif JUCE_MAC
+        thread_act_array_t threads {nullptr};
+        mach_msg_type_number_t numThreads {0};
+
+        if (task_threads (mach_task_self(), &threads, &numThreads) != KERN_SUCCESS)
+            return -1;
+
+        for (mach_msg_type_number_t index {0}; index < numThreads; ++index)
+            mach_port_deallocate (mach_task_self(), threads[index]);
+
+        vm_deallocate (mach_task_self(), (vm_address_t) threads, numThreads * sizeof (thread_t));
+        return (int) numThreads;
+       #else
+        return -1;
+       #endif
+    }
+
+    static int getNumOpenFileDescriptors()
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        const juce::File fdDirectory {JUCE_LINUX ? "/proc/self/fd" : "/dev/fd"};
+
+        // Listing the directory opens one more while it's being read
+        return fdDirectory.getNumberOfChildFiles (juce::File::findFilesAndDirectories) - 1;
+       #else
+        return -1;
+       #endif
+    }
+
+    juce::var getOptionsAsVar() const
+    {
+        juce::Array<juce::var> txtRecordKeyCounts;
+        juce::Array<juce::var> concurrentOperationCounts;
+
+        for (const auto keyCount : options.txtRecordKeyCounts)
+            txtRecordKeyCounts.add (keyCount);
+
+        for (const auto operationCount : options.concurrentOperationCounts)
+            concurrentOperationCounts.add (operationCount);
+
+        juce::DynamicObject::Ptr optionsObject {new juce::DynamicObject{}};
+        optionsObject->setProperty ("numIterations", options.numIterations);
+        optionsObject->setProperty ("numBurstInstances", options.numBurstInstances);
+        optionsObject->setProperty ("txtRecordKeyCounts", txtRecordKeyCounts);
+        optionsObject->setProperty ("concurrentOperationCounts", concurrentOperationCounts);
+        optionsObject->setProperty ("serviceType", options.serviceType);
+        optionsObject->setProperty ("timeoutMs", options.timeoutMs);
+        return optionsObject.get();
+    }
+
+    // Registers a service and waits for it, returning the name it was
+    // registered with or an empty string if it failed
+    juce::String registerAndWait (jucey::BonjourService& serviceToRegister)
+    {
+        juce::String registeredName;
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        const auto onServiceRegistered = [&](const jucey::BonjourService& service, const juce::Result& result)
+        {
+            if (result.wasOk())
+                registeredName = service.getName();
+
+            onServiceRegisteredEvent.signal();
+        };
+
+        if (serviceToRegister.registerAsync (onServiceRegistered, portToRegister).failed())
+            return {};
+
+        // Stopping the registration means the callback can't be called
+        // after this returns
+        if ( ! onServiceRegisteredEvent.wait (options.timeoutMs))
+            serviceToRegister = jucey::BonjourService {};
+
+        return registeredName;
+    }
+
+    juce::var runRegisterDiscoverLatencyBenchmark()
+    {
+        std::vector<double> samples;
+        auto numTimeouts {0};
+
+        for (auto iteration {0}; iteration < options.numIterations; ++iteration)
+        {
+            const auto nameToDiscover {"JUCEY Benchmark " + juce::String (iteration)};
+            juce::WaitableEvent onServiceDiscoveredEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool,
+                                                 const juce::Result& result)
+            {
+                if (result.wasOk() && isAvailable && service.getName() == nameToDiscover)
+                    onServiceDiscoveredEvent.signal();
+            };
+
+            jucey::BonjourService serviceToDiscover {options.serviceType};
+            serviceToDiscover.discoverAsync (onServiceDiscovered);
+
+            jucey::BonjourService serviceToRegister {options.serviceType, nameToDiscover, "local"};
+            const auto startTicks {juce::Time::getHighResolutionTicks()};
+            serviceToRegister.registerAsync ([](const jucey::BonjourService&, const juce::Result&) {}, portToRegister);
+
+            if (onServiceDiscoveredEvent.wait (options.timeoutMs))
+                samples.push_back (millisecondsSince (startTicks));
+            else
+                ++numTimeouts;
+        }
+
+        return summariseSamples (std::move (samples), numTimeouts);
+    }
+
+    juce::var runDiscoverBurstThroughputBenchmark()
+    {
+        juce::DynamicObject::Ptr throughput {new juce::DynamicObject{}};
+        throughput->setProperty ("instances", options.numBurstInstances);
+
+        std::vector<jucey::BonjourService> servicesToRegister;
+        servicesToRegister.reserve ((size_t) options.numBurstInstances);
+
+        for (auto index {0}; index < options.numBurstInstances; ++index)
+        {
+            servicesToRegister.emplace_back (options.serviceType, "JUCEY Burst " + juce::String (index), "local");
+
+            if (registerAndWait (servicesToRegister.back()).isEmpty())
+            {
+                throughput->setProperty ("error", "Failed to register every instance");
+                return throughput.get();
+            }
+        }
+
+        // Only called on the event loop thread so the set needs no lock
+        std::set<juce::String> discoveredNames;
+        juce::WaitableEvent onAllServicesDiscoveredEvent;
+
+        const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                             bool isAvailable,
+                                             bool,
+                                             const juce::Result& result)
+        {
+            if (result.failed() || ! isAvailable || ! service.getName().startsWith ("JUCEY Burst "))
+                return;
+
+            if (discoveredNames.insert (service.getName()).second
+                && (int) discoveredNames.size() == options.numBurstInstances)
+            {
+                onAllServicesDiscoveredEvent.signal();
+            }
+        };
+
+        jucey::BonjourService serviceToDiscover {options.serviceType};
+        const auto startTicks {juce::Time::getHighResolutionTicks()};
+        serviceToDiscover.discoverAsync (onServiceDiscovered);
+
+        if ( ! onAllServicesDiscoveredEvent.wait (options.timeoutMs))
+        {
+            throughput->setProperty ("error", "Timed out waiting for every instance");
+            return throughput.get();
+        }
+
+        const auto elapsedMs {millisecondsSince (startTicks)};
+        throughput->setProperty ("elapsedMs", elapsedMs);
+        throughput->setProperty ("instancesPerSecond", options.numBurstInstances * 1000.0 / std::max (elapsedMs, 0.001));
+        return throughput.get();
+    }
+
+    juce::var runResolveLatencyBenchmark()
+    {
+        jucey::BonjourService serviceToRegister {options.serviceType, "JUCEY Resolve Benchmark", "local"};
+
+        for (auto index {0}; index < 8; ++index)
+            serviceToRegister.setRecordItemValue ("key" + juce::String (index), "value" + juce::String (index));
+
+        const auto registeredName {registerAndWait (serviceToRegister)};
+
+        if (registeredName.isEmpty())
+            return summariseSamples ({}, options.numIterations);
+
+        // Every resolve should go out to the responder
+        const auto previousTimeToLive {jucey::BonjourService::getResolveCacheTimeToLive()};
+        jucey::BonjourService::setResolveCacheTimeToLive ({});
+
+        std::vector<double> samples;
+        auto numTimeouts {0};
+
+        for (auto iteration {0}; iteration < options.numIterations; ++iteration)
+        {
+            juce::WaitableEvent onServiceResolvedEvent;
+
+            const auto onServiceResolved = [&](const jucey::BonjourService&, const juce::String&, int, const juce::Result&)
+            {
+                onServiceResolvedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToResolve {options.serviceType, registeredName, "local."};
+            const auto startTicks {juce::Time::getHighResolutionTicks()};
+            serviceToResolve.resolveAsync (onServiceResolved);
+
+            if (onServiceResolvedEvent.wait (options.timeoutMs))
+                samples.push_back (millisecondsSince (startTicks));
+            else
+                ++numTimeouts;
+        }
+
+        jucey::BonjourService::setResolveCacheTimeToLive (previousTimeToLive);
+        return summariseSamples (std::move (samples), numTimeouts);
+    }
+
+    juce::var runTxtRecordBenchmarks()
+    {
+        juce::Array<juce::var> results;
+        const auto numRepeats {std::max (1, options.numIterations * 10)};
+
+        for (const auto keyCount : options.txtRecordKeyCounts)
+        {
+            std::vector<std::string> keys;
+            std::vector<std::string> values;
+            BonjourTxtRecord sourceRecord;
+
+            for (auto index {0}; index < keyCount; ++index)
+            {
+                keys.push_back ("key" + std::to_string (index));
+                values.push_back ("value" + std::to_string (index));
+                sourceRecord.setValue (keys.back(), values.back());
+            }
+
+            const auto numBytes {sourceRecord.getLength()};
+            const auto* bytes {static_cast<const unsigned char*> (sourceRecord.getBytes())};
+
+            const auto buildNs {nanosecondsPerIteration (numRepeats, [&]
+            {
+                jucey::BonjourService::TxtRecordBuilder builder {numBytes};
+
+                for (size_t index {0}; index < keys.size(); ++index)
+                    builder.add (keys[index], values[index]);
+
+                checksum += builder.getNumBytes();
+            })};
+
+            BonjourTxtRecord parsedRecord;
+
+            const auto parseNs {nanosecondsPerIteration (numRepeats, [&]
+            {
+                parsedRecord.copyFrom (numBytes, bytes);
+                checksum += (size_t) parsedRecord.getCount();
+            })};
+
+            const auto lookupNs {nanosecondsPerIteration (numRepeats, [&]
+            {
+                for (const auto& key : keys)
+                    if (const auto value {parsedRecord.findValue (key)})
+                        checksum += value->size();
+            }) / std::max (1, keyCount)};
+
+            juce::DynamicObject::Ptr result {new juce::DynamicObject{}};
+            result->setProperty ("keys", keyCount);
+            result->setProperty ("bytes", (int) numBytes);
+            result->setProperty ("buildNs", buildNs);
+            result->setProperty ("parseNs", parseNs);
+            result->setProperty ("lookupNsPerKey", lookupNs);
+            results.add (result.get());
+        }
+
+        return results;
+    }
+
+    juce::var runServiceCopyBenchmarks()
+    {
+        const auto numRepeats {std::max (1, options.numIterations * 10)};
+        jucey::BonjourService service {options.serviceType, "JUCEY Copy Benchmark", "local"};
+
+        for (auto index {0}; index < 8; ++index)
+            service.setRecordItemValue ("key" + juce::String (index), "value" + juce::String (index));
+
+        const auto copyNs {nanosecondsPerIteration (numRepeats, [&]
+        {
+            jucey::BonjourService copy {service};
+            checksum += (size_t) copy.getNumRecordItems();
+        })};
+
+        // Modifying a copy forces it to take its own copy of the data
+        const auto copyAndModifyNs {nanosecondsPerIteration (numRepeats, [&]
+        {
+            jucey::BonjourService copy {service};
+            copy.setRecordItemValue ("key0", "modified");
+            checksum += (size_t) copy.getNumRecordItems();
+        })};
+
+        juce::DynamicObject::Ptr result {new juce::DynamicObject{}};
+        result->setProperty ("recordItems", service.getNumRecordItems());
+        result->setProperty ("copyNs", copyNs);
+        result->setProperty ("copyAndModifyNs", copyAndModifyNs);
+        return result.get();
+    }
+
+    // A typical announcement, the records for a service and its address
+    BonjourDnsMessage makeAnnouncement() const
+    {
+        const auto instanceName {BonjourDnsName::fromParts ("JUCEY Codec Benchmark", options.serviceType, "local")};
+        const auto hostName {BonjourDnsName::fromString ("jucey-benchmark.local.")};
+
+        BonjourDnsMessage message;
+        message.flags = BonjourDnsMessage::responseFlags;
+
+        BonjourDnsRecord ptr;
+        ptr.name = instanceName.withoutFirst (1);
+        ptr.type = BonjourDnsRecord::ptr;
+        ptr.ttl = 4500;
+        ptr.target = instanceName;
+        message.answers.push_back (ptr);
+
+        BonjourDnsRecord srv;
+        srv.name = instanceName;
+        srv.type = BonjourDnsRecord::srv;
+        srv.cacheFlush = true;
+        srv.ttl = 120;
+        srv.port = 12345;
+        srv.target = hostName;
+        message.answers.push_back (srv);
+
+        BonjourDnsRecord txt;
+        txt.name = instanceName;
+        txt.type = BonjourDnsRecord::txt;
+        txt.cacheFlush = true;
+        txt.ttl = 4500;
+
+        for (auto index {0}; index < 8; ++index)
+            BonjourDnsTxtData::appendString (txt.data, {"key" + std::to_string (index), "=", "value" + std::to_string (index)});
+
+        message.answers.push_back (txt);
+
+        BonjourDnsRecord address;
+        address.name = hostName;
+        address.type = BonjourDnsRecord::a;
+        address.cacheFlush = true;
+        address.ttl = 120;
+        address.data = {192, 168, 0, 1};
+        message.answers.push_back (address);
+
+        return message;
+    }
+
+    juce::var runDnsCodecBenchmarks()
+    {
+        const auto numRepeats {std::max (1, options.numIterations * 100)};
+        const auto message {makeAnnouncement()};
+
+        std::array<uint8_t, BonjourDnsMessage::maxSize> buffer {};
+        size_t numBytes {0};
+
+        const auto writeNs {nanosecondsPerIteration (numRepeats, [&]
+        {
+            numBytes = message.write (buffer.data(), buffer.size());
+            checksum += numBytes;
+        })};
+
+        // Reading every record in place, as the mDNS backend does
+        const auto readNs {nanosecondsPerIteration (numRepeats, [&]
+        {
+            BonjourDnsReader reader {buffer.data(), numBytes};
+            BonjourDnsRecordView record;
+
+            while (reader.readNext (record))
+                checksum += record.name.getFirstLabel().size() + record.dataSize;
+        })};
+
+        // Copying every record out, for comparison
+        const auto readAndCopyNs {nanosecondsPerIteration (numRepeats, [&]
+        {
+            if (const auto copied {BonjourDnsMessage::read (buffer.data(), numBytes)})
+                checksum += copied->answers.size();
+        })};
+
+        juce::DynamicObject::Ptr result {new juce::DynamicObject{}};
+        result->setProperty ("bytes", (int) numBytes);
+        result->setProperty ("writeNs", writeNs);
+        result->setProperty ("readNs", readNs);
+        result->setProperty ("readAndCopyNs", readAndCopyNs);
+        result->setProperty ("readMegabytesPerSecond", (double) numBytes * 1000.0 / std::max (readNs, 0.001));
+        return result.get();
+    }
+
+    juce::var measureResourceUsage (int numOperations, const jucey::BonjourSession* session)
+    {
+        std::vector<jucey::BonjourService> servicesToDiscover ((size_t) numOperations, jucey::BonjourService {options.serviceType});
+
+        for (auto& serviceToDiscover : servicesToDiscover)
+        {
+            serviceToDiscover.setSession (session);
+            serviceToDiscover.discoverAsync ([](const jucey::BonjourService&, bool, bool, const juce::Result&) {});
+        }
+
+        juce::DynamicObject::Ptr usage {new juce::DynamicObject{}};
+        usage->setProperty ("threads", getNumThreadsInProcess());
+        usage->setProperty ("fileDescriptors", getNumOpenFileDescriptors());
+        return usage.get();
+    }
+
+    juce::var runResourceUsageBenchmarks()
+    {
+        // Make sure the event loop is running before taking the baseline
+        measureResourceUsage (1, nullptr);
+
+        juce::DynamicObject::Ptr baseline {new juce::DynamicObject{}};
+        baseline->setProperty ("threads", getNumThreadsInProcess());
+        baseline->setProperty ("fileDescriptors", getNumOpenFileDescriptors());
+
+        juce::Array<juce::var> operations;
+
+        for (const auto numOperations : options.concurrentOperationCounts)
+        {
+            juce::DynamicObject::Ptr result {new juce::DynamicObject{}};
+            result->setProperty ("operations", numOperations);
+            result->setProperty ("separateConnections", measureResourceUsage (numOperations, nullptr));
+
+            jucey::BonjourSession session;
+            result->setProperty ("sharedSession", measureResourceUsage (numOperations, &session));
+            operations.add (result.get());
+        }
+
+        juce::DynamicObject::Ptr usage {new juce::DynamicObject{}};
+        usage->setProperty ("baseline", baseline.get());
+        usage->setProperty ("concurrentOperations", operations);
+        return usage.get();
+    }
+
+    juce::var summariseAllocations (juce::int64 numAllocations, int numEvents, const char* eventName) const
+    {
+        juce::DynamicObject::Ptr summary {new juce::DynamicObject{}};
+        summary->setProperty (eventName, numEvents);
+        summary->setProperty ("allocations", numAllocations);
+        summary->setProperty ("perEvent", (double) numAllocations / std::max (1, numEvents));
+        return summary.get();
+    }
+
+    // Counts the allocations made for each discovered service once browsing
+    // has settled, with every instance going and coming back in each burst
+    juce::var measureDiscoverAllocations (BonjourBenchmarkBackend& backend, bool useBatches)
+    {
+        // Only changed on the event loop thread, and only read once the
+        // event has been signalled
+        auto numEvents {0};
+        juce::WaitableEvent onBurstReceivedEvent;
+
+        jucey::BonjourService serviceToDiscover {options.serviceType};
+
+        if (useBatches)
+        {
+            serviceToDiscover.discoverBatchAsync ([&](const std::vector<jucey::BonjourService::DiscoveryEvent>& events, const juce::Result&)
+            {
+                numEvents += (int) events.size();
+                onBurstReceivedEvent.signal();
+            });
+        }
+        else
+        {
+            serviceToDiscover.discoverAsync ([&](const jucey::BonjourService&, bool, bool isMoreComing, const juce::Result&)
+            {
+                ++numEvents;
+
+                if ( ! isMoreComing)
+                    onBurstReceivedEvent.signal();
+            });
+        }
+
+        const auto receiveBursts = [&](int numBursts)
+        {
+            for (auto burst {0}; burst < numBursts; ++burst)
+            {
+                backend.sendBrowseBurst();
+
+                if ( ! onBurstReceivedEvent.wait (options.timeoutMs))
+                    return false;
+            }
+
+            return true;
+        };
+
+        // The first bursts fill the pools and grow any buffers that are kept
+        if ( ! receiveBursts (numWarmUpIterations))
+            return "Timed out waiting for a burst";
+
+        numEvents = 0;
+        const auto startAllocations {options.getNumAllocations()};
+
+        if ( ! receiveBursts (std::max (2, options.numIterations / 10)))
+            return "Timed out waiting for a burst";
+
+        return summariseAllocations (options.getNumAllocations() - startAllocations, numEvents, "events");
+    }
+
+    // Counts the allocations made by resolving the same service again and
+    // again, with the resolve cache turned off so each one is answered by
+    // the backend
+    juce::var measureResolveAllocations (BonjourBenchmarkBackend& backend)
+    {
+        juce::WaitableEvent onServiceResolvedEvent;
+
+        const auto onServiceResolved = [&](const jucey::BonjourService&, const juce::String&, int, const juce::Result&)
+        {
+            onServiceResolvedEvent.signal();
+        };
+
+        jucey::BonjourService serviceToResolve {options.serviceType, backend.getInstanceName (0), "local."};
+
+        const auto resolve = [&](int numResolves)
+        {
+            for (auto iteration {0}; iteration < numResolves; ++iteration)
+            {
+                serviceToResolve.resolveAsync (onServiceResolved);
+
+                if ( ! onServiceResolvedEvent.wait (options.timeoutMs))
+                    return false;
+            }
+
+            return true;
+        };
+
+        const auto previousTimeToLive {jucey::BonjourService::getResolveCacheTimeToLive()};
+        jucey::BonjourService::setResolveCacheTimeToLive ({});
+
+        auto numAllocations {(juce::int64) -1};
+
+        if (resolve (numWarmUpIterations))
+        {
+            const auto startAllocations {options.getNumAllocations()};
+
+            if (resolve (options.numIterations))
+                numAllocations = options.getNumAllocations() - startAllocations;
+        }
+
+        jucey::BonjourService::setResolveCacheTimeToLive (previousTimeToLive);
+
+        if (numAllocations < 0)
+            return "Timed out waiting for a resolve";
+
+        return summariseAllocations (numAllocations, options.numIterations, "resolves");
+    }
+
+    juce::var runAllocationBenchmarks()
+    {
+        BonjourBenchmarkBackend backend {options.serviceType, options.numBurstInstances};
+        BonjourBackend::install (&backend);
+
+        juce::DynamicObject::Ptr allocations {new juce::DynamicObject{}};
+        allocations->setProperty ("discover", measureDiscoverAllocations (backend, false));
+        allocations->setProperty ("discoverBatch", measureDiscoverAllocations (backend, true));
+        allocations->setProperty ("resolve", measureResolveAllocations (backend));
+
+        // Resolves finish on the event loop thread, the backend must outlive
+        // all of them
+        for (auto attempt {0}; backend.getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+
+        BonjourBackend::install (nullptr);
+        return allocations.get();
+    }
+
+    static constexpr int portToRegister {50000};
+    static constexpr int numWarmUpIterations {10};
+
+    const jucey::BonjourBenchmarks::Options options;
+
+    // Accumulates results so the optimiser can't remove the measured work
+    size_t checksum {0};
+
+    JUCE_DECLARE_NON_COPYABLE (BonjourBenchmarkRunner)
+};
+
+namespace jucey
+{
+    juce::var BonjourBenchmarks::run (const Options& options)
+    {
+        return BonjourBenchmarkRunner {options}.run();
+    }
+}
+
+#endif // JUCEY_BENCHMARKS
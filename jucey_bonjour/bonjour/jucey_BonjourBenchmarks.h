@@ -0,0 +1,40 @@
+#pragma once
+
+#if JUCEY_BENCHMARKS
+
+namespace jucey
+{
+    // Repeatable measurements of the discovery, resolve and TXT record hot
+    // paths, returned as a JSON object so results can be tracked over time.
+    // See the benchmarks project for a command line runner.
+    class BonjourBenchmarks
+    {
+    public:
+        struct Options
+        {
+            // Answer everything from an in-process BonjourLoopbackResponder
+            // rather than the DNS service daemon, this takes the network out
+            // of the measurements
+            bool useLoopbackResponder {true};
+
+            int numIterations {200};
+            int numBurstInstances {200};
+            std::vector<int> txtRecordKeyCounts {1, 8, 32, 128};
+            std::vector<int> concurrentOperationCounts {1, 10, 100};
+            juce::String serviceType {"_jucey-bench._udp"};
+
+            // How long to wait for any single reply before giving up on it
+            int timeoutMs {5000};
+
+            // Returns how many heap allocations the process has made so far,
+            // the allocations made while discovering and resolving are only
+            // counted if this is set. See the benchmarks project for one way
+            // to count them.
+            std::function<juce::int64()> getNumAllocations {nullptr};
+        };
+
+        static juce::var run (const Options& options);
+    };
+}
+
+#endif // JUCEY_BENCHMARKS
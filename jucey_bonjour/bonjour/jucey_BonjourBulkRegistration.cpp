@@ -0,0 +1,440 @@
+
+namespace jucey
+{
+    // All the state is guarded by the event loop lock and every reply is
+    // called on the event loop thread. Each instance keeps the records or
+    // the ref it was registered with until it fails or everything is
+    // withdrawn, which closes the connection and with it everything that was
+    // registered on it.
+    class BonjourBulkRegistration::Pimpl
+    {
+    public:
+        Pimpl (const juce::String& typeToRegister, const juce::String& domainToRegisterIn)
+            : type {typeToRegister}
+            , domain {domainToRegisterIn}
+        {
+
+        }
+
+        ~Pimpl()
+        {
+            withdrawAll();
+        }
+
+        void setHostName (const juce::String& newHostName)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            hostName = newHostName;
+        }
+
+        void setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            callbackDispatcher = std::move (dispatcher);
+        }
+
+        juce::Result registerAll (const std::vector<Instance>& instancesToRegister, ResultsCallback callback)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            if (connection == nullptr)
+            {
+                BonjourConnection::Ptr newConnection {new BonjourConnection{}};
+
+                if (newConnection->getErrorCode() != kDNSServiceErr_NoError)
+                    return bonjourResult (newConnection->getErrorCode());
+
+                connection = std::move (newConnection);
+            }
+
+            const auto request {std::make_shared<Request> (Request {std::move (callback), {}})};
+
+            for (size_t index {0}; index < instancesToRegister.size(); ++index)
+            {
+                const auto& instanceToRegister {instancesToRegister[index]};
+
+                instances.push_back (std::make_unique<InstanceState>());
+                auto& instance {*instances.back()};
+                instance.owner = this;
+                instance.request = request;
+                instance.index = (int) index;
+                instance.service = BonjourService {type, instanceToRegister.name, domain};
+                instance.service.setCallbackDispatcher (callbackDispatcher);
+
+                auto txtRecord {instanceToRegister.txtRecord};
+                auto result {instance.service.setRecordItems (std::move (txtRecord))};
+
+                if (result.wasOk())
+                    result = start (instance, instanceToRegister.port);
+
+                if (result.failed())
+                    finish (instance, result);
+            }
+
+            return juce::Result::ok();
+        }
+
+        void withdrawAll()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            if (resultsTimerId != 0)
+                eventLoop->cancelTimer (std::exchange (resultsTimerId, 0));
+
+            for (const auto& instance : instances)
+                if (instance->isActive)
+                    BonjourMetricsRecorder::getInstance().operationStopped (jucey::BonjourMetrics::OperationKind::registration);
+
+            // Deallocating the connection removes every record and service
+            // registered on it, so none of them need removing first
+            requestsWithResults.clear();
+            instances.clear();
+            connection = nullptr;
+        }
+
+        int getNumRegistered() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            return (int) std::count_if (instances.begin(), instances.end(), [](const auto& instance)
+            {
+                return instance->isRegistered;
+            });
+        }
+
+        int getNumPending() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            return (int) std::count_if (instances.begin(), instances.end(), [](const auto& instance)
+            {
+                return instance->isActive && ! instance->isRegistered;
+            });
+        }
+
+        bool isRegisteringRecords() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            return hostName.isNotEmpty() && canRegisterRecords;
+        }
+
+    private:
+        // The results of one call to registerAll()
+        struct Request
+        {
+            ResultsCallback callback {nullptr};
+            std::vector<InstanceResult> results {};
+        };
+
+        struct InstanceState
+        {
+            Pimpl* owner {nullptr};
+            std::shared_ptr<Request> request {nullptr};
+            int index {0};
+            BonjourService service;
+
+            // The records the instance was registered with, or the ref of the
+            // service it was registered as
+            std::vector<DNSRecordRef> records {};
+            int numRecordsPending {0};
+            DNSServiceRef ref {nullptr};
+
+            bool isActive {false};
+            bool isRegistered {false};
+        };
+
+        juce::Result start (InstanceState& instance, int port)
+        {
+            // A socket should be bound to a valid port *before* registering
+            // and the bound port should be passed with each instance
+            jassert (port > 0 && port < 65536);
+
+            instance.isActive = true;
+            BonjourMetricsRecorder::getInstance().operationStarted (jucey::BonjourMetrics::OperationKind::registration);
+
+            if (hostName.isNotEmpty() && canRegisterRecords)
+            {
+                const auto errorCode {registerRecords (instance, port)};
+
+                if (errorCode != kDNSServiceErr_Unsupported)
+                    return bonjourResult (errorCode);
+
+                canRegisterRecords = false;
+            }
+
+            return bonjourResult (registerService (instance, port));
+        }
+
+        DNSServiceErrorType registerRecords (InstanceState& instance, int port)
+        {
+            const auto& data {*instance.service.data};
+
+            // There's no daemon to pick a name for an instance registered as
+            // records
+            if (data.name.isEmpty())
+                return kDNSServiceErr_BadParam;
+
+            const auto domainToRegisterIn {domain.isEmpty() ? juce::String {"local"} : domain};
+            const auto serviceName {BonjourDnsName::fromParts (data.name, type, domainToRegisterIn)};
+
+            auto typeName {BonjourDnsName::fromString (type)};
+            typeName.append (BonjourDnsName::fromString (domainToRegisterIn));
+
+            BonjourDnsRecord srvRecord;
+            srvRecord.type = BonjourDnsRecord::srv;
+            srvRecord.port = (uint16_t) port;
+            srvRecord.target = BonjourDnsName::fromString (hostName);
+
+            BonjourDnsRecord ptrRecord;
+            ptrRecord.type = BonjourDnsRecord::ptr;
+            ptrRecord.target = serviceName;
+
+            // An empty TXT record still has to hold a single empty string
+            const auto* txtBytes {static_cast<const uint8_t*> (data.txtRecord.getBytes())};
+            std::vector<uint8_t> txtData {txtBytes, txtBytes + (txtBytes != nullptr ? data.txtRecord.getLength() : 0)};
+
+            if (txtData.empty())
+                txtData.push_back (0);
+
+            struct Record
+            {
+                juce::String name;
+                uint16_t type;
+                DNSServiceFlags flags;
+                std::vector<uint8_t> data;
+            };
+
+            const Record records[] {{serviceName.toString(), BonjourDnsRecord::srv, kDNSServiceFlagsUnique, srvRecord.getData()},
+                                    {serviceName.toString(), BonjourDnsRecord::txt, kDNSServiceFlagsUnique, std::move (txtData)},
+                                    {typeName.toString(), BonjourDnsRecord::ptr, kDNSServiceFlagsShared, ptrRecord.getData()}};
+
+            for (const auto& record : records)
+            {
+                DNSRecordRef recordRef {nullptr};
+                const auto errorCode {connection->getBackend().registerRecord (connection->getRef(),
+                                                                               &recordRef,
+                                                                               record.flags,
+                                                                               0,
+                                                                               record.name.toRawUTF8(),
+                                                                               record.type,
+                                                                               kDNSServiceClass_IN,
+                                                                               (uint16_t) record.data.size(),
+                                                                               record.data.data(),
+                                                                               0,
+                                                                               &recordReply,
+                                                                               &instance)};
+
+                if (errorCode != kDNSServiceErr_NoError)
+                {
+                    removeRecords (instance, nullptr);
+                    return errorCode;
+                }
+
+                instance.records.push_back (recordRef);
+            }
+
+            instance.numRecordsPending = (int) instance.records.size();
+            return kDNSServiceErr_NoError;
+        }
+
+        DNSServiceErrorType registerService (InstanceState& instance, int port)
+        {
+            const auto& data {*instance.service.data};
+
+            DNSServiceRef ref {nullptr};
+            DNSServiceFlags flags {0};
+            connection->share (ref, flags);
+
+            const auto errorCode {connection->getBackend().registerService (&ref,
+                                                                            flags,
+                                                                            0,
+                                                                            data.name.isEmpty() ? nullptr : data.name.toUTF8(),
+                                                                            data.type.toUTF8(),
+                                                                            data.domain.isEmpty() ? nullptr : data.domain.toUTF8(),
+                                                                            hostName.isEmpty() ? nullptr : hostName.toUTF8(),
+                                                                            (uint16_t) port,
+                                                                            data.txtRecord.getLength(),
+                                                                            data.txtRecord.getBytes(),
+                                                                            &registerReply,
+                                                                            &instance)};
+
+            if (errorCode == kDNSServiceErr_NoError)
+                instance.ref = ref;
+
+            return errorCode;
+        }
+
+        // Removes the instance's records, other than one that's already gone
+        void removeRecords (InstanceState& instance, DNSRecordRef recordThatFailed)
+        {
+            for (auto* record : std::exchange (instance.records, {}))
+                if (record != recordThatFailed)
+                    connection->getBackend().removeRecord (connection->getRef(), record, 0);
+
+            instance.numRecordsPending = 0;
+        }
+
+        static void recordReply (DNSServiceRef sdRef,
+                                 DNSRecordRef recordRef,
+                                 DNSServiceFlags flags,
+                                 DNSServiceErrorType errorCode,
+                                 void* context)
+        {
+            juce::ignoreUnused (sdRef, flags);
+
+            auto& instance {*static_cast<InstanceState*> (context)};
+
+            if (errorCode != kDNSServiceErr_NoError)
+            {
+                instance.owner->removeRecords (instance, recordRef);
+                instance.owner->finish (instance, bonjourResult (errorCode));
+                return;
+            }
+
+            if (instance.numRecordsPending > 0 && --instance.numRecordsPending == 0)
+                instance.owner->finish (instance, juce::Result::ok());
+        }
+
+        static void registerReply (DNSServiceRef sdRef,
+                                   DNSServiceFlags flags,
+                                   DNSServiceErrorType errorCode,
+                                   const char* name,
+                                   const char* regtype,
+                                   const char* domain,
+                                   void* context)
+        {
+            juce::ignoreUnused (sdRef, flags);
+
+            auto& instance {*static_cast<InstanceState*> (context)};
+
+            if (errorCode != kDNSServiceErr_NoError)
+            {
+                instance.owner->finish (instance, bonjourResult (errorCode));
+                return;
+            }
+
+            if (instance.isRegistered)
+                return;
+
+            // The daemon may well have renamed the instance
+            auto& registeredData {instance.service.getWritableData()};
+            registeredData.name = name;
+            registeredData.type = regtype;
+            registeredData.domain = domain;
+
+            instance.owner->finish (instance, juce::Result::ok());
+        }
+
+        void finish (InstanceState& instance, const juce::Result& result)
+        {
+            instance.isRegistered = result.wasOk();
+
+            if (result.failed() && instance.isActive)
+            {
+                instance.isActive = false;
+                BonjourMetricsRecorder::getInstance().operationStopped (jucey::BonjourMetrics::OperationKind::registration);
+
+                if (instance.ref != nullptr)
+                    eventLoop->deallocateSharedRef (std::exchange (instance.ref, nullptr), connection->getBackend());
+            }
+
+            auto& request {*instance.request};
+
+            if (request.results.empty())
+                requestsWithResults.push_back (instance.request);
+
+            request.results.push_back ({instance.index, instance.service, result});
+
+            // Results that arrive close together are passed on as one batch
+            if (resultsTimerId == 0)
+            {
+                resultsTimerId = eventLoop->callAfterDelay (resultsDelayMs, [this]
+                {
+                    resultsTimerId = 0;
+                    flushResults();
+                });
+            }
+        }
+
+        void flushResults()
+        {
+            for (const auto& request : std::exchange (requestsWithResults, {}))
+            {
+                auto callback = [callback = request->callback, results = std::exchange (request->results, {})]
+                {
+                    if (callback != nullptr)
+                        callback (results);
+                };
+
+                auto timedCallback {BonjourMetricsRecorder::timeCallback (std::move (callback))};
+
+                if (callbackDispatcher == nullptr)
+                    timedCallback();
+                else
+                    callbackDispatcher (std::move (timedCallback));
+            }
+        }
+
+        static constexpr int resultsDelayMs {20};
+
+        juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const juce::String type;
+        const juce::String domain;
+        juce::String hostName {};
+        BonjourService::CallbackDispatcher callbackDispatcher {nullptr};
+        BonjourConnection::Ptr connection {nullptr};
+        bool canRegisterRecords {true};
+
+        std::vector<std::unique_ptr<InstanceState>> instances;
+        std::vector<std::shared_ptr<Request>> requestsWithResults;
+        BonjourEventLoop::TimerId resultsTimerId {0};
+    };
+
+    BonjourBulkRegistration::BonjourBulkRegistration (const juce::String& type, const juce::String& domain)
+        : pimpl {std::make_unique<Pimpl> (type, domain)}
+    {
+
+    }
+
+    BonjourBulkRegistration::~BonjourBulkRegistration()
+    {
+
+    }
+
+    void BonjourBulkRegistration::setHostName (const juce::String& hostName)
+    {
+        pimpl->setHostName (hostName);
+    }
+
+    void BonjourBulkRegistration::setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher)
+    {
+        pimpl->setCallbackDispatcher (std::move (dispatcher));
+    }
+
+    juce::Result BonjourBulkRegistration::registerAll (const std::vector<Instance>& instances, ResultsCallback callback)
+    {
+        return pimpl->registerAll (instances, std::move (callback));
+    }
+
+    void BonjourBulkRegistration::withdrawAll()
+    {
+        pimpl->withdrawAll();
+    }
+
+    int BonjourBulkRegistration::getNumRegistered() const
+    {
+        return pimpl->getNumRegistered();
+    }
+
+    int BonjourBulkRegistration::getNumPending() const
+    {
+        return pimpl->getNumPending();
+    }
+
+    bool BonjourBulkRegistration::isRegisteringRecords() const
+    {
+        return pimpl->isRegisteringRecords();
+    }
+}
+
+#include "jucey_BonjourBulkRegistrationTests.cpp"
@@ -0,0 +1,69 @@
+#pragma once
+
+namespace jucey
+{
+    // Registers many instances of one service type over a single connection
+    // to the daemon. When a host name has been set each instance is
+    // registered as its own PTR, SRV and TXT records with
+    // DNSServiceRegisterRecord, otherwise, or if the backend can't register
+    // records, each one is registered as a service sharing the connection.
+    // Results arrive in batches rather than one callback per instance, and
+    // everything that's been registered is withdrawn in a single call.
+    class BonjourBulkRegistration
+    {
+    public:
+        struct Instance
+        {
+            juce::String name {};
+            int port {0};
+            BonjourService::TxtRecordBuilder txtRecord {};
+        };
+
+        // The index is of the instance in the vector passed to registerAll().
+        // An instance that's lost after it was registered, to a name conflict
+        // say, is reported again with a failed result.
+        struct InstanceResult
+        {
+            int index {0};
+            BonjourService service;
+            juce::Result result {juce::Result::ok()};
+        };
+
+        using ResultsCallback = std::function<void(const std::vector<InstanceResult>& results)>;
+
+        explicit BonjourBulkRegistration (const juce::String& type, const juce::String& domain = {});
+
+        // Withdraws everything that's been registered
+        ~BonjourBulkRegistration();
+
+        // Instances registered after this point to the given host rather than
+        // this machine, this is needed to register records
+        void setHostName (const juce::String& hostName);
+
+        // Results are passed to the callback through the dispatcher, and the
+        // services in the results are given it too
+        void setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher);
+
+        // Only fails if the connection to the daemon couldn't be made, any
+        // problem with an individual instance is reported in its result. Can
+        // be called again to register more instances on the same connection.
+        juce::Result registerAll (const std::vector<Instance>& instances, ResultsCallback callback);
+
+        // Withdraws every instance at once by closing the connection, no more
+        // results are reported for any of them
+        void withdrawAll();
+
+        int getNumRegistered() const;
+        int getNumPending() const;
+
+        // False once the backend has turned down registering records, from
+        // then on every instance is registered as a service
+        bool isRegisteringRecords() const;
+
+    private:
+        class Pimpl;
+        std::unique_ptr<Pimpl> pimpl;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourBulkRegistration)
+    };
+}
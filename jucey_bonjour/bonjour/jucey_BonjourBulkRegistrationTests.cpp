@@ -0,0 +1,220 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourBulkRegistrationTests : private juce::UnitTest
+{
+public:
+    BonjourBulkRegistrationTests()
+        : juce::UnitTest ("BonjourBulkRegistration", "Networking")
+    {
+
+    }
+
+    ~BonjourBulkRegistrationTests()
+    {
+
+    }
+
+private:
+    using Instance = jucey::BonjourBulkRegistration::Instance;
+    using InstanceResult = jucey::BonjourBulkRegistration::InstanceResult;
+
+    // Collects the results of a registration until the expected number of
+    // them have arrived
+    struct Results
+    {
+        explicit Results (size_t numResultsToWaitFor)
+            : numExpected {numResultsToWaitFor}
+        {
+
+        }
+
+        jucey::BonjourBulkRegistration::ResultsCallback getCallback()
+        {
+            return [this](const std::vector<InstanceResult>& batch)
+            {
+                const juce::ScopedLock lock {resultsLock};
+                results.insert (results.end(), batch.begin(), batch.end());
+                ++numBatches;
+
+                if (results.size() >= numExpected)
+                    finished.signal();
+            };
+        }
+
+        bool wait() const
+        {
+            return finished.wait (5000);
+        }
+
+        const InstanceResult* find (int index) const
+        {
+            const juce::ScopedLock lock {resultsLock};
+
+            for (const auto& result : results)
+                if (result.index == index)
+                    return &result;
+
+            return nullptr;
+        }
+
+        const size_t numExpected;
+        juce::CriticalSection resultsLock;
+        std::vector<InstanceResult> results;
+        int numBatches {0};
+        juce::WaitableEvent finished;
+    };
+
+    static std::vector<Instance> createInstances (int numInstances)
+    {
+        std::vector<Instance> instances;
+
+        for (auto index {0}; index < numInstances; ++index)
+        {
+            Instance instance {"JUCEY Bulk Test Service " + juce::String (index), 20000 + index};
+            instance.txtRecord.add ("index", juce::String (index).toStdString());
+            instances.push_back (std::move (instance));
+        }
+
+        return instances;
+    }
+
+    void runRecordTests()
+    {
+        beginTest ("Records");
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourBulkRegistration registration {"_test._udp", "local"};
+        registration.setHostName ("jucey-bulk-test.local.");
+        expect (registration.isRegisteringRecords());
+
+        Results results {3};
+        expect (registration.registerAll (createInstances (3), results.getCallback()));
+        expect (results.wait());
+
+        expect (registration.isRegisteringRecords());
+        expect (registration.getNumRegistered() == 3);
+        expect (registration.getNumPending() == 0);
+        expect (responder.getNumRegisteredServices() == 3);
+
+        for (auto index {0}; index < 3; ++index)
+        {
+            const auto* result {results.find (index)};
+            expect (result != nullptr && result->result.wasOk());
+            expect (result != nullptr && result->service.getName() == "JUCEY Bulk Test Service " + juce::String (index));
+        }
+
+        // the records describe the service exactly as if it had been
+        // registered as one
+        auto resolveFuture {jucey::BonjourService {"_test._udp", "JUCEY Bulk Test Service 1", "local"}.resolveTask().getFuture()};
+        expect (resolveFuture.wait_for (std::chrono::seconds (5)) == std::future_status::ready);
+
+        const auto resolved {resolveFuture.get()};
+        expect (resolved.result.wasOk());
+        expect (resolved.hostName == "jucey-bulk-test.local.");
+        expect (resolved.port == 20001);
+        expect (resolved.service.getRecordItemValue ("index") == "1");
+
+        registration.withdrawAll();
+        expect (registration.getNumRegistered() == 0);
+        expect (responder.getNumRegisteredServices() == 0);
+    }
+
+    void runServiceTests()
+    {
+        beginTest ("Services");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            // without a host name every instance is registered as a service
+            jucey::BonjourBulkRegistration registration {"_test._udp"};
+            expect ( ! registration.isRegisteringRecords());
+
+            Results results {2};
+            expect (registration.registerAll (createInstances (2), results.getCallback()));
+            expect (results.wait());
+
+            expect (registration.getNumRegistered() == 2);
+            expect (responder.getNumRegisteredServices() == 2);
+
+            for (auto index {0}; index < 2; ++index)
+            {
+                const auto* result {results.find (index)};
+                expect (result != nullptr && result->result.wasOk());
+            }
+        }
+
+        // destroying the registration withdraws everything
+        expect (responder.getNumRegisteredServices() == 0);
+        expect (responder.getNumActiveOperations() == 0);
+    }
+
+    void runNameConflictTests()
+    {
+        beginTest ("Name conflicts");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        jucey::BonjourService takenService {"_test._udp", "JUCEY Bulk Test Service 0", "local"};
+        juce::WaitableEvent takenServiceRegistered;
+        expect (takenService.registerAsync ([&](const jucey::BonjourService&, const juce::Result&) { takenServiceRegistered.signal(); }, 12345));
+        expect (takenServiceRegistered.wait (5000));
+
+        jucey::BonjourBulkRegistration registration {"_test._udp", "local"};
+        registration.setHostName ("jucey-bulk-test.local.");
+
+        // records aren't renamed, so the instance with the taken name fails
+        // and none of its records are left behind
+        Results results {2};
+        expect (registration.registerAll (createInstances (2), results.getCallback()));
+        expect (results.wait());
+
+        const auto* conflict {results.find (0)};
+        expect (conflict != nullptr && conflict->result.getErrorMessage() == "bonjour error: Name conflict");
+
+        const auto* registered {results.find (1)};
+        expect (registered != nullptr && registered->result.wasOk());
+
+        expect (registration.getNumRegistered() == 1);
+        expect (registration.getNumPending() == 0);
+        expect (responder.getNumRegisteredServices() == 2);
+    }
+
+    void runBatchTests()
+    {
+        beginTest ("Batches");
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourBulkRegistration registration {"_test._udp", "local"};
+        registration.setHostName ("jucey-bulk-test.local.");
+
+        const auto numInstances {20};
+        Results results {(size_t) numInstances};
+        expect (registration.registerAll (createInstances (numInstances), results.getCallback()));
+        expect (results.wait());
+
+        // instances that register together are reported together
+        const juce::ScopedLock lock {results.resultsLock};
+        expect (results.results.size() == (size_t) numInstances);
+        expect (results.numBatches < numInstances);
+
+        for (auto index {0}; index < numInstances; ++index)
+            expect (std::count_if (results.results.begin(), results.results.end(), [index](const InstanceResult& result) { return result.index == index; }) == 1);
+    }
+
+    void runTest() override
+    {
+        // Tasks release what they hold on the event loop thread, keeping the
+        // loop alive stops the last of them taking it down from its own thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runRecordTests();
+        runServiceTests();
+        runNameConflictTests();
+        runBatchTests();
+    }
+};
+
+static BonjourBulkRegistrationTests bonjourBulkRegistrationTests;
+
+#endif // JUCEY_UNIT_TESTS
@@ -0,0 +1,110 @@
+
+namespace jucey
+{
+    BonjourCallbackQueue::BonjourCallbackQueue (int capacity)
+        : fifo {capacity + 1}
+        , callbacks ((size_t) capacity + 1)
+    {
+        // The queue needs room for at least one callback!
+        jassert (capacity > 0);
+    }
+
+    BonjourCallbackQueue::~BonjourCallbackQueue()
+    {
+
+    }
+
+    BonjourService::CallbackDispatcher BonjourCallbackQueue::getDispatcher()
+    {
+        return [this](std::function<void()> callback)
+        {
+            push (std::move (callback));
+        };
+    }
+
+    void BonjourCallbackQueue::push (std::function<void()> callback)
+    {
+        // Once anything is waiting in the overflow list every callback has to
+        // go there too, until it's empty, to keep them in order
+        if (numWaitingInOverflow.load() == 0)
+        {
+            int startIndex1, blockSize1, startIndex2, blockSize2;
+            fifo.prepareToWrite (1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+            if (blockSize1 + blockSize2 > 0)
+            {
+                callbacks[(size_t) (blockSize1 > 0 ? startIndex1 : startIndex2)] = std::move (callback);
+                fifo.finishedWrite (1);
+                return;
+            }
+        }
+
+        const juce::SpinLock::ScopedLockType lock {overflowLock};
+        overflow.push_back (std::move (callback));
+        ++numWaitingInOverflow;
+        ++numOverflowed;
+    }
+
+    int BonjourCallbackQueue::drain (int maxNumCallbacks)
+    {
+        auto numCalled {0};
+
+        while (numCalled < maxNumCallbacks)
+        {
+            // This is checked before the FIFO, so if the FIFO is then empty
+            // anything in the overflow list was pushed after everything that
+            // had been in it
+            const auto isOverflowWaiting {numWaitingInOverflow.load() > 0};
+
+            int startIndex1, blockSize1, startIndex2, blockSize2;
+            fifo.prepareToRead (1, startIndex1, blockSize1, startIndex2, blockSize2);
+            std::function<void()> callback {nullptr};
+
+            if (blockSize1 + blockSize2 > 0)
+            {
+                // Move the callback out before releasing the slot so the
+                // producer can reuse it while the callback is running
+                auto& slot {callbacks[(size_t) (blockSize1 > 0 ? startIndex1 : startIndex2)]};
+                callback = std::move (slot);
+                slot = nullptr;
+                fifo.finishedRead (1);
+            }
+            else if (isOverflowWaiting)
+            {
+                callback = popOverflow();
+            }
+            else
+            {
+                break;
+            }
+
+            if (callback != nullptr)
+                callback();
+
+            ++numCalled;
+        }
+
+        return numCalled;
+    }
+
+    int BonjourCallbackQueue::getNumPending() const
+    {
+        return fifo.getNumReady() + numWaitingInOverflow.load();
+    }
+
+    int BonjourCallbackQueue::getNumOverflowed() const
+    {
+        return numOverflowed.load();
+    }
+
+    std::function<void()> BonjourCallbackQueue::popOverflow()
+    {
+        const juce::SpinLock::ScopedLockType lock {overflowLock};
+        auto callback {std::move (overflow.front())};
+        overflow.pop_front();
+        --numWaitingInOverflow;
+        return callback;
+    }
+}
+
+#include "jucey_BonjourCallbackQueueTests.cpp"
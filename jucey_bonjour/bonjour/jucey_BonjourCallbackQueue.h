@@ -0,0 +1,44 @@
+#pragma once
+
+namespace jucey
+{
+    // A single producer, single consumer queue of callbacks. Pass the
+    // dispatcher to `BonjourService::setCallbackDispatcher()` and call
+    // `drain()` from the thread the callbacks should be called on. The queue
+    // must outlive any services using its dispatcher.
+    //
+    // Callbacks go into a lock-free FIFO. If that fills up, rather than
+    // dropping them, callbacks wait in an overflow list behind a lock until
+    // the FIFO has been drained, so they're still called in order.
+    class BonjourCallbackQueue
+    {
+    public:
+        explicit BonjourCallbackQueue (int capacity = 1024);
+        ~BonjourCallbackQueue();
+
+        BonjourService::CallbackDispatcher getDispatcher();
+
+        void push (std::function<void()> callback);
+        int drain (int maxNumCallbacks = std::numeric_limits<int>::max());
+
+        int getNumPending() const;
+
+        // The number of callbacks that have had to wait in the overflow list,
+        // if this keeps growing either drain the queue more often or give it
+        // a larger capacity
+        int getNumOverflowed() const;
+
+    private:
+        std::function<void()> popOverflow();
+
+        juce::AbstractFifo fifo;
+        std::vector<std::function<void()>> callbacks;
+
+        juce::SpinLock overflowLock;
+        std::deque<std::function<void()>> overflow;
+        std::atomic<int> numWaitingInOverflow {0};
+        std::atomic<int> numOverflowed {0};
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourCallbackQueue)
+    };
+}
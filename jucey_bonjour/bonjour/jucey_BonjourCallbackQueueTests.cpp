@@ -0,0 +1,116 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourCallbackQueueTests : private juce::UnitTest
+{
+public:
+    BonjourCallbackQueueTests()
+        : juce::UnitTest ("BonjourCallbackQueue", "Networking")
+    {
+
+    }
+
+    ~BonjourCallbackQueueTests()
+    {
+
+    }
+
+private:
+    void runOrderingTests()
+    {
+        beginTest ("Ordering");
+
+        jucey::BonjourCallbackQueue queue {8};
+        std::vector<int> calledValues;
+
+        for (auto value {0}; value < 5; ++value)
+            queue.push ([&calledValues, value] { calledValues.push_back (value); });
+
+        expect (queue.getNumPending() == 5);
+        expect (calledValues.empty());
+
+        expect (queue.drain (2) == 2);
+        expect (calledValues == std::vector<int> {0, 1});
+
+        expect (queue.drain() == 3);
+        expect (calledValues == std::vector<int> {0, 1, 2, 3, 4});
+        expect (queue.getNumPending() == 0);
+    }
+
+    void runCapacityTests()
+    {
+        beginTest ("Capacity");
+
+        jucey::BonjourCallbackQueue queue {2};
+        std::vector<int> calledValues;
+
+        queue.push ([&calledValues] { calledValues.push_back (0); });
+        queue.push ([&calledValues] { calledValues.push_back (1); });
+        expect (queue.getNumPending() == 2);
+        expect (queue.getNumOverflowed() == 0);
+
+        // callbacks that don't fit wait in the overflow list rather than
+        // being dropped, and anything after them waits too
+        queue.push ([&calledValues] { calledValues.push_back (2); });
+        queue.push ([&calledValues] { calledValues.push_back (3); });
+        expect (queue.getNumPending() == 4);
+        expect (queue.getNumOverflowed() == 2);
+
+        expect (queue.drain (3) == 3);
+        queue.push ([&calledValues] { calledValues.push_back (4); });
+        expect (queue.getNumOverflowed() == 3);
+
+        expect (queue.drain() == 2);
+        expect (calledValues == std::vector<int> {0, 1, 2, 3, 4});
+
+        // once drained the slots should be reusable
+        queue.push ([&calledValues] { calledValues.push_back (5); });
+        expect (queue.getNumOverflowed() == 3);
+        expect (queue.drain() == 1);
+        expect (calledValues.size() == 6);
+    }
+
+    void runDispatcherTests()
+    {
+        beginTest ("Dispatcher");
+
+        // a small queue so the producer often has to overflow
+        jucey::BonjourCallbackQueue queue {8};
+        const auto dispatcher {queue.getDispatcher()};
+        std::atomic<int> numCalls {0};
+        std::atomic<int> numOutOfOrder {0};
+
+        std::thread producer {[&]
+        {
+            for (auto index {0}; index < 500; ++index)
+            {
+                dispatcher ([&numCalls, &numOutOfOrder, index]
+                {
+                    if (numCalls++ != index)
+                        ++numOutOfOrder;
+                });
+            }
+        }};
+
+        auto numDrained {0};
+
+        while (numDrained < 500)
+            numDrained += queue.drain();
+
+        producer.join();
+
+        expect (numCalls == 500);
+        expect (numOutOfOrder == 0);
+        expect (queue.getNumPending() == 0);
+    }
+
+    void runTest() override
+    {
+        runOrderingTests();
+        runCapacityTests();
+        runDispatcherTests();
+    }
+};
+
+static BonjourCallbackQueueTests bonjourCallbackQueueTests;
+
+#endif // JUCEY_UNIT_TESTS
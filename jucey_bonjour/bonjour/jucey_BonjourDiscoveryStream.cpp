@@ -0,0 +1,166 @@
+
+namespace jucey
+{
+    // All the state is guarded by the event loop lock and the browse callback
+    // is always called on the event loop thread
+    class BonjourDiscoveryStream::Pimpl
+    {
+    public:
+        Pimpl()
+        {
+
+        }
+
+        ~Pimpl()
+        {
+            stop();
+        }
+
+        juce::Result start (const BonjourService& serviceToDiscover, int interfaceIndex)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            stop();
+
+            browser = serviceToDiscover;
+            callbackDispatcher = browser.getCallbackDispatcher();
+            browser.setCallbackDispatcher (nullptr);
+
+            const auto result {browser.discoverBatchAsync ([this](const std::vector<BonjourService::DiscoveryEvent>& events,
+                                                                  const juce::Result& discoverResult)
+                                                           {
+                                                               handleEvents (events, discoverResult);
+                                                           },
+                                                           interfaceIndex)};
+
+            isRunning = result.wasOk();
+
+            if ( ! isRunning)
+                browser = BonjourService{};
+
+            return result;
+        }
+
+        void stop()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            browser = BonjourService{};
+            isRunning = false;
+            queued.clear();
+
+            for (auto& waiter : std::exchange (waiters, {}))
+                waiter.state->fail (juce::Result::fail ("The discovery stream was stopped"));
+        }
+
+        BonjourTask<Batch> next (const BonjourTaskOptions& options)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            Waiter waiter {std::make_shared<BonjourTaskBase::State>(callbackDispatcher), nullptr};
+            waiter.value = waiter.state->createValue<Batch> ({});
+
+            if ( ! queued.empty())
+            {
+                waiter.finish (std::move (queued.front()));
+                queued.pop_front();
+            }
+            else if ( ! isRunning)
+            {
+                waiter.state->fail (juce::Result::fail ("The discovery stream isn't running"));
+            }
+            else
+            {
+                waiters.push_back (waiter);
+            }
+
+            waiter.state->start (options);
+            return {std::move (waiter.state), std::move (waiter.value)};
+        }
+
+        int getNumQueuedBatches() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            return (int) queued.size();
+        }
+
+    private:
+        struct Waiter
+        {
+            // Returns false if the task has already timed out or been
+            // cancelled
+            bool finish (Batch&& batch)
+            {
+                return state->finish ([this, &batch]
+                {
+                    *value = std::move (batch);
+                });
+            }
+
+            std::shared_ptr<BonjourTaskBase::State> state {nullptr};
+            std::shared_ptr<std::optional<Batch>> value {nullptr};
+        };
+
+        void handleEvents (const std::vector<BonjourService::DiscoveryEvent>& events,
+                           const juce::Result& result)
+        {
+            Batch batch {events, result};
+
+            // The discovered services call back the same way the service
+            // being discovered does
+            if (callbackDispatcher != nullptr)
+                for (auto& event : batch.events)
+                    event.service.setCallbackDispatcher (callbackDispatcher);
+
+            while ( ! waiters.empty())
+            {
+                auto waiter {std::move (waiters.front())};
+                waiters.pop_front();
+
+                if (waiter.finish (std::move (batch)))
+                    return;
+            }
+
+            queued.push_back (std::move (batch));
+        }
+
+        juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        BonjourService browser {};
+        BonjourService::CallbackDispatcher callbackDispatcher {nullptr};
+        bool isRunning {false};
+        std::deque<Batch> queued;
+        std::deque<Waiter> waiters;
+
+        JUCE_DECLARE_NON_COPYABLE (Pimpl)
+    };
+
+    BonjourDiscoveryStream::BonjourDiscoveryStream()
+        : pimpl {std::make_unique<Pimpl>()}
+    {
+
+    }
+
+    BonjourDiscoveryStream::~BonjourDiscoveryStream()
+    {
+
+    }
+
+    juce::Result BonjourDiscoveryStream::start (const BonjourService& serviceToDiscover, int interfaceIndex)
+    {
+        return pimpl->start (serviceToDiscover, interfaceIndex);
+    }
+
+    void BonjourDiscoveryStream::stop()
+    {
+        pimpl->stop();
+    }
+
+    BonjourTask<BonjourDiscoveryStream::Batch> BonjourDiscoveryStream::next (const BonjourTaskOptions& options)
+    {
+        return pimpl->next (options);
+    }
+
+    int BonjourDiscoveryStream::getNumQueuedBatches() const
+    {
+        return pimpl->getNumQueuedBatches();
+    }
+}
+
+#include "jucey_BonjourDiscoveryStreamTests.cpp"
@@ -0,0 +1,42 @@
+#pragma once
+
+namespace jucey
+{
+    // Discovers services as a stream of batches, each one everything added or
+    // removed in a burst of replies, that are waited for one at a time as
+    // tasks. Batches that arrive while nothing is waiting are queued in
+    // order, so none are lost between one task finishing and the next being
+    // asked for.
+    class BonjourDiscoveryStream
+    {
+    public:
+        struct Batch
+        {
+            std::vector<BonjourService::DiscoveryEvent> events {};
+            juce::Result result {juce::Result::ok()};
+        };
+
+        BonjourDiscoveryStream();
+        ~BonjourDiscoveryStream();
+
+        // Tasks resume through the callback dispatcher of the service being
+        // discovered, if it has one. Starting again stops the stream first.
+        juce::Result start (const BonjourService& serviceToDiscover, int interfaceIndex = 0);
+
+        // Drops any queued batches, and any tasks still waiting fail
+        void stop();
+
+        // Finishes with the oldest queued batch, or the next one to arrive.
+        // Fails straight away if the stream isn't running and nothing is
+        // queued.
+        BonjourTask<Batch> next (const BonjourTaskOptions& options = {});
+
+        int getNumQueuedBatches() const;
+
+    private:
+        class Pimpl;
+        std::unique_ptr<Pimpl> pimpl;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourDiscoveryStream)
+    };
+}
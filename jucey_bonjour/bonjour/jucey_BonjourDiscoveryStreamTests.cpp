@@ -0,0 +1,105 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourDiscoveryStreamTests : private juce::UnitTest
+{
+public:
+    BonjourDiscoveryStreamTests()
+        : juce::UnitTest ("BonjourDiscoveryStream", "Networking")
+    {
+
+    }
+
+    ~BonjourDiscoveryStreamTests()
+    {
+
+    }
+
+private:
+    using Batch = jucey::BonjourDiscoveryStream::Batch;
+
+    static bool isReady (const std::future<Batch>& future)
+    {
+        return future.wait_for (std::chrono::seconds (1)) == std::future_status::ready;
+    }
+
+    void runBatchTests()
+    {
+        beginTest ("Batches");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            jucey::BonjourDiscoveryStream stream;
+            expect (stream.start (jucey::BonjourService {"_test._udp"}));
+
+            // nothing has been registered yet so this waits
+            auto firstFuture {stream.next().getFuture()};
+            expect (firstFuture.wait_for (std::chrono::milliseconds (50)) == std::future_status::timeout);
+
+            auto serviceToRegister {std::make_unique<jucey::BonjourService> (jucey::BonjourService {"_test._udp", "JUCEY Stream Test Service", "local"})};
+            expect (serviceToRegister->registerAsync ([](const jucey::BonjourService&, const juce::Result&) {}, 12345));
+
+            expect (isReady (firstFuture));
+
+            const auto firstBatch {firstFuture.get()};
+            expect (firstBatch.result.wasOk());
+            expect (firstBatch.events.size() == 1);
+            expect (firstBatch.events.front().isAvailable);
+            expect (firstBatch.events.front().service.getName() == "JUCEY Stream Test Service");
+
+            // batches that arrive while nothing is waiting are queued
+            serviceToRegister.reset();
+
+            for (auto attempt {0}; stream.getNumQueuedBatches() == 0 && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+            expect (stream.getNumQueuedBatches() == 1);
+
+            auto secondTask {stream.next()};
+            expect (secondTask.isReady());
+            expect (stream.getNumQueuedBatches() == 0);
+
+            const auto secondBatch {secondTask.getFuture().get()};
+            expect (secondBatch.events.size() == 1);
+            expect ( ! secondBatch.events.front().isAvailable);
+        }
+    }
+
+    void runStopTests()
+    {
+        beginTest ("Stop");
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourDiscoveryStream stream;
+
+        // a stream that isn't running has nothing to wait for
+        auto notRunningFuture {stream.next().getFuture()};
+        expect (isReady (notRunningFuture));
+        expect (notRunningFuture.get().result.failed());
+
+        expect (stream.start (jucey::BonjourService {"_test._udp"}));
+
+        auto timedOutFuture {stream.next ({juce::RelativeTime::milliseconds (20)}).getFuture()};
+        expect (isReady (timedOutFuture));
+        expect (timedOutFuture.get().result.getErrorMessage() == "The operation timed out");
+
+        auto stoppedFuture {stream.next().getFuture()};
+        stream.stop();
+        expect (isReady (stoppedFuture));
+        expect (stoppedFuture.get().result.getErrorMessage() == "The discovery stream was stopped");
+    }
+
+    void runTest() override
+    {
+        // Tasks release what they hold on the event loop thread, keeping the
+        // loop alive stops the last of them taking it down from its own thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runBatchTests();
+        runStopTests();
+    }
+};
+
+static BonjourDiscoveryStreamTests bonjourDiscoveryStreamTests;
+
+#endif // JUCEY_UNIT_TESTS
@@ -0,0 +1,1049 @@
+
+// The DNS wire format, as used by multicast DNS. Received messages are read
+// in place, every name and record is a view into the receive buffer, and
+// messages are written straight into a fixed size buffer with names
+// compressed against those already written. Neither allocates, only copying
+// a view into one of the owning types below does.
+
+enum class BonjourDnsSection
+{
+    question,
+    answer,
+    authority,
+    additional
+};
+
+// A domain name held as its labels, so an instance name can contain dots.
+// The string form is the escaped one DNS-SD uses, where a dot or backslash
+// within a label is preceded by a backslash and any other byte can be written
+// as a three digit decimal escape.
+struct BonjourDnsName
+{
+    static constexpr size_t maxLabelLength {63};
+    static constexpr size_t maxLength {255};
+
+    // A name of maxLength bytes can't have more labels than this
+    static constexpr size_t maxLabels {128};
+
+    static BonjourDnsName fromString (const juce::String& name)
+    {
+        BonjourDnsName dnsName;
+        std::string label;
+        const auto* text {name.toRawUTF8()};
+
+        for (; *text != 0; ++text)
+        {
+            if (*text == '.')
+            {
+                if ( ! label.empty())
+                    dnsName.labels.push_back (std::move (label));
+
+                label.clear();
+            }
+            else if (*text == '\\' && text[1] != 0)
+            {
+                ++text;
+
+                if (isDigit (text[0]) && isDigit (text[1]) && isDigit (text[2]))
+                {
+                    label.push_back ((char) ((text[0] - '0') * 100 + (text[1] - '0') * 10 + (text[2] - '0')));
+                    text += 2;
+                }
+                else
+                {
+                    label.push_back (*text);
+                }
+            }
+            else
+            {
+                label.push_back (*text);
+            }
+        }
+
+        if ( ! label.empty())
+            dnsName.labels.push_back (std::move (label));
+
+        return dnsName;
+    }
+
+    // The instance name is taken as a single label, whatever it contains
+    static BonjourDnsName fromParts (const juce::String& instance,
+                                     const juce::String& type,
+                                     const juce::String& domain)
+    {
+        auto dnsName {fromString (type)};
+        dnsName.labels.insert (dnsName.labels.begin(), instance.toStdString());
+        dnsName.append (fromString (domain));
+        return dnsName;
+    }
+
+    // Labels are compared without regard to the case of any ASCII letters
+    static bool labelsMatch (std::string_view a, std::string_view b, bool ignoreCase = true)
+    {
+        if ( ! ignoreCase)
+            return a == b;
+
+        return a.size() == b.size()
+            && std::equal (a.begin(), a.end(), b.begin(), [](char x, char y)
+               {
+                   return toLowerCase (x) == toLowerCase (y);
+               });
+    }
+
+    // Hashes text so that anything labelsMatch() treats as the same gives the
+    // same hash
+    static size_t hashIgnoringCase (std::string_view text)
+    {
+        // FNV-1a over the lower case text
+        uint32_t hash {2166136261u};
+
+        for (const auto character : text)
+            hash = (hash ^ (uint8_t) toLowerCase (character)) * 16777619u;
+
+        return hash;
+    }
+
+    static void appendEscapedLabel (std::string& name, std::string_view label)
+    {
+        for (const auto character : label)
+        {
+            if (character == '.' || character == '\\')
+            {
+                name.push_back ('\\');
+                name.push_back (character);
+            }
+            else if ((uint8_t) character < 0x20 || character == 0x7f)
+            {
+                name.push_back ('\\');
+                name.push_back ((char) ('0' + (uint8_t) character / 100));
+                name.push_back ((char) ('0' + (uint8_t) character / 10 % 10));
+                name.push_back ((char) ('0' + (uint8_t) character % 10));
+            }
+            else
+            {
+                name.push_back (character);
+            }
+        }
+
+        name.push_back ('.');
+    }
+
+    juce::String toString() const
+    {
+        std::string name;
+
+        for (const auto& label : labels)
+            appendEscapedLabel (name, label);
+
+        return name.empty() ? juce::String {"."} : juce::String::fromUTF8 (name.data(), (int) name.size());
+    }
+
+    juce::String getLabel (size_t index) const
+    {
+        const auto& label {labels[index]};
+        return juce::String::fromUTF8 (label.data(), (int) label.size());
+    }
+
+    // The name without its first numLabels labels
+    BonjourDnsName withoutFirst (size_t numLabels) const
+    {
+        BonjourDnsName suffix;
+        suffix.labels.assign (labels.begin() + (std::ptrdiff_t) juce::jmin (numLabels, labels.size()), labels.end());
+        return suffix;
+    }
+
+    void append (const BonjourDnsName& other)
+    {
+        labels.insert (labels.end(), other.labels.begin(), other.labels.end());
+    }
+
+    bool isEmpty() const
+    {
+        return labels.empty();
+    }
+
+    bool operator== (const BonjourDnsName& other) const
+    {
+        return labels.size() == other.labels.size()
+            && std::equal (labels.begin(), labels.end(), other.labels.begin(), [](const std::string& a, const std::string& b)
+               {
+                   return labelsMatch (a, b);
+               });
+    }
+
+    bool operator!= (const BonjourDnsName& other) const
+    {
+        return ! operator== (other);
+    }
+
+    std::vector<std::string> labels;
+
+private:
+    static bool isDigit (char character)
+    {
+        return character >= '0' && character <= '9';
+    }
+
+    static char toLowerCase (char character)
+    {
+        return (character >= 'A' && character <= 'Z') ? (char) (character - 'A' + 'a') : character;
+    }
+};
+
+// A name within a message. The message has to outlive the view.
+class BonjourDnsNameView
+{
+public:
+    BonjourDnsNameView() = default;
+
+    BonjourDnsNameView (const uint8_t* messageData, size_t messageSize, size_t offset)
+        : message {messageData},
+          size {messageSize},
+          start {offset}
+    {
+
+    }
+
+    // Calls the function with each label until it returns false. Names are
+    // checked when a message is read, but compression pointers are still
+    // followed carefully as a view can be made of any offset.
+    template <typename Function>
+    void forEachLabel (Function&& function) const
+    {
+        auto offset {start};
+
+        for (size_t numLabels {0}; message != nullptr && offset < size && numLabels < BonjourDnsName::maxLabels;)
+        {
+            const auto length {message[offset]};
+
+            if (length == 0)
+                return;
+
+            if ((length & 0xc0) == 0xc0)
+            {
+                const auto target {offset + 1 < size ? (size_t) (((length & 0x3f) << 8) | message[offset + 1]) : size};
+
+                if (target >= offset)
+                    return;
+
+                offset = target;
+                continue;
+            }
+
+            if ((length & 0xc0) != 0 || offset + 1 + length > size)
+                return;
+
+            if ( ! function (std::string_view {reinterpret_cast<const char*> (message + offset + 1), length}))
+                return;
+
+            offset += 1 + (size_t) length;
+            ++numLabels;
+        }
+    }
+
+    size_t getNumLabels() const
+    {
+        size_t numLabels {0};
+
+        forEachLabel ([&numLabels](std::string_view)
+        {
+            ++numLabels;
+            return true;
+        });
+
+        return numLabels;
+    }
+
+    std::string_view getFirstLabel() const
+    {
+        std::string_view firstLabel;
+
+        forEachLabel ([&firstLabel](std::string_view label)
+        {
+            firstLabel = label;
+            return false;
+        });
+
+        return firstLabel;
+    }
+
+    // Compares the name with a sequence of labels, anything that can be
+    // viewed as a std::string_view
+    template <typename Label>
+    bool matches (const Label* labels, size_t numLabels, bool ignoreCase = true) const
+    {
+        size_t index {0};
+        auto isMatch {true};
+
+        forEachLabel ([&](std::string_view label)
+        {
+            isMatch = index < numLabels && BonjourDnsName::labelsMatch (label, labels[index++], ignoreCase);
+            return isMatch;
+        });
+
+        return isMatch && index == numLabels;
+    }
+
+    bool operator== (const BonjourDnsName& other) const
+    {
+        return matches (other.labels.data(), other.labels.size());
+    }
+
+    bool operator!= (const BonjourDnsName& other) const
+    {
+        return ! operator== (other);
+    }
+
+    bool operator== (const BonjourDnsNameView& other) const
+    {
+        std::array<std::string_view, BonjourDnsName::maxLabels> labels;
+        size_t numLabels {0};
+
+        other.forEachLabel ([&](std::string_view label)
+        {
+            labels[numLabels++] = label;
+            return true;
+        });
+
+        return matches (labels.data(), numLabels);
+    }
+
+    BonjourDnsName toName() const
+    {
+        BonjourDnsName name;
+
+        forEachLabel ([&name](std::string_view label)
+        {
+            name.labels.emplace_back (label);
+            return true;
+        });
+
+        return name;
+    }
+
+    juce::String toString() const
+    {
+        return toName().toString();
+    }
+
+private:
+    const uint8_t* message {nullptr};
+    size_t size {0};
+    size_t start {0};
+};
+
+struct BonjourDnsQuestion
+{
+    BonjourDnsName name;
+    uint16_t type {0};
+    bool wantsUnicastResponse {false};
+};
+
+struct BonjourDnsRecord
+{
+    enum Type : uint16_t
+    {
+        a = 1,
+        ptr = 12,
+        txt = 16,
+        aaaa = 28,
+        srv = 33,
+        any = 255
+    };
+
+    static bool hasNameInData (uint16_t type)
+    {
+        return type == ptr || type == srv;
+    }
+
+    // The record data without any name compression, this is what records are
+    // compared by when probes are tiebroken
+    std::vector<uint8_t> getData() const
+    {
+        std::vector<uint8_t> rdata;
+
+        if (type == srv)
+        {
+            for (const auto value : {priority, weight, port})
+            {
+                rdata.push_back ((uint8_t) (value >> 8));
+                rdata.push_back ((uint8_t) value);
+            }
+        }
+
+        if ( ! hasNameInData (type))
+        {
+            rdata.insert (rdata.end(), data.begin(), data.end());
+            return rdata;
+        }
+
+        for (const auto& label : target.labels)
+        {
+            rdata.push_back ((uint8_t) label.size());
+            rdata.insert (rdata.end(), label.begin(), label.end());
+        }
+
+        rdata.push_back (0);
+        return rdata;
+    }
+
+    // Is this the same record, regardless of its TTL
+    bool isSameRecord (const BonjourDnsRecord& other) const
+    {
+        return type == other.type && name == other.name && hasSameData (other);
+    }
+
+    bool hasSameData (const BonjourDnsRecord& other) const
+    {
+        if (hasNameInData (type))
+            return target == other.target && priority == other.priority && weight == other.weight && port == other.port;
+
+        return data == other.data;
+    }
+
+    BonjourDnsName name;
+    uint16_t type {0};
+    bool cacheFlush {false};
+    uint32_t ttl {0};
+
+    // PTR and SRV records
+    BonjourDnsName target;
+    uint16_t priority {0};
+    uint16_t weight {0};
+    uint16_t port {0};
+
+    // The data of any other type of record, such as TXT, A and AAAA
+    std::vector<uint8_t> data;
+};
+
+// A question or record within a message, questions only have a name and type
+struct BonjourDnsRecordView
+{
+    bool isSameRecord (const BonjourDnsRecord& other) const
+    {
+        return type == other.type && name == other.name && hasSameData (other);
+    }
+
+    bool hasSameData (const BonjourDnsRecord& other) const
+    {
+        if (BonjourDnsRecord::hasNameInData (type))
+            return target == other.target && priority == other.priority && weight == other.weight && port == other.port;
+
+        return dataSize == other.data.size() && std::equal (data, data + dataSize, other.data.begin());
+    }
+
+    BonjourDnsRecord toRecord() const
+    {
+        BonjourDnsRecord record;
+        record.name = name.toName();
+        record.type = type;
+        record.cacheFlush = cacheFlush;
+        record.ttl = ttl;
+
+        if (BonjourDnsRecord::hasNameInData (type))
+        {
+            record.target = target.toName();
+            record.priority = priority;
+            record.weight = weight;
+            record.port = port;
+        }
+        else
+        {
+            record.data.assign (data, data + dataSize);
+        }
+
+        return record;
+    }
+
+    BonjourDnsQuestion toQuestion() const
+    {
+        return {name.toName(), type, wantsUnicastResponse};
+    }
+
+    BonjourDnsSection section {BonjourDnsSection::question};
+    BonjourDnsNameView name;
+    uint16_t type {0};
+
+    // Questions use the top bit of the class to ask for a unicast response,
+    // records use it to say they replace any others with the same name
+    bool wantsUnicastResponse {false};
+    bool cacheFlush {false};
+
+    uint32_t ttl {0};
+
+    // The data of records other than PTR and SRV records
+    const uint8_t* data {nullptr};
+    uint16_t dataSize {0};
+
+    BonjourDnsNameView target;
+    uint16_t priority {0};
+    uint16_t weight {0};
+    uint16_t port {0};
+};
+
+// Reads each question and record of a message in turn. Every length is
+// checked against the buffer and compression pointers must point backwards,
+// so any packet off the network is safe to read.
+class BonjourDnsReader
+{
+public:
+    static constexpr size_t headerSize {12};
+
+    BonjourDnsReader (const uint8_t* messageData, size_t messageSize)
+        : data {messageData},
+          size {messageSize}
+    {
+        id = read16();
+        flags = read16();
+
+        for (auto& count : counts)
+            count = read16();
+    }
+
+    // Reads every entry, so a message can be checked before any of it is
+    // acted on
+    static bool isValid (const uint8_t* data, size_t size)
+    {
+        BonjourDnsReader reader {data, size};
+        BonjourDnsRecordView entry;
+
+        while (reader.readNext (entry)) {}
+
+        return ! reader.hasError();
+    }
+
+    uint16_t getId() const
+    {
+        return id;
+    }
+
+    uint16_t getFlags() const
+    {
+        return flags;
+    }
+
+    bool isResponse() const
+    {
+        return (flags & 0x8000) != 0;
+    }
+
+    uint16_t getCount (BonjourDnsSection section) const
+    {
+        return counts[(size_t) section];
+    }
+
+    bool hasError() const
+    {
+        return hasFailed;
+    }
+
+    // Returns false once every entry has been read, or as soon as anything is
+    // found to be malformed
+    bool readNext (BonjourDnsRecordView& entry)
+    {
+        while (sectionIndex < counts.size() && numReadInSection == counts[sectionIndex])
+        {
+            ++sectionIndex;
+            numReadInSection = 0;
+        }
+
+        if (hasFailed || sectionIndex == counts.size())
+            return false;
+
+        entry = {};
+        entry.section = (BonjourDnsSection) sectionIndex;
+        entry.name = readName();
+        entry.type = read16();
+
+        const auto hasTopClassBit {(read16() & 0x8000) != 0};
+
+        if (entry.section == BonjourDnsSection::question)
+        {
+            entry.wantsUnicastResponse = hasTopClassBit;
+        }
+        else
+        {
+            entry.cacheFlush = hasTopClassBit;
+            entry.ttl = read32();
+            readRecordData (entry);
+        }
+
+        ++numReadInSection;
+        return ! hasFailed;
+    }
+
+private:
+    uint8_t read8()
+    {
+        if (position >= size)
+        {
+            hasFailed = true;
+            return 0;
+        }
+
+        return data[position++];
+    }
+
+    uint16_t read16()
+    {
+        const auto high {read8()};
+        return (uint16_t) ((high << 8) | read8());
+    }
+
+    uint32_t read32()
+    {
+        const auto high {read16()};
+        return ((uint32_t) high << 16) | read16();
+    }
+
+    // Checks the name and moves past it
+    BonjourDnsNameView readName()
+    {
+        const BonjourDnsNameView name {data, size, position};
+        auto offset {position};
+        size_t length {1};
+        auto hasJumped {false};
+
+        while ( ! hasFailed)
+        {
+            const auto labelLength {offset < size ? data[offset] : 0xff};
+
+            if (offset >= size || ((labelLength & 0xc0) != 0 && (labelLength & 0xc0) != 0xc0))
+            {
+                hasFailed = true;
+                break;
+            }
+
+            if (labelLength == 0)
+            {
+                if ( ! hasJumped)
+                    position = offset + 1;
+
+                break;
+            }
+
+            if ((labelLength & 0xc0) == 0xc0)
+            {
+                // Only pointing backwards guarantees the name ends
+                const auto target {offset + 1 < size ? (size_t) (((labelLength & 0x3f) << 8) | data[offset + 1]) : size};
+
+                if (target >= offset)
+                {
+                    hasFailed = true;
+                    break;
+                }
+
+                if ( ! hasJumped)
+                    position = offset + 2;
+
+                hasJumped = true;
+                offset = target;
+                continue;
+            }
+
+            length += 1 + (size_t) labelLength;
+
+            if (offset + 1 + labelLength > size || length > BonjourDnsName::maxLength)
+            {
+                hasFailed = true;
+                break;
+            }
+
+            offset += 1 + (size_t) labelLength;
+        }
+
+        return name;
+    }
+
+    void readRecordData (BonjourDnsRecordView& entry)
+    {
+        const auto length {read16()};
+
+        if (hasFailed || position + length > size)
+        {
+            hasFailed = true;
+            return;
+        }
+
+        const auto end {position + length};
+
+        if (BonjourDnsRecord::hasNameInData (entry.type))
+        {
+            if (entry.type == BonjourDnsRecord::srv)
+            {
+                entry.priority = read16();
+                entry.weight = read16();
+                entry.port = read16();
+            }
+
+            entry.target = readName();
+
+            if (position != end)
+                hasFailed = true;
+        }
+        else
+        {
+            entry.data = data + position;
+            entry.dataSize = length;
+        }
+
+        position = end;
+    }
+
+    const uint8_t* data {nullptr};
+    size_t size {0};
+    size_t position {0};
+    bool hasFailed {false};
+
+    uint16_t id {0};
+    uint16_t flags {0};
+    std::array<uint16_t, 4> counts {};
+    size_t sectionIndex {0};
+    uint16_t numReadInSection {0};
+};
+
+// Writes a message into a buffer the caller owns. Entries have to be added in
+// section order. An entry that doesn't fit isn't written, and nothing else is
+// written after it, so whatever has been written is always a whole message.
+class BonjourDnsWriter
+{
+public:
+    BonjourDnsWriter (uint8_t* buffer, size_t bufferSize, uint16_t id, uint16_t flags)
+        : data {buffer},
+          capacity {bufferSize}
+    {
+        write16 (id);
+        write16 (flags);
+
+        for (auto index {0}; index < 4; ++index)
+            write16 (0);
+    }
+
+    template <typename Name>
+    bool addQuestion (const Name& name, uint16_t type, bool wantsUnicastResponse)
+    {
+        return addEntry (BonjourDnsSection::question, [&]
+        {
+            writeName (name);
+            write16 (type);
+            write16 ((uint16_t) (classIn | (wantsUnicastResponse ? 0x8000 : 0)));
+        });
+    }
+
+    bool addQuestion (const BonjourDnsQuestion& question)
+    {
+        return addQuestion (question.name, question.type, question.wantsUnicastResponse);
+    }
+
+    bool addRecord (BonjourDnsSection section, const BonjourDnsRecord& record)
+    {
+        // Questions don't have any data!
+        jassert (section != BonjourDnsSection::question);
+
+        return addEntry (section, [&]
+        {
+            writeName (record.name);
+            write16 (record.type);
+            write16 ((uint16_t) (classIn | (record.cacheFlush ? 0x8000 : 0)));
+            write32 (record.ttl);
+
+            const auto lengthPosition {position};
+            write16 (0);
+
+            if (record.type == BonjourDnsRecord::srv)
+            {
+                write16 (record.priority);
+                write16 (record.weight);
+                write16 (record.port);
+            }
+
+            if (BonjourDnsRecord::hasNameInData (record.type))
+                writeName (record.target);
+            else
+                writeBytes (record.data.data(), record.data.size());
+
+            const auto length {position - lengthPosition - 2};
+
+            if (length > std::numeric_limits<uint16_t>::max())
+                hasFailed = true;
+
+            if ( ! hasFailed)
+                patch16 (lengthPosition, (uint16_t) length);
+        });
+    }
+
+    size_t getSize() const
+    {
+        return position;
+    }
+
+    bool hasOverflowed() const
+    {
+        return hasFailed;
+    }
+
+private:
+    static constexpr uint16_t classIn {1};
+
+    // Only names that start within the first 16K can be pointed to
+    static constexpr size_t maxPointerOffset {0x3fff};
+
+    template <typename Write>
+    bool addEntry (BonjourDnsSection section, Write&& write)
+    {
+        // Questions and records have to be added in section order!
+        jassert (section >= currentSection);
+        currentSection = section;
+
+        if (hasFailed)
+            return false;
+
+        const auto entryPosition {position};
+        const auto entryNumNameOffsets {numNameOffsets};
+
+        write();
+
+        if (hasFailed)
+        {
+            position = entryPosition;
+            numNameOffsets = entryNumNameOffsets;
+            return false;
+        }
+
+        const auto countPosition {4 + 2 * (size_t) section};
+        patch16 (countPosition, (uint16_t) (((data[countPosition] << 8) | data[countPosition + 1]) + 1));
+        return true;
+    }
+
+    void write8 (uint8_t value)
+    {
+        if (position >= capacity)
+        {
+            hasFailed = true;
+            return;
+        }
+
+        data[position++] = value;
+    }
+
+    void write16 (uint16_t value)
+    {
+        write8 ((uint8_t) (value >> 8));
+        write8 ((uint8_t) value);
+    }
+
+    void write32 (uint32_t value)
+    {
+        write16 ((uint16_t) (value >> 16));
+        write16 ((uint16_t) value);
+    }
+
+    void writeBytes (const void* bytes, size_t numBytes)
+    {
+        // An empty record or label may have no data at all, and memcpy
+        // mustn't be given a null pointer even to copy nothing
+        if (numBytes == 0)
+            return;
+
+        if (position + numBytes > capacity)
+        {
+            hasFailed = true;
+            return;
+        }
+
+        std::memcpy (data + position, bytes, numBytes);
+        position += numBytes;
+    }
+
+    void patch16 (size_t offset, uint16_t value)
+    {
+        data[offset] = (uint8_t) (value >> 8);
+        data[offset + 1] = (uint8_t) value;
+    }
+
+    static size_t getLabels (const BonjourDnsName& name, std::array<std::string_view, BonjourDnsName::maxLabels>& labels)
+    {
+        const auto numLabels {juce::jmin (name.labels.size(), labels.size())};
+        std::copy (name.labels.begin(), name.labels.begin() + (std::ptrdiff_t) numLabels, labels.begin());
+        return numLabels;
+    }
+
+    static size_t getLabels (const BonjourDnsNameView& name, std::array<std::string_view, BonjourDnsName::maxLabels>& labels)
+    {
+        size_t numLabels {0};
+
+        name.forEachLabel ([&](std::string_view label)
+        {
+            labels[numLabels++] = label;
+            return true;
+        });
+
+        return numLabels;
+    }
+
+    // Writes as many labels as needed before pointing to a name already
+    // written that ends the same way. Names are matched exactly, rather than
+    // ignoring case, so every name reads back exactly as it was written.
+    template <typename Name>
+    void writeName (const Name& name)
+    {
+        std::array<std::string_view, BonjourDnsName::maxLabels> labels;
+        const auto numLabels {getLabels (name, labels)};
+
+        // Only names that have been finished can be pointed to
+        const auto numFinishedNameOffsets {numNameOffsets};
+
+        for (size_t index {0}; index < numLabels; ++index)
+        {
+            const auto& label {labels[index]};
+
+            for (size_t offsetIndex {0}; offsetIndex < numFinishedNameOffsets; ++offsetIndex)
+            {
+                const BonjourDnsNameView written {data, position, nameOffsets[offsetIndex]};
+
+                if (written.matches (labels.data() + index, numLabels - index, false))
+                {
+                    write16 ((uint16_t) (0xc000 | nameOffsets[offsetIndex]));
+                    return;
+                }
+            }
+
+            // Labels are limited to 63 bytes!
+            jassert (label.size() <= BonjourDnsName::maxLabelLength);
+
+            if (position <= maxPointerOffset && numNameOffsets < nameOffsets.size())
+                nameOffsets[numNameOffsets++] = (uint16_t) position;
+
+            write8 ((uint8_t) juce::jmin (label.size(), BonjourDnsName::maxLabelLength));
+            writeBytes (label.data(), juce::jmin (label.size(), BonjourDnsName::maxLabelLength));
+        }
+
+        write8 (0);
+    }
+
+    uint8_t* data {nullptr};
+    size_t capacity {0};
+    size_t position {0};
+    bool hasFailed {false};
+    BonjourDnsSection currentSection {BonjourDnsSection::question};
+
+    std::array<uint16_t, 128> nameOffsets {};
+    size_t numNameOffsets {0};
+};
+
+// TXT record data, a sequence of strings each prefixed with its length
+struct BonjourDnsTxtData
+{
+    static constexpr size_t maxStringLength {255};
+
+    // Calls the function with the offset and contents of each string,
+    // stopping at any string that would overrun the data
+    template <typename Function>
+    static void forEachString (const uint8_t* data, size_t size, Function&& function)
+    {
+        for (size_t offset {0}; offset < size;)
+        {
+            const auto length {(size_t) data[offset]};
+
+            if (offset + 1 + length > size)
+                return;
+
+            function (offset, std::string_view {reinterpret_cast<const char*> (data + offset + 1), length});
+            offset += 1 + length;
+        }
+    }
+
+    // Appends a single string made of every part, nothing is appended and
+    // false is returned if the parts are longer than maxStringLength in total
+    static bool appendString (std::vector<uint8_t>& data, std::initializer_list<std::string_view> parts)
+    {
+        size_t length {0};
+
+        for (const auto& part : parts)
+            length += part.size();
+
+        // TXT record strings are limited to 255 bytes!
+        if (length > maxStringLength)
+            return false;
+
+        data.push_back ((uint8_t) length);
+
+        for (const auto& part : parts)
+            data.insert (data.end(), part.begin(), part.end());
+
+        return true;
+    }
+};
+
+// A message held in owning types, for messages that are built up over time
+// before they're written
+struct BonjourDnsMessage
+{
+    static constexpr uint16_t responseFlags {0x8400};
+    static constexpr size_t maxSize {9000};
+
+    bool isResponse() const
+    {
+        return (flags & 0x8000) != 0;
+    }
+
+    // Returns the number of bytes written, any records that don't fit are
+    // left out
+    size_t write (uint8_t* buffer, size_t bufferSize) const
+    {
+        BonjourDnsWriter writer {buffer, bufferSize, id, flags};
+
+        for (const auto& question : questions)
+            writer.addQuestion (question);
+
+        for (const auto& record : answers)
+            writer.addRecord (BonjourDnsSection::answer, record);
+
+        for (const auto& record : authorities)
+            writer.addRecord (BonjourDnsSection::authority, record);
+
+        for (const auto& record : additionals)
+            writer.addRecord (BonjourDnsSection::additional, record);
+
+        // Too many records to fit in the buffer!
+        jassert ( ! writer.hasOverflowed());
+
+        return writer.getSize();
+    }
+
+    // Copies everything out of a received message
+    static std::optional<BonjourDnsMessage> read (const uint8_t* data, size_t size)
+    {
+        if ( ! BonjourDnsReader::isValid (data, size))
+            return std::nullopt;
+
+        BonjourDnsReader reader {data, size};
+        BonjourDnsMessage message;
+        message.id = reader.getId();
+        message.flags = reader.getFlags();
+
+        BonjourDnsRecordView entry;
+
+        while (reader.readNext (entry))
+        {
+            switch (entry.section)
+            {
+                case BonjourDnsSection::question:   message.questions.push_back (entry.toQuestion()); break;
+                case BonjourDnsSection::answer:     message.answers.push_back (entry.toRecord()); break;
+                case BonjourDnsSection::authority:  message.authorities.push_back (entry.toRecord()); break;
+                case BonjourDnsSection::additional: message.additionals.push_back (entry.toRecord()); break;
+            }
+        }
+
+        return message;
+    }
+
+    uint16_t id {0};
+    uint16_t flags {0};
+    std::vector<BonjourDnsQuestion> questions;
+    std::vector<BonjourDnsRecord> answers;
+    std::vector<BonjourDnsRecord> authorities;
+    std::vector<BonjourDnsRecord> additionals;
+};
+
+#include "jucey_BonjourDnsMessageTests.cpp"
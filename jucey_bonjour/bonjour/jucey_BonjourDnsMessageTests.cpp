@@ -0,0 +1,377 @@
+
+#if JUCEY_UNIT_TESTS
+
+class BonjourDnsMessageTests : private juce::UnitTest
+{
+public:
+    BonjourDnsMessageTests()
+        : juce::UnitTest ("BonjourDnsMessage", "Networking")
+    {
+
+    }
+
+    ~BonjourDnsMessageTests()
+    {
+
+    }
+
+private:
+    static BonjourDnsMessage makeAnnouncement()
+    {
+        const auto instanceName {BonjourDnsName::fromParts ("JUCEY.Test (2)", "_test._udp", "local")};
+
+        BonjourDnsMessage message;
+        message.flags = BonjourDnsMessage::responseFlags;
+
+        BonjourDnsRecord ptr;
+        ptr.name = instanceName.withoutFirst (1);
+        ptr.type = BonjourDnsRecord::ptr;
+        ptr.ttl = 4500;
+        ptr.target = instanceName;
+        message.answers.push_back (ptr);
+
+        BonjourDnsRecord srv;
+        srv.name = instanceName;
+        srv.type = BonjourDnsRecord::srv;
+        srv.cacheFlush = true;
+        srv.ttl = 120;
+        srv.port = 12345;
+        srv.target = BonjourDnsName::fromString ("jucey.local.");
+        message.additionals.push_back (srv);
+
+        BonjourDnsRecord txt;
+        txt.name = instanceName;
+        txt.type = BonjourDnsRecord::txt;
+        txt.ttl = 4500;
+        txt.data = {3, 'a', '=', 'b'};
+        message.additionals.push_back (txt);
+
+        BonjourDnsRecord address;
+        address.name = srv.target;
+        address.type = BonjourDnsRecord::a;
+        address.cacheFlush = true;
+        address.ttl = 120;
+        address.data = {127, 0, 0, 1};
+        message.additionals.push_back (address);
+
+        return message;
+    }
+
+    static std::vector<uint8_t> writeToVector (const BonjourDnsMessage& message)
+    {
+        std::vector<uint8_t> packet (BonjourDnsMessage::maxSize);
+        packet.resize (message.write (packet.data(), packet.size()));
+        return packet;
+    }
+
+    static bool containsSameRecords (const std::vector<BonjourDnsRecord>& a, const std::vector<BonjourDnsRecord>& b)
+    {
+        return a.size() == b.size()
+            && std::equal (a.begin(), a.end(), b.begin(), [](const BonjourDnsRecord& x, const BonjourDnsRecord& y)
+               {
+                   return x.isSameRecord (y) && x.ttl == y.ttl && x.cacheFlush == y.cacheFlush;
+               });
+    }
+
+    void runNameTests()
+    {
+        beginTest ("Names");
+
+        const auto instanceName {BonjourDnsName::fromParts ("JUCEY.Test (2)", "_test._udp", "local")};
+        expect (instanceName.labels.size() == 4);
+        expect (instanceName.toString() == "JUCEY\\.Test (2)._test._udp.local.");
+        expect (BonjourDnsName::fromString (instanceName.toString()) == instanceName);
+        expect (BonjourDnsName::fromString ("jucey\\.test (2)._TEST._udp.local") == instanceName);
+        expect (BonjourDnsName::fromString ("a\\009b.local.").labels.front() == std::string {"a\tb"});
+        expect (BonjourDnsName::fromString ("a\\009b.local.").toString() == "a\\009b.local.");
+        expect (BonjourDnsName {}.toString() == ".");
+    }
+
+    void runRoundTripTests()
+    {
+        beginTest ("Round Trip");
+
+        const auto message {makeAnnouncement()};
+        const auto packet {writeToVector (message)};
+        const auto readMessage {BonjourDnsMessage::read (packet.data(), packet.size())};
+
+        expect (readMessage.has_value());
+        expect (readMessage->isResponse());
+        expect (readMessage->questions.empty());
+        expect (containsSameRecords (readMessage->answers, message.answers));
+        expect (containsSameRecords (readMessage->additionals, message.additionals));
+        expect (readMessage->answers[0].target.getLabel (0) == "JUCEY.Test (2)");
+
+        // every truncated packet is rejected
+        for (size_t size {0}; size < packet.size(); ++size)
+            expect ( ! BonjourDnsReader::isValid (packet.data(), size));
+
+        // a record with no data at all is written without copying anything
+        BonjourDnsMessage emptyMessage;
+        emptyMessage.flags = BonjourDnsMessage::responseFlags;
+
+        BonjourDnsRecord emptyTxt;
+        emptyTxt.name = BonjourDnsName::fromParts ("JUCEY Empty", "_test._udp", "local");
+        emptyTxt.type = BonjourDnsRecord::txt;
+        emptyTxt.ttl = 4500;
+        emptyMessage.answers.push_back (emptyTxt);
+
+        const auto emptyPacket {writeToVector (emptyMessage)};
+        const auto readEmptyMessage {BonjourDnsMessage::read (emptyPacket.data(), emptyPacket.size())};
+        expect (readEmptyMessage.has_value());
+        expect (containsSameRecords (readEmptyMessage->answers, emptyMessage.answers));
+        expect (readEmptyMessage->answers[0].data.empty());
+
+        beginTest ("Reading In Place");
+
+        BonjourDnsReader reader {packet.data(), packet.size()};
+        BonjourDnsRecordView record;
+        std::vector<BonjourDnsSection> sections;
+
+        while (reader.readNext (record))
+        {
+            sections.push_back (record.section);
+
+            if (record.type == BonjourDnsRecord::txt)
+            {
+                // the data is a view into the packet, not a copy
+                expect (record.data > packet.data() && record.data + record.dataSize <= packet.data() + packet.size());
+                expect (record.dataSize == 4);
+                expect (record.isSameRecord (message.additionals[1]));
+                expect (record.name.getFirstLabel() == "JUCEY.Test (2)");
+                expect (record.name.getNumLabels() == 4);
+            }
+
+            if (record.type == BonjourDnsRecord::ptr)
+            {
+                expect (record.name == BonjourDnsName::fromString ("_TEST._UDP.LOCAL."));
+                expect (record.target.toString() == "JUCEY\\.Test (2)._test._udp.local.");
+            }
+        }
+
+        expect ( ! reader.hasError());
+        expect (sections == std::vector<BonjourDnsSection> {BonjourDnsSection::answer,
+                                                            BonjourDnsSection::additional,
+                                                            BonjourDnsSection::additional,
+                                                            BonjourDnsSection::additional});
+    }
+
+    void runCompressionTests()
+    {
+        beginTest ("Reading Compressed Names");
+
+        // A question for _test._udp.local and a PTR answer that refers back
+        // to it, both for its own name and within its target
+        const std::vector<uint8_t> compressed {0x00, 0x00, 0x84, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+                                               5, '_', 't', 'e', 's', 't', 4, '_', 'u', 'd', 'p', 5, 'l', 'o', 'c', 'a', 'l', 0,
+                                               0x00, 0x0c, 0x00, 0x01,
+                                               0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x04,
+                                               1, 'x', 0xc0, 0x0c};
+
+        const auto compressedMessage {BonjourDnsMessage::read (compressed.data(), compressed.size())};
+        expect (compressedMessage.has_value());
+        expect (compressedMessage->questions.size() == 1);
+        expect (compressedMessage->questions[0].name.toString() == "_test._udp.local.");
+        expect (compressedMessage->answers.size() == 1);
+        expect (compressedMessage->answers[0].name == compressedMessage->questions[0].name);
+        expect (compressedMessage->answers[0].target.toString() == "x._test._udp.local.");
+        expect (compressedMessage->answers[0].ttl == 4500);
+
+        // pointers that don't point backwards could loop forever
+        auto looped {compressed};
+        looped[49] = 48;
+        expect ( ! BonjourDnsReader::isValid (looped.data(), looped.size()));
+
+        auto forwards {compressed};
+        forwards[35] = 46;
+        expect ( ! BonjourDnsReader::isValid (forwards.data(), forwards.size()));
+
+        beginTest ("Writing Compressed Names");
+
+        const auto message {makeAnnouncement()};
+        const auto packet {writeToVector (message)};
+
+        size_t uncompressedSize {BonjourDnsReader::headerSize};
+
+        for (const auto* section : {&message.answers, &message.additionals})
+            for (const auto& record : *section)
+                uncompressedSize += record.name.toString().getNumBytesAsUTF8() + 1 + 10 + record.getData().size();
+
+        expect (packet.size() < uncompressedSize);
+
+        // the PTR record's name is the end of its target, so the target
+        // points to the name rather than repeating it
+        const std::vector<uint8_t> target {14, 'J', 'U', 'C', 'E', 'Y', '.', 'T', 'e', 's', 't', ' ', '(', '2', ')', 0xc0, 0x0c};
+        expect (std::search (packet.begin(), packet.end(), target.begin(), target.end()) != packet.end());
+
+        // names are only compressed against exactly the same name, so case is
+        // always preserved
+        BonjourDnsMessage mixedCase;
+        mixedCase.questions.push_back ({BonjourDnsName::fromString ("JUCEY.local."), BonjourDnsRecord::a, false});
+        mixedCase.questions.push_back ({BonjourDnsName::fromString ("jucey.local."), BonjourDnsRecord::a, true});
+
+        const auto mixedCasePacket {writeToVector (mixedCase)};
+        const auto mixedCaseMessage {BonjourDnsMessage::read (mixedCasePacket.data(), mixedCasePacket.size())};
+        expect (mixedCaseMessage.has_value());
+        expect (mixedCaseMessage->questions[0].name.toString() == "JUCEY.local.");
+        expect (mixedCaseMessage->questions[1].name.toString() == "jucey.local.");
+        expect (mixedCaseMessage->questions[1].wantsUnicastResponse);
+
+        // a name that repeats its own labels can only point to names that
+        // came before it
+        BonjourDnsMessage repeated;
+        repeated.questions.push_back ({BonjourDnsName::fromString ("a.a.a."), BonjourDnsRecord::a, false});
+        repeated.questions.push_back ({BonjourDnsName::fromString ("a.a."), BonjourDnsRecord::a, false});
+
+        const auto repeatedPacket {writeToVector (repeated)};
+        const auto repeatedMessage {BonjourDnsMessage::read (repeatedPacket.data(), repeatedPacket.size())};
+        expect (repeatedMessage.has_value());
+        expect (repeatedMessage->questions[0].name.toString() == "a.a.a.");
+        expect (repeatedMessage->questions[1].name.toString() == "a.a.");
+        expect (repeatedPacket.size() == BonjourDnsReader::headerSize + 7 + 4 + 2 + 4);
+    }
+
+    void runOverflowTests()
+    {
+        beginTest ("Buffer Overflow");
+
+        const auto message {makeAnnouncement()};
+        const auto fullSize {writeToVector (message).size()};
+        constexpr uint8_t guard {0xa5};
+
+        for (size_t capacity {0}; capacity <= fullSize; ++capacity)
+        {
+            std::vector<uint8_t> buffer (capacity + 16, guard);
+            BonjourDnsWriter writer {buffer.data(), capacity, 0, BonjourDnsMessage::responseFlags};
+
+            for (const auto& record : message.answers)
+                writer.addRecord (BonjourDnsSection::answer, record);
+
+            for (const auto& record : message.additionals)
+                writer.addRecord (BonjourDnsSection::additional, record);
+
+            expect (writer.hasOverflowed() == (capacity < fullSize));
+            expect (writer.getSize() <= capacity);
+            expect (std::all_of (buffer.begin() + (std::ptrdiff_t) capacity, buffer.end(), [](uint8_t byte) { return byte == guard; }));
+
+            // whatever fitted is still a whole message
+            if (capacity >= BonjourDnsReader::headerSize)
+                expect (BonjourDnsReader::isValid (buffer.data(), writer.getSize()));
+        }
+    }
+
+    void runTxtDataTests()
+    {
+        beginTest ("TXT Data");
+
+        std::vector<uint8_t> data;
+        BonjourDnsTxtData::appendString (data, {"key", "=", "value"});
+        BonjourDnsTxtData::appendString (data, {"flag"});
+        BonjourDnsTxtData::appendString (data, {});
+        expect (data.size() == 16);
+
+        // a string that overruns the data ends it
+        data.push_back (10);
+        data.push_back ('x');
+
+        std::vector<std::pair<size_t, std::string>> strings;
+
+        BonjourDnsTxtData::forEachString (data.data(), data.size(), [&strings](size_t offset, std::string_view string)
+        {
+            strings.emplace_back (offset, string);
+        });
+
+        expect (strings == std::vector<std::pair<size_t, std::string>> {{0, "key=value"}, {10, "flag"}, {15, ""}});
+    }
+
+    // Mutated and random packets must never be read out of bounds, and any
+    // packet that is accepted must survive being written and read again
+    void runFuzzTests()
+    {
+        beginTest ("Fuzzing");
+
+        juce::Random random {0x6a756365};
+
+        BonjourDnsMessage query;
+        query.questions.push_back ({BonjourDnsName::fromString ("_test._udp.local."), BonjourDnsRecord::ptr, true});
+        query.answers = makeAnnouncement().answers;
+
+        const std::vector<std::vector<uint8_t>> seeds {writeToVector (makeAnnouncement()), writeToVector (query)};
+        std::vector<uint8_t> rewritten (65536);
+        auto numAccepted {0};
+
+        for (auto iteration {0}; iteration < 20000; ++iteration)
+        {
+            std::vector<uint8_t> packet;
+
+            if (iteration % 10 == 0)
+            {
+                packet.resize ((size_t) random.nextInt (512));
+
+                for (auto& byte : packet)
+                    byte = (uint8_t) random.nextInt (256);
+            }
+            else
+            {
+                packet = seeds[(size_t) random.nextInt ((int) seeds.size())];
+
+                for (auto numMutations {1 + random.nextInt (8)}; --numMutations >= 0;)
+                    packet[(size_t) random.nextInt ((int) packet.size())] = (uint8_t) random.nextInt (256);
+
+                if (random.nextInt (4) == 0)
+                    packet.resize ((size_t) random.nextInt ((int) packet.size() + 1));
+            }
+
+            // Keep sanitisers honest, nothing may be read past the end
+            const std::unique_ptr<uint8_t[]> exact {new uint8_t[juce::jmax ((size_t) 1, packet.size())]};
+            std::copy (packet.begin(), packet.end(), exact.get());
+
+            BonjourDnsReader reader {exact.get(), packet.size()};
+            BonjourDnsRecordView entry;
+
+            while (reader.readNext (entry))
+            {
+                entry.name.toString();
+                entry.target.getNumLabels();
+            }
+
+            // a view can be made of any offset
+            if ( ! packet.empty())
+                BonjourDnsNameView {exact.get(), packet.size(), (size_t) random.nextInt ((int) packet.size())}.toString();
+
+            const auto message {BonjourDnsMessage::read (exact.get(), packet.size())};
+            expect (message.has_value() == ! reader.hasError());
+
+            if ( ! message.has_value())
+                continue;
+
+            ++numAccepted;
+
+            const auto size {message->write (rewritten.data(), rewritten.size())};
+            const auto reread {BonjourDnsMessage::read (rewritten.data(), size)};
+
+            expect (reread.has_value());
+            expect (reread->questions.size() == message->questions.size());
+            expect (containsSameRecords (reread->answers, message->answers));
+            expect (containsSameRecords (reread->authorities, message->authorities));
+            expect (containsSameRecords (reread->additionals, message->additionals));
+        }
+
+        // the mutations shouldn't be so aggressive nothing is ever accepted
+        expect (numAccepted > 100);
+    }
+
+    void runTest() override
+    {
+        runNameTests();
+        runRoundTripTests();
+        runCompressionTests();
+        runOverflowTests();
+        runTxtDataTests();
+        runFuzzTests();
+    }
+};
+
+static BonjourDnsMessageTests bonjourDnsMessageTests;
+
+#endif // JUCEY_UNIT_TESTS
@@ -0,0 +1,445 @@
+
+// A self-pipe that can be polled alongside the DNS service sockets so the
+// event loop can block indefinitely and still be woken up on demand. Windows
+// can't poll a pipe so a loopback datagram socket is used there instead.
+class BonjourWakeupSignal
+{
+public:
+    BonjourWakeupSignal()
+    {
+       #if JUCE_WINDOWS
+        socket.bindToPort (0, "127.0.0.1");
+       #else
+        if (pipe (fds) == 0)
+        {
+            fcntl (fds[0], F_SETFL, fcntl (fds[0], F_GETFL) | O_NONBLOCK);
+            fcntl (fds[1], F_SETFL, fcntl (fds[1], F_GETFL) | O_NONBLOCK);
+        }
+       #endif
+
+        // Failed to create the wakeup signal!
+        jassert (getFd() != invalidFd);
+    }
+
+    ~BonjourWakeupSignal()
+    {
+       #if ! JUCE_WINDOWS
+        for (auto fd : fds)
+            if (fd != invalidFd)
+                close (fd);
+       #endif
+    }
+
+    dnssd_sock_t getFd() const
+    {
+       #if JUCE_WINDOWS
+        return (dnssd_sock_t) socket.getRawSocketHandle();
+       #else
+        return fds[0];
+       #endif
+    }
+
+    void signal()
+    {
+        const char byte {0};
+
+       #if JUCE_WINDOWS
+        socket.write ("127.0.0.1", socket.getBoundPort(), &byte, 1);
+       #else
+        // If the pipe is full a wakeup is already pending so the result of
+        // the write doesn't matter
+        juce::ignoreUnused (write (fds[1], &byte, 1));
+       #endif
+    }
+
+    void clear()
+    {
+        char buffer[64];
+
+       #if JUCE_WINDOWS
+        while (socket.read (buffer, (int) sizeof (buffer), false) > 0) {}
+       #else
+        while (read (fds[0], buffer, sizeof (buffer)) > 0) {}
+       #endif
+    }
+
+private:
+   #if JUCE_WINDOWS
+    static constexpr dnssd_sock_t invalidFd {INVALID_SOCKET};
+    juce::DatagramSocket socket;
+   #else
+    static constexpr dnssd_sock_t invalidFd {-1};
+    int fds[2] {invalidFd, invalidFd};
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourWakeupSignal)
+};
+
+// A single process-wide thread that multiplexes the sockets of every active
+// DNSServiceRef and calls DNSServiceProcessResult for whichever is readable.
+//
+// The loop blocks until either a socket is readable or the wakeup signal is
+// raised, so an idle loop uses no CPU and changes take effect immediately.
+// Refs can be added and removed from any thread in O(1). Removing a ref
+// deallocates it straight away unless it's removed from within one of its own
+// callbacks, in which case it's deallocated as soon as the callback returns.
+// Functions can also be posted to the loop, either to run straight away or
+// after a delay, in the same context as the callbacks.
+//
+// Results are processed, and posted functions called, with the lock held.
+// That's what lets a service be sure none of its callbacks are running, but
+// it also means adding or removing a ref from another thread waits for
+// whatever callback is running, and a callback must never wait on a thread
+// that's adding or removing a ref.
+class BonjourEventLoop : private juce::Thread
+{
+public:
+    BonjourEventLoop()
+        : juce::Thread {"jucey_Bonjour"}
+    {
+        startThread();
+    }
+
+    ~BonjourEventLoop()
+    {
+        signalThreadShouldExit();
+        wakeupSignal.signal();
+        stopThread (1000);
+
+        // All operations should have been stopped before the loop is destroyed
+        jassert (sources.empty());
+    }
+
+    void addRef (DNSServiceRef ref, BonjourBackend& backend)
+    {
+        // You can't add a ref that is invalid!
+        jassert (ref != nullptr);
+
+        const juce::ScopedLock lock {sourcesLock};
+
+        // This ref has already been added!
+        jassert (indices.find (ref) == indices.end());
+
+        indices[ref] = sources.size();
+        sources.push_back ({ref, ++lastSourceId, &backend});
+        pollFds.push_back (makePollFd (backend.refSockFD (ref)));
+        sourcesChanged = true;
+        wakeupSignal.signal();
+    }
+
+    void removeRef (DNSServiceRef ref)
+    {
+        const juce::ScopedLock lock {sourcesLock};
+
+        const auto iter {indices.find (ref)};
+
+        if (iter == indices.end())
+            return;
+
+        const auto index {iter->second};
+        auto& backend {*sources[index].backend};
+        indices.erase (iter);
+
+        if (index != sources.size() - 1)
+        {
+            sources[index] = sources.back();
+            pollFds[index] = pollFds.back();
+            indices[sources[index].ref] = index;
+        }
+
+        sources.pop_back();
+        pollFds.pop_back();
+        sourcesChanged = true;
+        wakeupSignal.signal();
+
+        // The lock is held while results are processed, so if we get this far
+        // on the loop thread we're inside a callback and the ref can't be
+        // deallocated until DNSServiceProcessResult has returned
+        if (juce::Thread::getCurrentThreadId() == getThreadId())
+            refsToDeallocate.push_back ({ref, &backend});
+        else
+            backend.refDeallocate (ref);
+    }
+
+    // Refs that share another ref's connection aren't polled themselves, but
+    // they still can't be deallocated while one of its results is being
+    // processed
+    void deallocateSharedRef (DNSServiceRef ref, BonjourBackend& backend)
+    {
+        const juce::ScopedLock lock {sourcesLock};
+
+        if (juce::Thread::getCurrentThreadId() == getThreadId())
+            refsToDeallocate.push_back ({ref, &backend});
+        else
+            backend.refDeallocate (ref);
+    }
+
+    // Calls the function on the loop thread with the lock held, this is the
+    // same context as a DNS service callback
+    void post (std::function<void()> function)
+    {
+        const juce::ScopedLock lock {sourcesLock};
+        postedFunctions.push_back (std::move (function));
+        wakeupSignal.signal();
+    }
+
+    // Like post() but never waits for the loop to finish what it's doing,
+    // the function is called on the same pass as those that were posted
+    void postWithoutWaiting (std::function<void()> function)
+    {
+        {
+            const juce::ScopedLock lock {unlockedFunctionsLock};
+            unlockedFunctions.push_back (std::move (function));
+        }
+
+        wakeupSignal.signal();
+    }
+
+    using TimerId = uint64_t;
+
+    // Calls the function on the loop thread, with the lock held, once the
+    // delay has passed. The returned id can be used to cancel it.
+    TimerId callAfterDelay (int milliseconds, std::function<void()> function)
+    {
+        const juce::ScopedLock lock {sourcesLock};
+        const auto dueTime {juce::Time::getMillisecondCounterHiRes() + juce::jmax (0, milliseconds)};
+        timers.push_back ({++lastTimerId, dueTime, std::move (function)});
+        wakeupSignal.signal();
+        return lastTimerId;
+    }
+
+    void cancelTimer (TimerId timerId)
+    {
+        const juce::ScopedLock lock {sourcesLock};
+
+        const auto matchesId = [timerId](const Timer& timer)
+        {
+            return timer.id == timerId;
+        };
+
+        timers.erase (std::remove_if (timers.begin(), timers.end(), matchesId), timers.end());
+
+        // It may have been due at the same time as the timer being called
+        for (auto& timer : dueTimers)
+            if (matchesId (timer))
+                timer.function = nullptr;
+    }
+
+    // Held whenever results are processed or posted functions are called
+    const juce::CriticalSection& getLock() const
+    {
+        return sourcesLock;
+    }
+
+private:
+    struct Source
+    {
+        DNSServiceRef ref {nullptr};
+        uint64_t id {0};
+        BonjourBackend* backend {nullptr};
+    };
+
+    struct RefToDeallocate
+    {
+        DNSServiceRef ref {nullptr};
+        BonjourBackend* backend {nullptr};
+    };
+
+    struct Timer
+    {
+        TimerId id {0};
+        double dueTime {0.0};
+        std::function<void()> function {nullptr};
+    };
+
+   #if JUCE_WINDOWS
+    using PollFd = WSAPOLLFD;
+   #else
+    using PollFd = pollfd;
+   #endif
+
+    static PollFd makePollFd (dnssd_sock_t socket)
+    {
+        PollFd pollFd {};
+        pollFd.fd = socket;
+        pollFd.events = POLLIN;
+        return pollFd;
+    }
+
+    static int pollSockets (std::vector<PollFd>& fds, int timeoutMs)
+    {
+       #if JUCE_WINDOWS
+        return WSAPoll (fds.data(), (ULONG) fds.size(), timeoutMs);
+       #else
+        return poll (fds.data(), (nfds_t) fds.size(), timeoutMs);
+       #endif
+    }
+
+    void run() override
+    {
+        // The wakeup signal is always polled first, followed by a snapshot of
+        // the sources taken whenever they change
+        std::vector<PollFd> readyFds {makePollFd (wakeupSignal.getFd())};
+        std::vector<Source> readySources {Source{}};
+
+        while ( ! threadShouldExit())
+        {
+            int timeoutMs {-1};
+
+            {
+                const juce::ScopedLock lock {sourcesLock};
+
+                if (sourcesChanged)
+                {
+                    readyFds.resize (1);
+                    readyFds.insert (readyFds.end(), pollFds.begin(), pollFds.end());
+                    readySources.resize (1);
+                    readySources.insert (readySources.end(), sources.begin(), sources.end());
+                    sourcesChanged = false;
+                }
+
+                timeoutMs = getMillisecondsUntilNextTimer();
+            }
+
+            for (auto& pollFd : readyFds)
+                pollFd.revents = 0;
+
+            const auto numReady {pollSockets (readyFds, timeoutMs)};
+
+            if (numReady < 0)
+                continue;
+
+            const auto readyTicks {juce::Time::getHighResolutionTicks()};
+
+            if (readyFds.front().revents != 0)
+                wakeupSignal.clear();
+
+            const juce::ScopedLock lock {sourcesLock};
+
+            for (size_t index {1}; numReady > 0 && index < readyFds.size() && ! threadShouldExit(); ++index)
+            {
+                if (readyFds[index].revents == 0)
+                    continue;
+
+                // The ref may have been removed (and its address reused)
+                // since the snapshot was taken, so check the id still matches
+                const auto& source {readySources[index]};
+                const auto iter {indices.find (source.ref)};
+
+                if (iter != indices.end() && sources[iter->second].id == source.id)
+                {
+                    metrics.replyStarted (readyTicks);
+                    const auto startTicks {juce::Time::getHighResolutionTicks()};
+                    source.backend->processResult (source.ref);
+                    metrics.replyFinished (startTicks);
+                }
+
+                deallocatePendingRefs();
+            }
+
+            callDueTimers();
+            callPostedFunctions();
+        }
+    }
+
+    int getMillisecondsUntilNextTimer() const
+    {
+        if (timers.empty())
+            return -1;
+
+        // There are only ever a handful of timers so a linear search is fine
+        auto nextDueTime {timers.front().dueTime};
+
+        for (const auto& timer : timers)
+            nextDueTime = juce::jmin (nextDueTime, timer.dueTime);
+
+        const auto delay {nextDueTime - juce::Time::getMillisecondCounterHiRes()};
+        return delay > 0.0 ? (int) std::ceil (delay) : 0;
+    }
+
+    void callDueTimers()
+    {
+        const auto now {juce::Time::getMillisecondCounterHiRes()};
+
+        const auto firstDueTimer {std::stable_partition (timers.begin(), timers.end(), [now](const Timer& timer)
+        {
+            return timer.dueTime > now;
+        })};
+
+        dueTimers.assign (std::make_move_iterator (firstDueTimer), std::make_move_iterator (timers.end()));
+        timers.erase (firstDueTimer, timers.end());
+
+        // Each function is moved out before it's called in case it cancels
+        // its own timer
+        for (size_t index {0}; index < dueTimers.size() && ! threadShouldExit(); ++index)
+        {
+            auto function {std::move (dueTimers[index].function)};
+            dueTimers[index].function = nullptr;
+
+            if (function != nullptr)
+                function();
+        }
+
+        dueTimers.clear();
+
+        deallocatePendingRefs();
+    }
+
+    void deallocatePendingRefs()
+    {
+        for (const auto& refToDeallocate : refsToDeallocate)
+            refToDeallocate.backend->refDeallocate (refToDeallocate.ref);
+
+        refsToDeallocate.clear();
+    }
+
+    void callPostedFunctions()
+    {
+        // The two lists are swapped rather than replaced so neither has to
+        // allocate again once it has grown
+        while ( ! threadShouldExit())
+        {
+            std::swap (functionsToCall, postedFunctions);
+
+            {
+                const juce::ScopedLock lock {unlockedFunctionsLock};
+                functionsToCall.insert (functionsToCall.end(),
+                                        std::make_move_iterator (unlockedFunctions.begin()),
+                                        std::make_move_iterator (unlockedFunctions.end()));
+                unlockedFunctions.clear();
+            }
+
+            if (functionsToCall.empty())
+                return;
+
+            for (auto& function : functionsToCall)
+                function();
+
+            functionsToCall.clear();
+            deallocatePendingRefs();
+        }
+    }
+
+    BonjourWakeupSignal wakeupSignal;
+    BonjourMetricsRecorder& metrics {BonjourMetricsRecorder::getInstance()};
+    juce::CriticalSection sourcesLock;
+    std::vector<Source> sources;
+    std::vector<PollFd> pollFds;
+    std::unordered_map<DNSServiceRef,
+                       size_t,
+                       std::hash<DNSServiceRef>,
+                       std::equal_to<DNSServiceRef>,
+                       BonjourPoolAllocator<std::pair<const DNSServiceRef, size_t>>> indices;
+    std::vector<RefToDeallocate> refsToDeallocate;
+    std::vector<std::function<void()>> postedFunctions;
+    std::vector<std::function<void()>> functionsToCall;
+    juce::CriticalSection unlockedFunctionsLock;
+    std::vector<std::function<void()>> unlockedFunctions;
+    std::vector<Timer> timers;
+    std::vector<Timer> dueTimers;
+    uint64_t lastSourceId {0};
+    TimerId lastTimerId {0};
+    bool sourcesChanged {false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourEventLoop)
+};
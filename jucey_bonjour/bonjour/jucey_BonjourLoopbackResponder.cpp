@@ -0,0 +1,713 @@
+
+namespace jucey
+{
+    // Answers every operation from the services registered with it, without
+    // any network traffic
+    class BonjourLoopbackResponder::Backend : public BonjourQueuedBackend
+    {
+    public:
+        Backend()
+        {
+            BonjourBackend::install (this);
+        }
+
+        ~Backend() override
+        {
+            BonjourBackend::install (nullptr);
+        }
+
+        void setInterfaceIndices (const std::vector<int>& newInterfaceIndices)
+        {
+            // There must be at least one interface!
+            jassert ( ! newInterfaceIndices.empty());
+
+            const juce::ScopedLock lock {refsLock};
+            interfaceIndices.assign (newInterfaceIndices.begin(), newInterfaceIndices.end());
+        }
+
+        juce::String getHostName() const
+        {
+            return hostName;
+        }
+
+        int getNumRegisteredServices() const
+        {
+            const juce::ScopedLock lock {refsLock};
+
+            return (int) std::count_if (refs.begin(), refs.end(), [](const auto& ref)
+            {
+                return isService (*ref.second);
+            });
+        }
+
+        DNSServiceErrorType browse (DNSServiceRef* sdRef,
+                                    DNSServiceFlags flags,
+                                    uint32_t interfaceIndex,
+                                    const char* regtype,
+                                    const char* domain,
+                                    DNSServiceBrowseReply callBack,
+                                    void* context) override
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+            if (auto* ref {createRef (sdRef, flags, Kind::browse, errorCode)})
+            {
+                ref->interfaceIndex = interfaceIndex;
+                ref->type = juce::String::fromUTF8 (regtype);
+                ref->domain = juce::String::fromUTF8 (domain);
+                ref->browseReply = callBack;
+                ref->context = context;
+
+                std::vector<Ref*> registrations;
+
+                for (const auto& iter : refs)
+                    if (isService (*iter.second))
+                        registrations.push_back (iter.first);
+
+                sendBrowseReplies (*ref, registrations, true);
+            }
+
+            return errorCode;
+        }
+
+        DNSServiceErrorType resolve (DNSServiceRef* sdRef,
+                                     DNSServiceFlags flags,
+                                     uint32_t interfaceIndex,
+                                     const char* name,
+                                     const char* regtype,
+                                     const char* domain,
+                                     DNSServiceResolveReply callBack,
+                                     void* context) override
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+            if (auto* ref {createRef (sdRef, flags, Kind::resolve, errorCode)})
+            {
+                ref->interfaceIndex = interfaceIndex;
+                ref->name = juce::String::fromUTF8 (name);
+                ref->type = juce::String::fromUTF8 (regtype);
+                ref->domain = juce::String::fromUTF8 (domain);
+                ref->resolveReply = callBack;
+                ref->context = context;
+
+                // Like the daemon, a resolve for a service that isn't there
+                // yet waits for it to appear
+                for (const auto& iter : refs)
+                    if (isService (*iter.second))
+                        sendResolveReply (*ref, *iter.second);
+            }
+
+            return errorCode;
+        }
+
+        DNSServiceErrorType registerService (DNSServiceRef* sdRef,
+                                             DNSServiceFlags flags,
+                                             uint32_t interfaceIndex,
+                                             const char* name,
+                                             const char* regtype,
+                                             const char* domain,
+                                             const char* host,
+                                             uint16_t port,
+                                             uint16_t txtLen,
+                                             const void* txtRecord,
+                                             DNSServiceRegisterReply callBack,
+                                             void* context) override
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+            if (auto* ref {createRef (sdRef, flags, Kind::registration, errorCode)})
+            {
+                const auto* txtData {static_cast<const uint8_t*> (txtRecord)};
+
+                ref->interfaceIndex = interfaceIndex;
+                ref->type = withTrailingDot (juce::String::fromUTF8 (regtype));
+                ref->domain = withTrailingDot (domain != nullptr && *domain != 0 ? juce::String::fromUTF8 (domain) : juce::String {"local"});
+                ref->host = juce::String::fromUTF8 (host);
+                ref->port = port;
+                ref->txtRecord.assign (txtData, txtData + (txtData != nullptr ? txtLen : 0));
+                ref->registerReply = callBack;
+                ref->context = context;
+
+                const auto requestedName {name != nullptr && *name != 0 ? juce::String::fromUTF8 (name) : juce::String {"JUCEY Loopback"}};
+                ref->name = requestedName;
+
+                for (auto suffix {2}; isNameTaken (*ref); ++suffix)
+                {
+                    if ((flags & kDNSServiceFlagsNoAutoRename) != 0)
+                    {
+                        queueRegisterReply (*ref, 0, kDNSServiceErr_NameConflict);
+                        return errorCode;
+                    }
+
+                    ref->name = requestedName + " (" + juce::String (suffix) + ")";
+                }
+
+                ref->isRegistered = true;
+                queueRegisterReply (*ref, kDNSServiceFlagsAdd, kDNSServiceErr_NoError);
+                sendRegistrationReplies (*ref);
+            }
+
+            return errorCode;
+        }
+
+        // A service registered record by record appears as soon as its SRV
+        // record is registered, and its TXT record is whichever one has been
+        // registered with the same name. Every record, of any type, is also
+        // answered to record queries.
+        DNSServiceErrorType registerRecord (DNSServiceRef sdRef,
+                                            DNSRecordRef* recordRef,
+                                            DNSServiceFlags flags,
+                                            uint32_t interfaceIndex,
+                                            const char* fullname,
+                                            uint16_t rrtype,
+                                            uint16_t rrclass,
+                                            uint16_t rdlen,
+                                            const void* rdata,
+                                            uint32_t ttl,
+                                            DNSServiceRegisterRecordReply callBack,
+                                            void* context) override
+        {
+            juce::ignoreUnused (ttl);
+
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+            const auto* data {static_cast<const uint8_t*> (rdata)};
+
+            if (auto* ref {createRecordRef (sdRef, recordRef, errorCode)})
+            {
+                ref->flags = flags;
+                ref->interfaceIndex = interfaceIndex;
+                ref->recordName = juce::String::fromUTF8 (fullname);
+                ref->recordType = rrtype;
+                ref->recordClass = rrclass;
+                ref->recordData.assign (data, data + (data != nullptr ? rdlen : 0));
+                ref->registerRecordReply = callBack;
+                ref->context = context;
+
+                const auto name {BonjourDnsName::fromString (juce::String::fromUTF8 (fullname))};
+
+                if (name.labels.size() >= 3 && (rrtype == BonjourDnsRecord::srv || rrtype == BonjourDnsRecord::txt))
+                {
+                    ref->name = name.getLabel (0);
+                    ref->type = BonjourDnsName {{name.labels[1], name.labels[2]}}.toString();
+                    ref->domain = name.withoutFirst (3).toString();
+                }
+
+                if (rrtype == BonjourDnsRecord::srv)
+                {
+                    if (ref->recordData.size() < 7)
+                    {
+                        queueRegisterRecordReply (*ref, 0, kDNSServiceErr_BadParam);
+                        return errorCode;
+                    }
+
+                    if (isNameTaken (*ref))
+                    {
+                        queueRegisterRecordReply (*ref, 0, kDNSServiceErr_NameConflict);
+                        return errorCode;
+                    }
+
+                    ref->port = (uint16_t) ((ref->recordData[4] << 8) | ref->recordData[5]);
+                    ref->host = BonjourDnsNameView {ref->recordData.data(), ref->recordData.size(), 6}.toString();
+                    ref->txtRecord = findRecordData (*ref, BonjourDnsRecord::txt);
+                    ref->isRegistered = true;
+                    queueRegisterRecordReply (*ref, kDNSServiceFlagsAdd, kDNSServiceErr_NoError);
+                    sendRegistrationReplies (*ref);
+                    return errorCode;
+                }
+
+                ref->isRegistered = true;
+                queueRegisterRecordReply (*ref, kDNSServiceFlagsAdd, kDNSServiceErr_NoError);
+
+                // A TXT record changes the service with the same name, the
+                // same as if it had been updated
+                if (rrtype == BonjourDnsRecord::txt)
+                    if (auto* registration {findRecord (*ref, BonjourDnsRecord::srv)})
+                        updateTxtRecord (*registration, ref->recordData);
+
+                updateRecordQueries();
+            }
+
+            return errorCode;
+        }
+
+        DNSServiceErrorType queryRecord (DNSServiceRef* sdRef,
+                                         DNSServiceFlags flags,
+                                         uint32_t interfaceIndex,
+                                         const char* fullname,
+                                         uint16_t rrtype,
+                                         uint16_t rrclass,
+                                         DNSServiceQueryRecordReply callBack,
+                                         void* context) override
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+            if (auto* ref {createRef (sdRef, flags, Kind::recordQuery, errorCode)})
+            {
+                ref->interfaceIndex = interfaceIndex;
+                ref->recordName = juce::String::fromUTF8 (fullname);
+                ref->recordType = rrtype;
+                ref->recordClass = rrclass;
+                ref->queryRecordReply = callBack;
+                ref->context = context;
+                updateRecordQuery (*ref);
+            }
+
+            return errorCode;
+        }
+
+        DNSServiceErrorType updateRecord (DNSServiceRef sdRef,
+                                          DNSRecordRef recordRef,
+                                          DNSServiceFlags flags,
+                                          uint16_t rdlen,
+                                          const void* rdata,
+                                          uint32_t ttl) override
+        {
+            juce::ignoreUnused (flags, ttl);
+
+            const juce::ScopedLock lock {refsLock};
+            auto* ref {findRef (sdRef)};
+
+            if (ref == nullptr || ref->kind != Kind::registration)
+                return kDNSServiceErr_BadReference;
+
+            // Only the TXT record a service was registered with can be updated
+            if (recordRef != nullptr)
+                return kDNSServiceErr_Unsupported;
+
+            // Like the daemon, refuse anything too big to go in a record
+            if (rdlen > maxRecordDataSize)
+                return kDNSServiceErr_Invalid;
+
+            const auto* txtData {static_cast<const uint8_t*> (rdata)};
+            updateTxtRecord (*ref, {txtData, txtData + (txtData != nullptr ? rdlen : 0)});
+            return kDNSServiceErr_NoError;
+        }
+
+        DNSServiceErrorType getAddrInfo (DNSServiceRef* sdRef,
+                                         DNSServiceFlags flags,
+                                         uint32_t interfaceIndex,
+                                         DNSServiceProtocol protocol,
+                                         const char* hostname,
+                                         DNSServiceGetAddrInfoReply callBack,
+                                         void* context) override
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+            if (auto* ref {createRef (sdRef, flags, Kind::addressLookup, errorCode)})
+            {
+                ref->interfaceIndex = interfaceIndex;
+                ref->name = juce::String::fromUTF8 (hostname);
+                ref->addressReply = callBack;
+                ref->context = context;
+
+                // Any other host is never found, the same as a host that
+                // doesn't exist on the network
+                if (namesMatch (ref->name, hostName))
+                {
+                    const auto wantsIPv4 {protocol == 0 || (protocol & kDNSServiceProtocol_IPv4) != 0};
+                    const auto wantsIPv6 {protocol == 0 || (protocol & kDNSServiceProtocol_IPv6) != 0};
+                    const auto replyInterfaceIndex {interfaceIndex != 0 ? interfaceIndex : interfaceIndices.front()};
+
+                    if (wantsIPv4)
+                        sendAddressReply (*ref, replyInterfaceIndex, false, wantsIPv6);
+
+                    if (wantsIPv6)
+                        sendAddressReply (*ref, replyInterfaceIndex, true, false);
+                }
+            }
+
+            return errorCode;
+        }
+
+    private:
+        // Anyone browsing is told when a service goes, and anyone querying
+        // when a record goes
+        void refRemoved (Ref& ref) override
+        {
+            recordQueries.erase (&ref);
+
+            if ( ! ref.isRegistered)
+                return;
+
+            const auto wasService {isService (ref)};
+            ref.isRegistered = false;
+
+            if (wasService)
+                for (const auto& iter : refs)
+                    if (iter.second->kind == Kind::browse)
+                        sendBrowseReplies (*iter.second, {&ref}, false);
+
+            updateRecordQueries();
+        }
+
+        // Records that were registered individually are only a service if
+        // they're the SRV record
+        static bool isService (const Ref& ref)
+        {
+            return ref.isRegistered
+                && (ref.kind == Kind::registration || (ref.kind == Kind::record && ref.recordType == BonjourDnsRecord::srv));
+        }
+
+        void sendRegistrationReplies (Ref& registration)
+        {
+            for (const auto& iter : refs)
+            {
+                if (iter.second->kind == Kind::browse)
+                    sendBrowseReplies (*iter.second, {&registration}, true);
+                else if (iter.second->kind == Kind::resolve)
+                    sendResolveReply (*iter.second, registration);
+            }
+
+            updateRecordQueries();
+        }
+
+        // Anyone resolving the service is told about the change
+        void updateTxtRecord (Ref& registration, std::vector<uint8_t> txtRecord)
+        {
+            registration.txtRecord = std::move (txtRecord);
+
+            if (registration.isRegistered)
+            {
+                for (const auto& iter : refs)
+                    if (iter.second->kind == Kind::resolve)
+                        sendResolveReply (*iter.second, registration);
+
+                updateRecordQueries();
+            }
+        }
+
+        struct Answer
+        {
+            juce::String name;
+            uint16_t type;
+            std::vector<uint8_t> data;
+            uint32_t interfaceIndex;
+
+            bool operator== (const Answer& other) const
+            {
+                return type == other.type
+                    && interfaceIndex == other.interfaceIndex
+                    && data == other.data
+                    && namesMatch (name, other.name);
+            }
+        };
+
+        // The records of every registered service, of each record that was
+        // registered individually, and the host's loopback addresses, that
+        // the query asks for
+        std::vector<Answer> getAnswers (const Ref& query) const
+        {
+            std::vector<Answer> answers;
+
+            if (query.recordClass != kDNSServiceClass_IN)
+                return answers;
+
+            const auto queryName {BonjourDnsName::fromString (query.recordName)};
+
+            const auto addAnswer = [&] (const BonjourDnsName& name,
+                                        uint16_t type,
+                                        const std::vector<uint8_t>& data,
+                                        const std::vector<uint32_t>& answerInterfaceIndices)
+            {
+                if ((query.recordType != BonjourDnsRecord::any && query.recordType != type) || name != queryName)
+                    return;
+
+                for (const auto interfaceIndex : answerInterfaceIndices)
+                    if (query.interfaceIndex == 0 || query.interfaceIndex == interfaceIndex)
+                        answers.push_back ({name.toString(), type, data, interfaceIndex});
+            };
+
+            const auto host {BonjourDnsName::fromString (hostName)};
+            addAnswer (host, BonjourDnsRecord::a, {127, 0, 0, 1}, interfaceIndices);
+            addAnswer (host, BonjourDnsRecord::aaaa, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}, interfaceIndices);
+
+            for (const auto& iter : refs)
+            {
+                const auto& ref {*iter.second};
+
+                if ( ! ref.isRegistered)
+                    continue;
+
+                if (ref.kind == Kind::record)
+                {
+                    if (ref.recordClass == kDNSServiceClass_IN)
+                        addAnswer (BonjourDnsName::fromString (ref.recordName), ref.recordType, ref.recordData, getInterfaceIndices (ref));
+
+                    continue;
+                }
+
+                if (ref.kind != Kind::registration)
+                    continue;
+
+                const auto instanceName {BonjourDnsName::fromParts (ref.name, ref.type, ref.domain)};
+                auto typeName {BonjourDnsName::fromString (ref.type)};
+                typeName.append (BonjourDnsName::fromString (ref.domain));
+
+                BonjourDnsRecord ptr;
+                ptr.type = BonjourDnsRecord::ptr;
+                ptr.target = instanceName;
+
+                BonjourDnsRecord srv;
+                srv.type = BonjourDnsRecord::srv;
+                srv.port = ref.port;
+                srv.target = BonjourDnsName::fromString (ref.host.isNotEmpty() ? ref.host : hostName);
+
+                const auto indices {getInterfaceIndices (ref)};
+                addAnswer (typeName, BonjourDnsRecord::ptr, ptr.getData(), indices);
+                addAnswer (instanceName, BonjourDnsRecord::srv, srv.getData(), indices);
+                addAnswer (instanceName, BonjourDnsRecord::txt, ref.txtRecord.empty() ? std::vector<uint8_t> {0} : ref.txtRecord, indices);
+            }
+
+            return answers;
+        }
+
+        // Compares the answers with those last reported, and sends a reply
+        // for each difference as a single burst
+        void updateRecordQuery (Ref& query)
+        {
+            auto answers {getAnswers (query)};
+            auto& reported {recordQueries[&query]};
+
+            struct Change
+            {
+                const Answer* answer;
+                bool isAdd;
+            };
+
+            std::vector<Change> changes;
+
+            const auto contains = [](const std::vector<Answer>& list, const Answer& answer)
+            {
+                return std::find (list.begin(), list.end(), answer) != list.end();
+            };
+
+            for (const auto& answer : reported)
+                if ( ! contains (answers, answer))
+                    changes.push_back ({&answer, false});
+
+            for (const auto& answer : answers)
+                if ( ! contains (reported, answer))
+                    changes.push_back ({&answer, true});
+
+            for (size_t index {0}; index < changes.size(); ++index)
+            {
+                const auto& change {changes[index]};
+                const auto flags {(DNSServiceFlags) ((change.isAdd ? kDNSServiceFlagsAdd : 0)
+                                                     | (index + 1 < changes.size() ? kDNSServiceFlagsMoreComing : 0))};
+
+                queueQueryRecordReply (query,
+                                       flags,
+                                       change.answer->interfaceIndex,
+                                       kDNSServiceErr_NoError,
+                                       change.answer->name,
+                                       change.answer->type,
+                                       change.answer->data,
+                                       change.isAdd ? answerTtl : 0);
+            }
+
+            reported = std::move (answers);
+        }
+
+        void updateRecordQueries()
+        {
+            for (auto& iter : recordQueries)
+                updateRecordQuery (*iter.first);
+        }
+
+        // Finds a record of the given type for the same service as the given
+        // record, on the same connection
+        Ref* findRecord (const Ref& record, uint16_t recordType) const
+        {
+            for (const auto& iter : refs)
+            {
+                const auto& other {*iter.second};
+
+                if (other.kind == Kind::record
+                    && other.recordType == recordType
+                    && other.primary == record.primary
+                    && namesMatch (other.name, record.name)
+                    && namesMatch (other.type, record.type)
+                    && namesMatch (other.domain, record.domain))
+                {
+                    return iter.first;
+                }
+            }
+
+            return nullptr;
+        }
+
+        std::vector<uint8_t> findRecordData (const Ref& record, uint16_t recordType) const
+        {
+            if (const auto* other {findRecord (record, recordType)})
+                return other->recordData;
+
+            return {};
+        }
+
+        std::vector<uint32_t> getInterfaceIndices (const Ref& registration) const
+        {
+            if (registration.interfaceIndex != 0)
+                return {registration.interfaceIndex};
+
+            return interfaceIndices;
+        }
+
+        bool isNameTaken (const Ref& registration) const
+        {
+            return std::any_of (refs.begin(), refs.end(), [&registration](const auto& iter)
+            {
+                const auto& other {*iter.second};
+
+                return isService (other)
+                    && namesMatch (other.name, registration.name)
+                    && namesMatch (other.type, registration.type)
+                    && namesMatch (other.domain, registration.domain);
+            });
+        }
+
+        // Sends one reply per interface each registration appears on, as a
+        // single burst flagged with kDNSServiceFlagsMoreComing
+        void sendBrowseReplies (Ref& browse, const std::vector<Ref*>& registrations, bool isAdd)
+        {
+            struct Instance
+            {
+                const Ref* registration;
+                uint32_t interfaceIndex;
+            };
+
+            std::vector<Instance> instances;
+
+            for (const auto* registration : registrations)
+            {
+                if ( ! namesMatch (browse.type, registration->type)
+                    || ! (browse.domain.isEmpty() || namesMatch (browse.domain, registration->domain)))
+                {
+                    continue;
+                }
+
+                for (const auto interfaceIndex : getInterfaceIndices (*registration))
+                    if (browse.interfaceIndex == 0 || browse.interfaceIndex == interfaceIndex)
+                        instances.push_back ({registration, interfaceIndex});
+            }
+
+            for (size_t index {0}; index < instances.size(); ++index)
+            {
+                const auto& instance {instances[index]};
+                const auto flags {(DNSServiceFlags) ((isAdd ? kDNSServiceFlagsAdd : 0)
+                                                     | (index + 1 < instances.size() ? kDNSServiceFlagsMoreComing : 0))};
+
+                queueBrowseReply (browse,
+                                  flags,
+                                  instance.interfaceIndex,
+                                  kDNSServiceErr_NoError,
+                                  instance.registration->name,
+                                  instance.registration->type,
+                                  instance.registration->domain);
+            }
+        }
+
+        void sendResolveReply (Ref& resolve, const Ref& registration)
+        {
+            if ( ! namesMatch (resolve.name, registration.name)
+                || ! namesMatch (resolve.type, registration.type)
+                || ! namesMatch (resolve.domain, registration.domain))
+            {
+                return;
+            }
+
+            const auto registeredInterfaceIndices {getInterfaceIndices (registration)};
+            auto interfaceIndex {registeredInterfaceIndices.front()};
+
+            if (resolve.interfaceIndex != 0)
+            {
+                if (std::find (registeredInterfaceIndices.begin(),
+                               registeredInterfaceIndices.end(),
+                               resolve.interfaceIndex) == registeredInterfaceIndices.end())
+                {
+                    return;
+                }
+
+                interfaceIndex = resolve.interfaceIndex;
+            }
+
+            queueResolveReply (resolve,
+                               0,
+                               interfaceIndex,
+                               kDNSServiceErr_NoError,
+                               registration.name + "." + registration.type + registration.domain,
+                               registration.host.isNotEmpty() ? registration.host : hostName,
+                               registration.port,
+                               registration.txtRecord);
+        }
+
+        void sendAddressReply (Ref& lookup, uint32_t interfaceIndex, bool isIPv6, bool isMoreComing)
+        {
+            sockaddr_storage address {};
+
+            if (isIPv6)
+            {
+                auto& address6 {reinterpret_cast<sockaddr_in6&> (address)};
+                address6.sin6_family = AF_INET6;
+                address6.sin6_addr = in6addr_loopback;
+            }
+            else
+            {
+                auto& address4 {reinterpret_cast<sockaddr_in&> (address)};
+                address4.sin_family = AF_INET;
+                address4.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+            }
+
+            const auto flags {(DNSServiceFlags) (kDNSServiceFlagsAdd | (isMoreComing ? kDNSServiceFlagsMoreComing : 0))};
+            queueAddressReply (lookup, flags, interfaceIndex, lookup.name, address, answerTtl);
+        }
+
+        static constexpr uint32_t answerTtl {120};
+        static constexpr uint16_t maxRecordDataSize {8192};
+        const juce::String hostName {"jucey-loopback.local."};
+        std::vector<uint32_t> interfaceIndices {1};
+
+        // The answers last reported to each record query
+        std::unordered_map<Ref*, std::vector<Answer>> recordQueries;
+
+        JUCE_DECLARE_NON_COPYABLE (Backend)
+    };
+
+    BonjourLoopbackResponder::BonjourLoopbackResponder()
+        : backend {std::make_unique<Backend>()}
+    {
+
+    }
+
+    BonjourLoopbackResponder::~BonjourLoopbackResponder()
+    {
+
+    }
+
+    void BonjourLoopbackResponder::setInterfaceIndices (const std::vector<int>& newInterfaceIndices)
+    {
+        backend->setInterfaceIndices (newInterfaceIndices);
+    }
+
+    juce::String BonjourLoopbackResponder::getHostName() const
+    {
+        return backend->getHostName();
+    }
+
+    int BonjourLoopbackResponder::getNumRegisteredServices() const
+    {
+        return backend->getNumRegisteredServices();
+    }
+
+    int BonjourLoopbackResponder::getNumActiveOperations() const
+    {
+        return backend->getNumActiveOperations();
+    }
+}
+
+#include "jucey_BonjourLoopbackResponderTests.cpp"
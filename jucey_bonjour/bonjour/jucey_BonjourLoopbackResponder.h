@@ -0,0 +1,32 @@
+#pragma once
+
+namespace jucey
+{
+    // An in-process stand-in for the DNS service daemon. While one exists
+    // every operation that's started is answered by it rather than the
+    // daemon, nothing leaves the process, and replies are delivered through
+    // the same event loop and callbacks as replies from the daemon. Services
+    // registered while it exists can be discovered and resolved straight
+    // away, and resolve to the loopback addresses. Only one can exist at a
+    // time and it must outlive any operations started while it existed.
+    class BonjourLoopbackResponder
+    {
+    public:
+        BonjourLoopbackResponder();
+        ~BonjourLoopbackResponder();
+
+        // Services registered on interface 0 appear on each of these
+        // interfaces, by default there is a single interface with index 1
+        void setInterfaceIndices (const std::vector<int>& newInterfaceIndices);
+
+        juce::String getHostName() const;
+        int getNumRegisteredServices() const;
+        int getNumActiveOperations() const;
+
+    private:
+        class Backend;
+        std::unique_ptr<Backend> backend;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourLoopbackResponder)
+    };
+}
@@ -0,0 +1,494 @@
+
+#if JUCEY_UNIT_TESTS
+
+class BonjourLoopbackResponderTests : private juce::UnitTest
+{
+public:
+    BonjourLoopbackResponderTests()
+        : juce::UnitTest ("BonjourLoopbackResponder", "Networking")
+    {
+
+    }
+
+    ~BonjourLoopbackResponderTests()
+    {
+
+    }
+
+private:
+    // Operations stopped on the event loop thread are released shortly after
+    void waitForOperationsToStop (const jucey::BonjourLoopbackResponder& responder)
+    {
+        for (auto attempt {0}; responder.getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+
+        expect (responder.getNumActiveOperations() == 0);
+    }
+
+    jucey::BonjourService registerService (jucey::BonjourService& serviceToRegister, int portToRegister)
+    {
+        jucey::BonjourService registeredService;
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        const auto onServiceRegistered = [&](const jucey::BonjourService& service, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            registeredService = service;
+            onServiceRegisteredEvent.signal();
+        };
+
+        expect (serviceToRegister.registerAsync (onServiceRegistered, portToRegister));
+        expect (onServiceRegisteredEvent.wait (1000));
+        return registeredService;
+    }
+
+    void runRoundTripTests (const juce::String& serviceTypeToTest)
+    {
+        beginTest ("Round Trip: " + serviceTypeToTest);
+
+        jucey::BonjourService::clearResolveCache();
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            jucey::BonjourService serviceToRegister {serviceTypeToTest, "JUCEY Loopback Test Service", "local"};
+            serviceToRegister.setRecordItemValue ("keyA", "valueA");
+            serviceToRegister.setRecordItemValue ("keyB", "valueB");
+
+            const auto registeredService {registerService (serviceToRegister, 12345)};
+            expect (registeredService.getName() == "JUCEY Loopback Test Service");
+            expect (responder.getNumRegisteredServices() == 1);
+
+            // discover the registered service
+            jucey::BonjourService discoveredService;
+            juce::WaitableEvent onServiceDiscoveredEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool isMoreComing,
+                                                 const juce::Result& result)
+            {
+                // the service is withdrawn before this browse is stopped
+                if ( ! isAvailable)
+                    return;
+
+                expect (result.wasOk());
+                expect ( ! isMoreComing);
+                discoveredService = service;
+                onServiceDiscoveredEvent.signal();
+            };
+
+            jucey::BonjourService serviceToDiscover {serviceTypeToTest};
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+            expect (onServiceDiscoveredEvent.wait (1000));
+            expect (discoveredService.getName() == registeredService.getName());
+            expect (discoveredService.getInterfaceIndex() == 1);
+
+            // resolve it
+            juce::WaitableEvent onServiceResolvedEvent;
+
+            const auto onServiceResolved = [&](const jucey::BonjourService& service,
+                                               const juce::String& hostName,
+                                               int port,
+                                               const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (hostName == responder.getHostName());
+                expect (port == 12345);
+                expect (service.getRecordItemValue ("keyA") == "valueA");
+                expect (service.getRecordItemValue ("keyB") == "valueB");
+                onServiceResolvedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToResolve {discoveredService};
+            expect (serviceToResolve.resolveAsync (onServiceResolved));
+            expect (onServiceResolvedEvent.wait (1000));
+
+            // and look up its addresses
+            std::vector<juce::IPAddress> addresses;
+            juce::WaitableEvent onAddressResolvedEvent;
+
+            const auto onAddressResolved = [&](const jucey::BonjourService&,
+                                               const juce::String&,
+                                               int port,
+                                               const juce::IPAddress& address,
+                                               bool isAvailable,
+                                               bool isMoreComing,
+                                               const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (isAvailable);
+                expect (port == 12345);
+                addresses.push_back (address);
+
+                if ( ! isMoreComing)
+                    onAddressResolvedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToLookUp {discoveredService};
+            expect (serviceToLookUp.resolveAddressAsync (onAddressResolved));
+            expect (onAddressResolvedEvent.wait (1000));
+            expect (addresses.size() == 2);
+            expect (std::find (addresses.begin(), addresses.end(), juce::IPAddress::local()) != addresses.end());
+            expect (std::find (addresses.begin(), addresses.end(), juce::IPAddress::local (true)) != addresses.end());
+
+            // updated records are seen straight away
+            serviceToRegister.setRecordItemValue ("keyA", "updatedA");
+            serviceToRegister.removeRecordItem ("keyB");
+            expect (serviceToRegister.updateRecords());
+
+            jucey::BonjourService::clearResolveCache();
+            juce::WaitableEvent onServiceUpdatedEvent;
+
+            const auto onServiceUpdated = [&](const jucey::BonjourService& service,
+                                              const juce::String&,
+                                              int,
+                                              const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (service.getRecordItemValue ("keyA") == "updatedA");
+                expect ( ! service.containsRecordItem ("keyB"));
+                onServiceUpdatedEvent.signal();
+            };
+
+            jucey::BonjourService updatedServiceToResolve {discoveredService};
+            expect (updatedServiceToResolve.resolveAsync (onServiceUpdated));
+            expect (onServiceUpdatedEvent.wait (1000));
+
+            // withdrawing the service is seen by anyone browsing
+            juce::WaitableEvent onServiceRemovedEvent;
+
+            const auto onServiceRemoved = [&](const jucey::BonjourService& service,
+                                              bool isAvailable,
+                                              bool,
+                                              const juce::Result&)
+            {
+                if ( ! isAvailable && service.getName() == registeredService.getName())
+                    onServiceRemovedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToWatch {serviceTypeToTest};
+            expect (serviceToWatch.discoverAsync (onServiceRemoved));
+            serviceToRegister = jucey::BonjourService {};
+            expect (onServiceRemovedEvent.wait (1000));
+            expect (responder.getNumRegisteredServices() == 0);
+        }
+
+        jucey::BonjourService::clearResolveCache();
+        waitForOperationsToStop (responder);
+    }
+
+    void runNameConflictTests()
+    {
+        beginTest ("Name Conflict");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            jucey::BonjourService firstService {"_test._udp", "JUCEY Loopback Conflict", "local"};
+            jucey::BonjourService secondService {"_test._udp", "jucey loopback conflict", "local"};
+
+            expect (registerService (firstService, 1000).getName() == "JUCEY Loopback Conflict");
+            expect (registerService (secondService, 1001).getName() == "jucey loopback conflict (2)");
+            expect (responder.getNumRegisteredServices() == 2);
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runSharedSessionTests()
+    {
+        beginTest ("Shared Session");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            jucey::BonjourSession session;
+            expect (session.getResult());
+
+            // the session's connection is one operation in itself
+            expect (responder.getNumActiveOperations() == 1);
+
+            jucey::BonjourService serviceToRegister {"_test._tcp", "JUCEY Loopback Session", "local"};
+            serviceToRegister.setSession (&session);
+            registerService (serviceToRegister, 2000);
+
+            std::atomic<int> numDiscovered {0};
+            juce::WaitableEvent onAllServicesDiscoveredEvent;
+            std::vector<jucey::BonjourService> servicesToDiscover (5, jucey::BonjourService {"_test._tcp"});
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool,
+                                                 const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (isAvailable);
+                expect (service.getName() == "JUCEY Loopback Session");
+
+                if (++numDiscovered == (int) servicesToDiscover.size())
+                    onAllServicesDiscoveredEvent.signal();
+            };
+
+            for (auto& serviceToDiscover : servicesToDiscover)
+            {
+                serviceToDiscover.setSession (&session);
+                expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+            }
+
+            expect (onAllServicesDiscoveredEvent.wait (1000));
+            expect (responder.getNumActiveOperations() == 1 + 1 + (int) servicesToDiscover.size());
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runMultipleInterfaceTests()
+    {
+        beginTest ("Multiple Interfaces");
+
+        jucey::BonjourLoopbackResponder responder;
+        responder.setInterfaceIndices ({1, 2, 3});
+
+        {
+            jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Loopback Interfaces", "local"};
+            registerService (serviceToRegister, 3000);
+
+            std::vector<int> interfaceIndices;
+            juce::WaitableEvent onServicesDiscoveredEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool isMoreComing,
+                                                 const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (isAvailable);
+                interfaceIndices.push_back (service.getInterfaceIndex());
+
+                if ( ! isMoreComing)
+                    onServicesDiscoveredEvent.signal();
+            };
+
+            // the service appears once on each interface, in a single burst
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+            expect (onServicesDiscoveredEvent.wait (1000));
+            expect (interfaceIndices == std::vector<int> {1, 2, 3});
+
+            // but only on the interface asked for
+            interfaceIndices.clear();
+            onServicesDiscoveredEvent.reset();
+
+            jucey::BonjourService serviceToDiscoverOnInterface {"_test._udp"};
+            expect (serviceToDiscoverOnInterface.discoverAsync (onServiceDiscovered, 2));
+            expect (onServicesDiscoveredEvent.wait (1000));
+            expect (interfaceIndices == std::vector<int> {2});
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runMergedInterfaceTests()
+    {
+        beginTest ("Merged Interfaces");
+
+        jucey::BonjourLoopbackResponder responder;
+        responder.setInterfaceIndices ({1, 2, 3});
+
+        {
+            juce::CriticalSection eventsLock;
+            std::vector<jucey::BonjourService::DiscoveryEvent> events;
+            juce::WaitableEvent onBurstEndedEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool isMoreComing,
+                                                 const juce::Result& result)
+            {
+                expect (result.wasOk());
+
+                const juce::ScopedLock lock {eventsLock};
+                events.push_back ({service, isAvailable});
+
+                if ( ! isMoreComing)
+                    onBurstEndedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            serviceToDiscover.setInterfaceMergingEnabled (true);
+            expect (serviceToDiscover.isInterfaceMergingEnabled());
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+
+            jucey::BonjourServiceDirectory directory {"_test._udp"};
+            directory.setInterfaceMergingEnabled (true);
+            expect (directory.start());
+
+            auto serviceToRegister {std::make_unique<jucey::BonjourService> ("_test._udp", "JUCEY Loopback Merged", "local")};
+            registerService (*serviceToRegister, 5000);
+
+            // the service is added once, on every interface at once
+            expect (onBurstEndedEvent.wait (1000));
+
+            {
+                const juce::ScopedLock lock {eventsLock};
+                expect (events.size() == 1);
+
+                if (events.size() == 1)
+                {
+                    expect (events.front().isAvailable);
+                    expect (events.front().service.getName() == "JUCEY Loopback Merged");
+                    expect (events.front().service.getInterfaceIndex() == 0);
+                    expect (events.front().service.getInterfaceIndices() == std::vector<int> {1, 2, 3});
+                }
+
+                events.clear();
+                onBurstEndedEvent.reset();
+            }
+
+            for (auto attempt {0}; directory.getSnapshot()->size() == 0 && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+            expect (directory.getSnapshot()->size() == 1);
+
+            // and removed once, when it's gone from the last of them
+            serviceToRegister.reset();
+            expect (onBurstEndedEvent.wait (1000));
+
+            {
+                const juce::ScopedLock lock {eventsLock};
+                expect (events.size() == 1);
+                expect (events.size() == 1 && ! events.front().isAvailable);
+            }
+
+            for (auto attempt {0}; directory.getSnapshot()->size() > 0 && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+            expect (directory.getSnapshot()->size() == 0);
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runRecordQueryTests()
+    {
+        beginTest ("Record Queries");
+
+        using RecordEvent = jucey::BonjourService::RecordEvent;
+        using RecordType = jucey::BonjourService::RecordType;
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            juce::CriticalSection batchesLock;
+            std::deque<std::vector<RecordEvent>> batches;
+
+            const auto onRecords = [&](const std::vector<RecordEvent>& events, const juce::Result& result)
+            {
+                expect (result.wasOk());
+
+                const juce::ScopedLock lock {batchesLock};
+                batches.push_back (events);
+            };
+
+            const auto waitForBatch = [&]
+            {
+                for (auto attempt {0}; attempt < 100; ++attempt)
+                {
+                    {
+                        const juce::ScopedLock lock {batchesLock};
+
+                        if ( ! batches.empty())
+                        {
+                            auto batch {std::move (batches.front())};
+                            batches.pop_front();
+                            return batch;
+                        }
+                    }
+
+                    juce::Thread::sleep (10);
+                }
+
+                return std::vector<RecordEvent>{};
+            };
+
+            const auto txtData = [](const char* item)
+            {
+                std::string bytes (1, (char) std::strlen (item));
+                bytes += item;
+                return juce::MemoryBlock {bytes.data(), bytes.size()};
+            };
+
+            auto serviceToRegister {std::make_unique<jucey::BonjourService> ("_test._udp", "JUCEY Loopback Query", "local")};
+            serviceToRegister->setRecordItemValue ("version", "1");
+            registerService (*serviceToRegister, 4000);
+
+            // the TXT record is reported as soon as the query starts
+            jucey::BonjourService serviceToQuery {"_test._udp", "JUCEY Loopback Query", "local"};
+            expect (serviceToQuery.getFullName() == "JUCEY Loopback Query._test._udp.local.");
+            expect (serviceToQuery.queryRecordAsync (onRecords, RecordType::txt));
+
+            auto batch {waitForBatch()};
+            expect (batch.size() == 1);
+
+            if (batch.size() == 1)
+            {
+                expect (batch.front().isAvailable);
+                expect (batch.front().fullName == "JUCEY Loopback Query._test._udp.local.");
+                expect (batch.front().recordType == RecordType::txt);
+                expect (batch.front().recordClass == jucey::BonjourService::recordClassInternet);
+                expect (batch.front().data == txtData ("version=1"));
+                expect (batch.front().timeToLive.inSeconds() > 0.0);
+                expect (batch.front().interfaceIndex == 1);
+            }
+
+            // and the query keeps running, so a change is seen as the old
+            // record going and the new one arriving
+            serviceToRegister->setRecordItemValue ("version", "2");
+            expect (serviceToRegister->updateRecords());
+
+            batch = waitForBatch();
+            expect (batch.size() == 2);
+
+            if (batch.size() == 2)
+            {
+                expect ( ! batch[0].isAvailable);
+                expect (batch[0].data == txtData ("version=1"));
+                expect (batch[0].timeToLive.inSeconds() == 0.0);
+                expect (batch[1].isAvailable);
+                expect (batch[1].data == txtData ("version=2"));
+            }
+
+            serviceToRegister.reset();
+
+            batch = waitForBatch();
+            expect (batch.size() == 1 && ! batch.front().isAvailable);
+
+            // any name and type can be queried for, such as the host's address
+            jucey::BonjourService hostToQuery;
+            expect (hostToQuery.queryRecordAsync (onRecords, responder.getHostName(), RecordType::a));
+
+            batch = waitForBatch();
+            expect (batch.size() == 1);
+
+            const uint8_t loopbackAddress[] {127, 0, 0, 1};
+            expect (batch.size() == 1 && batch.front().data == juce::MemoryBlock {loopbackAddress, sizeof (loopbackAddress)});
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runTest() override
+    {
+        runRoundTripTests ("_test._udp");
+        runRoundTripTests ("_test._tcp");
+        runNameConflictTests();
+        runSharedSessionTests();
+        runMultipleInterfaceTests();
+        runMergedInterfaceTests();
+        runRecordQueryTests();
+    }
+};
+
+static BonjourLoopbackResponderTests bonjourLoopbackResponderTests;
+
+#endif // JUCEY_UNIT_TESTS
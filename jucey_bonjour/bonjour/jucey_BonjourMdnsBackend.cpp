@@ -0,0 +1,1523 @@
+
+#if JUCEY_NATIVE_MDNS
+
+#if ! JUCE_LINUX
+ #error "JUCEY_NATIVE_MDNS is only supported on Linux"
+#endif
+
+// Answers every operation itself by talking multicast DNS directly over a UDP
+// socket, so no daemon is needed. A single thread reads the socket and runs
+// every timer: probing for and announcing registered services, answering
+// queries for them, querying for browses, resolves and address lookups, and
+// expiring the records heard on the network. Whatever it learns is reported
+// through the same replies the daemon would send.
+//
+// Only IPv4 is used. The host name isn't probed for, and when probes are
+// tiebroken only the service's own SRV and TXT records are compared.
+class BonjourMdnsBackend : public BonjourQueuedBackend,
+                           private juce::Thread
+{
+public:
+    struct Options
+    {
+        // The address of the one interface to use, otherwise every interface
+        // that supports multicast other than the loopback interface is used
+        juce::String interfaceAddress {};
+
+        // Any port other than 5353 will only reach other instances using the
+        // same port, which keeps tests off the real network
+        int port {5353};
+
+        // Defaults to the computer's name in the local domain
+        juce::String hostName {};
+    };
+
+    explicit BonjourMdnsBackend (const Options& options)
+        : juce::Thread {"jucey_mDNS"},
+          port {options.port},
+          hostName {BonjourDnsName::fromString (options.hostName.isNotEmpty() ? options.hostName : getDefaultHostName())}
+    {
+        if (openSocket (options.interfaceAddress))
+            startThread();
+    }
+
+    ~BonjourMdnsBackend() override
+    {
+        signalThreadShouldExit();
+        wakeupSignal.signal();
+        stopThread (1000);
+
+        if (socketFd >= 0)
+            close (socketFd);
+    }
+
+    // Returns false if the socket couldn't be set up, in which case every
+    // operation fails as if the daemon wasn't running
+    bool isOpen() const
+    {
+        return socketFd >= 0;
+    }
+
+    juce::String getHostName() const
+    {
+        return hostName.toString();
+    }
+
+    DNSServiceErrorType browse (DNSServiceRef* sdRef,
+                                DNSServiceFlags flags,
+                                uint32_t interfaceIndex,
+                                const char* regtype,
+                                const char* domain,
+                                DNSServiceBrowseReply callBack,
+                                void* context) override
+    {
+        if ( ! isOpen())
+            return kDNSServiceErr_ServiceNotRunning;
+
+        if ( ! isLocalDomain (domain))
+            return kDNSServiceErr_Unsupported;
+
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+        if (auto* ref {createRef (sdRef, flags, Kind::browse, errorCode)})
+        {
+            ref->interfaceIndex = interfaceIndex;
+            ref->type = withTrailingDot (juce::String::fromUTF8 (regtype));
+            ref->domain = localDomain;
+            ref->browseReply = callBack;
+            ref->context = context;
+            startQuery (*ref);
+        }
+
+        return errorCode;
+    }
+
+    DNSServiceErrorType resolve (DNSServiceRef* sdRef,
+                                 DNSServiceFlags flags,
+                                 uint32_t interfaceIndex,
+                                 const char* name,
+                                 const char* regtype,
+                                 const char* domain,
+                                 DNSServiceResolveReply callBack,
+                                 void* context) override
+    {
+        if ( ! isOpen())
+            return kDNSServiceErr_ServiceNotRunning;
+
+        if ( ! isLocalDomain (domain))
+            return kDNSServiceErr_Unsupported;
+
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+        if (auto* ref {createRef (sdRef, flags, Kind::resolve, errorCode)})
+        {
+            ref->interfaceIndex = interfaceIndex;
+            ref->name = juce::String::fromUTF8 (name);
+            ref->type = withTrailingDot (juce::String::fromUTF8 (regtype));
+            ref->domain = localDomain;
+            ref->resolveReply = callBack;
+            ref->context = context;
+            startQuery (*ref);
+        }
+
+        return errorCode;
+    }
+
+    DNSServiceErrorType registerService (DNSServiceRef* sdRef,
+                                         DNSServiceFlags flags,
+                                         uint32_t interfaceIndex,
+                                         const char* name,
+                                         const char* regtype,
+                                         const char* domain,
+                                         const char* host,
+                                         uint16_t servicePort,
+                                         uint16_t txtLen,
+                                         const void* txtRecord,
+                                         DNSServiceRegisterReply callBack,
+                                         void* context) override
+    {
+        if ( ! isOpen())
+            return kDNSServiceErr_ServiceNotRunning;
+
+        // Services can only be registered on this host in the local domain
+        if ( ! isLocalDomain (domain) || (host != nullptr && *host != 0))
+            return kDNSServiceErr_Unsupported;
+
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+        if (auto* ref {createRef (sdRef, flags, Kind::registration, errorCode)})
+        {
+            const auto* txtData {static_cast<const uint8_t*> (txtRecord)};
+
+            ref->interfaceIndex = interfaceIndex;
+            ref->name = name != nullptr && *name != 0 ? juce::String::fromUTF8 (name) : hostName.getLabel (0);
+            ref->type = withTrailingDot (juce::String::fromUTF8 (regtype));
+            ref->domain = localDomain;
+            ref->port = servicePort;
+            ref->txtRecord.assign (txtData, txtData + (txtData != nullptr ? txtLen : 0));
+            ref->registerReply = callBack;
+            ref->context = context;
+
+            auto& registration {registrations[ref]};
+            registration.requestedName = ref->name;
+            registration.instanceName = getInstanceName (*ref);
+            registration.serviceTypeName = getServiceTypeName (*ref);
+            startProbing (registration, random.nextInt ({0, probeInterval}));
+        }
+
+        return errorCode;
+    }
+
+    DNSServiceErrorType updateRecord (DNSServiceRef sdRef,
+                                      DNSRecordRef recordRef,
+                                      DNSServiceFlags flags,
+                                      uint16_t rdlen,
+                                      const void* rdata,
+                                      uint32_t ttl) override
+    {
+        juce::ignoreUnused (flags, ttl);
+
+        const juce::ScopedLock lock {refsLock};
+        auto* ref {findRef (sdRef)};
+
+        if (ref == nullptr || ref->kind != Kind::registration)
+            return kDNSServiceErr_BadReference;
+
+        // Only the TXT record a service was registered with can be updated
+        if (recordRef != nullptr)
+            return kDNSServiceErr_Unsupported;
+
+        const auto* txtData {static_cast<const uint8_t*> (rdata)};
+        ref->txtRecord.assign (txtData, txtData + (txtData != nullptr ? rdlen : 0));
+
+        // Anyone with the old record cached is told about the new one
+        if (isAnswering (*ref))
+        {
+            for (const auto& interface : getInterfaces (ref->interfaceIndex))
+            {
+                BonjourDnsMessage message;
+                message.flags = BonjourDnsMessage::responseFlags;
+                message.answers.push_back (makeTxtRecord (*ref, txtTtl));
+                send (message, interface);
+            }
+        }
+
+        return kDNSServiceErr_NoError;
+    }
+
+    // Records can't be registered individually yet, only as part of a
+    // service, so anyone registering records falls back to registering
+    // services
+    DNSServiceErrorType registerRecord (DNSServiceRef sdRef,
+                                        DNSRecordRef* recordRef,
+                                        DNSServiceFlags flags,
+                                        uint32_t interfaceIndex,
+                                        const char* fullname,
+                                        uint16_t rrtype,
+                                        uint16_t rrclass,
+                                        uint16_t rdlen,
+                                        const void* rdata,
+                                        uint32_t ttl,
+                                        DNSServiceRegisterRecordReply callBack,
+                                        void* context) override
+    {
+        juce::ignoreUnused (sdRef, recordRef, flags, interfaceIndex, fullname, rrtype, rrclass, rdlen, rdata, ttl, callBack, context);
+        return kDNSServiceErr_Unsupported;
+    }
+
+    DNSServiceErrorType getAddrInfo (DNSServiceRef* sdRef,
+                                     DNSServiceFlags flags,
+                                     uint32_t interfaceIndex,
+                                     DNSServiceProtocol protocol,
+                                     const char* hostname,
+                                     DNSServiceGetAddrInfoReply callBack,
+                                     void* context) override
+    {
+        if ( ! isOpen())
+            return kDNSServiceErr_ServiceNotRunning;
+
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+        if (auto* ref {createRef (sdRef, flags, Kind::addressLookup, errorCode)})
+        {
+            ref->interfaceIndex = interfaceIndex;
+            ref->name = withTrailingDot (juce::String::fromUTF8 (hostname));
+            ref->protocol = protocol != 0 ? protocol : (DNSServiceProtocol) (kDNSServiceProtocol_IPv4 | kDNSServiceProtocol_IPv6);
+            ref->addressReply = callBack;
+            ref->context = context;
+            startQuery (*ref);
+        }
+
+        return errorCode;
+    }
+
+    // Only names in the local domain can be queried, as there's nothing to
+    // answer anything else
+    DNSServiceErrorType queryRecord (DNSServiceRef* sdRef,
+                                     DNSServiceFlags flags,
+                                     uint32_t interfaceIndex,
+                                     const char* fullname,
+                                     uint16_t rrtype,
+                                     uint16_t rrclass,
+                                     DNSServiceQueryRecordReply callBack,
+                                     void* context) override
+    {
+        if ( ! isOpen())
+            return kDNSServiceErr_ServiceNotRunning;
+
+        const auto name {BonjourDnsName::fromString (juce::String::fromUTF8 (fullname))};
+
+        if (rrclass != kDNSServiceClass_IN || name.isEmpty() || ! name.getLabel (name.labels.size() - 1).equalsIgnoreCase ("local"))
+            return kDNSServiceErr_Unsupported;
+
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+
+        if (auto* ref {createRef (sdRef, flags, Kind::recordQuery, errorCode)})
+        {
+            ref->interfaceIndex = interfaceIndex;
+            ref->recordName = name.toString();
+            ref->recordType = rrtype;
+            ref->recordClass = rrclass;
+            ref->queryRecordReply = callBack;
+            ref->context = context;
+            startQuery (*ref);
+        }
+
+        return errorCode;
+    }
+
+private:
+    struct Interface
+    {
+        uint32_t index {0};
+        in_addr address {};
+    };
+
+    struct CachedRecord
+    {
+        BonjourDnsRecord record;
+        uint32_t interfaceIndex {0};
+        double receivedTime {0.0};
+        double expiryTime {0.0};
+        int numRefreshes {0};
+
+        bool isSameRecord (const CachedRecord& other) const
+        {
+            return interfaceIndex == other.interfaceIndex && record.isSameRecord (other.record);
+        }
+
+        // Queries are sent at 80%, 85%, 90% and 95% of the TTL to refresh a
+        // record that's still wanted
+        double getRefreshTime() const
+        {
+            return receivedTime + record.ttl * 1000.0 * (0.8 + 0.05 * numRefreshes);
+        }
+
+        uint32_t getRemainingTtl (double now) const
+        {
+            return (uint32_t) juce::jmax (0.0, (expiryTime - now) / 1000.0);
+        }
+    };
+
+    struct Registration
+    {
+        enum class State
+        {
+            probing,
+            announcing,
+            announced,
+            failed
+        };
+
+        juce::String requestedName {};
+        int nameSuffix {1};
+
+        // Kept so received names can be compared without building ours
+        BonjourDnsName instanceName;
+        BonjourDnsName serviceTypeName;
+
+        State state {State::probing};
+        int numPacketsSent {0};
+        double nextTime {0.0};
+    };
+
+    struct Query
+    {
+        std::vector<BonjourDnsQuestion> questions;
+        double nextTime {0.0};
+        double interval {0.0};
+
+        // The records the last replies were for
+        std::vector<CachedRecord> reported;
+    };
+
+    static constexpr int probeInterval {250};
+    static constexpr int numProbes {3};
+    static constexpr int numAnnouncements {2};
+    static constexpr double maxQueryInterval {60.0 * 60.0 * 1000.0};
+    static constexpr size_t maxCacheSize {4096};
+
+    // The TTLs recommended for records that include a host name, and for
+    // everything else
+    static constexpr uint32_t hostTtl {120};
+    static constexpr uint32_t txtTtl {4500};
+
+    static inline const juce::String localDomain {"local."};
+    static inline const BonjourDnsName servicesName {BonjourDnsName::fromString ("_services._dns-sd._udp.local.")};
+
+    static juce::String getDefaultHostName()
+    {
+        auto name {juce::SystemStats::getComputerName().retainCharacters ("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-")};
+        return (name.isNotEmpty() ? name : juce::String {"jucey"}) + "." + localDomain;
+    }
+
+    static bool isLocalDomain (const char* domain)
+    {
+        return domain == nullptr || *domain == 0 || namesMatch (juce::String::fromUTF8 (domain), localDomain);
+    }
+
+    static double getTime()
+    {
+        return juce::Time::getMillisecondCounterHiRes();
+    }
+
+    bool openSocket (const juce::String& interfaceAddress)
+    {
+        ifaddrs* addresses {nullptr};
+
+        if (getifaddrs (&addresses) != 0)
+            return false;
+
+        for (auto* address {addresses}; address != nullptr; address = address->ifa_next)
+        {
+            if (address->ifa_addr == nullptr
+                || address->ifa_addr->sa_family != AF_INET
+                || (address->ifa_flags & IFF_UP) == 0)
+            {
+                continue;
+            }
+
+            const auto inAddress {reinterpret_cast<const sockaddr_in*> (address->ifa_addr)->sin_addr};
+
+            // The loopback interface doesn't claim to support multicast but
+            // it does, so it's used if it's asked for by address
+            const auto isWanted {interfaceAddress.isNotEmpty()
+                                 ? inAddress.s_addr == inet_addr (interfaceAddress.toRawUTF8())
+                                 : (address->ifa_flags & IFF_MULTICAST) != 0 && (address->ifa_flags & IFF_LOOPBACK) == 0};
+
+            if (isWanted)
+                interfaces.push_back ({if_nametoindex (address->ifa_name), inAddress});
+        }
+
+        freeifaddrs (addresses);
+
+        if (interfaces.empty())
+            return false;
+
+        const auto fd {socket (AF_INET, SOCK_DGRAM, 0)};
+
+        if (fd < 0)
+            return false;
+
+        const int on {1};
+        const int ttl {255};
+
+        sockaddr_in bindAddress {};
+        bindAddress.sin_family = AF_INET;
+        bindAddress.sin_port = htons ((uint16_t) port);
+        bindAddress.sin_addr.s_addr = htonl (INADDR_ANY);
+
+        auto isOk {setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on)) == 0
+                   && setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on)) == 0
+                   && setsockopt (fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof (on)) == 0
+                   && setsockopt (fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof (ttl)) == 0
+                   && setsockopt (fd, IPPROTO_IP, IP_MULTICAST_LOOP, &on, sizeof (on)) == 0
+                   && bind (fd, reinterpret_cast<const sockaddr*> (&bindAddress), sizeof (bindAddress)) == 0
+                   && fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) == 0};
+
+        for (const auto& interface : interfaces)
+        {
+            ip_mreq membership {};
+            membership.imr_multiaddr = getGroupAddress().sin_addr;
+            membership.imr_interface = interface.address;
+            isOk = isOk && setsockopt (fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof (membership)) == 0;
+        }
+
+        if ( ! isOk)
+        {
+            close (fd);
+            return false;
+        }
+
+        socketFd = fd;
+        return true;
+    }
+
+    sockaddr_in getGroupAddress() const
+    {
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons ((uint16_t) port);
+        address.sin_addr.s_addr = inet_addr ("224.0.0.251");
+        return address;
+    }
+
+    // Every interface, or just the one with the given index
+    std::vector<Interface> getInterfaces (uint32_t interfaceIndex) const
+    {
+        std::vector<Interface> matchingInterfaces;
+
+        for (const auto& interface : interfaces)
+            if (interfaceIndex == 0 || interfaceIndex == interface.index)
+                matchingInterfaces.push_back (interface);
+
+        return matchingInterfaces;
+    }
+
+    // Must be called with the lock held, as every packet is written into the
+    // same buffer
+    void send (const BonjourDnsMessage& message, const Interface& interface, const sockaddr_in* destination = nullptr)
+    {
+        const auto size {message.write (sendBuffer.data(), sendBuffer.size())};
+        const auto groupAddress {getGroupAddress()};
+
+        if (destination == nullptr)
+        {
+            destination = &groupAddress;
+            setsockopt (socketFd, IPPROTO_IP, IP_MULTICAST_IF, &interface.address, sizeof (interface.address));
+        }
+
+        sendto (socketFd,
+                sendBuffer.data(),
+                size,
+                0,
+                reinterpret_cast<const sockaddr*> (destination),
+                sizeof (*destination));
+    }
+
+    //==============================================================================
+    // The records of a registered service
+
+    static BonjourDnsName getServiceTypeName (const Ref& ref)
+    {
+        auto name {BonjourDnsName::fromString (ref.type)};
+        name.append (BonjourDnsName::fromString (ref.domain));
+        return name;
+    }
+
+    static BonjourDnsName getInstanceName (const Ref& ref)
+    {
+        return BonjourDnsName::fromParts (ref.name, ref.type, ref.domain);
+    }
+
+    static BonjourDnsRecord makePtrRecord (const Ref& registration, uint32_t ttl)
+    {
+        BonjourDnsRecord record;
+        record.name = getServiceTypeName (registration);
+        record.type = BonjourDnsRecord::ptr;
+        record.ttl = ttl;
+        record.target = getInstanceName (registration);
+        return record;
+    }
+
+    static BonjourDnsRecord makeServicesPtrRecord (const Ref& registration)
+    {
+        BonjourDnsRecord record;
+        record.name = servicesName;
+        record.type = BonjourDnsRecord::ptr;
+        record.ttl = txtTtl;
+        record.target = getServiceTypeName (registration);
+        return record;
+    }
+
+    BonjourDnsRecord makeSrvRecord (const Ref& registration, uint32_t ttl) const
+    {
+        BonjourDnsRecord record;
+        record.name = getInstanceName (registration);
+        record.type = BonjourDnsRecord::srv;
+        record.cacheFlush = true;
+        record.ttl = ttl;
+        record.port = ntohs (registration.port);
+        record.target = hostName;
+        return record;
+    }
+
+    static BonjourDnsRecord makeTxtRecord (const Ref& registration, uint32_t ttl)
+    {
+        BonjourDnsRecord record;
+        record.name = getInstanceName (registration);
+        record.type = BonjourDnsRecord::txt;
+        record.cacheFlush = true;
+        record.ttl = ttl;
+        record.data = registration.txtRecord;
+
+        // A TXT record is never empty, no keys is a single empty string
+        if (record.data.empty())
+            record.data.push_back (0);
+
+        return record;
+    }
+
+    BonjourDnsRecord makeAddressRecord (const Interface& interface) const
+    {
+        BonjourDnsRecord record;
+        record.name = hostName;
+        record.type = BonjourDnsRecord::a;
+        record.cacheFlush = true;
+        record.ttl = hostTtl;
+
+        const auto* bytes {reinterpret_cast<const uint8_t*> (&interface.address)};
+        record.data.assign (bytes, bytes + sizeof (interface.address));
+        return record;
+    }
+
+    static bool isOnInterface (const Ref& ref, const Interface& interface)
+    {
+        return ref.interfaceIndex == 0 || ref.interfaceIndex == interface.index;
+    }
+
+    // Services are only answered for once they've been probed for
+    bool isAnswering (const Ref& registration) const
+    {
+        const auto iter {registrations.find (const_cast<Ref*> (&registration))};
+
+        return iter != registrations.end()
+            && (iter->second.state == Registration::State::announcing
+                || iter->second.state == Registration::State::announced);
+    }
+
+    //==============================================================================
+    // Registering
+
+    void startProbing (Registration& registration, int delayMs)
+    {
+        registration.state = Registration::State::probing;
+        registration.numPacketsSent = 0;
+        registration.nextTime = getTime() + delayMs;
+        wakeupSignal.signal();
+    }
+
+    void sendProbe (const Ref& ref)
+    {
+        for (const auto& interface : getInterfaces (ref.interfaceIndex))
+        {
+            BonjourDnsMessage message;
+            message.questions.push_back ({getInstanceName (ref), BonjourDnsRecord::any, false});
+            message.authorities.push_back (makeSrvRecord (ref, hostTtl));
+            message.authorities.push_back (makeTxtRecord (ref, txtTtl));
+            send (message, interface);
+        }
+    }
+
+    void sendAnnouncement (const Ref& ref, bool isGoodbye)
+    {
+        for (const auto& interface : getInterfaces (ref.interfaceIndex))
+        {
+            BonjourDnsMessage message;
+            message.flags = BonjourDnsMessage::responseFlags;
+            message.answers.push_back (makePtrRecord (ref, isGoodbye ? 0 : txtTtl));
+            message.answers.push_back (makeSrvRecord (ref, isGoodbye ? 0 : hostTtl));
+            message.answers.push_back (makeTxtRecord (ref, isGoodbye ? 0 : txtTtl));
+
+            if ( ! isGoodbye)
+            {
+                message.answers.push_back (makeServicesPtrRecord (ref));
+                message.answers.push_back (makeAddressRecord (interface));
+            }
+
+            send (message, interface);
+        }
+    }
+
+    // Someone else is already using the name, so either pick the next one or
+    // give up if renaming isn't allowed
+    void nameConflicted (Ref& ref, Registration& registration)
+    {
+        if (registration.state == Registration::State::announcing
+            || registration.state == Registration::State::announced)
+        {
+            sendAnnouncement (ref, true);
+        }
+
+        if ((ref.flags & kDNSServiceFlagsNoAutoRename) != 0)
+        {
+            registration.state = Registration::State::failed;
+            queueRegisterReply (ref, 0, kDNSServiceErr_NameConflict);
+            return;
+        }
+
+        ref.name = registration.requestedName + " (" + juce::String (++registration.nameSuffix) + ")";
+        registration.instanceName = getInstanceName (ref);
+        startProbing (registration, 0);
+    }
+
+    // Probes are sorted by type, then data, and compared record by record. The
+    // probe with the later records wins.
+    using ProbeData = std::vector<std::pair<uint16_t, std::vector<uint8_t>>>;
+
+    static ProbeData getProbeData (const std::vector<BonjourDnsRecord>& records, const BonjourDnsName& name)
+    {
+        ProbeData probeData;
+
+        for (const auto& record : records)
+            if (record.name == name)
+                probeData.emplace_back (record.type, record.getData());
+
+        std::sort (probeData.begin(), probeData.end());
+        return probeData;
+    }
+
+    // The records in the authority section of a received probe
+    static ProbeData getProbeData (const uint8_t* data, size_t size, const BonjourDnsName& name)
+    {
+        ProbeData probeData;
+        BonjourDnsReader reader {data, size};
+        BonjourDnsRecordView record;
+
+        while (reader.readNext (record))
+            if (record.section == BonjourDnsSection::authority && record.name == name)
+                probeData.emplace_back (record.type, record.toRecord().getData());
+
+        std::sort (probeData.begin(), probeData.end());
+        return probeData;
+    }
+
+    //==============================================================================
+    // Querying
+
+    void startQuery (Ref& ref)
+    {
+        auto& query {queries[&ref]};
+        query.questions = getQuestions (ref);
+        query.nextTime = getTime() + random.nextInt ({20, 120});
+        query.interval = 1000.0;
+
+        // Anything already known is reported straight away
+        updateQuery (ref, query, getTime());
+        wakeupSignal.signal();
+    }
+
+    static std::vector<BonjourDnsQuestion> getQuestions (const Ref& ref)
+    {
+        switch (ref.kind)
+        {
+            case Kind::browse:
+                return {{getServiceTypeName (ref), BonjourDnsRecord::ptr, false}};
+
+            case Kind::resolve:
+                return {{getInstanceName (ref), BonjourDnsRecord::srv, false},
+                        {getInstanceName (ref), BonjourDnsRecord::txt, false}};
+
+            case Kind::addressLookup:
+            {
+                std::vector<BonjourDnsQuestion> questions;
+                const auto name {BonjourDnsName::fromString (ref.name)};
+
+                if ((ref.protocol & kDNSServiceProtocol_IPv4) != 0)
+                    questions.push_back ({name, BonjourDnsRecord::a, false});
+
+                if ((ref.protocol & kDNSServiceProtocol_IPv6) != 0)
+                    questions.push_back ({name, BonjourDnsRecord::aaaa, false});
+
+                return questions;
+            }
+
+            case Kind::recordQuery:
+                return {{BonjourDnsName::fromString (ref.recordName), ref.recordType, false}};
+
+            case Kind::connection:
+            case Kind::registration:
+            case Kind::record:
+                break;
+        }
+
+        return {};
+    }
+
+    static bool isAnswer (const CachedRecord& cachedRecord,
+                          const BonjourDnsQuestion& question,
+                          uint32_t interfaceIndex)
+    {
+        return (interfaceIndex == 0 || interfaceIndex == cachedRecord.interfaceIndex)
+            && (question.type == BonjourDnsRecord::any || question.type == cachedRecord.record.type)
+            && question.name == cachedRecord.record.name;
+    }
+
+    // Goodbyes are kept for a second but aren't reported
+    std::vector<CachedRecord> getAnswers (const Ref& ref, const Query& query) const
+    {
+        std::vector<CachedRecord> answers;
+
+        for (const auto& question : query.questions)
+            for (const auto& cachedRecord : cache)
+                if (cachedRecord.record.ttl > 0 && isAnswer (cachedRecord, question, ref.interfaceIndex))
+                    answers.push_back (cachedRecord);
+
+        return answers;
+    }
+
+    void sendQuery (const Ref& ref, const Query& query, double now)
+    {
+        for (const auto& interface : getInterfaces (ref.interfaceIndex))
+        {
+            BonjourDnsMessage message;
+            message.questions = query.questions;
+
+            // Answers that are known and aren't half way to expiring don't
+            // need to be sent again
+            for (const auto& cachedRecord : cache)
+            {
+                if (cachedRecord.interfaceIndex != interface.index
+                    || cachedRecord.getRemainingTtl (now) * 2 <= cachedRecord.record.ttl)
+                {
+                    continue;
+                }
+
+                for (const auto& question : message.questions)
+                {
+                    if (isAnswer (cachedRecord, question, interface.index))
+                    {
+                        auto knownAnswer {cachedRecord.record};
+                        knownAnswer.ttl = cachedRecord.getRemainingTtl (now);
+                        message.answers.push_back (std::move (knownAnswer));
+                        break;
+                    }
+                }
+            }
+
+            send (message, interface);
+        }
+    }
+
+    // Compares what's in the cache with what was last reported and sends a
+    // reply for each difference
+    void updateQuery (Ref& ref, Query& query, double now)
+    {
+        auto answers {getAnswers (ref, query)};
+
+        if (ref.kind == Kind::resolve)
+        {
+            // The newest of each record is the one that's reported, in case
+            // one that's been superseded hasn't expired yet
+            const auto findNewest = [&answers](auto isWanted)
+            {
+                auto newest {answers.end()};
+
+                for (auto iter {answers.begin()}; iter != answers.end(); ++iter)
+                    if (isWanted (*iter) && (newest == answers.end() || iter->receivedTime > newest->receivedTime))
+                        newest = iter;
+
+                return newest;
+            };
+
+            const auto srv {findNewest ([](const CachedRecord& answer)
+            {
+                return answer.record.type == BonjourDnsRecord::srv;
+            })};
+
+            if (srv == answers.end())
+                return;
+
+            const auto txt {findNewest ([&srv](const CachedRecord& answer)
+            {
+                return answer.record.type == BonjourDnsRecord::txt && answer.interfaceIndex == srv->interfaceIndex;
+            })};
+
+            // Like the daemon, a resolve waits for both records
+            if (txt == answers.end())
+                return;
+
+            std::vector<CachedRecord> resolved {*srv, *txt};
+
+            if (query.reported.size() == resolved.size()
+                && query.reported[0].isSameRecord (resolved[0])
+                && query.reported[1].isSameRecord (resolved[1]))
+            {
+                return;
+            }
+
+            queueResolveReply (ref,
+                               0,
+                               srv->interfaceIndex,
+                               kDNSServiceErr_NoError,
+                               getInstanceName (ref).toString(),
+                               srv->record.target.toString(),
+                               htons (srv->record.port),
+                               txt->record.data);
+
+            query.reported = std::move (resolved);
+            return;
+        }
+
+        struct Change
+        {
+            const CachedRecord* answer;
+            bool isAdd;
+        };
+
+        std::vector<Change> changes;
+
+        const auto contains = [](const std::vector<CachedRecord>& records, const CachedRecord& record)
+        {
+            return std::any_of (records.begin(), records.end(), [&record](const CachedRecord& other)
+            {
+                return other.isSameRecord (record);
+            });
+        };
+
+        for (const auto& reported : query.reported)
+            if ( ! contains (answers, reported))
+                changes.push_back ({&reported, false});
+
+        for (const auto& answer : answers)
+            if ( ! contains (query.reported, answer))
+                changes.push_back ({&answer, true});
+
+        for (size_t index {0}; index < changes.size(); ++index)
+        {
+            const auto& change {changes[index]};
+            const auto& record {change.answer->record};
+            const auto flags {(DNSServiceFlags) ((change.isAdd ? kDNSServiceFlagsAdd : 0)
+                                                 | (index + 1 < changes.size() ? kDNSServiceFlagsMoreComing : 0))};
+
+            if (ref.kind == Kind::browse && ! record.target.isEmpty())
+            {
+                queueBrowseReply (ref,
+                                  flags,
+                                  change.answer->interfaceIndex,
+                                  kDNSServiceErr_NoError,
+                                  record.target.getLabel (0),
+                                  ref.type,
+                                  ref.domain);
+            }
+            else if (ref.kind == Kind::addressLookup)
+            {
+                queueAddressReply (ref,
+                                   flags,
+                                   change.answer->interfaceIndex,
+                                   ref.name,
+                                   makeSocketAddress (*change.answer),
+                                   change.answer->getRemainingTtl (now));
+            }
+            else if (ref.kind == Kind::recordQuery)
+            {
+                queueQueryRecordReply (ref,
+                                       flags,
+                                       change.answer->interfaceIndex,
+                                       kDNSServiceErr_NoError,
+                                       record.name.toString(),
+                                       record.type,
+                                       record.getData(),
+                                       change.isAdd ? change.answer->getRemainingTtl (now) : 0);
+            }
+        }
+
+        query.reported = std::move (answers);
+    }
+
+    static sockaddr_storage makeSocketAddress (const CachedRecord& cachedRecord)
+    {
+        sockaddr_storage address {};
+        const auto& data {cachedRecord.record.data};
+
+        if (cachedRecord.record.type == BonjourDnsRecord::aaaa && data.size() == 16)
+        {
+            auto& address6 {reinterpret_cast<sockaddr_in6&> (address)};
+            address6.sin6_family = AF_INET6;
+            address6.sin6_scope_id = cachedRecord.interfaceIndex;
+            std::copy (data.begin(), data.end(), address6.sin6_addr.s6_addr);
+        }
+        else if (cachedRecord.record.type == BonjourDnsRecord::a && data.size() == 4)
+        {
+            auto& address4 {reinterpret_cast<sockaddr_in&> (address)};
+            address4.sin_family = AF_INET;
+            std::copy (data.begin(), data.end(), reinterpret_cast<uint8_t*> (&address4.sin_addr));
+        }
+
+        return address;
+    }
+
+    void updateQueries (double now)
+    {
+        for (auto& iter : queries)
+            updateQuery (*iter.first, iter.second, now);
+    }
+
+    void refRemoved (Ref& ref) override
+    {
+        const auto iter {registrations.find (&ref)};
+
+        if (iter != registrations.end())
+        {
+            if (isAnswering (ref))
+                sendAnnouncement (ref, true);
+
+            registrations.erase (iter);
+        }
+
+        queries.erase (&ref);
+    }
+
+    //==============================================================================
+    // Receiving
+
+    void receivePackets()
+    {
+        for (;;)
+        {
+            sockaddr_in source {};
+            iovec buffer {receiveBuffer.data(), receiveBuffer.size()};
+            char control[CMSG_SPACE (sizeof (in_pktinfo))] {};
+
+            msghdr header {};
+            header.msg_name = &source;
+            header.msg_namelen = sizeof (source);
+            header.msg_iov = &buffer;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof (control);
+
+            const auto numBytes {recvmsg (socketFd, &header, 0)};
+
+            if (numBytes <= 0)
+                return;
+
+            uint32_t interfaceIndex {0};
+
+            for (auto* controlHeader {CMSG_FIRSTHDR (&header)}; controlHeader != nullptr; controlHeader = CMSG_NXTHDR (&header, controlHeader))
+                if (controlHeader->cmsg_level == IPPROTO_IP && controlHeader->cmsg_type == IP_PKTINFO)
+                    interfaceIndex = (uint32_t) reinterpret_cast<const in_pktinfo*> (CMSG_DATA (controlHeader))->ipi_ifindex;
+
+            const auto interface {std::find_if (interfaces.begin(), interfaces.end(), [interfaceIndex](const Interface& candidate)
+            {
+                return candidate.index == interfaceIndex;
+            })};
+
+            if (interface == interfaces.end())
+                continue;
+
+            const auto* data {receiveBuffer.data()};
+            const auto size {(size_t) numBytes};
+
+            // Malformed packets are dropped before any of them is acted on
+            if ( ! BonjourDnsReader::isValid (data, size))
+                continue;
+
+            const juce::ScopedLock lock {refsLock};
+
+            if (BonjourDnsReader {data, size}.isResponse())
+                handleResponse (data, size, source, *interface);
+            else
+                handleQuery (data, size, source, *interface);
+        }
+    }
+
+    // Everything received is read in place, only records that are new to the
+    // cache are copied out of the packet
+    void handleResponse (const uint8_t* data, size_t size, const sockaddr_in& source, const Interface& interface)
+    {
+        // Responses from any other port aren't multicast DNS responses
+        if (ntohs (source.sin_port) != port)
+            return;
+
+        const auto now {getTime()};
+        BonjourDnsReader reader {data, size};
+        BonjourDnsRecordView record;
+
+        while (reader.readNext (record))
+        {
+            if (record.section != BonjourDnsSection::answer && record.section != BonjourDnsSection::additional)
+                continue;
+
+            checkForConflicts (record, interface);
+
+            if (record.type == BonjourDnsRecord::ptr
+                || record.type == BonjourDnsRecord::srv
+                || record.type == BonjourDnsRecord::txt
+                || record.type == BonjourDnsRecord::a
+                || record.type == BonjourDnsRecord::aaaa)
+            {
+                addToCache (record, interface.index, now);
+            }
+        }
+
+        updateQueries (now);
+    }
+
+    // A service's SRV record names this host, so anyone else with an SRV
+    // record for the same name must be using the name too
+    void checkForConflicts (const BonjourDnsRecordView& record, const Interface& interface)
+    {
+        if (record.type != BonjourDnsRecord::srv || record.ttl == 0)
+            return;
+
+        for (auto& iter : registrations)
+        {
+            auto& ref {*iter.first};
+            auto& registration {iter.second};
+
+            if (registration.state == Registration::State::failed
+                || ! isOnInterface (ref, interface)
+                || record.name != registration.instanceName
+                || record.hasSameData (makeSrvRecord (ref, hostTtl)))
+            {
+                continue;
+            }
+
+            nameConflicted (ref, registration);
+        }
+    }
+
+    void addToCache (const BonjourDnsRecordView& record, uint32_t interfaceIndex, double now)
+    {
+        // A goodbye is kept for a second in case it crossed with an update
+        const auto isGoodbye {record.ttl == 0};
+        const auto expiryTime {now + (isGoodbye ? 1000.0 : record.ttl * 1000.0)};
+        const auto numRefreshes {isGoodbye ? 4 : 0};
+
+        // Every other record of a unique set is now out of date and is
+        // dropped straight away, so nothing can be answered from it. An SRV
+        // or TXT set only ever has one record, but an address set can be
+        // split over several packets so only addresses that weren't just
+        // received are dropped.
+        if (record.cacheFlush && ! isGoodbye)
+        {
+            const auto isSingleRecordSet {record.type == BonjourDnsRecord::srv || record.type == BonjourDnsRecord::txt};
+
+            cache.erase (std::remove_if (cache.begin(), cache.end(), [&](const CachedRecord& cachedRecord)
+                         {
+                             return cachedRecord.interfaceIndex == interfaceIndex
+                                 && cachedRecord.record.type == record.type
+                                 && record.name == cachedRecord.record.name
+                                 && ! record.hasSameData (cachedRecord.record)
+                                 && (isSingleRecordSet || cachedRecord.receivedTime < now - 1000.0);
+                         }),
+                         cache.end());
+        }
+
+        const auto existing {std::find_if (cache.begin(), cache.end(), [&](const CachedRecord& cachedRecord)
+        {
+            return cachedRecord.interfaceIndex == interfaceIndex && record.isSameRecord (cachedRecord.record);
+        })};
+
+        if (existing != cache.end())
+        {
+            existing->record.ttl = record.ttl;
+            existing->receivedTime = now;
+            existing->expiryTime = expiryTime;
+            existing->numRefreshes = numRefreshes;
+        }
+        else if (cache.size() < maxCacheSize)
+        {
+            CachedRecord received {record.toRecord(), interfaceIndex, now, expiryTime, numRefreshes};
+            received.record.cacheFlush = false;
+            cache.push_back (std::move (received));
+        }
+    }
+
+    // Whether the querier listed the record as one it already knows about,
+    // with at least half its TTL remaining
+    static bool isKnownAnswer (const uint8_t* data, size_t size, const BonjourDnsRecord& record)
+    {
+        BonjourDnsReader reader {data, size};
+        BonjourDnsRecordView knownAnswer;
+
+        while (reader.readNext (knownAnswer))
+        {
+            if (knownAnswer.section == BonjourDnsSection::answer
+                && (uint64_t) knownAnswer.ttl * 2 >= record.ttl
+                && knownAnswer.isSameRecord (record))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void handleQuery (const uint8_t* data, size_t size, const sockaddr_in& source, const Interface& interface)
+    {
+        resolveProbeTiebreaks (data, size, interface);
+
+        // A query from any other port is from a plain DNS client, which needs
+        // a conventional unicast reply
+        const auto isLegacy {ntohs (source.sin_port) != port};
+
+        std::vector<BonjourDnsRecord> answers;
+        std::vector<BonjourDnsRecord> additionals;
+        auto wantsUnicastResponse {isLegacy};
+        auto isShared {false};
+
+        const auto addRecord = [](std::vector<BonjourDnsRecord>& records, BonjourDnsRecord record)
+        {
+            if (std::none_of (records.begin(), records.end(), [&record](const BonjourDnsRecord& other) { return other.isSameRecord (record); }))
+                records.push_back (std::move (record));
+        };
+
+        BonjourDnsReader reader {data, size};
+        BonjourDnsRecordView question;
+
+        while (reader.readNext (question) && question.section == BonjourDnsSection::question)
+        {
+            const auto matchesType = [&question](uint16_t type)
+            {
+                return question.type == type || question.type == BonjourDnsRecord::any;
+            };
+
+            const auto numAnswers {answers.size()};
+
+            if (matchesType (BonjourDnsRecord::a) && question.name == hostName)
+                addRecord (answers, makeAddressRecord (interface));
+
+            for (const auto& iter : registrations)
+            {
+                const auto& ref {*iter.first};
+                const auto& registration {iter.second};
+
+                if ( ! isAnswering (ref) || ! isOnInterface (ref, interface))
+                    continue;
+
+                if (matchesType (BonjourDnsRecord::ptr) && question.name == servicesName)
+                {
+                    addRecord (answers, makeServicesPtrRecord (ref));
+                    isShared = true;
+                }
+
+                if (matchesType (BonjourDnsRecord::ptr) && question.name == registration.serviceTypeName)
+                {
+                    addRecord (answers, makePtrRecord (ref, txtTtl));
+                    addRecord (additionals, makeSrvRecord (ref, hostTtl));
+                    addRecord (additionals, makeTxtRecord (ref, txtTtl));
+                    addRecord (additionals, makeAddressRecord (interface));
+                    isShared = true;
+                }
+
+                if (question.name == registration.instanceName)
+                {
+                    if (matchesType (BonjourDnsRecord::srv))
+                    {
+                        addRecord (answers, makeSrvRecord (ref, hostTtl));
+                        addRecord (additionals, makeAddressRecord (interface));
+                    }
+
+                    if (matchesType (BonjourDnsRecord::txt))
+                        addRecord (answers, makeTxtRecord (ref, txtTtl));
+                }
+            }
+
+            if (answers.size() > numAnswers && question.wantsUnicastResponse)
+                wantsUnicastResponse = true;
+        }
+
+        // Known-answer suppression, anything the querier already knows about
+        // isn't sent again
+        const auto isKnown = [data, size](const BonjourDnsRecord& record)
+        {
+            return isKnownAnswer (data, size, record);
+        };
+
+        const auto isAnswered = [&](const BonjourDnsRecord& record)
+        {
+            return isKnown (record) || std::any_of (answers.begin(), answers.end(), [&record](const BonjourDnsRecord& answer)
+            {
+                return answer.isSameRecord (record);
+            });
+        };
+
+        answers.erase (std::remove_if (answers.begin(), answers.end(), isKnown), answers.end());
+        additionals.erase (std::remove_if (additionals.begin(), additionals.end(), isAnswered), additionals.end());
+
+        if (answers.empty())
+            return;
+
+        BonjourDnsMessage response;
+        response.flags = BonjourDnsMessage::responseFlags;
+        response.answers = std::move (answers);
+        response.additionals = std::move (additionals);
+
+        if (isLegacy)
+        {
+            // Plain DNS clients expect their question back, and records they
+            // won't cache for long as they'll never see a goodbye
+            BonjourDnsReader questionReader {data, size};
+            response.id = questionReader.getId();
+
+            while (questionReader.readNext (question) && question.section == BonjourDnsSection::question)
+                response.questions.push_back (question.toQuestion());
+
+            for (auto* section : {&response.answers, &response.additionals})
+            {
+                for (auto& record : *section)
+                {
+                    record.cacheFlush = false;
+                    record.ttl = juce::jmin (record.ttl, (uint32_t) 10);
+                }
+            }
+        }
+
+        if (wantsUnicastResponse)
+        {
+            send (response, interface, &source);
+            return;
+        }
+
+        // Answers that others may also give are delayed so they can be
+        // suppressed, and so answers to several queries can go together
+        const auto dueTime {getTime() + (isShared ? random.nextInt ({20, 120}) : 0)};
+
+        for (auto& pendingResponse : pendingResponses)
+        {
+            if (pendingResponse.interface.index == interface.index)
+            {
+                for (auto& record : response.answers)
+                    addRecord (pendingResponse.message.answers, std::move (record));
+
+                for (auto& record : response.additionals)
+                    addRecord (pendingResponse.message.additionals, std::move (record));
+
+                pendingResponse.dueTime = juce::jmin (pendingResponse.dueTime, dueTime);
+                wakeupSignal.signal();
+                return;
+            }
+        }
+
+        pendingResponses.push_back ({std::move (response), interface, dueTime});
+        wakeupSignal.signal();
+    }
+
+    // Two hosts probing for the same name at once each compare the records
+    // in the other's probe against their own, and the earlier ones back off
+    void resolveProbeTiebreaks (const uint8_t* data, size_t size, const Interface& interface)
+    {
+        if (BonjourDnsReader {data, size}.getCount (BonjourDnsSection::authority) == 0)
+            return;
+
+        for (auto& iter : registrations)
+        {
+            auto& ref {*iter.first};
+            auto& registration {iter.second};
+
+            if (registration.state != Registration::State::probing || ! isOnInterface (ref, interface))
+                continue;
+
+            const auto& name {registration.instanceName};
+            const auto theirs {getProbeData (data, size, name)};
+
+            if (theirs.empty())
+                continue;
+
+            const auto ours {getProbeData ({makeSrvRecord (ref, hostTtl), makeTxtRecord (ref, txtTtl)}, name)};
+
+            // Probes identical to ours are our own coming back to us
+            if (theirs > ours)
+                startProbing (registration, 1000);
+        }
+    }
+
+    //==============================================================================
+    // Timers
+
+    void performDueWork (double now)
+    {
+        for (auto& iter : registrations)
+        {
+            auto& ref {*iter.first};
+            auto& registration {iter.second};
+
+            if (registration.nextTime > now)
+                continue;
+
+            if (registration.state == Registration::State::probing)
+            {
+                if (registration.numPacketsSent < numProbes)
+                {
+                    sendProbe (ref);
+                    ++registration.numPacketsSent;
+                    registration.nextTime = now + probeInterval;
+                    continue;
+                }
+
+                // Nobody objected, so the name is ours
+                registration.state = Registration::State::announcing;
+                registration.numPacketsSent = 0;
+                queueRegisterReply (ref, kDNSServiceFlagsAdd, kDNSServiceErr_NoError);
+            }
+
+            if (registration.state == Registration::State::announcing)
+            {
+                sendAnnouncement (ref, false);
+                registration.nextTime = now + 1000.0;
+
+                if (++registration.numPacketsSent >= numAnnouncements)
+                    registration.state = Registration::State::announced;
+            }
+        }
+
+        for (auto& iter : queries)
+        {
+            auto& query {iter.second};
+
+            if (query.nextTime > now)
+                continue;
+
+            sendQuery (*iter.first, query, now);
+            query.nextTime = now + query.interval;
+            query.interval = juce::jmin (query.interval * 2.0, maxQueryInterval);
+        }
+
+        refreshCache (now);
+
+        for (auto iter {pendingResponses.begin()}; iter != pendingResponses.end();)
+        {
+            if (iter->dueTime <= now)
+            {
+                send (iter->message, iter->interface);
+                iter = pendingResponses.erase (iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
+
+    void refreshCache (double now)
+    {
+        // Records that are still wanted are asked for again before they expire
+        std::map<uint32_t, BonjourDnsMessage> refreshQueries;
+
+        for (auto& cachedRecord : cache)
+        {
+            if (cachedRecord.numRefreshes >= 4 || cachedRecord.getRefreshTime() > now)
+                continue;
+
+            ++cachedRecord.numRefreshes;
+
+            const auto isWanted {std::any_of (queries.begin(), queries.end(), [&cachedRecord](const auto& iter)
+            {
+                const auto& questions {iter.second.questions};
+
+                return std::any_of (questions.begin(), questions.end(), [&](const BonjourDnsQuestion& question)
+                {
+                    return isAnswer (cachedRecord, question, iter.first->interfaceIndex);
+                });
+            })};
+
+            if (isWanted)
+                refreshQueries[cachedRecord.interfaceIndex].questions.push_back ({cachedRecord.record.name, cachedRecord.record.type, false});
+        }
+
+        for (const auto& iter : refreshQueries)
+            for (const auto& interface : getInterfaces (iter.first))
+                send (iter.second, interface);
+
+        const auto firstExpired {std::remove_if (cache.begin(), cache.end(), [now](const CachedRecord& cachedRecord)
+        {
+            return cachedRecord.expiryTime <= now;
+        })};
+
+        if (firstExpired != cache.end())
+        {
+            cache.erase (firstExpired, cache.end());
+            updateQueries (now);
+        }
+    }
+
+    int getMillisecondsUntilDueWork (double now) const
+    {
+        auto nextTime {std::numeric_limits<double>::max()};
+
+        for (const auto& iter : registrations)
+            if (iter.second.state == Registration::State::probing || iter.second.state == Registration::State::announcing)
+                nextTime = juce::jmin (nextTime, iter.second.nextTime);
+
+        for (const auto& iter : queries)
+            nextTime = juce::jmin (nextTime, iter.second.nextTime);
+
+        for (const auto& cachedRecord : cache)
+        {
+            nextTime = juce::jmin (nextTime, cachedRecord.expiryTime);
+
+            if (cachedRecord.numRefreshes < 4)
+                nextTime = juce::jmin (nextTime, cachedRecord.getRefreshTime());
+        }
+
+        for (const auto& pendingResponse : pendingResponses)
+            nextTime = juce::jmin (nextTime, pendingResponse.dueTime);
+
+        if (nextTime == std::numeric_limits<double>::max())
+            return -1;
+
+        return nextTime > now ? (int) std::ceil (nextTime - now) : 0;
+    }
+
+    void run() override
+    {
+        while ( ! threadShouldExit())
+        {
+            int timeoutMs {-1};
+
+            {
+                const juce::ScopedLock lock {refsLock};
+                timeoutMs = getMillisecondsUntilDueWork (getTime());
+            }
+
+            pollfd fds[2] {};
+            fds[0].fd = wakeupSignal.getFd();
+            fds[0].events = POLLIN;
+            fds[1].fd = socketFd;
+            fds[1].events = POLLIN;
+
+            if (poll (fds, 2, timeoutMs) < 0)
+                continue;
+
+            if (fds[0].revents != 0)
+                wakeupSignal.clear();
+
+            if (fds[1].revents != 0)
+                receivePackets();
+
+            const juce::ScopedLock lock {refsLock};
+            performDueWork (getTime());
+        }
+    }
+
+    struct PendingResponse
+    {
+        BonjourDnsMessage message;
+        Interface interface;
+        double dueTime {0.0};
+    };
+
+    const int port;
+    const BonjourDnsName hostName;
+    std::vector<Interface> interfaces;
+    int socketFd {-1};
+    BonjourWakeupSignal wakeupSignal;
+    std::array<uint8_t, BonjourDnsMessage::maxSize> receiveBuffer {};
+
+    // Everything below is guarded by the refs lock
+    std::array<uint8_t, BonjourDnsMessage::maxSize> sendBuffer {};
+    juce::Random random;
+    std::unordered_map<Ref*, Registration> registrations;
+    std::unordered_map<Ref*, Query> queries;
+    std::vector<CachedRecord> cache;
+    std::vector<PendingResponse> pendingResponses;
+
+    JUCE_DECLARE_NON_COPYABLE (BonjourMdnsBackend)
+};
+
+BonjourBackend& BonjourBackend::getDefault()
+{
+    static BonjourMdnsBackend mdnsBackend {{}};
+    return mdnsBackend;
+}
+
+#include "jucey_BonjourMdnsBackendTests.cpp"
+
+#endif // JUCEY_NATIVE_MDNS
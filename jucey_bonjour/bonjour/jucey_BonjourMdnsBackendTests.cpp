@@ -0,0 +1,222 @@
+
+#if JUCEY_UNIT_TESTS
+
+class BonjourMdnsBackendTests : private juce::UnitTest
+{
+public:
+    BonjourMdnsBackendTests()
+        : juce::UnitTest ("BonjourMdnsBackend", "Networking")
+    {
+
+    }
+
+    ~BonjourMdnsBackendTests()
+    {
+
+    }
+
+private:
+    // Every backend in a test uses the same port on the loopback interface,
+    // so they only talk to each other
+    static BonjourMdnsBackend::Options makeOptions (int port, const juce::String& hostName)
+    {
+        BonjourMdnsBackend::Options options;
+        options.interfaceAddress = "127.0.0.1";
+        options.port = port;
+        options.hostName = hostName;
+        return options;
+    }
+
+    static int getTestPort()
+    {
+        return 54000 + juce::Random::getSystemRandom().nextInt (1000);
+    }
+
+    void waitForOperationsToStop (const BonjourMdnsBackend& backend)
+    {
+        for (auto attempt {0}; backend.getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+
+        expect (backend.getNumActiveOperations() == 0);
+    }
+
+    // Probing for the name takes a little under a second
+    jucey::BonjourService registerService (BonjourMdnsBackend& backend,
+                                           jucey::BonjourService& serviceToRegister,
+                                           int portToRegister)
+    {
+        jucey::BonjourService registeredService;
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        const auto onServiceRegistered = [&](const jucey::BonjourService& service, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            registeredService = service;
+            onServiceRegisteredEvent.signal();
+        };
+
+        BonjourBackend::install (&backend);
+        expect (serviceToRegister.registerAsync (onServiceRegistered, portToRegister));
+        BonjourBackend::install (nullptr);
+
+        expect (onServiceRegisteredEvent.wait (3000));
+        return registeredService;
+    }
+
+    void runRoundTripTests()
+    {
+        beginTest ("Round Trip");
+
+        const auto port {getTestPort()};
+        BonjourMdnsBackend responder {makeOptions (port, "jucey-mdns-responder.local.")};
+        BonjourMdnsBackend querier {makeOptions (port, "jucey-mdns-querier.local.")};
+
+        if ( ! responder.isOpen() || ! querier.isOpen())
+        {
+            logMessage ("Skipped: multicast isn't available on the loopback interface");
+            return;
+        }
+
+        jucey::BonjourService::clearResolveCache();
+
+        {
+            jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY mDNS Test Service", "local"};
+            serviceToRegister.setRecordItemValue ("keyA", "valueA");
+            serviceToRegister.setRecordItemValue ("keyB", "valueB");
+
+            const auto registeredService {registerService (responder, serviceToRegister, 12345)};
+            expect (registeredService.getName() == "JUCEY mDNS Test Service");
+
+            // everything else is asked of the other backend, over the network
+            BonjourBackend::install (&querier);
+
+            jucey::BonjourService discoveredService;
+            juce::WaitableEvent onServiceDiscoveredEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                                 bool isAvailable,
+                                                 bool,
+                                                 const juce::Result& result)
+            {
+                if ( ! isAvailable)
+                    return;
+
+                expect (result.wasOk());
+                discoveredService = service;
+                onServiceDiscoveredEvent.signal();
+            };
+
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+            expect (onServiceDiscoveredEvent.wait (2000));
+            expect (discoveredService.getName() == registeredService.getName());
+            expect (discoveredService.getInterfaceIndex() == (int) if_nametoindex ("lo"));
+
+            juce::WaitableEvent onServiceResolvedEvent;
+
+            const auto onServiceResolved = [&](const jucey::BonjourService& service,
+                                               const juce::String& hostName,
+                                               int resolvedPort,
+                                               const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (hostName == responder.getHostName());
+                expect (resolvedPort == 12345);
+                expect (service.getRecordItemValue ("keyA") == "valueA");
+                expect (service.getRecordItemValue ("keyB") == "valueB");
+                onServiceResolvedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToResolve {discoveredService};
+            expect (serviceToResolve.resolveAsync (onServiceResolved));
+            expect (onServiceResolvedEvent.wait (2000));
+
+            // only IPv4 addresses are answered
+            std::vector<juce::IPAddress> addresses;
+            juce::WaitableEvent onAddressResolvedEvent;
+
+            const auto onAddressResolved = [&](const jucey::BonjourService&,
+                                               const juce::String&,
+                                               int,
+                                               const juce::IPAddress& address,
+                                               bool isAvailable,
+                                               bool isMoreComing,
+                                               const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (isAvailable);
+                addresses.push_back (address);
+
+                if ( ! isMoreComing)
+                    onAddressResolvedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToLookUp {discoveredService};
+            expect (serviceToLookUp.resolveAddressAsync (onAddressResolved));
+            expect (onAddressResolvedEvent.wait (2000));
+            expect (addresses == std::vector<juce::IPAddress> {juce::IPAddress {"127.0.0.1"}});
+
+            // the goodbye sent when the service is withdrawn is seen by
+            // anyone browsing
+            juce::WaitableEvent onServiceRemovedEvent;
+
+            const auto onServiceRemoved = [&](const jucey::BonjourService& service,
+                                              bool isAvailable,
+                                              bool,
+                                              const juce::Result&)
+            {
+                if ( ! isAvailable && service.getName() == registeredService.getName())
+                    onServiceRemovedEvent.signal();
+            };
+
+            jucey::BonjourService serviceToWatch {"_test._udp"};
+            expect (serviceToWatch.discoverAsync (onServiceRemoved));
+            serviceToRegister = jucey::BonjourService {};
+            expect (onServiceRemovedEvent.wait (2000));
+
+            BonjourBackend::install (nullptr);
+        }
+
+        jucey::BonjourService::clearResolveCache();
+        waitForOperationsToStop (responder);
+        waitForOperationsToStop (querier);
+    }
+
+    void runNameConflictTests()
+    {
+        beginTest ("Name Conflict");
+
+        const auto port {getTestPort()};
+        BonjourMdnsBackend firstHost {makeOptions (port, "jucey-mdns-first.local.")};
+        BonjourMdnsBackend secondHost {makeOptions (port, "jucey-mdns-second.local.")};
+
+        if ( ! firstHost.isOpen() || ! secondHost.isOpen())
+        {
+            logMessage ("Skipped: multicast isn't available on the loopback interface");
+            return;
+        }
+
+        {
+            jucey::BonjourService firstService {"_test._udp", "JUCEY mDNS Conflict", "local"};
+            jucey::BonjourService secondService {"_test._udp", "jucey mdns conflict", "local"};
+
+            // the second host's probe is answered by the first, so it has to
+            // pick another name
+            expect (registerService (firstHost, firstService, 1000).getName() == "JUCEY mDNS Conflict");
+            expect (registerService (secondHost, secondService, 1001).getName() == "jucey mdns conflict (2)");
+        }
+
+        waitForOperationsToStop (firstHost);
+        waitForOperationsToStop (secondHost);
+    }
+
+    void runTest() override
+    {
+        runRoundTripTests();
+        runNameConflictTests();
+    }
+};
+
+static BonjourMdnsBackendTests bonjourMdnsBackendTests;
+
+#endif // JUCEY_UNIT_TESTS
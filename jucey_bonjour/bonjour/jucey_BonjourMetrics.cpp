@@ -0,0 +1,260 @@
+
+// Set by the event loop while a reply is being processed, to when its socket
+// became readable
+static thread_local juce::int64 bonjourReplyReadyTicks {0};
+
+// A lock-free histogram that can be recorded into from any thread
+class BonjourLatencyHistogram
+{
+public:
+    using Histogram = jucey::BonjourMetrics::Histogram;
+
+    void record (uint64_t microseconds)
+    {
+        counts[(size_t) Histogram::getBucketIndex (microseconds)].fetch_add (1, std::memory_order_relaxed);
+        numSamples.fetch_add (1, std::memory_order_relaxed);
+        totalMicroseconds.fetch_add (microseconds, std::memory_order_relaxed);
+
+        auto currentMax {maxMicroseconds.load (std::memory_order_relaxed)};
+
+        while (microseconds > currentMax
+               && ! maxMicroseconds.compare_exchange_weak (currentMax, microseconds, std::memory_order_relaxed)) {}
+    }
+
+    void copyTo (Histogram& histogram) const
+    {
+        for (size_t index {0}; index < counts.size(); ++index)
+            histogram.counts[index] = counts[index].load (std::memory_order_relaxed);
+
+        histogram.numSamples = numSamples.load (std::memory_order_relaxed);
+        histogram.totalMicroseconds = totalMicroseconds.load (std::memory_order_relaxed);
+        histogram.maxMicroseconds = maxMicroseconds.load (std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        for (auto& count : counts)
+            count.store (0, std::memory_order_relaxed);
+
+        numSamples.store (0, std::memory_order_relaxed);
+        totalMicroseconds.store (0, std::memory_order_relaxed);
+        maxMicroseconds.store (0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, Histogram::numBuckets> counts {};
+    std::atomic<uint64_t> numSamples {0};
+    std::atomic<uint64_t> totalMicroseconds {0};
+    std::atomic<uint64_t> maxMicroseconds {0};
+};
+
+// Records the process-wide metrics. Everything is a relaxed atomic, nothing
+// is ordered with anything else, and a snapshot may be taken part way through
+// an operation being recorded.
+class BonjourMetricsRecorder
+{
+public:
+    using OperationKind = jucey::BonjourMetrics::OperationKind;
+
+    static BonjourMetricsRecorder& getInstance()
+    {
+        static BonjourMetricsRecorder instance;
+        return instance;
+    }
+
+    void operationStarted (OperationKind kind)
+    {
+        startedOperations[(size_t) kind].fetch_add (1, std::memory_order_relaxed);
+        activeOperations[(size_t) kind].fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void operationStopped (OperationKind kind)
+    {
+        activeOperations[(size_t) kind].fetch_sub (1, std::memory_order_relaxed);
+    }
+
+    // Called by the event loop either side of processing a reply
+    void replyStarted (juce::int64 readyTicks)
+    {
+        bonjourReplyReadyTicks = readyTicks;
+    }
+
+    void replyFinished (juce::int64 startTicks)
+    {
+        bonjourReplyReadyTicks = 0;
+        numRepliesProcessed.fetch_add (1, std::memory_order_relaxed);
+        processResultTime.record (microsecondsBetween (startTicks, juce::Time::getHighResolutionTicks()));
+    }
+
+    void errorReturned (DNSServiceErrorType errorCode)
+    {
+        const auto index {kDNSServiceErr_Unknown - (juce::int64) errorCode};
+
+        if (index >= 0 && index < (juce::int64) errorCounts.size())
+            errorCounts[(size_t) index].fetch_add (1, std::memory_order_relaxed);
+        else
+            numUnrecognisedErrors.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    // Wraps a user callback so its run time is recorded, along with how long
+    // it's been since the reply it's for became readable. This has to be
+    // called while the reply is being processed, but the returned function
+    // can be called on any thread.
+    template <typename Callback>
+    static auto timeCallback (Callback&& callback)
+    {
+        return [callback = std::forward<Callback> (callback), readyTicks = bonjourReplyReadyTicks]() mutable
+        {
+            const auto startTicks {juce::Time::getHighResolutionTicks()};
+            callback();
+            getInstance().callbackFinished (readyTicks, startTicks);
+        };
+    }
+
+    jucey::BonjourMetrics::Snapshot getSnapshot() const
+    {
+        jucey::BonjourMetrics::Snapshot snapshot;
+
+        for (size_t index {0}; index < jucey::BonjourMetrics::numOperationKinds; ++index)
+        {
+            snapshot.activeOperations[index] = activeOperations[index].load (std::memory_order_relaxed);
+            snapshot.startedOperations[index] = startedOperations[index].load (std::memory_order_relaxed);
+        }
+
+        snapshot.numRepliesProcessed = numRepliesProcessed.load (std::memory_order_relaxed);
+        snapshot.numCallbacksCalled = numCallbacksCalled.load (std::memory_order_relaxed);
+        processResultTime.copyTo (snapshot.processResultTime);
+        callbackTime.copyTo (snapshot.callbackTime);
+        readyToCallbackTime.copyTo (snapshot.readyToCallbackTime);
+
+        for (size_t index {0}; index < errorCounts.size(); ++index)
+            if (const auto count {errorCounts[index].load (std::memory_order_relaxed)})
+                snapshot.errorCounts[kDNSServiceErr_Unknown - (int) index] = count;
+
+        snapshot.numUnrecognisedErrors = numUnrecognisedErrors.load (std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    void reset()
+    {
+        for (auto& count : startedOperations)
+            count.store (0, std::memory_order_relaxed);
+
+        for (auto& count : errorCounts)
+            count.store (0, std::memory_order_relaxed);
+
+        numRepliesProcessed.store (0, std::memory_order_relaxed);
+        numCallbacksCalled.store (0, std::memory_order_relaxed);
+        numUnrecognisedErrors.store (0, std::memory_order_relaxed);
+        processResultTime.reset();
+        callbackTime.reset();
+        readyToCallbackTime.reset();
+    }
+
+private:
+    BonjourMetricsRecorder() = default;
+
+    static uint64_t microsecondsBetween (juce::int64 startTicks, juce::int64 endTicks)
+    {
+        return (uint64_t) juce::jmax (0.0, juce::Time::highResolutionTicksToSeconds (endTicks - startTicks) * 1.0e6);
+    }
+
+    void callbackFinished (juce::int64 readyTicks, juce::int64 startTicks)
+    {
+        numCallbacksCalled.fetch_add (1, std::memory_order_relaxed);
+        callbackTime.record (microsecondsBetween (startTicks, juce::Time::getHighResolutionTicks()));
+
+        // Callbacks that aren't for a reply, such as results answered from
+        // the resolve cache, have nothing to measure from
+        if (readyTicks != 0)
+            readyToCallbackTime.record (microsecondsBetween (readyTicks, startTicks));
+    }
+
+    // The error codes dns_sd defines count down from kDNSServiceErr_Unknown
+    static constexpr size_t numErrorCodes {128};
+
+    std::array<std::atomic<juce::int64>, jucey::BonjourMetrics::numOperationKinds> activeOperations {};
+    std::array<std::atomic<uint64_t>, jucey::BonjourMetrics::numOperationKinds> startedOperations {};
+    std::array<std::atomic<uint64_t>, numErrorCodes> errorCounts {};
+    std::atomic<uint64_t> numRepliesProcessed {0};
+    std::atomic<uint64_t> numCallbacksCalled {0};
+    std::atomic<uint64_t> numUnrecognisedErrors {0};
+    BonjourLatencyHistogram processResultTime;
+    BonjourLatencyHistogram callbackTime;
+    BonjourLatencyHistogram readyToCallbackTime;
+
+    JUCE_DECLARE_NON_COPYABLE (BonjourMetricsRecorder)
+};
+
+namespace jucey
+{
+    int BonjourMetrics::Histogram::getBucketIndex (uint64_t microseconds)
+    {
+        if (microseconds < (uint64_t) numLinearBuckets)
+            return (int) microseconds;
+
+        auto exponent {0};
+
+        for (auto value {microseconds}; value > 1; value >>= 1)
+            ++exponent;
+
+        const auto subBucket {(int) (microseconds >> (exponent - 3)) & (numSubBuckets - 1)};
+        return juce::jmin (numBuckets - 1, numLinearBuckets + (exponent - 4) * numSubBuckets + subBucket);
+    }
+
+    uint64_t BonjourMetrics::Histogram::getBucketLowerBound (int bucketIndex)
+    {
+        if (bucketIndex < numLinearBuckets)
+            return (uint64_t) juce::jmax (0, bucketIndex);
+
+        const auto exponent {4 + (bucketIndex - numLinearBuckets) / numSubBuckets};
+        const auto subBucket {(bucketIndex - numLinearBuckets) % numSubBuckets};
+        return (uint64_t) (numSubBuckets + subBucket) << (exponent - 3);
+    }
+
+    double BonjourMetrics::Histogram::getMeanMicroseconds() const
+    {
+        return numSamples > 0 ? (double) totalMicroseconds / (double) numSamples : 0.0;
+    }
+
+    uint64_t BonjourMetrics::Histogram::getPercentileMicroseconds (double percentile) const
+    {
+        if (numSamples == 0)
+            return 0;
+
+        const auto target {juce::jmax ((uint64_t) 1, (uint64_t) std::ceil (juce::jlimit (0.0, 100.0, percentile) / 100.0 * (double) numSamples))};
+        uint64_t numBelow {0};
+
+        for (auto index {0}; index < numBuckets; ++index)
+        {
+            numBelow += counts[(size_t) index];
+
+            if (numBelow >= target)
+                return getBucketLowerBound (index);
+        }
+
+        return getBucketLowerBound (numBuckets - 1);
+    }
+
+    int64_t BonjourMetrics::Snapshot::getNumActiveOperations (OperationKind kind) const
+    {
+        return activeOperations[(size_t) kind];
+    }
+
+    uint64_t BonjourMetrics::Snapshot::getNumStartedOperations (OperationKind kind) const
+    {
+        return startedOperations[(size_t) kind];
+    }
+
+    BonjourMetrics::Snapshot BonjourMetrics::getSnapshot()
+    {
+        return BonjourMetricsRecorder::getInstance().getSnapshot();
+    }
+
+    void BonjourMetrics::reset()
+    {
+        BonjourMetricsRecorder::getInstance().reset();
+    }
+}
+
+#include "jucey_BonjourMetricsTests.cpp"
@@ -0,0 +1,79 @@
+#pragma once
+
+namespace jucey
+{
+    // Process-wide counters and latency histograms for every bonjour
+    // operation. Recording is a handful of relaxed atomic operations so it's
+    // always on, and taking a snapshot never blocks an operation.
+    class BonjourMetrics
+    {
+    public:
+        enum class OperationKind
+        {
+            connection,
+            browse,
+            resolve,
+            registration,
+            addressLookup,
+            recordQuery
+        };
+
+        static constexpr size_t numOperationKinds {6};
+
+        // Latencies in microseconds, in log-linear buckets. Values below 16us
+        // each have a bucket of their own, above that each power of two is
+        // split into 8 buckets, so any value is within 12.5% of its bucket.
+        struct Histogram
+        {
+            static constexpr int numLinearBuckets {16};
+            static constexpr int numSubBuckets {8};
+            static constexpr int numBuckets {numLinearBuckets + 28 * numSubBuckets};
+
+            static int getBucketIndex (uint64_t microseconds);
+            static uint64_t getBucketLowerBound (int bucketIndex);
+
+            double getMeanMicroseconds() const;
+
+            // Returns the lower bound of the bucket the percentile falls in,
+            // where the percentile is between 0.0 and 100.0
+            uint64_t getPercentileMicroseconds (double percentile) const;
+
+            std::array<uint64_t, numBuckets> counts {};
+            uint64_t numSamples {0};
+            uint64_t totalMicroseconds {0};
+            uint64_t maxMicroseconds {0};
+        };
+
+        struct Snapshot
+        {
+            int64_t getNumActiveOperations (OperationKind kind) const;
+            uint64_t getNumStartedOperations (OperationKind kind) const;
+
+            std::array<int64_t, numOperationKinds> activeOperations {};
+            std::array<uint64_t, numOperationKinds> startedOperations {};
+
+            uint64_t numRepliesProcessed {0};
+            uint64_t numCallbacksCalled {0};
+
+            // How long each call to DNSServiceProcessResult took
+            Histogram processResultTime;
+
+            // How long each user callback took to run
+            Histogram callbackTime;
+
+            // From a socket becoming readable to the callback for the reply
+            // starting, including any time spent in a callback dispatcher
+            Histogram readyToCallbackTime;
+
+            // The number of times each DNS service error code has been
+            // returned, codes dns_sd doesn't define are counted together
+            std::map<int, uint64_t> errorCounts;
+            uint64_t numUnrecognisedErrors {0};
+        };
+
+        static Snapshot getSnapshot();
+
+        // Clears everything except the number of active operations
+        static void reset();
+    };
+}
@@ -0,0 +1,175 @@
+
+#if JUCEY_UNIT_TESTS
+
+class BonjourMetricsTests : private juce::UnitTest
+{
+public:
+    BonjourMetricsTests()
+        : juce::UnitTest ("BonjourMetrics", "Networking")
+    {
+
+    }
+
+    ~BonjourMetricsTests()
+    {
+
+    }
+
+private:
+    using Histogram = jucey::BonjourMetrics::Histogram;
+    using OperationKind = jucey::BonjourMetrics::OperationKind;
+
+    void runHistogramBucketTests()
+    {
+        beginTest ("Histogram Buckets");
+
+        for (uint64_t value {0}; value < (uint64_t) Histogram::numLinearBuckets; ++value)
+            expect (Histogram::getBucketIndex (value) == (int) value);
+
+        // every bucket starts where the previous one ends
+        for (auto index {1}; index < Histogram::numBuckets; ++index)
+        {
+            const auto lowerBound {Histogram::getBucketLowerBound (index)};
+            expect (lowerBound > Histogram::getBucketLowerBound (index - 1));
+            expect (Histogram::getBucketIndex (lowerBound) == index);
+            expect (Histogram::getBucketIndex (lowerBound - 1) == index - 1);
+        }
+
+        // and every value is within an eighth of its bucket
+        for (const auto value : {17ull, 100ull, 1000ull, 123456ull, 98765432ull})
+        {
+            const auto lowerBound {Histogram::getBucketLowerBound (Histogram::getBucketIndex (value))};
+            expect (lowerBound <= value);
+            expect ((double) (value - lowerBound) <= (double) value / 8.0);
+        }
+
+        expect (Histogram::getBucketIndex (std::numeric_limits<uint64_t>::max()) == Histogram::numBuckets - 1);
+    }
+
+    void runHistogramPercentileTests()
+    {
+        beginTest ("Histogram Percentiles");
+
+        BonjourLatencyHistogram latencies;
+        Histogram histogram;
+
+        latencies.copyTo (histogram);
+        expect (histogram.getPercentileMicroseconds (50.0) == 0);
+        expect (histogram.getMeanMicroseconds() == 0.0);
+
+        for (uint64_t value {1}; value <= 10; ++value)
+            latencies.record (value);
+
+        latencies.record (1000);
+        latencies.copyTo (histogram);
+
+        expect (histogram.numSamples == 11);
+        expect (histogram.maxMicroseconds == 1000);
+        expect (histogram.getPercentileMicroseconds (0.0) == 1);
+        expect (histogram.getPercentileMicroseconds (50.0) == 6);
+        expect (histogram.getPercentileMicroseconds (90.0) == 10);
+        expect (histogram.getPercentileMicroseconds (100.0) == Histogram::getBucketLowerBound (Histogram::getBucketIndex (1000)));
+        expectWithinAbsoluteError (histogram.getMeanMicroseconds(), 1055.0 / 11.0, 0.001);
+
+        latencies.reset();
+        latencies.copyTo (histogram);
+        expect (histogram.numSamples == 0);
+        expect (histogram.maxMicroseconds == 0);
+    }
+
+    void runErrorCountTests()
+    {
+        beginTest ("Error Counts");
+
+        jucey::BonjourMetrics::reset();
+
+        auto& recorder {BonjourMetricsRecorder::getInstance()};
+        recorder.errorReturned (kDNSServiceErr_BadParam);
+        recorder.errorReturned (kDNSServiceErr_BadParam);
+        recorder.errorReturned (kDNSServiceErr_NameConflict);
+        recorder.errorReturned (12345);
+
+        auto snapshot {jucey::BonjourMetrics::getSnapshot()};
+        expect (snapshot.errorCounts.size() == 2);
+        expect (snapshot.errorCounts[kDNSServiceErr_BadParam] == 2);
+        expect (snapshot.errorCounts[kDNSServiceErr_NameConflict] == 1);
+        expect (snapshot.numUnrecognisedErrors == 1);
+
+        jucey::BonjourMetrics::reset();
+        snapshot = jucey::BonjourMetrics::getSnapshot();
+        expect (snapshot.errorCounts.empty());
+        expect (snapshot.numUnrecognisedErrors == 0);
+    }
+
+    void runOperationTests()
+    {
+        beginTest ("Operations");
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourMetrics::reset();
+
+        const auto before {jucey::BonjourMetrics::getSnapshot()};
+
+        {
+            jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Metrics Test", "local"};
+            juce::WaitableEvent onServiceRegisteredEvent;
+
+            expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result&)
+            {
+                onServiceRegisteredEvent.signal();
+            }, 4000));
+
+            expect (onServiceRegisteredEvent.wait (1000));
+
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            juce::WaitableEvent onServiceDiscoveredEvent;
+
+            expect (serviceToDiscover.discoverAsync ([&](const jucey::BonjourService&, bool, bool, const juce::Result&)
+            {
+                // make the callback slow enough to measure
+                juce::Thread::sleep (2);
+                onServiceDiscoveredEvent.signal();
+            }));
+
+            expect (onServiceDiscoveredEvent.wait (1000));
+
+            // the counts are updated just after each callback returns
+            auto during {jucey::BonjourMetrics::getSnapshot()};
+
+            for (auto attempt {0}; (during.numCallbacksCalled < 2 || during.processResultTime.numSamples < 2) && attempt < 100; ++attempt)
+            {
+                juce::Thread::sleep (10);
+                during = jucey::BonjourMetrics::getSnapshot();
+            }
+
+            expect (during.getNumActiveOperations (OperationKind::registration) == before.getNumActiveOperations (OperationKind::registration) + 1);
+            expect (during.getNumActiveOperations (OperationKind::browse) == before.getNumActiveOperations (OperationKind::browse) + 1);
+            expect (during.getNumStartedOperations (OperationKind::registration) == 1);
+            expect (during.getNumStartedOperations (OperationKind::browse) == 1);
+            expect (during.numRepliesProcessed >= 2);
+            expect (during.numCallbacksCalled >= 2);
+            expect (during.callbackTime.maxMicroseconds >= 2000);
+            expect (during.readyToCallbackTime.numSamples >= 2);
+            expect (during.processResultTime.numSamples >= 2);
+        }
+
+        const auto after {jucey::BonjourMetrics::getSnapshot()};
+        expect (after.getNumActiveOperations (OperationKind::registration) == before.getNumActiveOperations (OperationKind::registration));
+        expect (after.getNumActiveOperations (OperationKind::browse) == before.getNumActiveOperations (OperationKind::browse));
+
+        for (auto attempt {0}; responder.getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+    }
+
+    void runTest() override
+    {
+        runHistogramBucketTests();
+        runHistogramPercentileTests();
+        runErrorCountTests();
+        runOperationTests();
+    }
+};
+
+static BonjourMetricsTests bonjourMetricsTests;
+
+#endif // JUCEY_UNIT_TESTS
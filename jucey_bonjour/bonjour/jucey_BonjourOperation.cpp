@@ -0,0 +1,153 @@
+
+namespace jucey
+{
+    // Cancelling marks the operation straight away, so any reply that arrives
+    // after that is dropped, and leaves stopping it to the event loop thread
+    // where its ref can be deallocated without the caller waiting on the
+    // event loop lock
+    class BonjourOperation::State
+    {
+    public:
+        // Must be called with the event loop lock held
+        void stopIfRunning()
+        {
+            if (stop != nullptr)
+                std::exchange (stop, nullptr)();
+        }
+
+        static void stopLater (std::vector<std::shared_ptr<State>> statesToStop)
+        {
+            const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+            eventLoop->postWithoutWaiting ([statesToStop = std::move (statesToStop)]
+            {
+                for (const auto& state : statesToStop)
+                    state->stopIfRunning();
+            });
+        }
+
+        std::atomic<bool> isCancelled {false};
+
+        // Set by the service that started the operation and cleared once it
+        // has stopped for any reason, only used with the event loop lock held
+        std::function<void()> stop {nullptr};
+    };
+
+    BonjourOperation::BonjourOperation()
+    {
+
+    }
+
+    BonjourOperation::BonjourOperation (juce::Result startResult, std::shared_ptr<State> operationState)
+        : result {std::move (startResult)}
+        , state {std::move (operationState)}
+    {
+
+    }
+
+    BonjourOperation::~BonjourOperation()
+    {
+
+    }
+
+    juce::Result BonjourOperation::getResult() const
+    {
+        return result;
+    }
+
+    bool BonjourOperation::wasOk() const noexcept
+    {
+        return result.wasOk();
+    }
+
+    bool BonjourOperation::failed() const noexcept
+    {
+        return result.failed();
+    }
+
+    BonjourOperation::operator bool() const noexcept
+    {
+        return result.wasOk();
+    }
+
+    BonjourOperation::operator juce::Result() const
+    {
+        return result;
+    }
+
+    void BonjourOperation::cancel() const
+    {
+        if (state != nullptr && ! state->isCancelled.exchange (true))
+            State::stopLater ({state});
+    }
+
+    bool BonjourOperation::isCancelled() const
+    {
+        return state != nullptr && state->isCancelled;
+    }
+
+    BonjourOperationGroup::BonjourOperationGroup()
+    {
+
+    }
+
+    BonjourOperationGroup::~BonjourOperationGroup()
+    {
+
+    }
+
+    void BonjourOperationGroup::add (const BonjourOperation& operation)
+    {
+        if (operation.state == nullptr)
+            return;
+
+        const juce::ScopedLock lock {operationsLock};
+
+        // Operations that have gone are dropped whenever the number of
+        // operations has doubled, so adding stays O(1) on average
+        if (operations.size() >= numOperationsAfterPruning * 2)
+        {
+            operations.erase (std::remove_if (operations.begin(),
+                                              operations.end(),
+                                              [](const std::weak_ptr<BonjourOperation::State>& other) { return other.expired(); }),
+                              operations.end());
+
+            numOperationsAfterPruning = juce::jmax ((size_t) 8, operations.size());
+        }
+
+        operations.push_back (operation.state);
+    }
+
+    void BonjourOperationGroup::cancelAll()
+    {
+        std::vector<std::shared_ptr<BonjourOperation::State>> statesToStop;
+
+        {
+            const juce::ScopedLock lock {operationsLock};
+            statesToStop.reserve (operations.size());
+
+            for (const auto& operation : operations)
+                if (auto state {operation.lock()})
+                    if ( ! state->isCancelled.exchange (true))
+                        statesToStop.push_back (std::move (state));
+
+            operations.clear();
+            numOperationsAfterPruning = 0;
+        }
+
+        // Every operation is stopped by a single posted function
+        if ( ! statesToStop.empty())
+            BonjourOperation::State::stopLater (std::move (statesToStop));
+    }
+
+    int BonjourOperationGroup::getNumOperations() const
+    {
+        const juce::ScopedLock lock {operationsLock};
+
+        return (int) std::count_if (operations.begin(),
+                                    operations.end(),
+                                    [](const std::weak_ptr<BonjourOperation::State>& operation) { return ! operation.expired(); });
+    }
+}
+
+#include "jucey_BonjourOperationTests.cpp"
@@ -0,0 +1,67 @@
+#pragma once
+
+namespace jucey
+{
+    // A handle to an operation started by a service, such as a discovery,
+    // resolve or registration. Cancelling it never blocks, it can be called
+    // from any thread, including within the operation's own callbacks, and
+    // no more callbacks are made for the operation once it returns. The
+    // operation itself is stopped on the next pass of the event loop.
+    //
+    // Copies refer to the same operation. A handle doesn't keep anything
+    // alive, the operation still stops when the service that started it is
+    // destroyed or starts another operation of the same sort.
+    class BonjourOperation
+    {
+    public:
+        BonjourOperation();
+        ~BonjourOperation();
+
+        // Whether the operation was started
+        juce::Result getResult() const;
+        bool wasOk() const noexcept;
+        bool failed() const noexcept;
+        operator bool() const noexcept;
+        operator juce::Result() const;
+
+        void cancel() const;
+        bool isCancelled() const;
+
+        // Only used within the module
+        class State;
+
+    private:
+        friend class BonjourService;
+        friend class BonjourOperationGroup;
+
+        BonjourOperation (juce::Result result, std::shared_ptr<State> state = nullptr);
+
+        juce::Result result {juce::Result::ok()};
+        std::shared_ptr<State> state {nullptr};
+    };
+
+    // Cancels any number of operations in one call, all of them stopping on
+    // the same pass of the event loop. Operations are only held weakly so
+    // ones that have already stopped don't build up, and the group can be
+    // used again once it's been cancelled.
+    class BonjourOperationGroup
+    {
+    public:
+        BonjourOperationGroup();
+        ~BonjourOperationGroup();
+
+        // Operations that failed to start are ignored
+        void add (const BonjourOperation& operation);
+
+        void cancelAll();
+
+        int getNumOperations() const;
+
+    private:
+        juce::CriticalSection operationsLock;
+        std::vector<std::weak_ptr<BonjourOperation::State>> operations;
+        size_t numOperationsAfterPruning {0};
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourOperationGroup)
+    };
+}
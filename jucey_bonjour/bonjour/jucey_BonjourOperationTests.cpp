@@ -0,0 +1,241 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourOperationTests : private juce::UnitTest
+{
+public:
+    BonjourOperationTests()
+        : juce::UnitTest ("BonjourOperation", "Networking")
+    {
+
+    }
+
+    ~BonjourOperationTests()
+    {
+
+    }
+
+private:
+    // Cancelled operations are stopped on the next pass of the event loop
+    void waitForNumOperations (const jucey::BonjourLoopbackResponder& responder, int numOperations)
+    {
+        for (auto attempt {0}; responder.getNumActiveOperations() > numOperations && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+
+        expect (responder.getNumActiveOperations() == numOperations);
+    }
+
+    void registerService (jucey::BonjourService& serviceToRegister, int portToRegister)
+    {
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, portToRegister));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+    }
+
+    void runCancelTests()
+    {
+        beginTest ("Cancel");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            const jucey::BonjourOperation emptyOperation;
+            emptyOperation.cancel();
+            expect ( ! emptyOperation.isCancelled());
+
+            jucey::BonjourService firstService {"_test._udp", "JUCEY Operation First", "local"};
+            registerService (firstService, 3000);
+
+            std::atomic<int> numDiscovered {0};
+            juce::WaitableEvent onServiceDiscoveredEvent;
+
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            const auto operation {serviceToDiscover.discoverAsync ([&](const jucey::BonjourService&, bool, bool, const juce::Result&)
+            {
+                ++numDiscovered;
+                onServiceDiscoveredEvent.signal();
+            })};
+
+            expect (operation.wasOk());
+            expect (onServiceDiscoveredEvent.wait (1000));
+            expect (responder.getNumActiveOperations() == 2);
+
+            // the service is left as it is but nothing more is reported
+            operation.cancel();
+            expect (operation.isCancelled());
+
+            jucey::BonjourService secondService {"_test._udp", "JUCEY Operation Second", "local"};
+            registerService (secondService, 3001);
+            waitForNumOperations (responder, 2);
+
+            juce::Thread::sleep (50);
+            expect (numDiscovered == 1);
+
+            // cancelling a registration withdraws it
+            jucey::BonjourService thirdService {"_test._udp", "JUCEY Operation Third", "local"};
+            const auto registration {thirdService.registerAsync ([](const jucey::BonjourService&, const juce::Result&) {}, 3002)};
+            expect (registration.wasOk());
+
+            for (auto attempt {0}; responder.getNumRegisteredServices() < 3 && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+            registration.cancel();
+            waitForNumOperations (responder, 2);
+            expect (responder.getNumRegisteredServices() == 2);
+        }
+
+        waitForNumOperations (responder, 0);
+    }
+
+    void runCancelWithinCallbackTests()
+    {
+        beginTest ("Cancel within a callback");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            std::atomic<int> numDiscovered {0};
+            jucey::BonjourOperation operation;
+
+            // nothing is discovered until the first service is registered, by
+            // which time the handle has been set
+            jucey::BonjourService serviceToDiscover {"_test._udp"};
+            operation = serviceToDiscover.discoverAsync ([&](const jucey::BonjourService&, bool, bool, const juce::Result&)
+            {
+                ++numDiscovered;
+                operation.cancel();
+            });
+
+            expect (operation.wasOk());
+
+            jucey::BonjourService firstService {"_test._udp", "JUCEY Operation First", "local"};
+            registerService (firstService, 3000);
+            waitForNumOperations (responder, 1);
+
+            jucey::BonjourService secondService {"_test._udp", "JUCEY Operation Second", "local"};
+            registerService (secondService, 3001);
+
+            juce::Thread::sleep (50);
+            expect (numDiscovered == 1);
+        }
+
+        waitForNumOperations (responder, 0);
+    }
+
+    void runDestroyWithQueuedCallbackTests()
+    {
+        beginTest ("Destroy with a queued callback");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            // callbacks are held until the test runs them itself
+            juce::CriticalSection queuedCallbacksLock;
+            std::vector<std::function<void()>> queuedCallbacks;
+            juce::WaitableEvent onCallbackQueuedEvent;
+            std::atomic<int> numDiscovered {0};
+
+            {
+                jucey::BonjourService serviceToDiscover {"_test._udp"};
+                serviceToDiscover.setCallbackDispatcher ([&](std::function<void()> callback)
+                {
+                    const juce::ScopedLock lock {queuedCallbacksLock};
+                    queuedCallbacks.push_back (std::move (callback));
+                    onCallbackQueuedEvent.signal();
+                });
+
+                expect (serviceToDiscover.discoverAsync ([&](const jucey::BonjourService&, bool, bool, const juce::Result&)
+                {
+                    ++numDiscovered;
+                }).wasOk());
+
+                jucey::BonjourService firstService {"_test._udp", "JUCEY Operation First", "local"};
+                registerService (firstService, 3000);
+                expect (onCallbackQueuedEvent.wait (1000));
+            }
+
+            // the service has gone, so nothing it queued is called
+            const juce::ScopedLock lock {queuedCallbacksLock};
+            expect ( ! queuedCallbacks.empty());
+
+            for (auto& callback : queuedCallbacks)
+                callback();
+
+            expect (numDiscovered == 0);
+        }
+
+        waitForNumOperations (responder, 0);
+    }
+
+    void runGroupTests()
+    {
+        beginTest ("Groups");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            const auto numBrowsers {100};
+            std::atomic<int> numDiscovered {0};
+            juce::WaitableEvent onAllDiscoveredEvent;
+
+            const auto onServiceDiscovered = [&](const jucey::BonjourService&, bool, bool, const juce::Result&)
+            {
+                if (++numDiscovered == numBrowsers)
+                    onAllDiscoveredEvent.signal();
+            };
+
+            jucey::BonjourOperationGroup group;
+            std::vector<jucey::BonjourService> servicesToDiscover (numBrowsers, jucey::BonjourService {"_test._udp"});
+
+            for (auto& serviceToDiscover : servicesToDiscover)
+                group.add (serviceToDiscover.discoverAsync (onServiceDiscovered));
+
+            expect (group.getNumOperations() == numBrowsers);
+
+            jucey::BonjourService firstService {"_test._udp", "JUCEY Operation First", "local"};
+            registerService (firstService, 3000);
+            expect (onAllDiscoveredEvent.wait (5000));
+
+            // every browser stops together, without any of the services
+            // that started them being destroyed
+            group.cancelAll();
+            expect (group.getNumOperations() == 0);
+            waitForNumOperations (responder, 1);
+
+            jucey::BonjourService secondService {"_test._udp", "JUCEY Operation Second", "local"};
+            registerService (secondService, 3001);
+
+            juce::Thread::sleep (50);
+            expect (numDiscovered == numBrowsers);
+
+            // operations that have been replaced aren't kept by the group
+            group.add (servicesToDiscover.front().discoverAsync (onServiceDiscovered));
+            group.add (servicesToDiscover.front().discoverAsync (onServiceDiscovered));
+            expect (group.getNumOperations() == 1);
+        }
+
+        waitForNumOperations (responder, 0);
+    }
+
+    void runTest() override
+    {
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runCancelTests();
+        runCancelWithinCallbackTests();
+        runDestroyWithQueuedCallbackTests();
+        runGroupTests();
+    }
+};
+
+static BonjourOperationTests bonjourOperationTests;
+
+#endif // JUCEY_UNIT_TESTS
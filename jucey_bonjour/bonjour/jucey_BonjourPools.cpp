@@ -0,0 +1,211 @@
+
+// Fixed size blocks for the objects that are made and thrown away for every
+// reply, such as the data behind each discovered service. Freed blocks are
+// kept, up to a limit, and handed out again before anything new is taken
+// from the heap, so a steady stream of replies settles into reusing the
+// same few blocks. Safe to use from any thread.
+template <size_t blockSize>
+class BonjourBlockPool
+{
+public:
+    // The pool is never destroyed, so blocks can still be given back to it
+    // while other statics are being destroyed
+    static BonjourBlockPool& getInstance()
+    {
+        static auto* pool {new BonjourBlockPool{}};
+        return *pool;
+    }
+
+    void* allocate()
+    {
+        {
+            const juce::SpinLock::ScopedLockType lock {freeBlocksLock};
+
+            if (freeBlocks != nullptr)
+            {
+                --numFreeBlocks;
+                return std::exchange (freeBlocks, freeBlocks->next);
+            }
+        }
+
+        return ::operator new (blockSize);
+    }
+
+    void deallocate (void* block) noexcept
+    {
+        {
+            const juce::SpinLock::ScopedLockType lock {freeBlocksLock};
+
+            if (numFreeBlocks < maxFreeBlocks)
+            {
+                freeBlocks = new (block) FreeBlock {freeBlocks};
+                ++numFreeBlocks;
+                return;
+            }
+        }
+
+        ::operator delete (block);
+    }
+
+    int getNumFreeBlocks() const
+    {
+        const juce::SpinLock::ScopedLockType lock {freeBlocksLock};
+        return (int) numFreeBlocks;
+    }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next {nullptr};
+    };
+
+    static_assert (blockSize >= sizeof (FreeBlock));
+
+    // Enough for a few bursts of a busy network, anything beyond this goes
+    // back to the heap
+    static constexpr size_t maxFreeBlocks {4096};
+
+    juce::SpinLock freeBlocksLock;
+    FreeBlock* freeBlocks {nullptr};
+    size_t numFreeBlocks {0};
+};
+
+// An allocator for node based containers and shared pointers that takes
+// single objects from a block pool. Anything bigger, such as the buckets of
+// a hash table, comes from the heap as usual.
+template <typename Type>
+class BonjourPoolAllocator
+{
+public:
+    using value_type = Type;
+
+    BonjourPoolAllocator() = default;
+
+    template <typename OtherType>
+    BonjourPoolAllocator (const BonjourPoolAllocator<OtherType>&) noexcept
+    {
+
+    }
+
+    Type* allocate (size_t numObjects)
+    {
+        if (numObjects == 1)
+            return static_cast<Type*> (getPool().allocate());
+
+        return static_cast<Type*> (::operator new (numObjects * sizeof (Type)));
+    }
+
+    void deallocate (Type* objects, size_t numObjects) noexcept
+    {
+        if (numObjects == 1)
+            getPool().deallocate (objects);
+        else
+            ::operator delete (objects);
+    }
+
+    template <typename OtherType>
+    bool operator== (const BonjourPoolAllocator<OtherType>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename OtherType>
+    bool operator!= (const BonjourPoolAllocator<OtherType>&) const noexcept
+    {
+        return false;
+    }
+
+    // Objects of a similar size share a pool
+    static auto& getPool()
+    {
+        // Over-aligned objects can't come from a pool!
+        static_assert (alignof (Type) <= alignof (std::max_align_t));
+
+        constexpr auto alignment {alignof (std::max_align_t)};
+        return BonjourBlockPool<(sizeof (Type) + alignment - 1) / alignment * alignment>::getInstance();
+    }
+};
+
+// Shares a single juce::String between every occurrence of the same short
+// piece of text, such as a service type, a name seen in every burst or a
+// TXT record key, so turning text from a reply into a String only allocates
+// the first time it's seen. The table has a fixed number of slots, a string
+// simply replaces whichever string was in its slot before.
+class BonjourStringPool
+{
+public:
+    // Anything longer than a DNS label is never shared
+    static constexpr size_t maxLength {63};
+
+    // Like the block pools it's never destroyed, so strings can still be
+    // shared while other statics are being destroyed
+    static BonjourStringPool& getInstance()
+    {
+        static auto* pool {new BonjourStringPool{}};
+        return *pool;
+    }
+
+    juce::String get (std::string_view text)
+    {
+        if (text.empty())
+            return {};
+
+        if (text.size() > maxLength)
+            return juce::String::fromUTF8 (text.data(), (int) text.size());
+
+        const auto hash {hashText (text)};
+        auto& slot {slots[hash & (slots.size() - 1)]};
+
+        {
+            const juce::SpinLock::ScopedLockType lock {slotsLock};
+
+            if (slot.hash == hash && toStringView (slot.string) == text)
+                return slot.string;
+        }
+
+        // Strings are only made and freed outside the lock. The string that's
+        // replaced is swapped out and freed after the lock is released, and
+        // copying the new one only takes a reference.
+        auto string {juce::String::fromUTF8 (text.data(), (int) text.size())};
+
+        {
+            const juce::SpinLock::ScopedLockType lock {slotsLock};
+            slot.hash = hash;
+            std::swap (slot.string, string);
+            return slot.string;
+        }
+    }
+
+    juce::String get (const char* text)
+    {
+        return text != nullptr ? get (std::string_view {text}) : juce::String{};
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t hash {0};
+        juce::String string {};
+    };
+
+    static uint32_t hashText (std::string_view text)
+    {
+        // FNV-1a
+        uint32_t hash {2166136261u};
+
+        for (const auto character : text)
+            hash = (hash ^ (uint8_t) character) * 16777619u;
+
+        return hash;
+    }
+
+    static std::string_view toStringView (const juce::String& string)
+    {
+        return {string.toRawUTF8(), string.getNumBytesAsUTF8()};
+    }
+
+    juce::SpinLock slotsLock;
+    std::array<Slot, 1024> slots;
+};
+
+#include "jucey_BonjourPoolsTests.cpp"
@@ -0,0 +1,106 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourPoolsTests : private juce::UnitTest
+{
+public:
+    BonjourPoolsTests()
+        : juce::UnitTest ("BonjourPools", "Networking")
+    {
+
+    }
+
+    ~BonjourPoolsTests()
+    {
+
+    }
+
+private:
+    struct TestObject
+    {
+        char bytes[200] {};
+    };
+
+    void runBlockTests()
+    {
+        beginTest ("Blocks");
+
+        BonjourPoolAllocator<TestObject> allocator;
+        auto* first {allocator.allocate (1)};
+        allocator.deallocate (first, 1);
+
+        // The block that was just freed is handed out again
+        auto* second {allocator.allocate (1)};
+        expect (second == first);
+
+        // Arrays come from the heap and are never pooled
+        const auto numFreeBlocks {BonjourPoolAllocator<TestObject>::getPool().getNumFreeBlocks()};
+        auto* array {allocator.allocate (4)};
+        allocator.deallocate (array, 4);
+        expect (BonjourPoolAllocator<TestObject>::getPool().getNumFreeBlocks() == numFreeBlocks);
+
+        allocator.deallocate (second, 1);
+        expect (BonjourPoolAllocator<TestObject>::getPool().getNumFreeBlocks() == numFreeBlocks + 1);
+    }
+
+    void runContainerTests()
+    {
+        beginTest ("Containers");
+
+        using Map = std::map<int, TestObject, std::less<int>, BonjourPoolAllocator<std::pair<const int, TestObject>>>;
+        Map map;
+
+        for (auto index {0}; index < 100; ++index)
+            map[index].bytes[0] = (char) index;
+
+        // Filling the map again reuses the nodes that were just freed
+        map.clear();
+
+        for (auto index {0}; index < 100; ++index)
+            map[index].bytes[0] = (char) index;
+
+        for (const auto& [key, value] : map)
+            expect (value.bytes[0] == (char) key);
+
+        // Shared pointers keep their control block and object in one block
+        const auto shared {std::allocate_shared<TestObject> (BonjourPoolAllocator<TestObject>{})};
+        expect (shared != nullptr);
+    }
+
+    void runStringTests()
+    {
+        beginTest ("Strings");
+
+        auto& strings {BonjourStringPool::getInstance()};
+
+        expect (strings.get ("_test._udp") == "_test._udp");
+        expect (strings.get ("_test._udp") == strings.get (std::string_view {"_test._udpx", 10}));
+        expect (strings.get ((const char*) nullptr).isEmpty());
+        expect (strings.get (std::string_view {}).isEmpty());
+
+        // Far more strings than there are slots, each one is always returned
+        // intact however many others have replaced it since
+        for (auto round {0}; round < 2; ++round)
+        {
+            for (auto index {0}; index < 5000; ++index)
+            {
+                const auto text {"JUCEY " + std::to_string (index)};
+                expect (strings.get (text) == juce::String {text.c_str()});
+            }
+        }
+
+        // Longer strings are never shared but are still returned intact
+        const std::string longText (BonjourStringPool::maxLength + 1, 'x');
+        expect (strings.get (longText) == juce::String {longText.c_str()});
+    }
+
+    void runTest() override
+    {
+        runBlockTests();
+        runContainerTests();
+        runStringTests();
+    }
+};
+
+static BonjourPoolsTests bonjourPoolsTests;
+
+#endif // JUCEY_UNIT_TESTS
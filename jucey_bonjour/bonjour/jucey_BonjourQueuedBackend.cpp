@@ -0,0 +1,443 @@
+
+// A backend that runs its operations in process rather than in the daemon.
+// Each ref that owns a connection has a wakeup signal standing in for the
+// daemon's socket. Replies are queued on the connection and the signal is
+// raised until they've all been processed, so the event loop treats them
+// exactly the same as replies from the daemon.
+class BonjourQueuedBackend : public BonjourBackend
+{
+public:
+    ~BonjourQueuedBackend() override
+    {
+        // Every operation should have been stopped before the backend is
+        // destroyed!
+        jassert (refs.empty());
+    }
+
+    int getNumActiveOperations() const
+    {
+        const juce::ScopedLock lock {refsLock};
+        return (int) refs.size();
+    }
+
+    dnssd_sock_t refSockFD (DNSServiceRef sdRef) override
+    {
+        const juce::ScopedLock lock {refsLock};
+
+        if (auto* ref {findRef (sdRef)})
+            return getSocketOwner (*ref).signal->getFd();
+
+        return (dnssd_sock_t) -1;
+    }
+
+    DNSServiceErrorType processResult (DNSServiceRef sdRef) override
+    {
+        std::function<void()> reply;
+
+        {
+            const juce::ScopedLock lock {refsLock};
+            auto* ref {findRef (sdRef)};
+
+            if (ref == nullptr || ref->primary != nullptr)
+                return kDNSServiceErr_BadReference;
+
+            if ( ! ref->replies.empty())
+            {
+                reply = std::move (ref->replies.front().call);
+                ref->replies.pop_front();
+            }
+
+            if (ref->replies.empty())
+                ref->signal->clear();
+        }
+
+        // Called without the lock held as the callback may well start or
+        // stop operations of its own
+        if (reply != nullptr)
+            reply();
+
+        return kDNSServiceErr_NoError;
+    }
+
+    void refDeallocate (DNSServiceRef sdRef) override
+    {
+        const juce::ScopedLock lock {refsLock};
+        auto* ref {findRef (sdRef)};
+
+        if (ref == nullptr)
+            return;
+
+        // Deallocating a connection invalidates every ref sharing it
+        if (ref->kind == Kind::connection)
+        {
+            std::vector<Ref*> sharedRefs;
+
+            for (const auto& iter : refs)
+                if (iter.second->primary == ref)
+                    sharedRefs.push_back (iter.first);
+
+            for (auto* sharedRef : sharedRefs)
+                removeRef (*sharedRef);
+        }
+
+        removeRef (*ref);
+    }
+
+    DNSServiceErrorType createConnection (DNSServiceRef* sdRef) override
+    {
+        const juce::ScopedLock lock {refsLock};
+        auto errorCode {(DNSServiceErrorType) kDNSServiceErr_NoError};
+        createRef (sdRef, 0, Kind::connection, errorCode);
+        return errorCode;
+    }
+
+    DNSServiceErrorType removeRecord (DNSServiceRef sdRef,
+                                      DNSRecordRef recordRef,
+                                      DNSServiceFlags flags) override
+    {
+        juce::ignoreUnused (flags);
+
+        const juce::ScopedLock lock {refsLock};
+        auto* record {findRef (reinterpret_cast<DNSServiceRef> (recordRef))};
+
+        if (record == nullptr || record->kind != Kind::record || record->primary != findRef (sdRef))
+            return kDNSServiceErr_BadReference;
+
+        removeRef (*record);
+        return kDNSServiceErr_NoError;
+    }
+
+protected:
+    enum class Kind
+    {
+        connection,
+        browse,
+        resolve,
+        registration,
+        addressLookup,
+        record,
+        recordQuery
+    };
+
+    struct Ref;
+
+    struct Reply
+    {
+        Ref* target {nullptr};
+        std::function<void()> call {nullptr};
+    };
+
+    struct Ref
+    {
+        Kind kind {Kind::connection};
+        Ref* primary {nullptr};
+        std::unique_ptr<BonjourWakeupSignal> signal {nullptr};
+        std::deque<Reply> replies;
+
+        DNSServiceFlags flags {0};
+        uint32_t interfaceIndex {0};
+        juce::String name {};
+        juce::String type {};
+        juce::String domain {};
+        juce::String host {};
+        uint16_t port {0};
+        std::vector<uint8_t> txtRecord;
+        DNSServiceProtocol protocol {0};
+        bool isRegistered {false};
+
+        // Records registered on a connection, or queried for
+        juce::String recordName {};
+        uint16_t recordType {0};
+        uint16_t recordClass {0};
+        std::vector<uint8_t> recordData;
+
+        DNSServiceBrowseReply browseReply {nullptr};
+        DNSServiceResolveReply resolveReply {nullptr};
+        DNSServiceRegisterReply registerReply {nullptr};
+        DNSServiceRegisterRecordReply registerRecordReply {nullptr};
+        DNSServiceGetAddrInfoReply addressReply {nullptr};
+        DNSServiceQueryRecordReply queryRecordReply {nullptr};
+        void* context {nullptr};
+    };
+
+    static DNSServiceRef toDnsServiceRef (Ref* ref)
+    {
+        return reinterpret_cast<DNSServiceRef> (ref);
+    }
+
+    static Ref& getSocketOwner (Ref& ref)
+    {
+        return ref.primary != nullptr ? *ref.primary : ref;
+    }
+
+    static juce::String withTrailingDot (const juce::String& name)
+    {
+        return name.endsWithChar ('.') ? name : name + ".";
+    }
+
+    // Names are case insensitive and may or may not be fully qualified
+    static bool namesMatch (const juce::String& a, const juce::String& b)
+    {
+        return withTrailingDot (a).equalsIgnoreCase (withTrailingDot (b));
+    }
+
+    Ref* findRef (DNSServiceRef sdRef) const
+    {
+        const auto iter {refs.find (reinterpret_cast<Ref*> (sdRef))};
+        return iter != refs.end() ? iter->second.get() : nullptr;
+    }
+
+    // Must be called with the lock held
+    Ref* createRef (DNSServiceRef* sdRef, DNSServiceFlags flags, Kind kind, DNSServiceErrorType& errorCode)
+    {
+        if (sdRef == nullptr)
+        {
+            errorCode = kDNSServiceErr_BadParam;
+            return nullptr;
+        }
+
+        auto ref {std::make_unique<Ref>()};
+        ref->kind = kind;
+        ref->flags = flags;
+
+        if ((flags & kDNSServiceFlagsShareConnection) != 0)
+        {
+            auto* primary {findRef (*sdRef)};
+
+            if (primary == nullptr || primary->kind != Kind::connection)
+            {
+                errorCode = kDNSServiceErr_BadReference;
+                return nullptr;
+            }
+
+            ref->primary = primary;
+        }
+        else
+        {
+            ref->signal = std::make_unique<BonjourWakeupSignal>();
+        }
+
+        auto* createdRef {ref.get()};
+        refs.emplace (createdRef, std::move (ref));
+        *sdRef = toDnsServiceRef (createdRef);
+        return createdRef;
+    }
+
+    // Must be called with the lock held. A record is a ref of its own that
+    // shares the connection it's registered on.
+    Ref* createRecordRef (DNSServiceRef sdRef, DNSRecordRef* recordRef, DNSServiceErrorType& errorCode)
+    {
+        auto* connection {findRef (sdRef)};
+
+        if (recordRef == nullptr || connection == nullptr || connection->kind != Kind::connection)
+        {
+            errorCode = kDNSServiceErr_BadReference;
+            return nullptr;
+        }
+
+        auto ref {std::make_unique<Ref>()};
+        ref->kind = Kind::record;
+        ref->primary = connection;
+
+        auto* createdRef {ref.get()};
+        refs.emplace (createdRef, std::move (ref));
+        *recordRef = reinterpret_cast<DNSRecordRef> (createdRef);
+        return createdRef;
+    }
+
+    // Called with the lock held just before a ref is removed
+    virtual void refRemoved (Ref& ref)
+    {
+        juce::ignoreUnused (ref);
+    }
+
+    // The queue*Reply functions must be called with the lock held, the reply
+    // is dropped if the ref is deallocated before it's been processed
+    void queueBrowseReply (Ref& browse,
+                           DNSServiceFlags flags,
+                           uint32_t interfaceIndex,
+                           DNSServiceErrorType errorCode,
+                           const juce::String& name,
+                           const juce::String& type,
+                           const juce::String& domain)
+    {
+        enqueue (browse, [sdRef = toDnsServiceRef (&browse),
+                          callBack = browse.browseReply,
+                          context = browse.context,
+                          flags,
+                          interfaceIndex,
+                          errorCode,
+                          name,
+                          type,
+                          domain]
+        {
+            callBack (sdRef,
+                      flags,
+                      interfaceIndex,
+                      errorCode,
+                      name.toRawUTF8(),
+                      type.toRawUTF8(),
+                      domain.toRawUTF8(),
+                      context);
+        });
+    }
+
+    void queueResolveReply (Ref& resolve,
+                            DNSServiceFlags flags,
+                            uint32_t interfaceIndex,
+                            DNSServiceErrorType errorCode,
+                            const juce::String& fullName,
+                            const juce::String& hostName,
+                            uint16_t port,
+                            const std::vector<uint8_t>& txtRecord)
+    {
+        enqueue (resolve, [sdRef = toDnsServiceRef (&resolve),
+                           callBack = resolve.resolveReply,
+                           context = resolve.context,
+                           flags,
+                           interfaceIndex,
+                           errorCode,
+                           fullName,
+                           hostName,
+                           port,
+                           txtRecord]
+        {
+            callBack (sdRef,
+                      flags,
+                      interfaceIndex,
+                      errorCode,
+                      fullName.toRawUTF8(),
+                      hostName.toRawUTF8(),
+                      port,
+                      (uint16_t) txtRecord.size(),
+                      txtRecord.data(),
+                      context);
+        });
+    }
+
+    void queueRegisterReply (Ref& registration,
+                             DNSServiceFlags flags,
+                             DNSServiceErrorType errorCode)
+    {
+        enqueue (registration, [sdRef = toDnsServiceRef (&registration),
+                                callBack = registration.registerReply,
+                                context = registration.context,
+                                name = registration.name,
+                                type = registration.type,
+                                domain = registration.domain,
+                                flags,
+                                errorCode]
+        {
+            callBack (sdRef,
+                      flags,
+                      errorCode,
+                      name.toRawUTF8(),
+                      type.toRawUTF8(),
+                      domain.toRawUTF8(),
+                      context);
+        });
+    }
+
+    void queueRegisterRecordReply (Ref& record,
+                                   DNSServiceFlags flags,
+                                   DNSServiceErrorType errorCode)
+    {
+        enqueue (record, [sdRef = toDnsServiceRef (record.primary),
+                          recordRef = reinterpret_cast<DNSRecordRef> (&record),
+                          callBack = record.registerRecordReply,
+                          context = record.context,
+                          flags,
+                          errorCode]
+        {
+            callBack (sdRef, recordRef, flags, errorCode, context);
+        });
+    }
+
+    void queueQueryRecordReply (Ref& query,
+                                DNSServiceFlags flags,
+                                uint32_t interfaceIndex,
+                                DNSServiceErrorType errorCode,
+                                const juce::String& fullName,
+                                uint16_t recordType,
+                                const std::vector<uint8_t>& recordData,
+                                uint32_t ttl)
+    {
+        enqueue (query, [sdRef = toDnsServiceRef (&query),
+                         callBack = query.queryRecordReply,
+                         context = query.context,
+                         flags,
+                         interfaceIndex,
+                         errorCode,
+                         fullName,
+                         recordType,
+                         recordClass = query.recordClass,
+                         recordData,
+                         ttl]
+        {
+            callBack (sdRef,
+                      flags,
+                      interfaceIndex,
+                      errorCode,
+                      fullName.toRawUTF8(),
+                      recordType,
+                      recordClass,
+                      (uint16_t) recordData.size(),
+                      recordData.data(),
+                      ttl,
+                      context);
+        });
+    }
+
+    void queueAddressReply (Ref& lookup,
+                            DNSServiceFlags flags,
+                            uint32_t interfaceIndex,
+                            const juce::String& hostName,
+                            const sockaddr_storage& address,
+                            uint32_t ttl)
+    {
+        enqueue (lookup, [sdRef = toDnsServiceRef (&lookup),
+                          callBack = lookup.addressReply,
+                          context = lookup.context,
+                          flags,
+                          interfaceIndex,
+                          hostName,
+                          address,
+                          ttl]
+        {
+            callBack (sdRef,
+                      flags,
+                      interfaceIndex,
+                      kDNSServiceErr_NoError,
+                      hostName.toRawUTF8(),
+                      reinterpret_cast<const sockaddr*> (&address),
+                      ttl,
+                      context);
+        });
+    }
+
+    mutable juce::CriticalSection refsLock;
+    std::unordered_map<Ref*, std::unique_ptr<Ref>> refs;
+
+private:
+    void removeRef (Ref& ref)
+    {
+        refRemoved (ref);
+
+        auto& replies {getSocketOwner (ref).replies};
+
+        replies.erase (std::remove_if (replies.begin(), replies.end(), [&ref](const Reply& reply)
+                                       {
+                                           return reply.target == &ref;
+                                       }),
+                       replies.end());
+
+        refs.erase (&ref);
+    }
+
+    void enqueue (Ref& target, std::function<void()> call)
+    {
+        auto& owner {getSocketOwner (target)};
+        owner.replies.push_back ({&target, std::move (call)});
+        owner.signal->signal();
+    }
+};
@@ -1,511 +1,2228 @@
 
-class BonjourDnsService : private juce::Thread
+juce::Result bonjourResult (DNSServiceErrorType errorCode)
+{
+    if (errorCode != kDNSServiceErr_NoError)
+        BonjourMetricsRecorder::getInstance().errorReturned (errorCode);
+
+    switch (errorCode)
+    {
+        case kDNSServiceErr_NoError:                    return juce::Result::ok();
+        case kDNSServiceErr_Unknown:                    return juce::Result::fail ("bonjour error: Unknown");
+        case kDNSServiceErr_NoSuchName:                 return juce::Result::fail ("bonjour error: No such name");
+        case kDNSServiceErr_NoMemory:                   return juce::Result::fail ("bonjour error: No memory");
+        case kDNSServiceErr_BadParam:                   return juce::Result::fail ("bonjour error: Bad parameter");
+        case kDNSServiceErr_BadReference:               return juce::Result::fail ("bonjour error: Bad reference");
+        case kDNSServiceErr_BadState:                   return juce::Result::fail ("bonjour error: Bad state");
+        case kDNSServiceErr_BadFlags:                   return juce::Result::fail ("bonjour error: Bad flags");
+        case kDNSServiceErr_Unsupported:                return juce::Result::fail ("bonjour error: Unsupported");
+        case kDNSServiceErr_NotInitialized:             return juce::Result::fail ("bonjour error: Not initialized");
+        case kDNSServiceErr_AlreadyRegistered:          return juce::Result::fail ("bonjour error: Already registered");
+        case kDNSServiceErr_NameConflict:               return juce::Result::fail ("bonjour error: Name conflict");
+        case kDNSServiceErr_Invalid:                    return juce::Result::fail ("bonjour error: Invalid");
+        case kDNSServiceErr_Firewall:                   return juce::Result::fail ("bonjour error: Firewall");
+        case kDNSServiceErr_Incompatible:               return juce::Result::fail ("bonjour error: Client library incompatible with daemon");
+        case kDNSServiceErr_BadInterfaceIndex:          return juce::Result::fail ("bonjour error: Bad interface index");
+        case kDNSServiceErr_Refused:                    return juce::Result::fail ("bonjour error: Refused");
+        case kDNSServiceErr_NoSuchRecord:               return juce::Result::fail ("bonjour error: No such record");
+        case kDNSServiceErr_NoAuth:                     return juce::Result::fail ("bonjour error: No auth");
+        case kDNSServiceErr_NoSuchKey:                  return juce::Result::fail ("bonjour error: No such key");
+        case kDNSServiceErr_NATTraversal:               return juce::Result::fail ("bonjour error: NAT Traversal");
+        case kDNSServiceErr_DoubleNAT:                  return juce::Result::fail ("bonjour error: Double NAT");
+        case kDNSServiceErr_BadTime:                    return juce::Result::fail ("bonjour error: Bad time");
+        case kDNSServiceErr_BadSig:                     return juce::Result::fail ("bonjour error: Bad signature");
+        case kDNSServiceErr_BadKey:                     return juce::Result::fail ("bonjour error: Bad key");
+        case kDNSServiceErr_Transient:                  return juce::Result::fail ("bonjour error: Transient");
+        case kDNSServiceErr_ServiceNotRunning:          return juce::Result::fail ("bonjour error: Background daemon not running");
+        case kDNSServiceErr_NATPortMappingUnsupported:  return juce::Result::fail ("bonjour error: NAT port mapping unsupported: NAT doesn't support PCP, NAT-PMP or UPnP");
+        case kDNSServiceErr_NATPortMappingDisabled:     return juce::Result::fail ("bonjour error: NAT port mapping disabled: NAT supports PCP, NAT-PMP or UPnP, but it's disabled by the administrator");
+        case kDNSServiceErr_NoRouter:                   return juce::Result::fail ("bonjour error: No router currently configured (probably no network connectivity)");
+        case kDNSServiceErr_PollingMode:                return juce::Result::fail ("bonjour error: Polling mode");
+        case kDNSServiceErr_Timeout:                    return juce::Result::fail ("bonjour error: Timeout");
+        default:                                        return juce::Result::fail ("bonjour error: Unhandled");
+    };
+}
+
+// The primary connection behind a session. Operations started on it share
+// its socket, so only the primary ref is polled by the event loop and its
+// results are handed on to whichever operation they belong to.
+class BonjourConnection : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<BonjourConnection>;
+
+    BonjourConnection()
+        : backend {BonjourBackend::getCurrent()}
+        , errorCode {backend.createConnection (&ref)}
+    {
+        if (errorCode == kDNSServiceErr_NoError)
+        {
+            eventLoop->addRef (ref, backend);
+            BonjourMetricsRecorder::getInstance().operationStarted (jucey::BonjourMetrics::OperationKind::connection);
+        }
+    }
+
+    ~BonjourConnection()
+    {
+        // Every operation sharing the connection holds a reference to it, so
+        // they've all been deallocated by now
+        if (errorCode == kDNSServiceErr_NoError)
+        {
+            eventLoop->removeRef (ref);
+            BonjourMetricsRecorder::getInstance().operationStopped (jucey::BonjourMetrics::OperationKind::connection);
+        }
+    }
+
+    DNSServiceErrorType getErrorCode() const
+    {
+        return errorCode;
+    }
+
+    // Operations sharing the connection have to use the same backend
+    BonjourBackend& getBackend() const
+    {
+        return backend;
+    }
+
+    // Sets up the ref and flags to start an operation sharing this connection
+    DNSServiceErrorType share (DNSServiceRef& refToShare, DNSServiceFlags& flags) const
+    {
+        if (errorCode == kDNSServiceErr_NoError)
+        {
+            refToShare = ref;
+            flags |= kDNSServiceFlagsShareConnection;
+        }
+
+        return errorCode;
+    }
+
+    // Records are registered on the connection itself
+    DNSServiceRef getRef() const
+    {
+        return ref;
+    }
+
+private:
+    juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+    BonjourBackend& backend;
+    DNSServiceRef ref {nullptr};
+    const DNSServiceErrorType errorCode {kDNSServiceErr_NoError};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourConnection)
+};
+
+struct jucey::BonjourSession::Pimpl
+{
+    BonjourConnection::Ptr connection {new BonjourConnection{}};
+};
+
+// Owns a running operation's ref. A ref of its own is polled by the event
+// loop, whereas a ref sharing a connection keeps the connection open until
+// the ref has been deallocated.
+class BonjourDnsService
+{
+public:
+    BonjourDnsService (DNSServiceRef serviceRef,
+                       jucey::BonjourMetrics::OperationKind operationKind,
+                       BonjourBackend& backendToUse,
+                       BonjourConnection::Ptr sharedConnection = nullptr)
+        : ref {serviceRef}
+        , kind {operationKind}
+        , backend {backendToUse}
+        , connection {std::move (sharedConnection)}
+    {
+        // An operation sharing a connection has to use the connection's backend!
+        jassert (connection == nullptr || &connection->getBackend() == &backend);
+
+        if (connection == nullptr)
+            eventLoop->addRef (ref, backend);
+
+        BonjourMetricsRecorder::getInstance().operationStarted (kind);
+    }
+
+    ~BonjourDnsService()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (ref == nullptr)
+            return;
+
+        if (connection == nullptr)
+            eventLoop->removeRef (ref);
+        else
+            eventLoop->deallocateSharedRef (ref, backend);
+
+        BonjourMetricsRecorder::getInstance().operationStopped (kind);
+        ref = nullptr;
+        connection = nullptr;
+    }
+
+    BonjourBackend& getBackend() const
+    {
+        return backend;
+    }
+
+private:
+    juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+    DNSServiceRef ref {nullptr};
+    const jucey::BonjourMetrics::OperationKind kind;
+    BonjourBackend& backend;
+    BonjourConnection::Ptr connection {nullptr};
+};
+
+// Keeps a TXT record exactly as it appears on the wire, a sequence of length
+// prefixed "key=value" strings, along with an index of where each item's key
+// and value are and a small open addressing hash table of the keys, both
+// built in a single pass. Keyed lookups and indexed access are O(1), and
+// copying a record from a reply reuses any storage the record already has so
+// resolving the same service again doesn't allocate.
+class BonjourTxtRecord
+{
+public:
+    BonjourTxtRecord() = default;
+
+    void clear()
+    {
+        bytes.clear();
+        items.clear();
+    }
+
+    void copyFrom (uint16_t txtLen, const unsigned char* txtRecord)
+    {
+        bytes.assign (txtRecord, txtRecord + (txtRecord != nullptr ? txtLen : 0));
+        buildIndex();
+    }
+
+    void moveFrom (std::vector<uint8_t>&& newBytes)
+    {
+        bytes = std::move (newBytes);
+        buildIndex();
+    }
+
+    bool hasDuplicateKeys() const
+    {
+        return numDuplicateKeys > 0;
+    }
+
+    bool hasSameBytesAs (const BonjourTxtRecord& other) const
+    {
+        return bytes == other.bytes;
+    }
+
+    uint16_t getLength() const
+    {
+        return (uint16_t) bytes.size();
+    }
+
+    const void* getBytes() const
+    {
+        return bytes.data();
+    }
+
+    std::string_view getValueView (std::string_view key) const
+    {
+        if (const auto* item {findItem (key)})
+            return getValueView (*item);
+
+        return {};
+    }
+
+    std::optional<std::string_view> findValue (std::string_view key) const
+    {
+        if (const auto* item {findItem (key)})
+            return getValueView (*item);
+
+        return std::nullopt;
+    }
+
+    jucey::BonjourService::RecordItemView getItemViewAtIndex (int index) const
+    {
+        const auto& item {items[(size_t) index]};
+        return {getKeyView (item), getValueView (item), item.hasValue};
+    }
+
+    juce::String getValue (const juce::String& key) const
+    {
+        return toString (getValueView (toStringView (key)));
+    }
+
+    jucey::BonjourService::RecordItem getItemAtIndex (int index) const
+    {
+        const auto& item {items[(size_t) index]};
+        return {toString (getKeyView (item)), toString (getValueView (item))};
+    }
+
+    bool containsKey (const juce::String& key) const
+    {
+        return findItem (toStringView (key)) != nullptr;
+    }
+
+    int getCount() const
+    {
+        return (int) items.size();
+    }
+
+    // Like TXTRecordSetValue, the record is left unchanged if the key is
+    // invalid or the item or record would be too long
+    juce::Result setValue (const juce::String& key, const juce::String& value)
+    {
+        const auto keyView {toStringView (key)};
+        const auto valueView {toStringView (value)};
+
+        // key names should be a maximum of 9 characters
+        jassert (keyView.size() < 10);
+
+        if (keyView.empty())
+            return juce::Result::fail ("TXT record keys can't be empty");
+
+        // keys are printable US-ASCII, excluding '=' (RFC 6763 section 6.4)
+        for (const auto character : keyView)
+            if (character < 0x20 || character > 0x7e || character == '=')
+                return juce::Result::fail ("TXT record key \"" + key + "\" contains an invalid character");
+
+        // the whole "key=value" string must fit in 255 bytes
+        const auto itemLength {keyView.size() + 1 + valueView.size()};
+
+        if (itemLength > BonjourDnsTxtData::maxStringLength)
+            return juce::Result::fail ("TXT record items must be a maximum of 255 bytes");
+
+        // a TXT record can be a maximum of 65535 bytes, not counting any
+        // existing value that's about to be replaced
+        const auto* existingItem {findItem (keyView)};
+        const auto existingLength {existingItem != nullptr ? (size_t) 1 + bytes[existingItem->offset] : 0};
+
+        if (bytes.size() - existingLength + 1 + itemLength > std::numeric_limits<uint16_t>::max())
+            return juce::Result::fail ("TXT records must be a maximum of 65535 bytes");
+
+        // As with TXTRecordSetValue any existing value is removed and the new
+        // one is appended to the end of the record
+        removeValue (key);
+        BonjourDnsTxtData::appendString (bytes, {keyView, "=", valueView});
+        buildIndex();
+
+        return juce::Result::ok();
+    }
+
+    void removeValue (const juce::String& key)
+    {
+        if (const auto* item {findItem (toStringView (key))})
+        {
+            const auto start {bytes.begin() + item->offset};
+            bytes.erase (start, start + 1 + bytes[item->offset]);
+            buildIndex();
+        }
+    }
+
+private:
+    struct Item
+    {
+        uint16_t offset {0};
+        uint8_t keyLength {0};
+        uint8_t valueLength {0};
+        bool hasValue {false};
+    };
+
+    static std::string_view toStringView (const juce::String& string)
+    {
+        return {string.toRawUTF8(), string.getNumBytesAsUTF8()};
+    }
+
+    // Keys and values are short and mostly the same from one service to the
+    // next, so they're shared rather than copied out every time
+    static juce::String toString (std::string_view view)
+    {
+        return BonjourStringPool::getInstance().get (view);
+    }
+
+    static uint32_t hashKey (std::string_view key)
+    {
+        // FNV-1a over the lower case key so it matches case insensitively
+        uint32_t hash {2166136261u};
+
+        for (const auto character : key)
+            hash = (hash ^ (uint8_t) toLowerCase (character)) * 16777619u;
+
+        return hash;
+    }
+
+    static char toLowerCase (char character)
+    {
+        return (character >= 'A' && character <= 'Z') ? (char) (character - 'A' + 'a') : character;
+    }
+
+    static bool keysMatch (std::string_view a, std::string_view b)
+    {
+        // keys are case insensitive
+        return a.size() == b.size()
+            && std::equal (a.begin(), a.end(), b.begin(), [](char x, char y)
+               {
+                   return toLowerCase (x) == toLowerCase (y);
+               });
+    }
+
+    std::string_view getKeyView (const Item& item) const
+    {
+        return {reinterpret_cast<const char*> (bytes.data()) + item.offset + 1, item.keyLength};
+    }
+
+    std::string_view getValueView (const Item& item) const
+    {
+        if ( ! item.hasValue)
+            return {};
+
+        return {reinterpret_cast<const char*> (bytes.data()) + item.offset + 1 + item.keyLength + 1, item.valueLength};
+    }
+
+    const Item* findItem (std::string_view key) const
+    {
+        if (hashTable.empty())
+            return nullptr;
+
+        const auto mask {hashTable.size() - 1};
+
+        for (auto slot {hashKey (key) & mask};; slot = (slot + 1) & mask)
+        {
+            const auto itemIndex {hashTable[slot]};
+
+            if (itemIndex == emptySlot)
+                return nullptr;
+
+            if (keysMatch (getKeyView (items[itemIndex]), key))
+                return &items[itemIndex];
+        }
+    }
+
+    bool addToHashTable (uint16_t itemIndex)
+    {
+        const auto key {getKeyView (items[itemIndex])};
+        const auto mask {hashTable.size() - 1};
+
+        for (auto slot {hashKey (key) & mask};; slot = (slot + 1) & mask)
+        {
+            if (hashTable[slot] == emptySlot)
+            {
+                hashTable[slot] = itemIndex;
+                return true;
+            }
+
+            // only the first of any duplicate keys can be looked up
+            if (keysMatch (getKeyView (items[hashTable[slot]]), key))
+                return false;
+        }
+    }
+
+    void buildHashTable()
+    {
+        // keep the table at most half full so probe sequences stay short
+        size_t tableSize {8};
+
+        while (tableSize < items.size() * 2)
+            tableSize *= 2;
+
+        hashTable.assign (items.empty() ? 0 : tableSize, emptySlot);
+        numDuplicateKeys = 0;
+
+        for (size_t index {0}; index < items.size(); ++index)
+            if ( ! addToHashTable ((uint16_t) index))
+                ++numDuplicateKeys;
+    }
+
+    void buildIndex()
+    {
+        items.clear();
+
+        // a malformed record, anything that overruns the buffer is ignored
+        BonjourDnsTxtData::forEachString (bytes.data(), bytes.size(), [this](size_t offset, std::string_view string)
+        {
+            const auto separator {string.find ('=')};
+
+            Item item;
+            item.offset = (uint16_t) offset;
+            item.hasValue = separator != std::string_view::npos;
+            item.keyLength = (uint8_t) (item.hasValue ? separator : string.size());
+            item.valueLength = (uint8_t) (item.hasValue ? string.size() - separator - 1 : 0);
+
+            // empty strings and strings without a key should be ignored
+            if (item.keyLength > 0)
+                items.push_back (item);
+        });
+
+        buildHashTable();
+    }
+
+    static constexpr uint16_t emptySlot {std::numeric_limits<uint16_t>::max()};
+
+    std::vector<uint8_t> bytes;
+    std::vector<Item> items;
+    std::vector<uint16_t> hashTable;
+    size_t numDuplicateKeys {0};
+};
+
+// Collapses concurrent resolves of the same service instance into a single
+// DNSServiceResolve and optionally keeps the result for a time to live so
+// repeated resolves can be answered without asking the daemon again. All
+// state is guarded by the event loop lock so waiters can't be called after
+// they've been cancelled.
+class BonjourResolveCache
 {
 public:
-    BonjourDnsService (DNSServiceRef ref)
-        : juce::Thread {"jucey_Bonjour"}
-        , ref {ref, &DNSServiceRefDeallocate}
+    struct Key
+    {
+        juce::String name {};
+        juce::String type {};
+        juce::String domain {};
+        uint32_t interfaceIndex {0};
+
+        // DNS names match without regard to case
+        bool operator== (const Key& other) const
+        {
+            return interfaceIndex == other.interfaceIndex
+                && BonjourDnsName::labelsMatch (toStringView (name), toStringView (other.name))
+                && BonjourDnsName::labelsMatch (toStringView (type), toStringView (other.type))
+                && BonjourDnsName::labelsMatch (toStringView (domain), toStringView (other.domain));
+        }
+    };
+
+    struct Entry
+    {
+        juce::String hostName {};
+        uint16_t port {0};
+        uint32_t interfaceIndex {0};
+        BonjourTxtRecord txtRecord {};
+        juce::Result result {juce::Result::ok()};
+        juce::uint32 timeResolved {0};
+    };
+
+    using Waiter = std::function<void(const Entry& entry)>;
+    using WaiterId = uint64_t;
+
+    // Like the pools the cache is never destroyed, so results are kept between
+    // short lived services and work posted to the event loop can't outlive it
+    static BonjourResolveCache& getInstance()
+    {
+        static auto* cache {new BonjourResolveCache{}};
+        return *cache;
+    }
+
+    static void setTimeToLive (juce::RelativeTime newTimeToLive)
     {
-        startThread();
+        timeToLiveMs = std::max ((juce::int64) 0, newTimeToLive.inMilliseconds());
+    }
+
+    static juce::RelativeTime getTimeToLive()
+    {
+        return juce::RelativeTime::milliseconds (timeToLiveMs.load());
+    }
+
+    void clear()
+    {
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const juce::ScopedLock lock {eventLoop->getLock()};
+        entries.clear();
+    }
+
+    // The service resolving keeps the event loop alive
+    juce::Result resolve (const Key& key, BonjourConnection* connection, Waiter waiter, WaiterId& waiterId)
+    {
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const juce::ScopedLock lock {eventLoop->getLock()};
+        waiterId = ++lastWaiterId;
+
+        if (const auto* entry {findFreshEntry (key)})
+        {
+            // Answer from the cache on the event loop thread so the callback is
+            // still asynchronous, unless the waiter is cancelled first
+            cachedWaiters.emplace (waiterId, std::move (waiter));
+            eventLoop->post ([this, id = waiterId, entryToDeliver = *entry]
+            {
+                const auto iter {cachedWaiters.find (id)};
+
+                if (iter == cachedWaiters.end())
+                    return;
+
+                const auto waiterToCall {std::move (iter->second)};
+                cachedWaiters.erase (iter);
+                waiterToCall (entryToDeliver);
+            });
+
+            return juce::Result::ok();
+        }
+
+        const auto [iter, isNewQuery] {queries.try_emplace (key)};
+        auto& query {iter->second};
+
+        if (isNewQuery)
+        {
+            query.owner = this;
+            query.key = key;
+
+            DNSServiceRef ref {nullptr};
+            DNSServiceFlags flags {0};
+            auto result {juce::Result::ok()};
+
+            // Whoever starts the query decides which connection, and so which
+            // backend, it's made on
+            auto& backend {connection != nullptr ? connection->getBackend() : BonjourBackend::getCurrent()};
+
+            if (connection != nullptr)
+                result = bonjourResult (connection->share (ref, flags));
+
+            if (result.wasOk())
+                result = bonjourResult (backend.resolve (&ref,
+                                                         flags,
+                                                         key.interfaceIndex,
+                                                         key.name.toUTF8(),
+                                                         key.type.toUTF8(),
+                                                         key.domain.toUTF8(),
+                                                         &resolveReply,
+                                                         &query));
+
+            if (result.failed())
+            {
+                queries.erase (iter);
+                return result;
+            }
+
+            query.dnsService.emplace (ref, jucey::BonjourMetrics::OperationKind::resolve, backend, connection);
+        }
+
+        query.waiters.emplace (waiterId, std::move (waiter));
+        return juce::Result::ok();
+    }
+
+    void cancel (WaiterId waiterId)
+    {
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const juce::ScopedLock lock {eventLoop->getLock()};
+
+        if (cachedWaiters.erase (waiterId) > 0)
+            return;
+
+        for (auto iter {queries.begin()}; iter != queries.end(); ++iter)
+        {
+            if (iter->second.waiters.erase (waiterId) > 0)
+            {
+                // Nobody is waiting on this resolve any more
+                if (iter->second.waiters.empty())
+                    queries.erase (iter);
+
+                return;
+            }
+        }
+    }
+
+private:
+    BonjourResolveCache() = default;
+
+    static std::string_view toStringView (const juce::String& string)
+    {
+        return {string.toRawUTF8(), string.getNumBytesAsUTF8()};
+    }
+
+    struct KeyHash
+    {
+        size_t operator() (const Key& key) const
+        {
+            return BonjourDnsName::hashIgnoringCase (toStringView (key.name))
+                 ^ (BonjourDnsName::hashIgnoringCase (toStringView (key.type)) << 1)
+                 ^ (BonjourDnsName::hashIgnoringCase (toStringView (key.domain)) << 2)
+                 ^ ((size_t) key.interfaceIndex << 3);
+        }
+    };
+
+    // Every query and waiter is a node from a block pool, so resolving
+    // again and again doesn't keep going back to the heap
+    using Waiters = std::map<WaiterId,
+                             Waiter,
+                             std::less<WaiterId>,
+                             BonjourPoolAllocator<std::pair<const WaiterId, Waiter>>>;
+
+    // Nodes never move, so the query itself is the resolve's context
+    struct Query
+    {
+        BonjourResolveCache* owner {nullptr};
+        Key key {};
+        std::optional<BonjourDnsService> dnsService {};
+        Waiters waiters;
+    };
+
+    using Queries = std::unordered_map<Key,
+                                       Query,
+                                       KeyHash,
+                                       std::equal_to<Key>,
+                                       BonjourPoolAllocator<std::pair<const Key, Query>>>;
+
+    static void resolveReply (DNSServiceRef sdRef,
+                              DNSServiceFlags flags,
+                              uint32_t interfaceIndex,
+                              DNSServiceErrorType errorCode,
+                              const char* fullname,
+                              const char* hosttarget,
+                              uint16_t port,                                   /* In network byte order */
+                              uint16_t txtLen,
+                              const unsigned char* txtRecord,
+                              void* context)
+    {
+        juce::ignoreUnused (sdRef, flags, fullname);
+
+        if (auto* query {static_cast<Query*>(context)})
+        {
+            // Replies are only ever handled on the event loop thread, one at
+            // a time, so the same entry is filled in for each of them and
+            // keeps its storage between resolves
+            auto& cache {*query->owner};
+            auto& entry {cache.replyEntry};
+            entry.hostName = BonjourStringPool::getInstance().get (hosttarget);
+            entry.port = port;
+            entry.interfaceIndex = interfaceIndex;
+            entry.txtRecord.copyFrom (txtLen, txtRecord);
+            entry.result = bonjourResult (errorCode);
+            entry.timeResolved = juce::Time::getMillisecondCounter();
+
+            // The query is destroyed here so move everything that's needed
+            // out of it first
+            const auto waiters {std::move (query->waiters)};
+            const auto key {query->key};
+            cache.queries.erase (key);
+
+            if (entry.result.wasOk() && timeToLiveMs.load() > 0)
+                cache.addEntry (key, entry);
+
+            for (const auto& waiter : waiters)
+                waiter.second (entry);
+        }
+    }
+
+    const Entry* findFreshEntry (const Key& key)
+    {
+        const auto iter {entries.find (key)};
+
+        if (iter == entries.end())
+            return nullptr;
+
+        if (isExpired (iter->second))
+        {
+            entries.erase (iter);
+            return nullptr;
+        }
+
+        return &iter->second;
+    }
+
+    void addEntry (const Key& key, const Entry& entry)
+    {
+        // Expired entries are removed lazily, prune them all whenever the
+        // cache has doubled in size so it can't grow without bound
+        if (entries.size() >= nextPruneSize)
+        {
+            for (auto iter {entries.begin()}; iter != entries.end();)
+                iter = isExpired (iter->second) ? entries.erase (iter) : std::next (iter);
+
+            nextPruneSize = std::max ((size_t) 64, entries.size() * 2);
+        }
+
+        entries[key] = entry;
+    }
+
+    static bool isExpired (const Entry& entry)
+    {
+        return juce::Time::getMillisecondCounter() - entry.timeResolved >= (juce::uint32) timeToLiveMs.load();
+    }
+
+    static inline std::atomic<juce::int64> timeToLiveMs {0};
+
+    Queries queries;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    Waiters cachedWaiters;
+    Entry replyEntry {};
+    WaiterId lastWaiterId {0};
+    size_t nextPruneSize {64};
+
+    JUCE_DECLARE_NON_COPYABLE (BonjourResolveCache)
+};
+
+namespace jucey
+{
+    // Everything that describes a service, shared between copies and only
+    // copied when one of them is modified
+    class BonjourService::Data : public juce::ReferenceCountedObject
+    {
+    public:
+        Data() = default;
+
+        Data (const juce::String& serviceType,
+              const juce::String& serviceName,
+              const juce::String& serviceDomain)
+            : type {serviceType}
+            , name {serviceName}
+            , domain {serviceDomain}
+        {
+
+        }
+
+        // A new service is made for every discovery reply, so their data is
+        // kept in a block pool
+        static void* operator new (size_t size)
+        {
+            jassert (size == sizeof (Data));
+            return BonjourPoolAllocator<Data>::getPool().allocate();
+        }
+
+        static void operator delete (void* data)
+        {
+            BonjourPoolAllocator<Data>::getPool().deallocate (data);
+        }
+
+        juce::String type {};
+        juce::String name {};
+        juce::String domain {};
+        uint32_t interfaceIndex {0};
+        std::vector<int> interfaceIndices {};
+        BonjourTxtRecord txtRecord {};
+        CallbackDispatcher callbackDispatcher {nullptr};
+        BonjourConnection::Ptr connection {nullptr};
+        bool isInterfaceMergingEnabled {false};
+    };
+
+    // The state of any operations a service has started, this is unique to
+    // each instance, never copied, and only created once an operation starts.
+    // The DNS service callbacks are given the Pimpl rather than the service so
+    // a service can be moved while its operations are running.
+    struct BonjourService::Pimpl
+    {
+        using OperationState = std::shared_ptr<BonjourOperation::State>;
+
+        // Every reply hands its callback on by reference count rather than
+        // copying it, and the callbacks themselves are kept in a block pool
+        template <typename Callback>
+        using SharedCallback = std::shared_ptr<Callback>;
+
+        template <typename Callback>
+        static SharedCallback<Callback> shareCallback (Callback callback)
+        {
+            if (callback == nullptr)
+                return nullptr;
+
+            return std::allocate_shared<Callback> (BonjourPoolAllocator<Callback>{}, std::move (callback));
+        }
+
+        // A service is made for each operation, so these are pooled too
+        static void* operator new (size_t size)
+        {
+            jassert (size == sizeof (Pimpl));
+            return BonjourPoolAllocator<Pimpl>::getPool().allocate();
+        }
+
+        static void operator delete (void* pimpl)
+        {
+            BonjourPoolAllocator<Pimpl>::getPool().deallocate (pimpl);
+        }
+
+        static void browseReply (DNSServiceRef sdRef,
+                                 DNSServiceFlags flags,
+                                 uint32_t interfaceIndex,
+                                 DNSServiceErrorType errorCode,
+                                 const char* serviceName,
+                                 const char* regtype,
+                                 const char* replyDomain,
+                                 void* context)
+        {
+            juce::ignoreUnused (sdRef);
+            auto* pimpl {static_cast<Pimpl*>(context)};
+
+            if (pimpl != nullptr && ! isCancelled (pimpl->operationState))
+            {
+                // The same names turn up in every burst, so they're shared
+                // rather than copied out of each reply
+                auto& strings {BonjourStringPool::getInstance()};
+                BonjourService discoveredService {strings.get (regtype), strings.get (serviceName), strings.get (replyDomain)};
+                auto& discoveredData {discoveredService.getWritableData()};
+                discoveredData.interfaceIndex = interfaceIndex;
+                discoveredData.callbackDispatcher = pimpl->owner->data->callbackDispatcher;
+                discoveredData.connection = pimpl->owner->data->connection;
+
+                if (pimpl->isMergingInterfaces)
+                {
+                    if (errorCode == kDNSServiceErr_NoError)
+                    {
+                        const auto isAvailable {(flags & kDNSServiceFlagsAdd) != 0};
+
+                        if (pimpl->mergeInterface (discoveredData, isAvailable))
+                            pimpl->pendingDiscoveryEvents.push_back ({std::move (discoveredService), isAvailable});
+
+                        if ((flags & kDNSServiceFlagsMoreComing) == 0)
+                            pimpl->flushMergedDiscoveryEvents();
+
+                        return;
+                    }
+
+                    // Anything that's been held back goes before the error
+                    pimpl->flushMergedDiscoveryEvents();
+                }
+
+                if (pimpl->discoverBatchAsyncCallback != nullptr)
+                {
+                    if (errorCode == kDNSServiceErr_NoError)
+                        pimpl->pendingDiscoveryEvents.push_back ({std::move (discoveredService), (flags & kDNSServiceFlagsAdd) != 0});
+
+                    if ((flags & kDNSServiceFlagsMoreComing) == 0 || errorCode != kDNSServiceErr_NoError)
+                        pimpl->flushDiscoveryEvents (bonjourResult (errorCode));
+
+                    return;
+                }
+
+                pimpl->dispatch (pimpl->operationState,
+                                 [callback = pimpl->discoverAsyncCallback,
+                                  discoveredService = std::move (discoveredService),
+                                  isAvailable = (flags & kDNSServiceFlagsAdd) != 0,
+                                  isMoreComing = (flags & kDNSServiceFlagsMoreComing) != 0,
+                                  result = bonjourResult (errorCode)]
+                {
+                    (*callback) (discoveredService, isAvailable, isMoreComing, result);
+                });
+            }
+        }
+
+        static void queryRecordReply (DNSServiceRef sdRef,
+                                      DNSServiceFlags flags,
+                                      uint32_t interfaceIndex,
+                                      DNSServiceErrorType errorCode,
+                                      const char* fullname,
+                                      uint16_t rrtype,
+                                      uint16_t rrclass,
+                                      uint16_t rdlen,
+                                      const void* rdata,
+                                      uint32_t ttl,
+                                      void* context)
+        {
+            juce::ignoreUnused (sdRef);
+            auto* pimpl {static_cast<Pimpl*>(context)};
+
+            if (pimpl != nullptr && ! isCancelled (pimpl->operationState))
+            {
+                if (errorCode == kDNSServiceErr_NoError)
+                {
+                    pimpl->pendingRecordEvents.push_back ({juce::String::fromUTF8 (fullname),
+                                                           (int) rrtype,
+                                                           (int) rrclass,
+                                                           juce::MemoryBlock {rdata, rdata != nullptr ? (size_t) rdlen : 0},
+                                                           juce::RelativeTime::seconds ((double) ttl),
+                                                           (int) interfaceIndex,
+                                                           (flags & kDNSServiceFlagsAdd) != 0});
+                }
+
+                if ((flags & kDNSServiceFlagsMoreComing) == 0 || errorCode != kDNSServiceErr_NoError)
+                    pimpl->flushRecordEvents (bonjourResult (errorCode));
+            }
+        }
+
+        void handleResolved (const BonjourResolveCache::Entry& entry)
+        {
+            resolveWaiterId = 0;
+
+            if (isCancelled (resolveState))
+                return;
+
+            // Resolving the same instance again usually gets the same reply,
+            // the data is only copied and written to when something changed
+            if (owner->data->interfaceIndex != entry.interfaceIndex
+                || ! owner->data->txtRecord.hasSameBytesAs (entry.txtRecord))
+            {
+                auto& resolvedData {owner->getWritableData()};
+                resolvedData.interfaceIndex = entry.interfaceIndex;
+                resolvedData.txtRecord = entry.txtRecord;
+            }
+
+            if (resolveAddressAsyncCallback != nullptr)
+            {
+                startAddressLookup (entry);
+                return;
+            }
+
+            dispatch (resolveState,
+                      [callback = resolveAsyncCallback,
+                       resolvedService = BonjourService {*owner},
+                       hostName = entry.hostName,
+                       port = (int) entry.port,
+                       result = entry.result]
+            {
+                (*callback) (resolvedService, hostName, port, result);
+            });
+        }
+
+        // Looks up the addresses of the resolved host on the interface it was
+        // resolved on, as soon as the SRV record arrives and on the same loop,
+        // so nobody has to block in getaddrinfo before they can connect
+        void startAddressLookup (const BonjourResolveCache::Entry& entry)
+        {
+            resolvedHostName = entry.hostName;
+            resolvedPort = (int) entry.port;
+
+            DNSServiceRef ref {nullptr};
+            DNSServiceFlags flags {0};
+            auto addressConnection {getConnection()};
+            auto& addressBackend {addressConnection != nullptr ? addressConnection->getBackend() : BonjourBackend::getCurrent()};
+            auto result {entry.result};
+
+            if (result.wasOk() && addressConnection != nullptr)
+                result = bonjourResult (addressConnection->share (ref, flags));
+
+            if (result.wasOk())
+                result = bonjourResult (addressBackend.getAddrInfo (&ref,
+                                                                    flags,
+                                                                    entry.interfaceIndex,
+                                                                    kDNSServiceProtocol_IPv4 | kDNSServiceProtocol_IPv6,
+                                                                    entry.hostName.toUTF8(),
+                                                                    &addressReply,
+                                                                    this));
+
+            if (result.failed())
+            {
+                dispatch (resolveState,
+                          [callback = resolveAddressAsyncCallback,
+                           resolvedService = BonjourService {*owner},
+                           hostName = resolvedHostName,
+                           port = resolvedPort,
+                           result]
+                {
+                    (*callback) (resolvedService, hostName, port, {}, false, false, result);
+                });
+
+                return;
+            }
+
+            addressDnsService = std::make_unique<BonjourDnsService>(ref,
+                                                                    jucey::BonjourMetrics::OperationKind::addressLookup,
+                                                                    addressBackend,
+                                                                    std::move (addressConnection));
+        }
+
+        static void addressReply (DNSServiceRef sdRef,
+                                  DNSServiceFlags flags,
+                                  uint32_t interfaceIndex,
+                                  DNSServiceErrorType errorCode,
+                                  const char* hostname,
+                                  const struct sockaddr* address,
+                                  uint32_t ttl,
+                                  void* context)
+        {
+            juce::ignoreUnused (sdRef, hostname, ttl);
+            auto* pimpl {static_cast<Pimpl*>(context)};
+
+            if (pimpl != nullptr && ! isCancelled (pimpl->resolveState))
+            {
+                // Each address is reported along with the interface it can be
+                // reached on, which matters for IPv6 link-local addresses
+                BonjourService resolvedService {*pimpl->owner};
+
+                if (resolvedService.getInterfaceIndex() != (int) interfaceIndex)
+                    resolvedService.getWritableData().interfaceIndex = interfaceIndex;
+
+                pimpl->dispatch (pimpl->resolveState,
+                                 [callback = pimpl->resolveAddressAsyncCallback,
+                                  resolvedService = std::move (resolvedService),
+                                  hostName = pimpl->resolvedHostName,
+                                  port = pimpl->resolvedPort,
+                                  ipAddress = toIPAddress (address),
+                                  isAvailable = (flags & kDNSServiceFlagsAdd) != 0,
+                                  isMoreComing = (flags & kDNSServiceFlagsMoreComing) != 0,
+                                  result = bonjourResult (errorCode)]
+                {
+                    (*callback) (resolvedService, hostName, port, ipAddress, isAvailable, isMoreComing, result);
+                });
+            }
+        }
+
+        static juce::IPAddress toIPAddress (const struct sockaddr* address)
+        {
+            if (address == nullptr)
+                return {};
+
+            if (address->sa_family == AF_INET)
+            {
+                const auto* ipv4Address {reinterpret_cast<const sockaddr_in*> (address)};
+                return juce::IPAddress {reinterpret_cast<const juce::uint8*> (&ipv4Address->sin_addr), false};
+            }
+
+            if (address->sa_family == AF_INET6)
+            {
+                const auto* ipv6Address {reinterpret_cast<const sockaddr_in6*> (address)};
+                return juce::IPAddress {reinterpret_cast<const juce::uint8*> (&ipv6Address->sin6_addr), true};
+            }
+
+            return {};
+        }
+
+        static void registerReply (DNSServiceRef sdRef,
+                                   DNSServiceFlags flags,
+                                   DNSServiceErrorType errorCode,
+                                   const char* name,
+                                   const char* regtype,
+                                   const char* domain,
+                                   void* context)
+        {
+            juce::ignoreUnused (sdRef, flags);
+            auto* pimpl {static_cast<Pimpl*>(context)};
+
+            if (pimpl != nullptr && ! isCancelled (pimpl->operationState))
+            {
+                auto& registeredData {pimpl->owner->getWritableData()};
+                registeredData.name = name;
+                registeredData.type = regtype;
+                registeredData.domain = domain;
+
+                pimpl->dispatch (pimpl->operationState,
+                                 [callback = pimpl->registerAsyncCallback,
+                                  registeredService = BonjourService {*pimpl->owner},
+                                  result = bonjourResult (errorCode)]
+                {
+                    (*callback) (registeredService, result);
+                });
+            }
+        }
+
+        Pimpl (BonjourService& ownerToUse)
+            : owner {&ownerToUse}
+        {
+
+        }
+
+        ~Pimpl()
+        {
+            cancelResolve();
+
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            cancelRecordUpdate();
+            detachOperation (operationState);
+            detachOperation (resolveState);
+        }
+
+        void flushDiscoveryEvents (const juce::Result& result)
+        {
+            const auto& callbackDispatcher {owner->data->callbackDispatcher};
+
+            if (callbackDispatcher == nullptr)
+            {
+                // Called directly so the events can be cleared afterwards,
+                // keeping their storage for the next burst
+                BonjourMetricsRecorder::timeCallback ([this, &result]
+                {
+                    (*discoverBatchAsyncCallback) (pendingDiscoveryEvents, result);
+                })();
+
+                pendingDiscoveryEvents.clear();
+                return;
+            }
+
+            // The events go with the callback, so the next burst needs new
+            // storage. It's reserved at the size of this burst, so a burst of
+            // a similar size takes one allocation for its events rather than
+            // one every time the vector grows. Wrapping the callback for the
+            // dispatcher allocates separately.
+            const auto numEvents {pendingDiscoveryEvents.size()};
+
+            callbackDispatcher (dropIfCancelled (operationState,
+                                                 BonjourMetricsRecorder::timeCallback ([callback = discoverBatchAsyncCallback,
+                                                                                        events = std::move (pendingDiscoveryEvents),
+                                                                                        result]
+            {
+                (*callback) (events, result);
+            })));
+
+            pendingDiscoveryEvents.clear();
+            pendingDiscoveryEvents.reserve (numEvents);
+        }
+
+        // Returns true if the instance has just appeared on its first
+        // interface, or gone from its last. Those are the only changes that
+        // are passed on, with the service no longer tied to an interface.
+        bool mergeInterface (Data& discoveredData, bool isAvailable)
+        {
+            const auto key {getMergeKey (discoveredData)};
+            auto& interfaceIndices {mergedInterfaces[key]};
+            const auto interfaceIndex {(int) discoveredData.interfaceIndex};
+            const auto iter {std::find (interfaceIndices.begin(), interfaceIndices.end(), interfaceIndex)};
+
+            if (isAvailable)
+            {
+                if (iter != interfaceIndices.end())
+                    return false;
+
+                interfaceIndices.push_back (interfaceIndex);
+
+                if (interfaceIndices.size() > 1)
+                    return false;
+            }
+            else
+            {
+                if (iter == interfaceIndices.end())
+                    return false;
+
+                interfaceIndices.erase (iter);
+
+                if ( ! interfaceIndices.empty())
+                    return false;
+
+                mergedInterfaces.erase (key);
+            }
+
+            discoveredData.interfaceIndex = 0;
+            discoveredData.interfaceIndices = {interfaceIndex};
+            return true;
+        }
+
+        static juce::String getMergeKey (const Data& discoveredData)
+        {
+            return (discoveredData.name + "." + discoveredData.type + discoveredData.domain).toLowerCase();
+        }
+
+        // Each burst of merged events is held until it ends, so an added
+        // instance has every interface it appeared on in that burst, and
+        // the last event passed to discoverAsync() isn't flagged as having
+        // more to come when the replies after it were held back
+        void flushMergedDiscoveryEvents()
+        {
+            if (pendingDiscoveryEvents.empty())
+                return;
+
+            for (auto& event : pendingDiscoveryEvents)
+            {
+                if (event.isAvailable)
+                {
+                    const auto iter {mergedInterfaces.find (getMergeKey (*event.service.data))};
+
+                    if (iter != mergedInterfaces.end())
+                        event.service.getWritableData().interfaceIndices = iter->second;
+                }
+            }
+
+            if (discoverBatchAsyncCallback != nullptr)
+            {
+                flushDiscoveryEvents (juce::Result::ok());
+                return;
+            }
+
+            for (size_t index {0}; index < pendingDiscoveryEvents.size(); ++index)
+            {
+                dispatch (operationState,
+                          [callback = discoverAsyncCallback,
+                           event = std::move (pendingDiscoveryEvents[index]),
+                           isMoreComing = index + 1 < pendingDiscoveryEvents.size()]
+                {
+                    (*callback) (event.service, event.isAvailable, isMoreComing, juce::Result::ok());
+                });
+            }
+
+            pendingDiscoveryEvents.clear();
+        }
+
+        void flushRecordEvents (const juce::Result& result)
+        {
+            const auto& callbackDispatcher {owner->data->callbackDispatcher};
+
+            if (callbackDispatcher == nullptr)
+            {
+                BonjourMetricsRecorder::timeCallback ([this, &result]
+                {
+                    (*queryRecordAsyncCallback) (pendingRecordEvents, result);
+                })();
+
+                pendingRecordEvents.clear();
+                return;
+            }
+
+            callbackDispatcher (dropIfCancelled (operationState,
+                                                 BonjourMetricsRecorder::timeCallback ([callback = queryRecordAsyncCallback,
+                                                                                        events = std::move (pendingRecordEvents),
+                                                                                        result]
+            {
+                (*callback) (events, result);
+            })));
+
+            pendingRecordEvents.clear();
+        }
+
+        template <typename Callback>
+        void dispatch (const OperationState& operation, Callback&& callback)
+        {
+            const auto& callbackDispatcher {owner->data->callbackDispatcher};
+            auto timedCallback {BonjourMetricsRecorder::timeCallback (std::forward<Callback> (callback))};
+
+            if (callbackDispatcher == nullptr)
+                timedCallback();
+            else
+                callbackDispatcher (dropIfCancelled (operation, std::move (timedCallback)));
+        }
+
+        // A callback that's still waiting for the dispatcher when its
+        // operation is cancelled is never called
+        template <typename Callback>
+        static std::function<void()> dropIfCancelled (const OperationState& operation, Callback&& callback)
+        {
+            return [operation, callback = std::forward<Callback> (callback)]() mutable
+            {
+                if ( ! isCancelled (operation))
+                    callback();
+            };
+        }
+
+        static bool isCancelled (const OperationState& operation)
+        {
+            return operation != nullptr && operation->isCancelled;
+        }
+
+        // Must be called with the event loop lock held. Any earlier operation
+        // the state was for has already been replaced, so cancelling its
+        // handle no longer does anything.
+        BonjourOperation startOperation (OperationState& operation, std::function<void()> stop)
+        {
+            detachOperation (operation);
+            operation = std::allocate_shared<BonjourOperation::State> (BonjourPoolAllocator<BonjourOperation::State>{});
+            operation->stop = std::move (stop);
+            return {juce::Result::ok(), operation};
+        }
+
+        // Must be called with the event loop lock held. The operation is
+        // marked as cancelled, just as BonjourOperation::cancel() would, so
+        // any callback still waiting for the dispatcher is dropped rather
+        // than called after the service has gone or moved on.
+        static void detachOperation (OperationState& operation)
+        {
+            if (operation != nullptr)
+            {
+                operation->isCancelled.exchange (true);
+                std::exchange (operation, nullptr)->stop = nullptr;
+            }
+        }
+
+        // Called on the event loop thread when an operation is cancelled
+        void stopDnsService()
+        {
+            detachOperation (operationState);
+            cancelRecordUpdate();
+            registeredRef = nullptr;
+            pendingDiscoveryEvents.clear();
+            pendingRecordEvents.clear();
+            dnsService.reset();
+        }
+
+        void stopResolve()
+        {
+            detachOperation (resolveState);
+            cancelResolve();
+            addressDnsService.reset();
+        }
+
+        juce::Result startResolve()
+        {
+            cancelResolve();
+
+            return BonjourResolveCache::getInstance().resolve ({owner->data->name,
+                                                                owner->data->type,
+                                                                owner->data->domain,
+                                                                owner->data->interfaceIndex},
+                                                               getConnection().get(),
+                                                               [this](const BonjourResolveCache::Entry& entry)
+                                                               {
+                                                                   handleResolved (entry);
+                                                               },
+                                                               resolveWaiterId);
+        }
+
+        // The handle is made first as a cached result is handed over before
+        // the resolve returns
+        BonjourOperation startResolveOperation()
+        {
+            auto operation {startOperation (resolveState, [this] { stopResolve(); })};
+            const auto result {startResolve()};
+
+            if (result.failed())
+            {
+                detachOperation (resolveState);
+                return {result};
+            }
+
+            return operation;
+        }
+
+        void cancelResolve()
+        {
+            if (resolveWaiterId != 0)
+                BonjourResolveCache::getInstance().cancel (std::exchange (resolveWaiterId, 0));
+        }
+
+        // The service's own session, the process-wide session if sessions
+        // are shared by default, or nullptr if the operation should have a
+        // connection of its own
+        BonjourConnection::Ptr getConnection()
+        {
+            if (owner->data->connection != nullptr)
+                return owner->data->connection;
+
+            if ( ! BonjourSession::isSharedByDefault())
+                return nullptr;
+
+            if ( ! defaultSession.has_value())
+                defaultSession.emplace();
+
+            return (*defaultSession)->pimpl->connection;
+        }
+
+        // Sets up the ref, flags and backend for a new operation, sharing a
+        // connection if there is one to share
+        juce::Result prepareDnsService (DNSServiceRef& ref, DNSServiceFlags& flags)
+        {
+            ref = nullptr;
+            flags = 0;
+            connection = getConnection();
+
+            if (connection == nullptr)
+            {
+                backend = &BonjourBackend::getCurrent();
+                return juce::Result::ok();
+            }
+
+            backend = &connection->getBackend();
+            return bonjourResult (connection->share (ref, flags));
+        }
+
+        BonjourOperation startDnsService (DNSServiceRef ref, jucey::BonjourMetrics::OperationKind kind)
+        {
+            // You can't start the DNS Service if the reference is invalid!
+            jassert (ref != nullptr);
+
+            {
+                // Any update waiting to be sent was for the operation being
+                // replaced
+                const juce::ScopedLock lock {eventLoop->getLock()};
+                cancelRecordUpdate();
+                registeredRef = kind == jucey::BonjourMetrics::OperationKind::registration ? ref : nullptr;
+                lastRecordUpdateResult = juce::Result::ok();
+            }
+
+            dnsService = std::make_unique<BonjourDnsService>(ref, kind, *backend, std::move (connection));
+
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            return startOperation (operationState, [this] { stopDnsService(); });
+        }
+
+        // Changes to the records of a registered service are sent once no
+        // more have been made for recordUpdateDelayMs, so a burst of changes
+        // goes out as a single update. Each change restarts the timer, but a
+        // steady stream of changes is still sent every recordUpdateMaxDelayMs.
+        // The data is held until then so any further changes are made to a
+        // copy and the record can't change mid-update.
+        void scheduleRecordUpdate()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            if (registeredRef == nullptr)
+                return;
+
+            const auto now {juce::Time::getMillisecondCounterHiRes()};
+
+            if (recordUpdateTimerId == 0)
+                firstRecordChangeTime = now;
+            else
+                eventLoop->cancelTimer (std::exchange (recordUpdateTimerId, 0));
+
+            pendingRecordData = owner->data;
+
+            const auto timeUntilMaxDelay {firstRecordChangeTime + recordUpdateMaxDelayMs - now};
+            const auto delay {juce::jlimit (0, recordUpdateDelayMs, (int) timeUntilMaxDelay)};
+
+            recordUpdateTimerId = eventLoop->callAfterDelay (delay, [this]
+            {
+                recordUpdateTimerId = 0;
+                sendRecordUpdate();
+            });
+        }
+
+        juce::Result updateRecords()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+
+            if (registeredRef == nullptr)
+                return juce::Result::fail ("Only the records of a registered service can be updated");
+
+            cancelRecordUpdate();
+            pendingRecordData = owner->data;
+            return sendRecordUpdate();
+        }
+
+        // Must be called with the event loop lock held
+        juce::Result sendRecordUpdate()
+        {
+            if (pendingRecordData == nullptr)
+                return juce::Result::ok();
+
+            const auto recordData {std::move (pendingRecordData)};
+
+            // A null record ref updates the TXT record the service was
+            // registered with
+            lastRecordUpdateResult = bonjourResult (dnsService->getBackend().updateRecord (registeredRef,
+                                                                                           nullptr,
+                                                                                           0,
+                                                                                           recordData->txtRecord.getLength(),
+                                                                                           recordData->txtRecord.getBytes(),
+                                                                                           0));
+            return lastRecordUpdateResult;
+        }
+
+        // Must be called with the event loop lock held
+        void cancelRecordUpdate()
+        {
+            if (recordUpdateTimerId != 0)
+                eventLoop->cancelTimer (std::exchange (recordUpdateTimerId, 0));
+
+            pendingRecordData = nullptr;
+        }
+
+        static constexpr int recordUpdateDelayMs {100};
+        static constexpr int recordUpdateMaxDelayMs {1000};
+
+        // Only changed with the event loop lock held, so no callback can be
+        // using the owner while it's being moved
+        BonjourService* owner {nullptr};
+        juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        SharedCallback<DiscoverAsyncCallback> discoverAsyncCallback {nullptr};
+        SharedCallback<DiscoverBatchAsyncCallback> discoverBatchAsyncCallback {nullptr};
+        std::vector<DiscoveryEvent> pendingDiscoveryEvents;
+        std::map<juce::String, std::vector<int>> mergedInterfaces;
+        bool isMergingInterfaces {false};
+        SharedCallback<QueryRecordAsyncCallback> queryRecordAsyncCallback {nullptr};
+        std::vector<RecordEvent> pendingRecordEvents;
+        SharedCallback<ResolveAsyncCallback> resolveAsyncCallback {nullptr};
+        SharedCallback<ResolveAddressAsyncCallback> resolveAddressAsyncCallback {nullptr};
+        std::unique_ptr<BonjourDnsService> addressDnsService {nullptr};
+        juce::String resolvedHostName {};
+        int resolvedPort {0};
+        SharedCallback<RegisterAsyncCallback> registerAsyncCallback {nullptr};
+        std::unique_ptr<BonjourDnsService> dnsService {nullptr};
+        std::optional<juce::SharedResourcePointer<BonjourSession>> defaultSession {};
+        BonjourConnection::Ptr connection {nullptr};
+        BonjourBackend* backend {nullptr};
+        BonjourResolveCache::WaiterId resolveWaiterId {0};
+        DNSServiceRef registeredRef {nullptr};
+        juce::Result lastRecordUpdateResult {juce::Result::ok()};
+        juce::ReferenceCountedObjectPtr<Data> pendingRecordData {nullptr};
+        BonjourEventLoop::TimerId recordUpdateTimerId {0};
+        double firstRecordChangeTime {0.0};
+        OperationState operationState {nullptr};
+        OperationState resolveState {nullptr};
+
+        JUCE_DECLARE_NON_COPYABLE (Pimpl)
+    };
+
+    BonjourService::BonjourService()
+        : data {getEmptyData()}
+    {
+
+    }
+
+    BonjourService::BonjourService (const juce::String& type,
+                                    const juce::String& name,
+                                    const juce::String& domain)
+        : data {new Data {type, name, domain}}
+    {
+        // bonjour services must always start with an underscore ("_")
+        jassert (type.startsWith ("_"));
+
+        // bonjour services must always end with "._udp" or "._tcp"
+        jassert (isUdp() || isTcp());
+    }
+
+    BonjourService::BonjourService (const BonjourService& other)
+        : data {other.data}
+    {
+
+    }
+
+    BonjourService::BonjourService (BonjourService&& other) noexcept
+        : data {getEmptyData()}
+    {
+        *this = std::move (other);
+    }
+
+    BonjourService& BonjourService::operator= (const BonjourService& other)
+    {
+        // Any operations this service started are stopped, the same as if it
+        // had been destroyed
+        pimpl.reset();
+        data = other.data;
+
+        return *this;
+    }
+
+    BonjourService& BonjourService::operator= (BonjourService&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        pimpl.reset();
+
+        if (other.pimpl == nullptr)
+        {
+            std::swap (data, other.data);
+            return *this;
+        }
+
+        // The other service's operations carry on running under this one,
+        // holding the event loop lock stops any of their callbacks running
+        // until they've been pointed at their new owner
+        const juce::ScopedLock lock {other.pimpl->eventLoop->getLock()};
+        std::swap (data, other.data);
+        pimpl = std::move (other.pimpl);
+        pimpl->owner = this;
+
+        return *this;
+    }
+
+    BonjourService::~BonjourService()
+    {
+        // Stop the operations first as their callbacks may still be using
+        // the data
+        pimpl.reset();
+    }
+
+    const juce::ReferenceCountedObjectPtr<BonjourService::Data>& BonjourService::getEmptyData()
+    {
+        // Shared by every default constructed (or moved from) service so they
+        // don't allocate anything until they're modified
+        static const juce::ReferenceCountedObjectPtr<Data> emptyData {new Data{}};
+        return emptyData;
+    }
+
+    BonjourService::Data& BonjourService::getWritableData()
+    {
+        if (data->getReferenceCount() > 1)
+            data = new Data {*data};
+
+        return *data;
+    }
+
+    BonjourService::Pimpl& BonjourService::getPimpl()
+    {
+        if (pimpl == nullptr)
+            pimpl = std::make_unique<Pimpl>(*this);
+
+        return *pimpl;
+    }
+
+    juce::String BonjourService::getName() const
+    {
+        return data->name;
+    }
+
+    juce::String BonjourService::getType() const
+    {
+        return data->type;
+    }
+
+    juce::String BonjourService::getDomain() const
+    {
+        return data->domain;
+    }
+
+    int BonjourService::getInterfaceIndex() const
+    {
+        return (int) data->interfaceIndex;
+    }
+
+    std::vector<int> BonjourService::getInterfaceIndices() const
+    {
+        if ( ! data->interfaceIndices.empty())
+            return data->interfaceIndices;
+
+        if (data->interfaceIndex != 0)
+            return {(int) data->interfaceIndex};
+
+        return {};
+    }
+
+    juce::var BonjourService::getRecordItemValue (const juce::String& key, const juce::var& defaultReturnValue) const
+    {
+        const auto value {data->txtRecord.findValue ({key.toRawUTF8(), key.getNumBytesAsUTF8()})};
+
+        if ( ! value.has_value())
+            return defaultReturnValue;
+
+        return juce::String::fromUTF8 (value->data(), (int) value->size());
+    }
+
+    BonjourService::RecordItem BonjourService::getRecordItemAtIndex (int index) const
+    {
+        if (index < 0 || index >= getNumRecordItems())
+        {
+            // Trying to access a non-existant record item, check
+            // `getNumRecordItems()` before calling this function
+            jassertfalse;
+            return {};
+        }
+
+        return data->txtRecord.getItemAtIndex (index);
+    }
+
+    BonjourService::RecordItemView BonjourService::getRecordItemViewAtIndex (int index) const
+    {
+        if (index < 0 || index >= getNumRecordItems())
+        {
+            // Trying to access a non-existant record item, check
+            // `getNumRecordItems()` before calling this function
+            jassertfalse;
+            return {};
+        }
+
+        return data->txtRecord.getItemViewAtIndex (index);
+    }
+
+    BonjourService::RecordItemRange BonjourService::getRecordItems() const
+    {
+        return {*this};
+    }
+
+    juce::Result BonjourService::setRecordItemValue (const juce::String& key,
+                                                     const juce::var& newValue)
+    {
+        const auto result {getWritableData().txtRecord.setValue (key, newValue)};
+
+        if (result.wasOk() && pimpl != nullptr)
+            pimpl->scheduleRecordUpdate();
+
+        return result;
     }
 
-    ~BonjourDnsService()
+    void BonjourService::removeRecordItem (const juce::String& key)
     {
-        stopThread (1000);
+        if ( ! containsRecordItem (key))
+            return;
+
+        getWritableData().txtRecord.removeValue (key);
+
+        if (pimpl != nullptr)
+            pimpl->scheduleRecordUpdate();
     }
 
-    void stop()
+    juce::Result BonjourService::setRecordItems (TxtRecordBuilder&& builder)
     {
-        signalThreadShouldExit();
+        if (builder.result.failed())
+            return builder.result;
+
+        BonjourTxtRecord txtRecord;
+        txtRecord.moveFrom (std::move (builder.bytes));
+        builder = TxtRecordBuilder{};
+
+        if (txtRecord.hasDuplicateKeys())
+            return juce::Result::fail ("TXT record keys must be unique");
+
+        getWritableData().txtRecord = std::move (txtRecord);
+
+        if (pimpl != nullptr)
+            pimpl->scheduleRecordUpdate();
+
+        return juce::Result::ok();
     }
 
-private:
-    void run() override
+    juce::Result BonjourService::updateRecords()
     {
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 100 * 1000; /* 100ms */
+        if (pimpl == nullptr)
+            return juce::Result::fail ("Only the records of a registered service can be updated");
 
-        const int dnsServiceSocket {DNSServiceRefSockFD (ref.get())};
-        fd_set readfds;
+        return pimpl->updateRecords();
+    }
 
-        while ( ! threadShouldExit())
-        {
-            FD_ZERO (&readfds);
-            FD_SET (dnsServiceSocket, &readfds);
+    juce::Result BonjourService::getLastRecordUpdateResult() const
+    {
+        if (pimpl == nullptr)
+            return juce::Result::ok();
 
-            if (select (dnsServiceSocket + 1, &readfds, nullptr, nullptr, &tv) > 0 && ! threadShouldExit())
-            {
-                if (FD_ISSET (dnsServiceSocket, &readfds) && ! threadShouldExit())
-                    DNSServiceProcessResult (ref.get());
-            }
-        }
+        const juce::ScopedLock lock {pimpl->eventLoop->getLock()};
+        return pimpl->lastRecordUpdateResult;
+    }
 
-        ref = nullptr;
+    bool BonjourService::containsRecordItem (const juce::String& key) const
+    {
+        return data->txtRecord.containsKey (key);
     }
 
-    std::unique_ptr<_DNSServiceRef_t, decltype(&DNSServiceRefDeallocate)> ref;
-};
+    int BonjourService::getNumRecordItems() const
+    {
+        return data->txtRecord.getCount();
+    }
 
-class BonjourTxtRecord
-{
-public:
-    BonjourTxtRecord()
+    bool BonjourService::isUdp() const
     {
-        TXTRecordCreate (&ref, 0, nullptr);
+        return data->type.contains ("._udp");
     }
 
-    BonjourTxtRecord (const BonjourTxtRecord& other)
+    bool BonjourService::isTcp() const
     {
-        TXTRecordCreate (&ref, 0, nullptr);
+        return data->type.contains ("._tcp");
+    }
 
-        for (auto index {0}; index < other.getCount(); ++index)
-        {
-            const auto item {other.getItemAtIndex (index)};
-            setValue (item.key, item.value);
-        }
+    void BonjourService::setSession (const BonjourSession* session)
+    {
+        getWritableData().connection = session != nullptr ? session->pimpl->connection : nullptr;
     }
 
-    ~BonjourTxtRecord()
+    void BonjourService::setInterfaceMergingEnabled (bool shouldMergeInterfaces)
     {
-        TXTRecordDeallocate (&ref);
+        getWritableData().isInterfaceMergingEnabled = shouldMergeInterfaces;
     }
 
-    void clear()
+    bool BonjourService::isInterfaceMergingEnabled() const
     {
-        TXTRecordDeallocate (&ref);
-        TXTRecordCreate (&ref, 0, nullptr);
+        return data->isInterfaceMergingEnabled;
+    }
 
+    void BonjourService::setCallbackDispatcher (CallbackDispatcher dispatcher)
+    {
+        getWritableData().callbackDispatcher = std::move (dispatcher);
     }
 
-    void copyFrom (uint16_t txtLen, const unsigned char* txtRecord)
+    BonjourService::CallbackDispatcher BonjourService::getCallbackDispatcher() const
     {
-        clear();
+        return data->callbackDispatcher;
+    }
 
-        for (auto index {0}; index < getCount (txtLen, txtRecord); ++index)
+    BonjourService::CallbackDispatcher BonjourService::createThreadPoolDispatcher (juce::ThreadPool& threadPool)
+    {
+        return [&threadPool](std::function<void()> callback)
         {
-            const auto item {getItemAtIndex (txtLen, txtRecord, index)};
-            setValue (item.key, item.value);
-        }
+            threadPool.addJob (std::move (callback));
+        };
     }
 
-    uint16_t getLength() const
+   #if JUCE_MODULE_AVAILABLE_juce_events
+    BonjourService::CallbackDispatcher BonjourService::createMessageThreadDispatcher()
     {
-        return TXTRecordGetLength (&ref);
+        return [](std::function<void()> callback)
+        {
+            juce::MessageManager::callAsync (std::move (callback));
+        };
     }
+   #endif
 
-    const void* getBytes() const
+    BonjourOperation BonjourService::discoverAsync (BonjourService::DiscoverAsyncCallback callback, int interfaceIndex)
     {
-        return TXTRecordGetBytesPtr (&ref);
+        auto& operations {getPimpl()};
+
+        // Calls on a shared connection can't overlap with its results being
+        // processed
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+
+        DNSServiceRef ref {nullptr};
+        DNSServiceFlags flags {0};
+        operations.discoverAsyncCallback = Pimpl::shareCallback (std::move (callback));
+        operations.discoverBatchAsyncCallback = nullptr;
+        operations.pendingDiscoveryEvents.clear();
+        operations.mergedInterfaces.clear();
+        operations.isMergingInterfaces = data->isInterfaceMergingEnabled;
+
+        auto result {operations.prepareDnsService (ref, flags)};
+
+        if (result.failed())
+            return {result};
+
+        result = bonjourResult (operations.backend->browse (&ref,
+                                                            flags,
+                                                            interfaceIndex,
+                                                            data->type.toUTF8(),
+                                                            data->domain.isEmpty() ? nullptr : data->domain.toUTF8(),
+                                                            &Pimpl::browseReply,
+                                                            &operations));
+
+        if (result.failed())
+            return {result};
+
+        return operations.startDnsService (ref, jucey::BonjourMetrics::OperationKind::browse);
     }
 
-    juce::String getValue (const juce::String& key) const
+    BonjourOperation BonjourService::discoverBatchAsync (BonjourService::DiscoverBatchAsyncCallback callback, int interfaceIndex)
     {
-        uint8_t valueLength {0};
-        const void* valueBuffer {TXTRecordGetValuePtr (getLength(), getBytes(), key.toRawUTF8(), &valueLength)};
-        return juce::String {(const char*) valueBuffer, valueLength};
+        auto& operations {getPimpl()};
+
+        // Calls on a shared connection can't overlap with its results being
+        // processed
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+
+        DNSServiceRef ref {nullptr};
+        DNSServiceFlags flags {0};
+        operations.discoverAsyncCallback = nullptr;
+        operations.discoverBatchAsyncCallback = Pimpl::shareCallback (std::move (callback));
+        operations.pendingDiscoveryEvents.clear();
+        operations.mergedInterfaces.clear();
+        operations.isMergingInterfaces = data->isInterfaceMergingEnabled;
+
+        auto result {operations.prepareDnsService (ref, flags)};
+
+        if (result.failed())
+            return {result};
+
+        result = bonjourResult (operations.backend->browse (&ref,
+                                                            flags,
+                                                            interfaceIndex,
+                                                            data->type.toUTF8(),
+                                                            data->domain.isEmpty() ? nullptr : data->domain.toUTF8(),
+                                                            &Pimpl::browseReply,
+                                                            &operations));
+
+        if (result.failed())
+            return {result};
+
+        return operations.startDnsService (ref, jucey::BonjourMetrics::OperationKind::browse);
     }
 
-    jucey::BonjourService::RecordItem getItemAtIndex (int index) const
+    BonjourOperation BonjourService::queryRecordAsync (QueryRecordAsyncCallback callback, int recordType, int interfaceIndex)
     {
-        return getItemAtIndex (getLength(), getBytes(), index);
+        return queryRecordAsync (callback, getFullName(), recordType, recordClassInternet, interfaceIndex);
     }
 
-    bool containsKey (const juce::String& name) const
+    BonjourOperation BonjourService::queryRecordAsync (QueryRecordAsyncCallback callback,
+                                                       const juce::String& fullName,
+                                                       int recordType,
+                                                       int recordClass,
+                                                       int interfaceIndex)
     {
-        return TXTRecordContainsKey (getLength(), getBytes(), name.toRawUTF8()) == 1;
+        // There's nothing to pass the records to!
+        jassert (callback != nullptr);
+
+        auto& operations {getPimpl()};
+
+        // Calls on a shared connection can't overlap with its results being
+        // processed
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+
+        DNSServiceRef ref {nullptr};
+        DNSServiceFlags flags {0};
+        operations.queryRecordAsyncCallback = Pimpl::shareCallback (std::move (callback));
+        operations.pendingRecordEvents.clear();
+
+        auto result {operations.prepareDnsService (ref, flags)};
+
+        if (result.failed())
+            return {result};
+
+        result = bonjourResult (operations.backend->queryRecord (&ref,
+                                                                 flags | kDNSServiceFlagsLongLivedQuery,
+                                                                 (uint32_t) interfaceIndex,
+                                                                 fullName.toUTF8(),
+                                                                 (uint16_t) recordType,
+                                                                 (uint16_t) recordClass,
+                                                                 &Pimpl::queryRecordReply,
+                                                                 &operations));
+
+        if (result.failed())
+            return {result};
+
+        return operations.startDnsService (ref, jucey::BonjourMetrics::OperationKind::recordQuery);
     }
 
-    int getCount() const
+    juce::String BonjourService::getFullName() const
+    {
+        return BonjourDnsName::fromParts (data->name, data->type, data->domain.isEmpty() ? juce::String {"local"} : data->domain).toString();
+    }
+
+    BonjourOperation BonjourService::resolveAsync (jucey::BonjourService::ResolveAsyncCallback callback)
     {
-        return getCount (getLength(), getBytes());
+        auto& operations {getPimpl()};
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+        operations.resolveAsyncCallback = Pimpl::shareCallback (std::move (callback));
+        operations.resolveAddressAsyncCallback = nullptr;
+        operations.addressDnsService.reset();
+        return operations.startResolveOperation();
     }
 
-    void setValue (const juce::String& key, const juce::String& value)
+    BonjourOperation BonjourService::resolveAddressAsync (ResolveAddressAsyncCallback callback)
     {
-        // key names must be a maximum of 9 characters
-        jassert (key.length() < 10);
+        auto& operations {getPimpl()};
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+        operations.resolveAsyncCallback = nullptr;
+        operations.resolveAddressAsyncCallback = Pimpl::shareCallback (std::move (callback));
+        operations.addressDnsService.reset();
+        return operations.startResolveOperation();
+    }
 
-        // values must be a maximum of 255 characters
-        jassert (value.length() < 256);
+    void BonjourService::setResolveCacheTimeToLive (juce::RelativeTime timeToLive)
+    {
+        BonjourResolveCache::setTimeToLive (timeToLive);
+    }
 
-        TXTRecordSetValue (&ref, key.toRawUTF8(), (uint8_t) value.length(), value.toRawUTF8());
+    juce::RelativeTime BonjourService::getResolveCacheTimeToLive()
+    {
+        return BonjourResolveCache::getTimeToLive();
     }
 
-    void removeValue (const juce::String& key)
+    void BonjourService::clearResolveCache()
     {
-        TXTRecordRemoveValue (&ref, key.toRawUTF8());
+        BonjourResolveCache::getInstance().clear();
     }
 
-private:
-    static jucey::BonjourService::RecordItem getItemAtIndex (uint16_t txtLen, const void* txtRecord, uint16_t index)
+    BonjourOperation BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
+                                                    int portToRegisterServiceOn)
     {
-        const uint16_t maxKeyLength {256};
-        char keyBuffer[maxKeyLength] {};
-        uint8_t valueLength {0};
-        const void* valueBuffer {nullptr};
+        // A socket should be bound to a valid port *before* calling register
+        // and the bound port should be passed to this method
+        jassert (portToRegisterServiceOn > 0 && portToRegisterServiceOn < 65536);
 
-        TXTRecordGetItemAtIndex (txtLen,
-                                 txtRecord,
-                                 index,
-                                 maxKeyLength,
-                                 keyBuffer,
-                                 &valueLength,
-                                 &valueBuffer);
+        auto& operations {getPimpl()};
 
-        return {keyBuffer, juce::String {(const char*) valueBuffer, valueLength}};
+        // Calls on a shared connection can't overlap with its results being
+        // processed
+        const juce::ScopedLock lock {operations.eventLoop->getLock()};
+
+        DNSServiceRef ref {nullptr};
+        DNSServiceFlags flags {0};
+        operations.registerAsyncCallback = Pimpl::shareCallback (std::move (callback));
+
+        auto result {operations.prepareDnsService (ref, flags)};
+
+        if (result.failed())
+            return {result};
+
+        result = bonjourResult (operations.backend->registerService (&ref,
+                                                                     flags,
+                                                                     0,
+                                                                     data->name.isEmpty() ? nullptr : data->name.toUTF8(),
+                                                                     data->type.toUTF8(),
+                                                                     data->domain.isEmpty() ? nullptr : data->domain.toUTF8(),
+                                                                     nullptr,
+                                                                     (uint16_t) portToRegisterServiceOn,
+                                                                     data->txtRecord.getLength(),
+                                                                     data->txtRecord.getBytes(),
+                                                                     &Pimpl::registerReply,
+                                                                     &operations));
+
+        if (result.failed())
+            return {result};
+
+        return operations.startDnsService (ref, jucey::BonjourMetrics::OperationKind::registration);
     }
 
-    static int getCount (uint16_t txtLen, const void* txtRecord)
+    BonjourOperation BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
+                                                    const juce::DatagramSocket& socketToRegisterServiceOn)
     {
-        return (int) TXTRecordGetCount (txtLen, txtRecord);
+        // It doesn't make sense to call this method with a UDP socket, if the
+        // service to be registered isn't a UDP service!
+        jassert (isUdp());
+        return registerAsync (callback, socketToRegisterServiceOn.getBoundPort());
     }
-    
-    TXTRecordRef ref {};
-};
 
-juce::Result bonjourResult (DNSServiceErrorType errorCode)
-{
-    switch (errorCode)
+    BonjourOperation BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
+                                                    const juce::StreamingSocket& socketToRegisterServiceOn)
     {
-        case kDNSServiceErr_NoError:                    return juce::Result::ok();
-        case kDNSServiceErr_Unknown:                    return juce::Result::fail ("bonjour error: Unknown");
-        case kDNSServiceErr_NoSuchName:                 return juce::Result::fail ("bonjour error: No such name");
-        case kDNSServiceErr_NoMemory:                   return juce::Result::fail ("bonjour error: No memory");
-        case kDNSServiceErr_BadParam:                   return juce::Result::fail ("bonjour error: Bad parameter");
-        case kDNSServiceErr_BadReference:               return juce::Result::fail ("bonjour error: Bad reference");
-        case kDNSServiceErr_BadState:                   return juce::Result::fail ("bonjour error: Bad state");
-        case kDNSServiceErr_BadFlags:                   return juce::Result::fail ("bonjour error: Bad flags");
-        case kDNSServiceErr_Unsupported:                return juce::Result::fail ("bonjour error: Unsupported");
-        case kDNSServiceErr_NotInitialized:             return juce::Result::fail ("bonjour error: Not initialized");
-        case kDNSServiceErr_AlreadyRegistered:          return juce::Result::fail ("bonjour error: Already registered");
-        case kDNSServiceErr_NameConflict:               return juce::Result::fail ("bonjour error: Name conflict");
-        case kDNSServiceErr_Invalid:                    return juce::Result::fail ("bonjour error: Invalid");
-        case kDNSServiceErr_Firewall:                   return juce::Result::fail ("bonjour error: Firewall");
-        case kDNSServiceErr_Incompatible:               return juce::Result::fail ("bonjour error: Client library incompatible with daemon");
-        case kDNSServiceErr_BadInterfaceIndex:          return juce::Result::fail ("bonjour error: Bad interface index");
-        case kDNSServiceErr_Refused:                    return juce::Result::fail ("bonjour error: Refused");
-        case kDNSServiceErr_NoSuchRecord:               return juce::Result::fail ("bonjour error: No such record");
-        case kDNSServiceErr_NoAuth:                     return juce::Result::fail ("bonjour error: No auth");
-        case kDNSServiceErr_NoSuchKey:                  return juce::Result::fail ("bonjour error: No such key");
-        case kDNSServiceErr_NATTraversal:               return juce::Result::fail ("bonjour error: NAT Traversal");
-        case kDNSServiceErr_DoubleNAT:                  return juce::Result::fail ("bonjour error: Double NAT");
-        case kDNSServiceErr_BadTime:                    return juce::Result::fail ("bonjour error: Bad time");
-        case kDNSServiceErr_BadSig:                     return juce::Result::fail ("bonjour error: Bad signature");
-        case kDNSServiceErr_BadKey:                     return juce::Result::fail ("bonjour error: Bad key");
-        case kDNSServiceErr_Transient:                  return juce::Result::fail ("bonjour error: Transient");
-        case kDNSServiceErr_ServiceNotRunning:          return juce::Result::fail ("bonjour error: Background daemon not running");
-        case kDNSServiceErr_NATPortMappingUnsupported:  return juce::Result::fail ("bonjour error: NAT port mapping unsupported: NAT doesn't support PCP, NAT-PMP or UPnP");
-        case kDNSServiceErr_NATPortMappingDisabled:     return juce::Result::fail ("bonjour error: NAT port mapping disabled: NAT supports PCP, NAT-PMP or UPnP, but it's disabled by the administrator");
-        case kDNSServiceErr_NoRouter:                   return juce::Result::fail ("bonjour error: No router currently configured (probably no network connectivity)");
-        case kDNSServiceErr_PollingMode:                return juce::Result::fail ("bonjour error: Polling mode");
-        case kDNSServiceErr_Timeout:                    return juce::Result::fail ("bonjour error: Timeout");
-        default:                                        return juce::Result::fail ("bonjour error: Unhandled");
-    };
-}
+        // It doesn't make sense to call this method with a TCP socket, if the
+        // service to be registered isn't a TCP service!
+        jassert (isTcp());
+        return registerAsync (callback, socketToRegisterServiceOn.getBoundPort());
+    }
 
-namespace jucey
-{
-    struct BonjourService::Pimpl
+    BonjourTask<BonjourService::ResolveResult> BonjourService::resolveTask (const BonjourTaskOptions& options) const
     {
-        static void browseReply (DNSServiceRef sdRef,
-                                 DNSServiceFlags flags,
-                                 uint32_t interfaceIndex,
-                                 DNSServiceErrorType errorCode,
-                                 const char* serviceName,
-                                 const char* regtype,
-                                 const char* replyDomain,
-                                 void* context)
+        // The operation calls back directly on the event loop so the task can
+        // finish there, only the continuation goes through the dispatcher
+        auto state {std::make_shared<BonjourTaskBase::State>(data->callbackDispatcher)};
+        auto value {state->createValue<ResolveResult>({*this})};
+
+        const juce::ScopedLock lock {state->eventLoop->getLock()};
+        state->operation = *this;
+        state->operation.setCallbackDispatcher (nullptr);
+
+        const auto result {state->operation.resolveAsync ([weakState = std::weak_ptr<BonjourTaskBase::State> {state},
+                                                           weakValue = std::weak_ptr<std::optional<ResolveResult>> {value}]
+                                                          (const BonjourService& resolvedService,
+                                                           const juce::String& hostName,
+                                                           int port,
+                                                           const juce::Result& resolveResult)
         {
-            if (auto* serviceToDiscover {static_cast<BonjourService*>(context)})
-            {
-                BonjourService discoveredService {regtype, serviceName, replyDomain};
-                discoveredService.pimpl->interfaceIndex = interfaceIndex;
-                serviceToDiscover->pimpl->discoverAsyncCallback (discoveredService,
-                                                                 flags & kDNSServiceFlagsAdd,
-                                                                 flags & kDNSServiceFlagsMoreComing,
-                                                                 bonjourResult (errorCode));
-            }
-        }
+            const auto lockedState {weakState.lock()};
+            const auto lockedValue {weakValue.lock()};
 
-        static void resolveReply (DNSServiceRef sdRef,
-                                  DNSServiceFlags flags,
-                                  uint32_t interfaceIndex,
-                                  DNSServiceErrorType errorCode,
-                                  const char* fullname,
-                                  const char* hosttarget,
-                                  uint16_t port,                                   /* In network byte order */
-                                  uint16_t txtLen,
-                                  const unsigned char* txtRecord,
-                                  void* context)
-        {
-            if (auto* serviceToResolve {static_cast<BonjourService*>(context)})
-            {
-                serviceToResolve->pimpl->dnsService->stop();
-                serviceToResolve->pimpl->interfaceIndex = interfaceIndex;
-                serviceToResolve->pimpl->txtRecord.copyFrom (txtLen, txtRecord);
-                serviceToResolve->pimpl->resolveAsyncCallback (*serviceToResolve,
-                                                               hosttarget,
-                                                               port,
-                                                               bonjourResult (errorCode));
-            }
-        }
+            if (lockedState == nullptr || lockedValue == nullptr)
+                return;
 
-        static void registerReply (DNSServiceRef sdRef,
-                                   DNSServiceFlags flags,
-                                   DNSServiceErrorType errorCode,
-                                   const char* name,
-                                   const char* regtype,
-                                   const char* domain,
-                                   void* context)
-        {
-            if (auto* serviceToRegister {static_cast<BonjourService*>(context)})
+            lockedState->finish ([&]
             {
-                serviceToRegister->name = name;
-                serviceToRegister->type = regtype;
-                serviceToRegister->domain = domain;
-                serviceToRegister->pimpl->registerAsyncCallback (*serviceToRegister,
-                                                                 bonjourResult (errorCode));
-            }
-        }
+                *lockedValue = ResolveResult {resolvedService, hostName, port, resolveResult};
+                (*lockedValue)->service.setCallbackDispatcher (lockedState->dispatcher);
+            });
+        })};
 
-        Pimpl()
-        {
+        if (result.failed())
+            state->fail (result);
 
-        }
+        state->start (options);
+        return {std::move (state), std::move (value)};
+    }
 
-        Pimpl (const Pimpl& other)
-            : interfaceIndex {other.interfaceIndex}
-            , txtRecord {other.txtRecord}
-        {
+    BonjourTask<BonjourService::RegisterResult> BonjourService::registerTask (int portToRegisterServiceOn,
+                                                                             const BonjourTaskOptions& options) const
+    {
+        auto state {std::make_shared<BonjourTaskBase::State>(data->callbackDispatcher)};
+        auto value {state->createValue<RegisterResult>({*this})};
 
-        }
+        const juce::ScopedLock lock {state->eventLoop->getLock()};
+        state->operation = *this;
+        state->operation.setCallbackDispatcher (nullptr);
 
-        void startDnsService (DNSServiceRef ref)
+        const auto result {state->operation.registerAsync ([weakState = std::weak_ptr<BonjourTaskBase::State> {state},
+                                                            weakValue = std::weak_ptr<std::optional<RegisterResult>> {value}]
+                                                           (const BonjourService&, const juce::Result& registerResult)
         {
-            // You can't start the DNS Service if the reference is invalid!
-            jassert (ref != nullptr);
-            dnsService = std::make_unique<BonjourDnsService>(ref);
-        }
+            const auto lockedState {weakState.lock()};
+            const auto lockedValue {weakValue.lock()};
 
-        void stopDnsService()
-        {
-            if (dnsService != nullptr)
-                dnsService->stop();
-        }
+            if (lockedState == nullptr || lockedValue == nullptr)
+                return;
 
-        uint32_t interfaceIndex {0};
-        BonjourTxtRecord txtRecord {};
+            lockedState->finish ([&]
+            {
+                // On success the registration itself is handed over, moving
+                // it keeps it registered under its new owner
+                auto& registration {lockedState->operation};
+                registration.setCallbackDispatcher (lockedState->dispatcher);
 
-        // These should all be unique per instance even when a copy occurs
-        DiscoverAsyncCallback discoverAsyncCallback {nullptr};
-        ResolveAsyncCallback resolveAsyncCallback {nullptr};
-        RegisterAsyncCallback registerAsyncCallback {nullptr};
-        std::unique_ptr<BonjourDnsService> dnsService {nullptr};
-    };
+                *lockedValue = RegisterResult {registerResult.wasOk() ? std::move (registration) : BonjourService {registration},
+                                               registerResult};
+            });
+        }, portToRegisterServiceOn)};
 
-    BonjourService::BonjourService()
-        : pimpl {std::make_unique<BonjourService::Pimpl>()}
-    {
+        if (result.failed())
+            state->fail (result);
 
+        state->start (options);
+        return {std::move (state), std::move (value)};
     }
 
-    BonjourService::BonjourService (const juce::String& type,
-                                    const juce::String& name,
-                                    const juce::String& domain)
-        : type {type}
-        , name {name}
-        , domain {domain}
-        , pimpl {std::make_unique<BonjourService::Pimpl>()}
+    BonjourService::RecordItemIterator::RecordItemIterator (const BonjourService& serviceToIterate, int startIndex)
+        : service {&serviceToIterate}
+        , index {startIndex}
     {
-        // bonjour services must always start with an underscore ("_")
-        jassert (type.startsWith ("_"));
 
-        // bonjour services must always end with "._udp" or "._tcp"
-        jassert (isUdp() || isTcp());
     }
 
-    BonjourService::BonjourService (const BonjourService& other)
-        : type {other.type}
-        , name {other.name}
-        , domain {other.domain}
-        , pimpl {std::make_unique<BonjourService::Pimpl>(*other.pimpl.get())}
+    BonjourService::RecordItemView BonjourService::RecordItemIterator::operator*() const
     {
-
+        return service->data->txtRecord.getItemViewAtIndex (index);
     }
 
-    BonjourService& BonjourService::operator= (const BonjourService& other)
+    BonjourService::RecordItemIterator& BonjourService::RecordItemIterator::operator++()
     {
-        name = other.name;
-        type = other.type;
-        domain = other.domain;
-        pimpl = std::make_unique<BonjourService::Pimpl>(*other.pimpl.get());
-
+        ++index;
         return *this;
     }
 
-    BonjourService::~BonjourService()
+    bool BonjourService::RecordItemIterator::operator== (const RecordItemIterator& other) const
     {
-        
+        return service == other.service
+            && index == other.index;
     }
 
-    juce::String BonjourService::getName() const
+    bool BonjourService::RecordItemIterator::operator!= (const RecordItemIterator& other) const
     {
-        return name;
+        return service != other.service
+            || index != other.index;
     }
 
-    juce::String BonjourService::getType() const
+    BonjourService::RecordItemIterator BonjourService::RecordItemRange::begin() const
     {
-        return type;
+        return {service, 0};
     }
 
-    juce::String BonjourService::getDomain() const
+    BonjourService::RecordItemIterator BonjourService::RecordItemRange::end() const
     {
-        return domain;
+        return {service, service.getNumRecordItems()};
     }
 
-    juce::var BonjourService::getRecordItemValue (const juce::String& key, const juce::var& defaultReturnValue) const
+    BonjourService::TxtRecordBuilder::TxtRecordBuilder (size_t numBytesToReserve)
     {
-        if ( ! containsRecordItem (key))
-            return defaultReturnValue;
-        
-        return pimpl->txtRecord.getValue (key);
+        bytes.reserve (numBytesToReserve);
     }
 
-    BonjourService::RecordItem BonjourService::getRecordItemAtIndex (int index) const
+    BonjourService::TxtRecordBuilder& BonjourService::TxtRecordBuilder::addKey (std::string_view key)
     {
-        if (index >= getNumRecordItems())
+        if (isValidKey (key) && canAdd (key.size()))
         {
-            // Trying to access a non-existant record item, check
-            // `getNumRecordItems()` before calling this function
-            jassertfalse;
-            return {};
+            BonjourDnsTxtData::appendString (bytes, {key});
+            ++numItems;
         }
 
-        return pimpl->txtRecord.getItemAtIndex (index);
+        return *this;
     }
 
-    void BonjourService::setRecordItemValue (const juce::String& key,
-                                             const juce::var& newValue)
+    BonjourService::TxtRecordBuilder& BonjourService::TxtRecordBuilder::add (std::string_view key, std::string_view value)
     {
-        pimpl->txtRecord.setValue (key, newValue);
-    }
+        const auto itemLength {key.size() + 1 + value.size()};
 
-    void BonjourService::removeRecordItem (const juce::String& key)
-    {
-        pimpl->txtRecord.removeValue (key);
-    }
+        if (isValidKey (key) && canAdd (itemLength))
+        {
+            BonjourDnsTxtData::appendString (bytes, {key, "=", value});
+            ++numItems;
+        }
 
-    bool BonjourService::containsRecordItem (const juce::String& key) const
-    {
-        return pimpl->txtRecord.containsKey (key);
+        return *this;
     }
 
-    int BonjourService::getNumRecordItems() const
+    BonjourService::TxtRecordBuilder& BonjourService::TxtRecordBuilder::add (std::string_view key, const juce::MemoryBlock& value)
     {
-        return pimpl->txtRecord.getCount();
+        return add (key, std::string_view {static_cast<const char*> (value.getData()), value.getSize()});
     }
 
-    bool BonjourService::isUdp() const
+    juce::Result BonjourService::TxtRecordBuilder::getResult() const
     {
-        return type.contains ("._udp");
+        return result;
     }
 
-    bool BonjourService::isTcp() const
+    int BonjourService::TxtRecordBuilder::getNumItems() const
     {
-        return type.contains ("._tcp");
+        return numItems;
     }
 
-    juce::Result BonjourService::discoverAsync (BonjourService::DiscoverAsyncCallback callback, int interfaceIndex)
+    size_t BonjourService::TxtRecordBuilder::getNumBytes() const
     {
-        DNSServiceRef ref {nullptr};
-        pimpl->discoverAsyncCallback = callback;
-
-        const auto result {bonjourResult (DNSServiceBrowse (&ref,
-                                                            0,
-                                                            interfaceIndex,
-                                                            type.toUTF8(),
-                                                            domain.isEmpty() ? nullptr : domain.toUTF8(),
-                                                            &Pimpl::browseReply,
-                                                            this))};
-
-        if (result.ok())
-            pimpl->startDnsService (ref);
-
-        return result;
+        return bytes.size();
     }
 
-    juce::Result BonjourService::resolveAsync (jucey::BonjourService::ResolveAsyncCallback callback)
+    bool BonjourService::TxtRecordBuilder::isValidKey (std::string_view key)
     {
-        DNSServiceRef ref {nullptr};
-        pimpl->resolveAsyncCallback = callback;
-
-        const auto result {bonjourResult (DNSServiceResolve (&ref,
-                                                             0,
-                                                             pimpl->interfaceIndex,
-                                                             name.toUTF8(),
-                                                             type.toUTF8(),
-                                                             domain.toUTF8(),
-                                                             &Pimpl::resolveReply,
-                                                             this))};
+        if (key.empty())
+            return fail ("TXT record keys can't be empty");
 
-        if (result.ok())
-            pimpl->startDnsService (ref);
+        // keys are printable US-ASCII, excluding '=' (RFC 6763 section 6.4)
+        for (const auto character : key)
+            if (character < 0x20 || character > 0x7e || character == '=')
+                return fail ("TXT record key \"" + juce::String (key.data(), key.size()) + "\" contains an invalid character");
 
-        return result;
+        return true;
     }
 
-    juce::Result BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
-                                                int portToRegisterServiceOn)
+    bool BonjourService::TxtRecordBuilder::canAdd (size_t itemLength)
     {
-        // A socket should be bound to a valid port *before* calling register
-        // and the bound port should be passed to this method
-        jassert (portToRegisterServiceOn > 0 && portToRegisterServiceOn < 65536);
+        if (itemLength > std::numeric_limits<uint8_t>::max())
+            return fail ("TXT record items must be a maximum of 255 bytes");
 
-        DNSServiceRef ref {nullptr};
-        pimpl->registerAsyncCallback = callback;
-
-        const auto result {bonjourResult (DNSServiceRegister (&ref,
-                                                              0,
-                                                              0,
-                                                              name.isEmpty() ? nullptr : name.toUTF8(),
-                                                              type.toUTF8(),
-                                                              domain.isEmpty() ? nullptr : domain.toUTF8(),
-                                                              nullptr,
-                                                              portToRegisterServiceOn,
-                                                              pimpl->txtRecord.getLength(),
-                                                              pimpl->txtRecord.getBytes(),
-                                                              &Pimpl::registerReply,
-                                                              this))};
-
-        if (result.ok())
-            pimpl->startDnsService (ref);
+        if (bytes.size() + 1 + itemLength > std::numeric_limits<uint16_t>::max())
+            return fail ("TXT records must be a maximum of 65535 bytes");
 
-        return result;
+        return result.wasOk();
     }
 
-    juce::Result BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
-                                                const juce::DatagramSocket& socketToRegisterServiceOn)
+    bool BonjourService::TxtRecordBuilder::fail (const juce::String& errorMessage)
     {
-        // It doesn't make sense to call this method with a UDP socket, if the
-        // service to be registered isn't a UDP service!
-        jassert (isUdp());
-        return registerAsync (callback, socketToRegisterServiceOn.getBoundPort());
-    }
+        // only the first problem is kept
+        if (result.wasOk())
+            result = juce::Result::fail (errorMessage);
 
-    juce::Result BonjourService::registerAsync (jucey::BonjourService::RegisterAsyncCallback callback,
-                                                const juce::StreamingSocket& socketToRegisterServiceOn)
-    {
-        // It doesn't make sense to call this method with a TCP socket, if the
-        // service to be registered isn't a TCP service!
-        jassert (isTcp());
-        return registerAsync (callback, socketToRegisterServiceOn.getBoundPort());
+        return false;
     }
 
-    BonjourService::RecordItem::RecordItem (const juce::String& key,
-                                            const juce::String& value)
-        : key {key}
-        , value {value}
+    BonjourService::RecordItem::RecordItem (const juce::String& itemKey,
+                                            const juce::String& itemValue)
+        : key {itemKey}
+        , value {itemValue}
     {
 
     }
@@ -523,4 +2240,4 @@ namespace jucey
     }
 }
 
-#include "jucey_BonjourServiceTests.cpp"
+#include "jucey_BonjourServiceTests.cpp"
@@ -1,7 +1,7 @@
-
-#pragma once
-
-namespace jucey
+
+#pragma once
+
+namespace jucey
 {
     class BonjourService
     {
@@ -10,12 +10,22 @@ namespace jucey
         BonjourService (const juce::String& type,
                         const juce::String& name = {},
                         const juce::String& domain = {});
+        // Copies share everything that describes the service until one of them
+        // is modified, so copying a service never allocates. Operations that
+        // are running aren't copied but they do move with the service.
         BonjourService (const BonjourService& other);
+        BonjourService (BonjourService&& other) noexcept;
         ~BonjourService();
 
         juce::String getName() const;
         juce::String getType() const;
         juce::String getDomain() const;
+        int getInterfaceIndex() const;
+
+        // Every interface a service was seen on when it was discovered with
+        // interface merging enabled, otherwise just the interface it was
+        // discovered on, if any
+        std::vector<int> getInterfaceIndices() const;
 
         struct RecordItem
         {
@@ -33,38 +43,270 @@ namespace jucey
             JUCE_LEAK_DETECTOR (RecordItem)
         };
 
+        // A view onto a record item that doesn't copy the key or value, it's
+        // only valid until the service's record items are next modified
+        struct RecordItemView
+        {
+            std::string_view key {};
+            std::string_view value {};
+            bool hasValue {false};
+        };
+
+        class RecordItemIterator
+        {
+        public:
+            RecordItemView operator*() const;
+            RecordItemIterator& operator++();
+            bool operator== (const RecordItemIterator& other) const;
+            bool operator!= (const RecordItemIterator& other) const;
+
+        private:
+            friend class BonjourService;
+            friend struct RecordItemRange;
+            RecordItemIterator (const BonjourService& service, int index);
+
+            const BonjourService* service {nullptr};
+            int index {0};
+        };
+
+        struct RecordItemRange
+        {
+            RecordItemIterator begin() const;
+            RecordItemIterator end() const;
+
+            const BonjourService& service;
+        };
+
+        // Builds a whole TXT record in one go, writing each item straight into
+        // the wire format. Values can be binary, keys don't need a value, and
+        // each item is checked as it's added with the first problem kept in
+        // the result. Items that fail the checks aren't added.
+        class TxtRecordBuilder
+        {
+        public:
+            explicit TxtRecordBuilder (size_t numBytesToReserve = 0);
+
+            TxtRecordBuilder& addKey (std::string_view key);
+            TxtRecordBuilder& add (std::string_view key, std::string_view value);
+            TxtRecordBuilder& add (std::string_view key, const juce::MemoryBlock& value);
+
+            juce::Result getResult() const;
+            int getNumItems() const;
+            size_t getNumBytes() const;
+
+        private:
+            friend class BonjourService;
+
+            bool isValidKey (std::string_view key);
+            bool canAdd (size_t itemLength);
+            bool fail (const juce::String& errorMessage);
+
+            std::vector<uint8_t> bytes;
+            int numItems {0};
+            juce::Result result {juce::Result::ok()};
+        };
+
         juce::var getRecordItemValue (const juce::String& key, const juce::var& defaultReturnValue = {}) const;
         RecordItem getRecordItemAtIndex (int index) const;
+        RecordItemView getRecordItemViewAtIndex (int index) const;
+        RecordItemRange getRecordItems() const;
         
-        void setRecordItemValue (const juce::String& key, const juce::var& newValue);
+        // Fails, leaving the record as it was, if the key is invalid or the
+        // "key=value" item would be over 255 bytes as UTF-8, or the whole
+        // record over 65535 bytes
+        juce::Result setRecordItemValue (const juce::String& key, const juce::var& newValue);
         void removeRecordItem (const juce::String& key);
 
+        // Replaces all the record items at once, the service is left as it
+        // was if the builder failed or has any duplicate keys
+        juce::Result setRecordItems (TxtRecordBuilder&& builder);
+
+        // Once a service has been registered any changes to its record items
+        // are pushed to the live registration without registering it again.
+        // Changes are sent once none have been made for 100 ms, or at most a
+        // second after the first one, call this to send any changes straight
+        // away.
+        juce::Result updateRecords();
+
+        // The result of the last update sent since the service was registered,
+        // changes sent after a delay have no other way of reporting that
+        // they failed
+        juce::Result getLastRecordUpdateResult() const;
+
         bool containsRecordItem (const juce::String& key) const;
         int getNumRecordItems() const;
 
         bool isUdp() const;
         bool isTcp() const;
 
+        // Operations started after this share the session's connection to the
+        // daemon, as do any services they discover. Pass nullptr to go back to
+        // sharing the process-wide session only if sessions are shared by
+        // default.
+        void setSession (const BonjourSession* session);
+
+        // Discovery started after this reports each instance once, however
+        // many interfaces it's on, rather than once per interface. It's
+        // added when it first appears on any interface and removed once it's
+        // gone from all of them. Services discovered this way have an
+        // interface index of zero, so they resolve on whichever interface
+        // answers first.
+        void setInterfaceMergingEnabled (bool shouldMergeInterfaces);
+        bool isInterfaceMergingEnabled() const;
+
+        using CallbackDispatcher = std::function<void(std::function<void()> callback)>;
+
+        // By default callbacks are called directly on the bonjour event loop
+        // thread, a dispatcher can be used to hand them off to another thread
+        // instead so slow callbacks don't hold up any other replies.
+        //
+        // Callbacks called directly run with the event loop's lock held, so
+        // while one is running, any other thread that starts, cancels or
+        // destroys an operation waits for it to return. A callback called
+        // directly must never wait on another thread that might do any of
+        // those things, or the two will deadlock.
+        void setCallbackDispatcher (CallbackDispatcher dispatcher);
+        CallbackDispatcher getCallbackDispatcher() const;
+
+        // Each callback is a separate job, so callbacks from the same
+        // operation can run at the same time on different threads and in any
+        // order. Use the message thread dispatcher or a BonjourCallbackQueue
+        // if the order matters.
+        static CallbackDispatcher createThreadPoolDispatcher (juce::ThreadPool& threadPool);
+       #if JUCE_MODULE_AVAILABLE_juce_events
+        static CallbackDispatcher createMessageThreadDispatcher();
+       #endif
+
         using DiscoverAsyncCallback = std::function<void(const BonjourService& service, bool isAvailable, bool isMoreComing, const juce::Result& result)>;
         using ResolveAsyncCallback = std::function<void(const BonjourService& service, const juce::String& hostName, int port, const juce::Result& result)>;
         using RegisterAsyncCallback = std::function<void(const BonjourService& service, const juce::Result& result)>;
+        using ResolveAddressAsyncCallback = std::function<void(const BonjourService& service, const juce::String& hostName, int port, const juce::IPAddress& address, bool isAvailable, bool isMoreComing, const juce::Result& result)>;
 
-        juce::Result discoverAsync (DiscoverAsyncCallback callback, int interfaceIndex = 0);
-        juce::Result resolveAsync (ResolveAsyncCallback callback);
-        juce::Result registerAsync (RegisterAsyncCallback callback, int portToRegisterServiceOn);
-        juce::Result registerAsync (RegisterAsyncCallback callback, const juce::DatagramSocket& socketToRegisterServiceOn);
-        juce::Result registerAsync (RegisterAsyncCallback callback, const juce::StreamingSocket& socketToRegisterServiceOn);
+        // Collects every service added or removed in a burst of replies
+        // (until kDNSServiceFlagsMoreComing clears) into a single callback
+        struct DiscoveryEvent;
+        using DiscoverBatchAsyncCallback = std::function<void(const std::vector<DiscoveryEvent>& events, const juce::Result& result)>;
+
+        // Each operation returns a handle that can cancel it without
+        // destroying the service, along with whether it started
+        BonjourOperation discoverAsync (DiscoverAsyncCallback callback, int interfaceIndex = 0);
+        BonjourOperation discoverBatchAsync (DiscoverBatchAsyncCallback callback, int interfaceIndex = 0);
+        BonjourOperation resolveAsync (ResolveAsyncCallback callback);
+
+        // Resolves the service and then carries straight on to look up the
+        // IPv4 and IPv6 addresses of its host, calling back with each address
+        // as it arrives or goes away until the service is resolved again or
+        // destroyed. The service passed to the callback has the index of the
+        // interface the address was found on.
+        BonjourOperation resolveAddressAsync (ResolveAddressAsyncCallback callback);
+
+        // The record types that are most often queried for, any other type
+        // can be queried for by its number
+        struct RecordType
+        {
+            static constexpr int a {1};
+            static constexpr int ptr {12};
+            static constexpr int txt {16};
+            static constexpr int aaaa {28};
+            static constexpr int srv {33};
+            static constexpr int any {255};
+        };
+
+        static constexpr int recordClassInternet {1};
+
+        // Watches for records of any type and class, passing on every record
+        // that's added or removed, along with its TTL, in bursts like
+        // discoverBatchAsync(). Unlike a resolve the query keeps running, so
+        // changes to a record are seen as they happen, until the service is
+        // destroyed or starts another query, browse or registration.
+        struct RecordEvent;
+        using QueryRecordAsyncCallback = std::function<void(const std::vector<RecordEvent>& events, const juce::Result& result)>;
+
+        // Queries for this instance's own records, such as its TXT record
+        BonjourOperation queryRecordAsync (QueryRecordAsyncCallback callback, int recordType, int interfaceIndex = 0);
+
+        BonjourOperation queryRecordAsync (QueryRecordAsyncCallback callback,
+                                           const juce::String& fullName,
+                                           int recordType,
+                                           int recordClass = recordClassInternet,
+                                           int interfaceIndex = 0);
+
+        // The escaped name of this instance as it appears in its records,
+        // such as "My Service._http._tcp.local."
+        juce::String getFullName() const;
+
+        // Concurrent resolves of the same instance always share one query,
+        // a non-zero time to live also keeps the results so later resolves
+        // can be answered without asking the daemon again
+        static void setResolveCacheTimeToLive (juce::RelativeTime timeToLive);
+        static juce::RelativeTime getResolveCacheTimeToLive();
+        static void clearResolveCache();
+
+        BonjourOperation registerAsync (RegisterAsyncCallback callback, int portToRegisterServiceOn);
+        BonjourOperation registerAsync (RegisterAsyncCallback callback, const juce::DatagramSocket& socketToRegisterServiceOn);
+        BonjourOperation registerAsync (RegisterAsyncCallback callback, const juce::StreamingSocket& socketToRegisterServiceOn);
+
+        // The same operations as tasks, which can be waited for with a
+        // continuation, a std::future or co_await. The operation runs on a
+        // copy of this service so this one is left as it is. A failed task
+        // still has the service in its result, along with why it failed.
+        struct ResolveResult;
+        struct RegisterResult;
+
+        BonjourTask<ResolveResult> resolveTask (const BonjourTaskOptions& options = {}) const;
+        BonjourTask<RegisterResult> registerTask (int portToRegisterServiceOn, const BonjourTaskOptions& options = {}) const;
 
         BonjourService& operator= (const BonjourService& other);
+        BonjourService& operator= (BonjourService&& other) noexcept;
 
     private:
-        juce::String type {};
-        juce::String name {};
-        juce::String domain {};
-        
+        friend class BonjourBulkRegistration;
+
+        class Data;
+        juce::ReferenceCountedObjectPtr<Data> data;
+
         class Pimpl;
         std::unique_ptr<Pimpl> pimpl;
 
+        static const juce::ReferenceCountedObjectPtr<Data>& getEmptyData();
+        Data& getWritableData();
+        Pimpl& getPimpl();
+
         JUCE_LEAK_DETECTOR (BonjourService)
     };
+
+    struct BonjourService::DiscoveryEvent
+    {
+        BonjourService service;
+        bool isAvailable {false};
+    };
+
+    // The record data is exactly as it appears on the wire, other than names
+    // within it never being compressed
+    struct BonjourService::RecordEvent
+    {
+        juce::String fullName {};
+        int recordType {0};
+        int recordClass {0};
+        juce::MemoryBlock data {};
+        juce::RelativeTime timeToLive {};
+        int interfaceIndex {0};
+        bool isAvailable {false};
+    };
+
+    struct BonjourService::ResolveResult
+    {
+        BonjourService service;
+        juce::String hostName {};
+        int port {0};
+        juce::Result result {juce::Result::ok()};
+    };
+
+    // The service is the registration itself, it stays registered for as
+    // long as it (or whatever it's moved to) exists
+    struct BonjourService::RegisterResult
+    {
+        BonjourService service;
+        juce::Result result {juce::Result::ok()};
+    };
 }
@@ -0,0 +1,220 @@
+
+namespace jucey
+{
+    const std::vector<BonjourService>& BonjourServiceDirectory::Snapshot::getServices() const
+    {
+        return services;
+    }
+
+    const BonjourService* BonjourServiceDirectory::Snapshot::findService (const juce::String& name,
+                                                                          const juce::String& domain,
+                                                                          int interfaceIndex) const
+    {
+        const auto iter {indices.find ({name, domain, interfaceIndex})};
+        return iter != indices.end() ? &services[iter->second] : nullptr;
+    }
+
+    bool BonjourServiceDirectory::Snapshot::contains (const BonjourService& service) const
+    {
+        return indices.find (makeKey (service)) != indices.end();
+    }
+
+    int BonjourServiceDirectory::Snapshot::size() const
+    {
+        return (int) services.size();
+    }
+
+    // DNS names match without regard to case, so "Foo" and "foo" are the same
+    // instance
+    bool BonjourServiceDirectory::Snapshot::Key::operator== (const Key& other) const
+    {
+        return interfaceIndex == other.interfaceIndex
+            && BonjourDnsName::labelsMatch (toStringView (name), toStringView (other.name))
+            && BonjourDnsName::labelsMatch (toStringView (domain), toStringView (other.domain));
+    }
+
+    size_t BonjourServiceDirectory::Snapshot::KeyHash::operator() (const Key& key) const
+    {
+        return BonjourDnsName::hashIgnoringCase (toStringView (key.name))
+             ^ (BonjourDnsName::hashIgnoringCase (toStringView (key.domain)) << 1)
+             ^ ((size_t) key.interfaceIndex << 2);
+    }
+
+    std::string_view BonjourServiceDirectory::Snapshot::toStringView (const juce::String& string)
+    {
+        return {string.toRawUTF8(), string.getNumBytesAsUTF8()};
+    }
+
+    BonjourServiceDirectory::Snapshot::Key BonjourServiceDirectory::Snapshot::makeKey (const BonjourService& service)
+    {
+        return {service.getName(), service.getDomain(), service.getInterfaceIndex()};
+    }
+
+    bool BonjourServiceDirectory::Snapshot::add (const BonjourService& service)
+    {
+        if ( ! indices.emplace (makeKey (service), services.size()).second)
+            return false;
+
+        services.push_back (service);
+        return true;
+    }
+
+    bool BonjourServiceDirectory::Snapshot::remove (const BonjourService& service)
+    {
+        const auto iter {indices.find (makeKey (service))};
+
+        if (iter == indices.end())
+            return false;
+
+        const auto index {iter->second};
+        indices.erase (iter);
+
+        if (index != services.size() - 1)
+        {
+            services[index] = services.back();
+            indices[makeKey (services[index])] = index;
+        }
+
+        services.pop_back();
+        return true;
+    }
+
+    BonjourServiceDirectory::BonjourServiceDirectory (const juce::String& type,
+                                                      const juce::String& domain,
+                                                      int interfaceIndexToBrowse)
+        : browser {type, {}, domain}
+        , interfaceIndex {interfaceIndexToBrowse}
+        , snapshot {std::make_shared<const Snapshot>()}
+        , notifier {std::make_shared<Notifier>()}
+    {
+        notifier->directory = this;
+    }
+
+    BonjourServiceDirectory::~BonjourServiceDirectory()
+    {
+        stop();
+
+        // Any notification still waiting for the dispatcher is dropped
+        const juce::ScopedLock lock {notifier->lock};
+        notifier->directory = nullptr;
+    }
+
+    void BonjourServiceDirectory::setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher)
+    {
+        callbackDispatcher = std::move (dispatcher);
+    }
+
+    void BonjourServiceDirectory::setInterfaceMergingEnabled (bool shouldMergeInterfaces)
+    {
+        isMergingInterfaces = shouldMergeInterfaces;
+    }
+
+    juce::Result BonjourServiceDirectory::start()
+    {
+        // The snapshot is always updated on the event loop thread, so bursts
+        // are applied one at a time and in the order they arrived, and only
+        // listeners are called via the dispatcher
+        browser.setInterfaceMergingEnabled (isMergingInterfaces);
+        return browser.discoverBatchAsync ([this](const std::vector<BonjourService::DiscoveryEvent>& events,
+                                                  const juce::Result& result)
+                                           {
+                                               handleDiscoveryEvents (events, result);
+                                           },
+                                           interfaceIndex);
+    }
+
+    void BonjourServiceDirectory::stop()
+    {
+        // Replacing the browser waits for any update that's running on the
+        // event loop thread, and stops any more from starting
+        browser = BonjourService {browser.getType(), {}, browser.getDomain()};
+        setSnapshot (std::make_shared<const Snapshot>());
+
+        // Waits for any listener that's being notified, and drops any
+        // notification that's still waiting for the dispatcher
+        const juce::ScopedLock lock {notifier->lock};
+        ++notifier->generation;
+    }
+
+    BonjourServiceDirectory::SnapshotPtr BonjourServiceDirectory::getSnapshot() const
+    {
+        const juce::SpinLock::ScopedLockType lock {snapshotLock};
+        return snapshot;
+    }
+
+    void BonjourServiceDirectory::setSnapshot (SnapshotPtr newSnapshot)
+    {
+        {
+            const juce::SpinLock::ScopedLockType lock {snapshotLock};
+            std::swap (snapshot, newSnapshot);
+        }
+
+        // the old snapshot, if this was the last reference, is destroyed
+        // here rather than while the lock is held
+    }
+
+    void BonjourServiceDirectory::addListener (Listener* listener)
+    {
+        listeners.add (listener);
+    }
+
+    void BonjourServiceDirectory::removeListener (Listener* listener)
+    {
+        listeners.remove (listener);
+    }
+
+    void BonjourServiceDirectory::handleDiscoveryEvents (const std::vector<BonjourService::DiscoveryEvent>& events,
+                                                         const juce::Result& result)
+    {
+        if (result.failed() || events.empty())
+            return;
+
+        // Only ever called on the event loop thread, so nothing else can be
+        // updating the snapshot
+        auto newSnapshot {std::make_shared<Snapshot> (*getSnapshot())};
+        Diff diff;
+
+        for (const auto& event : events)
+        {
+            if (event.isAvailable)
+            {
+                // The browser has no dispatcher, so services are given the
+                // directory's as they're added, as if they'd inherited it
+                auto service {event.service};
+
+                if (callbackDispatcher != nullptr)
+                    service.setCallbackDispatcher (callbackDispatcher);
+
+                if (newSnapshot->add (service))
+                    diff.added.push_back (std::move (service));
+            }
+            else if (newSnapshot->remove (event.service))
+            {
+                diff.removed.push_back (event.service);
+            }
+        }
+
+        if (diff.added.empty() && diff.removed.empty())
+            return;
+
+        setSnapshot (std::move (newSnapshot));
+
+        auto notify = [sharedNotifier = notifier, generation = notifier->generation.load(), diff = std::move (diff)]
+        {
+            const juce::ScopedLock lock {sharedNotifier->lock};
+
+            if (sharedNotifier->directory == nullptr || sharedNotifier->generation != generation)
+                return;
+
+            auto& directory {*sharedNotifier->directory};
+            directory.listeners.call ([&directory, &diff](Listener& listener) { listener.serviceDirectoryChanged (directory, diff); });
+        };
+
+        if (callbackDispatcher == nullptr)
+            notify();
+        else
+            callbackDispatcher (std::move (notify));
+    }
+}
+
+#include "jucey_BonjourServiceDirectoryTests.cpp"
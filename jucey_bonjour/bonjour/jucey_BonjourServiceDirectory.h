@@ -0,0 +1,121 @@
+#pragma once
+
+namespace jucey
+{
+    // Keeps an up to date view of every instance of a service type that is
+    // currently visible on the network. Each burst of replies is applied to a
+    // full copy of the current snapshot on the event loop thread, which is
+    // then published under a short lock. Readers can take an immutable
+    // snapshot at any time, which only holds that lock long enough to copy a
+    // pointer, and listeners are only told about the services that were
+    // added or removed in each burst.
+    class BonjourServiceDirectory
+    {
+    public:
+        class Snapshot
+        {
+        public:
+            const std::vector<BonjourService>& getServices() const;
+            const BonjourService* findService (const juce::String& name,
+                                               const juce::String& domain,
+                                               int interfaceIndex) const;
+
+            bool contains (const BonjourService& service) const;
+            int size() const;
+
+        private:
+            friend class BonjourServiceDirectory;
+
+            struct Key
+            {
+                juce::String name {};
+                juce::String domain {};
+                int interfaceIndex {0};
+
+                bool operator== (const Key& other) const;
+            };
+
+            struct KeyHash
+            {
+                size_t operator() (const Key& key) const;
+            };
+
+            static Key makeKey (const BonjourService& service);
+            static std::string_view toStringView (const juce::String& string);
+
+            bool add (const BonjourService& service);
+            bool remove (const BonjourService& service);
+
+            std::vector<BonjourService> services;
+            std::unordered_map<Key, size_t, KeyHash> indices;
+        };
+
+        using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
+        struct Diff
+        {
+            std::vector<BonjourService> added;
+            std::vector<BonjourService> removed;
+        };
+
+        class Listener
+        {
+        public:
+            virtual ~Listener() = default;
+
+            // Called on the bonjour event loop thread, or via the dispatcher
+            // set on the directory, after the snapshot has been updated. Diffs
+            // are only passed on in order if the dispatcher keeps callbacks in
+            // order. Nothing is called once the directory has been stopped
+            // or destroyed.
+            virtual void serviceDirectoryChanged (BonjourServiceDirectory& directory,
+                                                  const Diff& diff) = 0;
+        };
+
+        explicit BonjourServiceDirectory (const juce::String& type,
+                                          const juce::String& domain = {},
+                                          int interfaceIndex = 0);
+        ~BonjourServiceDirectory();
+
+        // Must be set before calling start(), only listeners are called via
+        // the dispatcher
+        void setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher);
+
+        // Must be set before calling start(), lists each instance once however
+        // many interfaces it's on, see BonjourService::setInterfaceMergingEnabled()
+        void setInterfaceMergingEnabled (bool shouldMergeInterfaces);
+
+        juce::Result start();
+        void stop();
+
+        SnapshotPtr getSnapshot() const;
+
+        void addListener (Listener* listener);
+        void removeListener (Listener* listener);
+
+    private:
+        void handleDiscoveryEvents (const std::vector<BonjourService::DiscoveryEvent>& events,
+                                    const juce::Result& result);
+        void setSnapshot (SnapshotPtr newSnapshot);
+
+        BonjourService browser;
+        BonjourService::CallbackDispatcher callbackDispatcher {nullptr};
+        bool isMergingInterfaces {false};
+        const int interfaceIndex {0};
+        // Shared with notifications waiting for the dispatcher, so they can
+        // tell if the directory has since been stopped or destroyed
+        struct Notifier
+        {
+            juce::CriticalSection lock;
+            BonjourServiceDirectory* directory {nullptr};
+            std::atomic<uint64_t> generation {0};
+        };
+
+        juce::SpinLock snapshotLock;
+        SnapshotPtr snapshot;
+        std::shared_ptr<Notifier> notifier;
+        juce::ListenerList<Listener, juce::Array<Listener*, juce::CriticalSection>> listeners;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourServiceDirectory)
+    };
+}
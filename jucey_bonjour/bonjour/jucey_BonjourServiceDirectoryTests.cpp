@@ -0,0 +1,248 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourServiceDirectoryTests : private juce::UnitTest
+{
+public:
+    BonjourServiceDirectoryTests()
+        : juce::UnitTest ("BonjourServiceDirectory", "Networking")
+    {
+
+    }
+
+    ~BonjourServiceDirectoryTests()
+    {
+
+    }
+
+private:
+    struct DiffListener : public jucey::BonjourServiceDirectory::Listener
+    {
+        void serviceDirectoryChanged (jucey::BonjourServiceDirectory&,
+                                      const jucey::BonjourServiceDirectory::Diff& diff) override
+        {
+            const juce::ScopedLock lock {diffsLock};
+            diffs.push_back (diff);
+        }
+
+        int getNumDiffs() const
+        {
+            const juce::ScopedLock lock {diffsLock};
+            return (int) diffs.size();
+        }
+
+        juce::CriticalSection diffsLock;
+        std::vector<jucey::BonjourServiceDirectory::Diff> diffs;
+    };
+
+    // Replies from the loopback responder are delivered on the event loop
+    // thread, so anything they change is waited for
+    template <typename Condition>
+    bool waitFor (Condition&& condition)
+    {
+        for (auto attempt {0}; ! condition() && attempt < 200; ++attempt)
+            juce::Thread::sleep (5);
+
+        return condition();
+    }
+
+    void registerService (jucey::BonjourService& serviceToRegister, int portToRegister)
+    {
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, portToRegister));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+    }
+
+    void runEmptyDirectoryTests()
+    {
+        beginTest ("Empty Directory");
+
+        jucey::BonjourServiceDirectory directory {"_test._udp"};
+        const auto snapshot {directory.getSnapshot()};
+
+        expect (snapshot != nullptr);
+        expect (snapshot->size() == 0);
+        expect (snapshot->getServices().empty());
+        expect (snapshot->findService ("JUCEY Test Service", "local.", 0) == nullptr);
+    }
+
+    void runAddAndRemoveTests()
+    {
+        beginTest ("Add and Remove");
+
+        jucey::BonjourLoopbackResponder responder;
+        DiffListener listener;
+        jucey::BonjourServiceDirectory directory {"_test._udp"};
+        directory.addListener (&listener);
+        expect (directory.start());
+
+        auto firstService {std::make_unique<jucey::BonjourService> ("_test._udp", "JUCEY Directory First", "local")};
+        jucey::BonjourService secondService {"_test._udp", "JUCEY Directory Second", "local"};
+        registerService (*firstService, 4000);
+        registerService (secondService, 4001);
+
+        expect (waitFor ([&] { return directory.getSnapshot()->size() == 2; }));
+        const auto snapshot {directory.getSnapshot()};
+
+        // names match without regard to case, as they do in DNS
+        expect (snapshot->findService ("JUCEY Directory First", "local.", 1) != nullptr);
+        expect (snapshot->findService ("jucey directory first", "LOCAL.", 1) != nullptr);
+
+        {
+            const juce::ScopedLock lock {listener.diffsLock};
+
+            for (const auto& diff : listener.diffs)
+            {
+                expect (diff.removed.empty());
+
+                for (const auto& service : diff.added)
+                    expect (snapshot->contains (service));
+            }
+        }
+
+        const auto numDiffs {listener.getNumDiffs()};
+        firstService = nullptr;
+
+        expect (waitFor ([&] { return directory.getSnapshot()->size() == 1; }));
+        expect (directory.getSnapshot()->findService ("JUCEY Directory First", "local.", 1) == nullptr);
+        expect (waitFor ([&] { return listener.getNumDiffs() == numDiffs + 1; }));
+
+        {
+            const juce::ScopedLock lock {listener.diffsLock};
+            expect (listener.diffs.back().added.empty());
+            expect (listener.diffs.back().removed.size() == 1);
+        }
+
+        directory.removeListener (&listener);
+        directory.stop();
+        expect (directory.getSnapshot()->size() == 0);
+
+        // earlier snapshots are immutable so they should be unaffected
+        expect (snapshot->size() == 2);
+    }
+
+    void runThreadPoolDispatcherTests()
+    {
+        beginTest ("Thread Pool Dispatcher");
+
+        jucey::BonjourLoopbackResponder responder;
+        juce::ThreadPool threadPool {4};
+        DiffListener listener;
+
+        {
+            jucey::BonjourServiceDirectory directory {"_test._udp"};
+            directory.setCallbackDispatcher (jucey::BonjourService::createThreadPoolDispatcher (threadPool));
+            directory.addListener (&listener);
+            expect (directory.start());
+
+            // Services come and go in quick succession, however the listeners
+            // are called the snapshot is always updated in order
+            for (auto round {0}; round < 20; ++round)
+            {
+                jucey::BonjourService service {"_test._udp", "JUCEY Directory Short Lived", "local"};
+                registerService (service, 4000);
+            }
+
+            jucey::BonjourService service {"_test._udp", "JUCEY Directory Long Lived", "local"};
+            registerService (service, 4001);
+
+            expect (waitFor ([&] { return directory.getSnapshot()->findService ("JUCEY Directory Long Lived", "local.", 1) != nullptr; }));
+            expect (directory.getSnapshot()->size() == 1);
+
+            // services are given the directory's dispatcher
+            expect (directory.getSnapshot()->getServices().front().getCallbackDispatcher() != nullptr);
+
+            directory.removeListener (&listener);
+        }
+
+        threadPool.removeAllJobs (true, 1000);
+    }
+
+    void runStopTests()
+    {
+        beginTest ("Stop");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        // notifications are held until the test runs them itself
+        juce::CriticalSection queuedCallbacksLock;
+        std::vector<std::function<void()>> queuedCallbacks;
+
+        const auto dispatcher = [&](std::function<void()> callback)
+        {
+            const juce::ScopedLock lock {queuedCallbacksLock};
+            queuedCallbacks.push_back (std::move (callback));
+        };
+
+        const auto getNumQueuedCallbacks = [&]
+        {
+            const juce::ScopedLock lock {queuedCallbacksLock};
+            return queuedCallbacks.size();
+        };
+
+        const auto callQueuedCallbacks = [&]
+        {
+            const juce::ScopedLock lock {queuedCallbacksLock};
+
+            for (auto& callback : queuedCallbacks)
+                callback();
+
+            queuedCallbacks.clear();
+        };
+
+        jucey::BonjourService service {"_test._udp", "JUCEY Directory Stop", "local"};
+        registerService (service, 4000);
+
+        DiffListener listener;
+
+        {
+            jucey::BonjourServiceDirectory directory {"_test._udp"};
+            directory.setCallbackDispatcher (dispatcher);
+            directory.addListener (&listener);
+            expect (directory.start());
+            expect (waitFor ([&] { return getNumQueuedCallbacks() == 1; }));
+
+            // nothing from before the directory was stopped is passed on
+            directory.stop();
+            expect (directory.getSnapshot()->size() == 0);
+            callQueuedCallbacks();
+            expect (listener.getNumDiffs() == 0);
+
+            // once started again listeners are told as usual
+            expect (directory.start());
+            expect (waitFor ([&] { return getNumQueuedCallbacks() == 1; }));
+            callQueuedCallbacks();
+            expect (listener.getNumDiffs() == 1);
+
+            jucey::BonjourService otherService {"_test._udp", "JUCEY Directory Stop Other", "local"};
+            registerService (otherService, 4001);
+            expect (waitFor ([&] { return getNumQueuedCallbacks() == 1; }));
+        }
+
+        // or after it has been destroyed
+        callQueuedCallbacks();
+        expect (listener.getNumDiffs() == 1);
+    }
+
+    void runTest() override
+    {
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runEmptyDirectoryTests();
+        runAddAndRemoveTests();
+        runThreadPoolDispatcherTests();
+        runStopTests();
+    }
+};
+
+static BonjourServiceDirectoryTests bonjourServiceDirectoryTests;
+
+#endif // JUCEY_UNIT_TESTS
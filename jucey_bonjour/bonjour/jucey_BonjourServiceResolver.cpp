@@ -0,0 +1,357 @@
+
+namespace jucey
+{
+    // All the state is guarded by the event loop lock, the browse and resolve
+    // callbacks are always called on the event loop thread and any dispatcher
+    // is only used for the callback passed to the resolver
+    class BonjourServiceResolver::Pimpl
+    {
+    public:
+        Pimpl (BonjourService::ResolveAsyncCallback callbackToCall,
+               int initialMaxNumConcurrentResolves)
+            : callback {std::move (callbackToCall)}
+            , maxNumConcurrentResolves {initialMaxNumConcurrentResolves}
+        {
+            // At least one resolve has to be allowed at a time!
+            jassert (maxNumConcurrentResolves > 0);
+        }
+
+        ~Pimpl()
+        {
+            stop();
+        }
+
+        void setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            callbackDispatcher = std::move (dispatcher);
+        }
+
+        void setMaxNumConcurrentResolves (int newMaxNumConcurrentResolves)
+        {
+            // At least one resolve has to be allowed at a time!
+            jassert (newMaxNumConcurrentResolves > 0);
+
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            maxNumConcurrentResolves = juce::jmax (1, newMaxNumConcurrentResolves);
+            startPendingResolves();
+        }
+
+        void setResolveTimeout (juce::RelativeTime newResolveTimeout)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            resolveTimeoutMs = juce::jlimit ((juce::int64) 0,
+                                             (juce::int64) std::numeric_limits<int>::max(),
+                                             newResolveTimeout.inMilliseconds());
+        }
+
+        void resolve (const BonjourService& service)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            const auto key {makeKey (service)};
+
+            if (resolving.find (key) != resolving.end())
+                return;
+
+            // A service that's queued again moves to the front of the queue
+            removePending (key);
+
+            // Resolves call back on the event loop thread, only the callback
+            // passed to the resolver is dispatched
+            BonjourService serviceToResolve {service};
+            serviceToResolve.setCallbackDispatcher (nullptr);
+
+            pending.emplace (++lastPriority, PendingService {key, std::move (serviceToResolve)});
+            pendingPriorities[key] = lastPriority;
+
+            startPendingResolves();
+        }
+
+        void cancel (const BonjourService& service)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            const auto key {makeKey (service)};
+
+            removePending (key);
+            const auto iter {resolving.find (key)};
+
+            if (iter != resolving.end())
+            {
+                removeResolving (iter);
+                startPendingResolves();
+            }
+        }
+
+        juce::Result discoverAndResolve (const juce::String& type,
+                                         const juce::String& domain,
+                                         int interfaceIndex)
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            browser = BonjourService {type, {}, domain};
+
+            return browser.discoverBatchAsync ([this](const std::vector<BonjourService::DiscoveryEvent>& events,
+                                                      const juce::Result& result)
+                                               {
+                                                   handleDiscoveryEvents (events, result);
+                                               },
+                                               interfaceIndex);
+        }
+
+        void stop()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            browser = BonjourService{};
+            pending.clear();
+            pendingPriorities.clear();
+
+            while ( ! resolving.empty())
+                removeResolving (resolving.begin());
+        }
+
+        int getNumPending() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            return (int) pending.size();
+        }
+
+        int getNumResolving() const
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            return (int) resolving.size();
+        }
+
+    private:
+        struct PendingService
+        {
+            juce::String key {};
+            BonjourService service {};
+        };
+
+        struct KeyHash
+        {
+            size_t operator() (const juce::String& key) const
+            {
+                return key.hash();
+            }
+        };
+
+        struct Resolve
+        {
+            std::unique_ptr<BonjourService> service {};
+            BonjourEventLoop::TimerId timeoutTimerId {0};
+        };
+
+        using Resolving = std::unordered_map<juce::String, Resolve, KeyHash>;
+
+        static juce::String makeKey (const BonjourService& service)
+        {
+            return service.getName() + "." + service.getType() + service.getDomain() + "%" + juce::String (service.getInterfaceIndex());
+        }
+
+        void removePending (const juce::String& key)
+        {
+            const auto iter {pendingPriorities.find (key)};
+
+            if (iter == pendingPriorities.end())
+                return;
+
+            pending.erase (iter->second);
+            pendingPriorities.erase (iter);
+        }
+
+        // Cancels the timeout and hands back the service, the resolve stops
+        // when it's destroyed
+        std::unique_ptr<BonjourService> removeResolving (Resolving::iterator iter)
+        {
+            if (iter->second.timeoutTimerId != 0)
+                eventLoop->cancelTimer (iter->second.timeoutTimerId);
+
+            auto service {std::move (iter->second.service)};
+            resolving.erase (iter);
+            return service;
+        }
+
+        void startPendingResolves()
+        {
+            while ((int) resolving.size() < maxNumConcurrentResolves && ! pending.empty())
+            {
+                // The newest service has the highest priority
+                const auto newest {std::prev (pending.end())};
+                const auto key {newest->second.key};
+                auto& resolver {resolving[key].service};
+                resolver = std::make_unique<BonjourService> (std::move (newest->second.service));
+                pendingPriorities.erase (key);
+                pending.erase (newest);
+
+                const auto result {resolver->resolveAsync ([this, key](const BonjourService& service,
+                                                                       const juce::String& hostName,
+                                                                       int port,
+                                                                       const juce::Result& resolveResult)
+                                                           {
+                                                               handleResolved (key, service, hostName, port, resolveResult);
+                                                           })};
+
+                if (result.failed())
+                {
+                    const BonjourService failedService {*resolver};
+                    resolving.erase (key);
+                    deliver (failedService, {}, 0, result);
+                    continue;
+                }
+
+                if (resolveTimeoutMs > 0)
+                {
+                    resolving[key].timeoutTimerId = eventLoop->callAfterDelay ((int) resolveTimeoutMs, [this, key]
+                    {
+                        handleTimeout (key);
+                    });
+                }
+            }
+        }
+
+        void handleTimeout (const juce::String& key)
+        {
+            const auto iter {resolving.find (key)};
+
+            if (iter == resolving.end())
+                return;
+
+            iter->second.timeoutTimerId = 0;
+            const BonjourService timedOutService {*removeResolving (iter)};
+            deliver (timedOutService, {}, 0, bonjourResult (kDNSServiceErr_Timeout));
+            startPendingResolves();
+        }
+
+        void handleResolved (const juce::String& key,
+                             const BonjourService& service,
+                             const juce::String& hostName,
+                             int port,
+                             const juce::Result& result)
+        {
+            // This is called from inside the resolver's own callback so it
+            // can't be destroyed yet, it's kept until the next one finishes
+            finished.clear();
+
+            const auto iter {resolving.find (key)};
+
+            if (iter != resolving.end())
+                finished.push_back (removeResolving (iter));
+
+            deliver (service, hostName, port, result);
+            startPendingResolves();
+        }
+
+        void handleDiscoveryEvents (const std::vector<BonjourService::DiscoveryEvent>& events,
+                                    const juce::Result& result)
+        {
+            if (result.failed())
+            {
+                deliver (browser, {}, 0, result);
+                return;
+            }
+
+            // Each burst is queued in order so the last service to appear is
+            // the first to be resolved
+            for (const auto& event : events)
+            {
+                if (event.isAvailable)
+                    resolve (event.service);
+                else
+                    cancel (event.service);
+            }
+        }
+
+        void deliver (const BonjourService& service,
+                      const juce::String& hostName,
+                      int port,
+                      const juce::Result& result)
+        {
+            if (callbackDispatcher == nullptr)
+            {
+                callback (service, hostName, port, result);
+                return;
+            }
+
+            callbackDispatcher ([callbackToCall = callback, service, hostName, port, result]
+            {
+                callbackToCall (service, hostName, port, result);
+            });
+        }
+
+        juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const BonjourService::ResolveAsyncCallback callback {nullptr};
+        BonjourService::CallbackDispatcher callbackDispatcher {nullptr};
+        int maxNumConcurrentResolves {8};
+        juce::int64 resolveTimeoutMs {10000};
+
+        BonjourService browser;
+        std::map<uint64_t, PendingService> pending;
+        std::unordered_map<juce::String, uint64_t, KeyHash> pendingPriorities;
+        Resolving resolving;
+        std::vector<std::unique_ptr<BonjourService>> finished;
+        uint64_t lastPriority {0};
+
+        JUCE_DECLARE_NON_COPYABLE (Pimpl)
+    };
+
+    BonjourServiceResolver::BonjourServiceResolver (BonjourService::ResolveAsyncCallback callback,
+                                                    int maxNumConcurrentResolves)
+        : pimpl {std::make_unique<Pimpl> (std::move (callback), maxNumConcurrentResolves)}
+    {
+
+    }
+
+    BonjourServiceResolver::~BonjourServiceResolver()
+    {
+
+    }
+
+    void BonjourServiceResolver::setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher)
+    {
+        pimpl->setCallbackDispatcher (std::move (dispatcher));
+    }
+
+    void BonjourServiceResolver::setMaxNumConcurrentResolves (int newMaxNumConcurrentResolves)
+    {
+        pimpl->setMaxNumConcurrentResolves (newMaxNumConcurrentResolves);
+    }
+
+    void BonjourServiceResolver::setResolveTimeout (juce::RelativeTime newResolveTimeout)
+    {
+        pimpl->setResolveTimeout (newResolveTimeout);
+    }
+
+    void BonjourServiceResolver::resolve (const BonjourService& service)
+    {
+        pimpl->resolve (service);
+    }
+
+    void BonjourServiceResolver::cancel (const BonjourService& service)
+    {
+        pimpl->cancel (service);
+    }
+
+    juce::Result BonjourServiceResolver::discoverAndResolve (const juce::String& type,
+                                                             const juce::String& domain,
+                                                             int interfaceIndex)
+    {
+        return pimpl->discoverAndResolve (type, domain, interfaceIndex);
+    }
+
+    void BonjourServiceResolver::stop()
+    {
+        pimpl->stop();
+    }
+
+    int BonjourServiceResolver::getNumPending() const
+    {
+        return pimpl->getNumPending();
+    }
+
+    int BonjourServiceResolver::getNumResolving() const
+    {
+        return pimpl->getNumResolving();
+    }
+}
+
+#include "jucey_BonjourServiceResolverTests.cpp"
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace jucey
+{
+    // Resolves any number of services without resolving them all at once.
+    // Services waiting to be resolved are queued with the newest first, and
+    // no more than a set number of resolves are ever in flight. Each service
+    // is passed to the callback as soon as it's been resolved. Feed it
+    // services directly or have it browse for a type and resolve every
+    // instance that appears, services that go away before they've been
+    // resolved are dropped from the queue. A resolve that isn't answered
+    // within the timeout is stopped and passed to the callback as failed, so
+    // instances that have gone without saying so can't hold on to a slot.
+    class BonjourServiceResolver
+    {
+    public:
+        explicit BonjourServiceResolver (BonjourService::ResolveAsyncCallback callback,
+                                         int maxNumConcurrentResolves = 8);
+        ~BonjourServiceResolver();
+
+        // Must be set before any services are resolved, any dispatcher must
+        // not call back into the resolver after it has been destroyed
+        void setCallbackDispatcher (BonjourService::CallbackDispatcher dispatcher);
+        void setMaxNumConcurrentResolves (int newMaxNumConcurrentResolves);
+
+        // Ten seconds by default, it applies to resolves started after it's
+        // set and zero never times out
+        void setResolveTimeout (juce::RelativeTime newResolveTimeout);
+
+        void resolve (const BonjourService& service);
+        void cancel (const BonjourService& service);
+
+        juce::Result discoverAndResolve (const juce::String& type,
+                                         const juce::String& domain = {},
+                                         int interfaceIndex = 0);
+        void stop();
+
+        int getNumPending() const;
+        int getNumResolving() const;
+
+    private:
+        class Pimpl;
+        std::unique_ptr<Pimpl> pimpl;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourServiceResolver)
+    };
+}
@@ -0,0 +1,227 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourServiceResolverTests : private juce::UnitTest
+{
+public:
+    BonjourServiceResolverTests()
+        : juce::UnitTest ("BonjourServiceResolver", "Networking")
+    {
+
+    }
+
+    ~BonjourServiceResolverTests()
+    {
+
+    }
+
+private:
+    struct ResolvedListener
+    {
+        void serviceResolved (const jucey::BonjourService& service, const juce::Result& result)
+        {
+            const juce::ScopedLock lock {resolvedLock};
+            resolved.push_back ({service.getName(), result});
+        }
+
+        int getNumResolved() const
+        {
+            const juce::ScopedLock lock {resolvedLock};
+            return (int) resolved.size();
+        }
+
+        juce::CriticalSection resolvedLock;
+        std::vector<std::pair<juce::String, juce::Result>> resolved;
+    };
+
+    // Replies from the loopback responder are delivered on the event loop
+    // thread, so anything they change is waited for
+    template <typename Condition>
+    bool waitFor (Condition&& condition)
+    {
+        for (auto attempt {0}; ! condition() && attempt < 200; ++attempt)
+            juce::Thread::sleep (5);
+
+        return condition();
+    }
+
+    void registerService (jucey::BonjourService& serviceToRegister, int portToRegister)
+    {
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, portToRegister));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+    }
+
+    void runConcurrencyLimitTests()
+    {
+        beginTest ("Concurrency Limit");
+
+        jucey::BonjourLoopbackResponder responder;
+        const auto onServiceResolved = [](const jucey::BonjourService&, const juce::String&, int, const juce::Result&) {};
+
+        jucey::BonjourServiceResolver resolver {onServiceResolved, 2};
+
+        // nothing answers for these so they stay pending until cancelled
+        for (auto index {0}; index < 5; ++index)
+            resolver.resolve (jucey::BonjourService {"_missing._udp", "Missing Service " + juce::String (index), "local."});
+
+        expect (resolver.getNumResolving() == 2);
+        expect (resolver.getNumPending() == 3);
+        expect (responder.getNumActiveOperations() == 2);
+
+        // queueing the same service again shouldn't add another resolve
+        resolver.resolve (jucey::BonjourService {"_missing._udp", "Missing Service 0", "local."});
+        expect (resolver.getNumResolving() + resolver.getNumPending() == 5);
+
+        // the newest services are resolved first, so cancelling one of them
+        // should let the next newest pending service start
+        resolver.cancel (jucey::BonjourService {"_missing._udp", "Missing Service 4", "local."});
+        expect (resolver.getNumResolving() == 2);
+        expect (resolver.getNumPending() == 2);
+
+        resolver.setMaxNumConcurrentResolves (4);
+        expect (resolver.getNumResolving() == 4);
+        expect (resolver.getNumPending() == 0);
+
+        resolver.stop();
+        expect (resolver.getNumResolving() == 0);
+        expect (resolver.getNumPending() == 0);
+        expect (waitFor ([&] { return responder.getNumActiveOperations() == 0; }));
+    }
+
+    void runPriorityTests()
+    {
+        beginTest ("Priority");
+
+        jucey::BonjourLoopbackResponder responder;
+        std::vector<std::unique_ptr<jucey::BonjourService>> registeredServices;
+
+        for (auto index {0}; index < 3; ++index)
+        {
+            registeredServices.push_back (std::make_unique<jucey::BonjourService> ("_test._udp", "JUCEY Resolver Service " + juce::String (index), "local"));
+            registerService (*registeredServices.back(), 4000 + index);
+        }
+
+        ResolvedListener listener;
+
+        jucey::BonjourServiceResolver resolver {[&](const jucey::BonjourService& service, const juce::String&, int, const juce::Result& result)
+        {
+            listener.serviceResolved (service, result);
+        }, 1};
+
+        // the only slot is taken by a service that never answers while the
+        // others are queued
+        const jucey::BonjourService missingService {"_missing._udp", "Missing Service", "local."};
+        resolver.resolve (missingService);
+
+        for (const auto& service : registeredServices)
+            resolver.resolve (*service);
+
+        expect (resolver.getNumResolving() == 1);
+        expect (resolver.getNumPending() == 3);
+
+        // once the slot is free they're resolved one at a time, newest first
+        resolver.cancel (missingService);
+        expect (waitFor ([&] { return listener.getNumResolved() == 3; }));
+
+        const juce::ScopedLock lock {listener.resolvedLock};
+        expect (listener.resolved.size() == 3);
+
+        for (size_t index {0}; index < listener.resolved.size(); ++index)
+        {
+            expect (listener.resolved[index].first == "JUCEY Resolver Service " + juce::String (2 - (int) index));
+            expect (listener.resolved[index].second.wasOk());
+        }
+    }
+
+    void runTimeoutTests()
+    {
+        beginTest ("Timeout");
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourService registeredService {"_test._udp", "JUCEY Resolver Timeout", "local"};
+        registerService (registeredService, 4000);
+
+        ResolvedListener listener;
+
+        jucey::BonjourServiceResolver resolver {[&](const jucey::BonjourService& service, const juce::String&, int, const juce::Result& result)
+        {
+            listener.serviceResolved (service, result);
+        }, 1};
+
+        resolver.setResolveTimeout (juce::RelativeTime::milliseconds (100));
+
+        // the instance that never answers is given up on, which frees its
+        // slot for the one waiting behind it
+        resolver.resolve (jucey::BonjourService {"_missing._udp", "Missing Service", "local."});
+        resolver.resolve (registeredService);
+        expect (resolver.getNumResolving() == 1);
+        expect (resolver.getNumPending() == 1);
+
+        expect (waitFor ([&] { return listener.getNumResolved() == 2; }));
+        expect (resolver.getNumResolving() == 0);
+        expect (resolver.getNumPending() == 0);
+        expect (waitFor ([&] { return responder.getNumActiveOperations() == 1; }));
+
+        const juce::ScopedLock lock {listener.resolvedLock};
+        expect (listener.resolved.size() == 2);
+        expect (listener.resolved.front().first == "Missing Service");
+        expect (listener.resolved.front().second.failed());
+        expect (listener.resolved.back().first == "JUCEY Resolver Timeout");
+        expect (listener.resolved.back().second.wasOk());
+    }
+
+    void runDiscoverAndResolveTests (const juce::String& serviceTypeToTest)
+    {
+        beginTest ("Discover And Resolve: " + serviceTypeToTest);
+
+        jucey::BonjourLoopbackResponder responder;
+        jucey::BonjourService serviceToRegister {serviceTypeToTest, "JUCEY Resolver Test Service", "local"};
+        const auto portToRegister {getRandom().nextInt ({1, std::numeric_limits<uint16_t>::max()})};
+        registerService (serviceToRegister, portToRegister);
+
+        juce::WaitableEvent onServiceResolvedEvent;
+
+        const auto onServiceResolved = [&](const jucey::BonjourService& service,
+                                           const juce::String& hostName,
+                                           int port,
+                                           const juce::Result& result)
+        {
+            expect (result.wasOk());
+
+            if (service.getName() == serviceToRegister.getName())
+            {
+                expect (hostName == responder.getHostName());
+                expect (port == portToRegister);
+                onServiceResolvedEvent.signal();
+            }
+        };
+
+        jucey::BonjourServiceResolver resolver {onServiceResolved, 1};
+        expect (resolver.discoverAndResolve (serviceTypeToTest));
+        expect (onServiceResolvedEvent.wait (1000));
+    }
+
+    void runTest() override
+    {
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runConcurrencyLimitTests();
+        runPriorityTests();
+        runTimeoutTests();
+        runDiscoverAndResolveTests ("_test._udp");
+        runDiscoverAndResolveTests ("_test._tcp");
+    }
+};
+
+static BonjourServiceResolverTests bonjourServiceResolverTests;
+
+#endif // JUCEY_UNIT_TESTS
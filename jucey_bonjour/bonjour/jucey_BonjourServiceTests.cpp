@@ -88,6 +88,36 @@ private:
         return discoveredService;
     }
 
+    void runServiceBatchDiscoveryTests (const jucey::BonjourService& expectedService)
+    {
+        beginTest ("Batch Discover: " + expectedService.getType());
+
+        jucey::BonjourService serviceToDiscover {expectedService};
+        juce::WaitableEvent onServicesDiscoveredEvent;
+
+        const auto onServicesDiscovered = [&](const std::vector<jucey::BonjourService::DiscoveryEvent>& events,
+                                              const juce::Result& result)
+        {
+            beginTest ("Batch Discovered: " + expectedService.getType());
+
+            expect (result.wasOk());
+            expect ( ! events.empty());
+
+            for (const auto& event : events)
+            {
+                expect (event.isAvailable);
+                expect (event.service.getType() == expectedService.getType());
+                expect (event.service.getName() == expectedService.getName());
+                expect (event.service.getDomain() == expectedService.getDomain());
+            }
+
+            onServicesDiscoveredEvent.signal();
+        };
+
+        expect (serviceToDiscover.discoverBatchAsync (onServicesDiscovered));
+        expect (onServicesDiscoveredEvent.wait (10000));
+    }
+
     void runServiceResolutionTests (const jucey::BonjourService& serviceToResolve,
                                     int expectedPort)
     {
@@ -104,7 +134,7 @@ private:
             beginTest ("Resolved: " + serviceToResolve.getType());
 
             expect (result.wasOk());
-            expect (result.wasOk());
+            expect (hostName.isNotEmpty());
             expect (service.getName() == serviceToResolve.getName());
             expect (service.getType() == serviceToResolve.getType());
             expect (service.getDomain() == serviceToResolve.getDomain());
@@ -121,6 +151,305 @@ private:
         expect (onServiceResolvedEvent.wait (10000));
     }
 
+    void runAddressResolutionTests (const jucey::BonjourService& serviceToResolve,
+                                    int expectedPort)
+    {
+        beginTest ("Resolve Address: " + serviceToResolve.getType());
+
+        juce::WaitableEvent onAddressResolvedEvent;
+
+        const auto onAddressResolved = [&](const jucey::BonjourService& service,
+                                           const juce::String& hostName,
+                                           int port,
+                                           const juce::IPAddress& address,
+                                           bool isAvailable,
+                                           bool,
+                                           const juce::Result& result)
+        {
+            expect (result.wasOk());
+            expect (service.getName() == serviceToResolve.getName());
+            expect (hostName.isNotEmpty());
+            expect (port == expectedPort);
+
+            if (isAvailable)
+            {
+                expect ( ! address.isNull());
+                onAddressResolvedEvent.signal();
+            }
+        };
+
+        jucey::BonjourService serviceToResolveCopy {serviceToResolve};
+        expect (serviceToResolveCopy.resolveAddressAsync (onAddressResolved));
+        expect (onAddressResolvedEvent.wait (10000));
+    }
+
+    void runResolveCacheTests (const jucey::BonjourService& serviceToResolve,
+                               int expectedPort)
+    {
+        beginTest ("Resolve Cache: " + serviceToResolve.getType());
+
+        const auto previousTimeToLive {jucey::BonjourService::getResolveCacheTimeToLive()};
+        jucey::BonjourService::setResolveCacheTimeToLive (juce::RelativeTime::seconds (10.0));
+        jucey::BonjourService::clearResolveCache();
+
+        std::atomic<int> numResolved {0};
+        juce::WaitableEvent onAllServicesResolvedEvent;
+
+        const auto onServiceResolved = [&](const jucey::BonjourService& service,
+                                           const juce::String& hostName,
+                                           int port,
+                                           const juce::Result& result)
+        {
+            expect (result.wasOk());
+            expect (service.getName() == serviceToResolve.getName());
+            expect (hostName.isNotEmpty());
+            expect (port == expectedPort);
+
+            if (++numResolved == 3)
+                onAllServicesResolvedEvent.signal();
+        };
+
+        // the first two resolves should be coalesced into a single query
+        jucey::BonjourService firstService {serviceToResolve};
+        jucey::BonjourService secondService {serviceToResolve};
+        expect (firstService.resolveAsync (onServiceResolved));
+        expect (secondService.resolveAsync (onServiceResolved));
+
+        // once the first result is cached a third resolve should be answered
+        // from the cache
+        for (auto attempt {0}; numResolved < 2 && attempt < 1000; ++attempt)
+            juce::Thread::sleep (10);
+
+        jucey::BonjourService thirdService {serviceToResolve};
+        expect (thirdService.resolveAsync (onServiceResolved));
+        expect (onAllServicesResolvedEvent.wait (10000));
+        expect (numResolved == 3);
+
+        jucey::BonjourService::setResolveCacheTimeToLive (previousTimeToLive);
+        jucey::BonjourService::clearResolveCache();
+    }
+
+    void runResolveCacheLifetimeTests()
+    {
+        beginTest ("Resolve Cache Lifetime");
+
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        jucey::BonjourLoopbackResponder responder;
+
+        const auto previousTimeToLive {jucey::BonjourService::getResolveCacheTimeToLive()};
+        jucey::BonjourService::setResolveCacheTimeToLive (juce::RelativeTime::seconds (10.0));
+        jucey::BonjourService::clearResolveCache();
+
+        jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Resolve Cache Lifetime", "local"};
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, 4000));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+
+        const auto resolveFromTemporaryService = [&](const juce::String& name)
+        {
+            juce::WaitableEvent onServiceResolvedEvent;
+            jucey::BonjourService serviceToResolve {"_test._udp", name, "local"};
+
+            expect (serviceToResolve.resolveAsync ([&](const jucey::BonjourService&,
+                                                       const juce::String&,
+                                                       int port,
+                                                       const juce::Result& result)
+            {
+                expect (result.wasOk());
+                expect (port == 4000);
+                onServiceResolvedEvent.signal();
+            }));
+
+            expect (onServiceResolvedEvent.wait (1000));
+        };
+
+        const auto getNumResolves = []
+        {
+            return jucey::BonjourMetrics::getSnapshot().getNumStartedOperations (jucey::BonjourMetrics::OperationKind::resolve);
+        };
+
+        // the result outlives the service that asked for it, and names match
+        // without regard to case, so the second resolve is answered from the
+        // cache without another query
+        resolveFromTemporaryService ("JUCEY Resolve Cache Lifetime");
+        const auto numResolves {getNumResolves()};
+        resolveFromTemporaryService ("jucey resolve cache lifetime");
+        expect (getNumResolves() == numResolves);
+
+        // a service destroyed before a cached result is handed over is never
+        // called back, holding the lock keeps the result from being handed
+        // over in the meantime
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            jucey::BonjourService serviceToResolve {"_test._udp", "JUCEY Resolve Cache Lifetime", "local"};
+            expect (serviceToResolve.resolveAsync ([&](const jucey::BonjourService&, const juce::String&, int, const juce::Result&)
+            {
+                expect (false);
+            }));
+        }
+
+        // anything posted before this has been called once it's signalled
+        juce::WaitableEvent onPostedEvent;
+        eventLoop->post ([&] { onPostedEvent.signal(); });
+        expect (onPostedEvent.wait (1000));
+
+        jucey::BonjourService::setResolveCacheTimeToLive (previousTimeToLive);
+        jucey::BonjourService::clearResolveCache();
+    }
+
+    void runUnchangedResolveTests()
+    {
+        beginTest ("Unchanged Resolve");
+
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        jucey::BonjourLoopbackResponder responder;
+
+        jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Unchanged Resolve", "local"};
+        serviceToRegister.setRecordItemValue ("keyA", "valueA");
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, 4000));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+
+        const auto resolve = [&](jucey::BonjourService& serviceToResolve)
+        {
+            juce::WaitableEvent onServiceResolvedEvent;
+
+            expect (serviceToResolve.resolveAsync ([&](const jucey::BonjourService&, const juce::String&, int, const juce::Result& result)
+            {
+                expect (result.wasOk());
+                onServiceResolvedEvent.signal();
+            }));
+
+            expect (onServiceResolvedEvent.wait (1000));
+        };
+
+        jucey::BonjourService firstService {"_test._udp", "JUCEY Unchanged Resolve", "local"};
+        resolve (firstService);
+        expect (firstService.getRecordItemValue ("keyA") == "valueA");
+
+        // the same reply again leaves the data shared with the first service
+        jucey::BonjourService secondService {firstService};
+        resolve (secondService);
+        expect (secondService.getRecordItemValue ("keyA") == "valueA");
+        expect (secondService.getRecordItemViewAtIndex (0).key.data() == firstService.getRecordItemViewAtIndex (0).key.data());
+
+        // a different reply is written to the second service alone
+        serviceToRegister.setRecordItemValue ("keyA", "updatedA");
+        expect (serviceToRegister.updateRecords());
+
+        for (auto attempt {0}; secondService.getRecordItemValue ("keyA").toString() != "updatedA" && attempt < 20; ++attempt)
+        {
+            juce::Thread::sleep (10);
+            resolve (secondService);
+        }
+
+        expect (secondService.getRecordItemValue ("keyA") == "updatedA");
+        expect (firstService.getRecordItemValue ("keyA") == "valueA");
+    }
+
+    void runRecordUpdateErrorTests()
+    {
+        beginTest ("Record Update Errors");
+
+        // Operations release what they hold on the event loop thread, keeping
+        // the loop alive stops the last of them taking it down from its own
+        // thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        jucey::BonjourLoopbackResponder responder;
+
+        jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Record Update Errors", "local"};
+        expect (serviceToRegister.getLastRecordUpdateResult().wasOk());
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        expect (serviceToRegister.registerAsync ([&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        }, 4000));
+
+        expect (onServiceRegisteredEvent.wait (1000));
+
+        const auto waitForLastRecordUpdateResult = [&](bool wasOk)
+        {
+            for (auto attempt {0}; serviceToRegister.getLastRecordUpdateResult().wasOk() != wasOk && attempt < 200; ++attempt)
+                juce::Thread::sleep (10);
+
+            return serviceToRegister.getLastRecordUpdateResult().wasOk() == wasOk;
+        };
+
+        // a record too big for the responder is refused once it's sent, long
+        // after the changes were made
+        for (auto index {0}; index < 40; ++index)
+            expect (serviceToRegister.setRecordItemValue ("key" + juce::String (index), juce::String::repeatedString ("v", 240)));
+
+        expect (waitForLastRecordUpdateResult (false));
+
+        // and the next update that goes through clears it
+        for (auto index {0}; index < 40; ++index)
+            serviceToRegister.removeRecordItem ("key" + juce::String (index));
+
+        expect (waitForLastRecordUpdateResult (true));
+    }
+
+    void runRecordUpdateTests (jucey::BonjourService& registeredService,
+                               const jucey::BonjourService& serviceToResolve)
+    {
+        beginTest ("Update Records: " + registeredService.getType());
+
+        jucey::BonjourService unregisteredService {registeredService.getType()};
+        expect (unregisteredService.updateRecords().failed());
+
+        // both changes should go out together as a single update
+        registeredService.setRecordItemValue ("keyA", "updatedA");
+        registeredService.removeRecordItem ("keyB");
+        expect (registeredService.updateRecords());
+
+        std::atomic<bool> wasUpdated {false};
+        juce::WaitableEvent onServiceResolvedEvent;
+
+        const auto onServiceResolved = [&](const jucey::BonjourService& service,
+                                           const juce::String&,
+                                           int,
+                                           const juce::Result& result)
+        {
+            expect (result.wasOk());
+            wasUpdated = service.getRecordItemValue ("keyA") == "updatedA"
+                      && ! service.containsRecordItem ("keyB");
+            onServiceResolvedEvent.signal();
+        };
+
+        // the daemon may take a moment to pick up the change
+        for (auto attempt {0}; ! wasUpdated && attempt < 20; ++attempt)
+        {
+            jucey::BonjourService serviceToResolveCopy {serviceToResolve};
+            expect (serviceToResolveCopy.resolveAsync (onServiceResolved));
+            expect (onServiceResolvedEvent.wait (10000));
+
+            if ( ! wasUpdated)
+                juce::Thread::sleep (100);
+        }
+
+        expect (wasUpdated);
+    }
+
     void runBonjourNetworkTests (const juce::String& serviceTypeToTest)
     {
         jucey::BonjourService serviceToRegister {serviceTypeToTest, "JUCEY Test Service", "local"};
@@ -131,7 +460,30 @@ private:
 
         const auto registeredService (runServiceRegistrationTests (serviceToRegister, portToRegister));
         const auto discoveredService (runServiceDiscoveryTests (registeredService));
+        runServiceBatchDiscoveryTests (registeredService);
         runServiceResolutionTests (discoveredService, portToRegister);
+        runAddressResolutionTests (discoveredService, portToRegister);
+        runResolveCacheTests (discoveredService, portToRegister);
+        runRecordUpdateTests (serviceToRegister, discoveredService);
+    }
+
+    void runTeardownLatencyTests (const juce::String& serviceTypeToTest)
+    {
+        beginTest ("Teardown Latency: " + serviceTypeToTest);
+
+        const auto onServiceDiscovered = [](const jucey::BonjourService&, bool, bool, const juce::Result&) {};
+
+        std::vector<jucey::BonjourService> servicesToDiscover (100, jucey::BonjourService {serviceTypeToTest});
+
+        for (auto& serviceToDiscover : servicesToDiscover)
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+
+        const auto startTime {juce::Time::getMillisecondCounterHiRes()};
+        servicesToDiscover.clear();
+        const auto teardownTime {juce::Time::getMillisecondCounterHiRes() - startTime};
+
+        // stopping a service should never wait on a polling timeout
+        expect (teardownTime < 100.0, "Teardown took " + juce::String (teardownTime) + "ms");
     }
 
     void runDefaultConstructorTests()
@@ -188,6 +540,51 @@ private:
         expect (copiedService.getRecordItemAtIndex (1) == originalService.getRecordItemAtIndex (1));
     }
 
+    void runMoveConstructorTests()
+    {
+        beginTest ("Move Constructor");
+        jucey::BonjourService originalService {"_type._tcp", "name", "domain"};
+        originalService.setRecordItemValue ("keyA", "valueA");
+
+        jucey::BonjourService movedService {std::move (originalService)};
+        expect (movedService.getType() == "_type._tcp");
+        expect (movedService.getName() == "name");
+        expect (movedService.getDomain() == "domain");
+        expect (movedService.getRecordItemValue ("keyA") == "valueA");
+
+        jucey::BonjourService assignedService;
+        assignedService = std::move (movedService);
+        expect (assignedService.getType() == "_type._tcp");
+        expect (assignedService.getName() == "name");
+        expect (assignedService.getRecordItemValue ("keyA") == "valueA");
+    }
+
+    void runCopyOnWriteTests()
+    {
+        beginTest ("Copy On Write");
+        jucey::BonjourService originalService {"_type._tcp", "name", "domain"};
+        originalService.setRecordItemValue ("keyA", "valueA");
+
+        const auto originalView {originalService.getRecordItemViewAtIndex (0)};
+
+        jucey::BonjourService copiedService {originalService};
+        copiedService.setRecordItemValue ("keyA", "changed");
+        copiedService.setRecordItemValue ("keyB", "valueB");
+
+        // modifying the copy must leave the original, and any views onto it, alone
+        expect (originalService.getNumRecordItems() == 1);
+        expect (originalService.getRecordItemValue ("keyA") == "valueA");
+        expect (originalView.value == "valueA");
+        expect (copiedService.getNumRecordItems() == 2);
+        expect (copiedService.getRecordItemValue ("keyA") == "changed");
+
+        jucey::BonjourService assignedService;
+        assignedService = originalService;
+        assignedService.removeRecordItem ("keyA");
+        expect (originalService.containsRecordItem ("keyA"));
+        expect ( ! assignedService.containsRecordItem ("keyA"));
+    }
+
     void runRecordItemTests()
     {
         beginTest ("Record Items");
@@ -210,6 +607,161 @@ private:
         expect (service.containsRecordItem ("keyB") == false);
         expect (service.containsRecordItem ("keyC") == true);
         expect (service.containsRecordItem ("keyD") == false);
+
+        // anything that can't be written leaves the record as it was, the
+        // limit is in UTF-8 bytes so a value under 255 characters can still
+        // be too long
+        expect (service.setRecordItemValue ("keyA", juce::String::repeatedString ("a", 250)).wasOk());
+        expect (service.setRecordItemValue ("keyA", juce::String::repeatedString ("a", 251)).failed());
+        expect (service.setRecordItemValue ("keyA", juce::String::repeatedString (juce::String::fromUTF8 ("\xc3\xa9"), 200)).failed());
+        expect (service.setRecordItemValue ("", "value").failed());
+        expect (service.setRecordItemValue ("key=", "value").failed());
+        expect (service.getNumRecordItems() == 2);
+        expect (service.getRecordItemValue ("keyA").toString().length() == 250);
+    }
+
+    void runRecordItemIteratorTests()
+    {
+        beginTest ("Record Item Iterator");
+
+        jucey::BonjourService service;
+
+        for (auto index {0}; index < 40; ++index)
+            service.setRecordItemValue ("key" + juce::String (index), "value" + juce::String (index));
+
+        expect (service.getNumRecordItems() == 40);
+
+        auto index {0};
+
+        for (const auto item : service.getRecordItems())
+        {
+            const auto expectedItem {service.getRecordItemAtIndex (index)};
+            expect (juce::String (item.key.data(), item.key.size()) == expectedItem.key);
+            expect (juce::String (item.value.data(), item.value.size()) == expectedItem.value);
+            expect (item.hasValue);
+            ++index;
+        }
+
+        expect (index == 40);
+
+        // every key should be found through the hashed index
+        for (index = 0; index < 40; ++index)
+        {
+            expect (service.getRecordItemValue ("KEY" + juce::String (index)) == juce::var ("value" + juce::String (index)));
+            expect (service.getRecordItemViewAtIndex (index).value.size() > 0);
+        }
+
+        expect (service.getRecordItemValue ("missing", 42) == juce::var (42));
+    }
+
+    void runTxtRecordBuilderTests()
+    {
+        beginTest ("TXT Record Builder");
+
+        {
+            const uint8_t binaryValue[] {0x00, 0xff, '=', 0x7f};
+
+            jucey::BonjourService::TxtRecordBuilder builder {64};
+            builder.add ("keyA", "valueA")
+                   .add ("keyB", juce::MemoryBlock {binaryValue, sizeof (binaryValue)})
+                   .addKey ("flag")
+                   .add ("empty", "");
+
+            expect (builder.getResult().wasOk());
+            expect (builder.getNumItems() == 4);
+            expect (builder.getNumBytes() == 12 + 10 + 5 + 7);
+
+            jucey::BonjourService service {"_type._tcp"};
+            service.setRecordItemValue ("old", "value");
+            expect (service.setRecordItems (std::move (builder)).wasOk());
+
+            expect (service.getNumRecordItems() == 4);
+            expect ( ! service.containsRecordItem ("old"));
+            expect (service.getRecordItemValue ("keyA") == "valueA");
+
+            const auto binaryItem {service.getRecordItemViewAtIndex (1)};
+            expect (binaryItem.key == "keyB");
+            expect (binaryItem.value == std::string_view (reinterpret_cast<const char*> (binaryValue), sizeof (binaryValue)));
+
+            const auto flagItem {service.getRecordItemViewAtIndex (2)};
+            expect (flagItem.key == "flag" && ! flagItem.hasValue);
+
+            const auto emptyItem {service.getRecordItemViewAtIndex (3)};
+            expect (emptyItem.key == "empty" && emptyItem.hasValue && emptyItem.value.empty());
+        }
+
+        {
+            jucey::BonjourService::TxtRecordBuilder builder;
+            builder.add ("", "value");
+            expect (builder.getResult().failed());
+            expect (builder.getNumItems() == 0);
+
+            jucey::BonjourService service {"_type._tcp"};
+            service.setRecordItemValue ("old", "value");
+            expect (service.setRecordItems (std::move (builder)).failed());
+            expect (service.containsRecordItem ("old"));
+        }
+
+        {
+            jucey::BonjourService::TxtRecordBuilder builder;
+            builder.add ("bad=key", "value");
+            expect (builder.getResult().failed());
+
+            builder = jucey::BonjourService::TxtRecordBuilder {};
+            builder.add ("key", std::string (255, 'x'));
+            expect (builder.getResult().failed());
+
+            builder = jucey::BonjourService::TxtRecordBuilder {};
+            builder.add ("key", std::string (251, 'x'));
+            expect (builder.getResult().wasOk());
+        }
+
+        {
+            jucey::BonjourService::TxtRecordBuilder builder;
+            builder.add ("key", "a").add ("KEY", "b");
+            expect (builder.getResult().wasOk());
+
+            jucey::BonjourService service {"_type._tcp"};
+            expect (service.setRecordItems (std::move (builder)).failed());
+            expect (service.getNumRecordItems() == 0);
+        }
+    }
+
+    void runTxtRecordParsingTests()
+    {
+        beginTest ("TXT Record Parsing");
+
+        const unsigned char wireBytes[] {6, 'k', 'e', 'y', 'A', '=', 'a',
+                                         0,
+                                         4, 'f', 'l', 'a', 'g',
+                                         5, '=', 'n', 'o', 'p', 'e',
+                                         7, 'K', 'E', 'Y', 'B', '=', 'b', 'b',
+                                         6, 'k', 'e', 'y', 'A', '=', 'x'};
+
+        BonjourTxtRecord txtRecord;
+        txtRecord.copyFrom ((uint16_t) sizeof (wireBytes), wireBytes);
+
+        // the bytes should be kept exactly as received
+        expect (txtRecord.getLength() == sizeof (wireBytes));
+        expect (std::memcmp (txtRecord.getBytes(), wireBytes, sizeof (wireBytes)) == 0);
+
+        // empty strings and strings without a key are ignored
+        expect (txtRecord.getCount() == 4);
+        expect (txtRecord.getItemAtIndex (0) == jucey::BonjourService::RecordItem {"keyA", "a"});
+        expect (txtRecord.getItemAtIndex (1) == jucey::BonjourService::RecordItem {"flag", ""});
+
+        // keys are case insensitive and the first of any duplicates wins
+        expect (txtRecord.containsKey ("flag"));
+        expect (txtRecord.containsKey ("keyb"));
+        expect (txtRecord.getValueView ("KEYA") == "a");
+        expect (txtRecord.getValue ("keyB") == "bb");
+        expect (txtRecord.getValueView ("flag").empty());
+
+        // anything that overruns the buffer should be ignored
+        txtRecord.copyFrom (10, wireBytes + 8);
+        expect (txtRecord.getCount() == 1);
+        expect (txtRecord.containsKey ("flag"));
+        expect ( ! txtRecord.containsKey ("nope"));
     }
 
     void runTest() override
@@ -218,9 +770,18 @@ private:
         runUdpConstructorTests();
         runTcpConstructorTests();
         runCopyConstructorTests();
+        runMoveConstructorTests();
+        runCopyOnWriteTests();
         runRecordItemTests();
+        runRecordItemIteratorTests();
+        runTxtRecordBuilderTests();
+        runTxtRecordParsingTests();
+        runResolveCacheLifetimeTests();
+        runUnchangedResolveTests();
+        runRecordUpdateErrorTests();
         runBonjourNetworkTests ("_test._udp");
         runBonjourNetworkTests ("_test._tcp");
+        runTeardownLatencyTests ("_test._udp");
     }
 };
 
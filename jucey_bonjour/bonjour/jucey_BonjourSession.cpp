@@ -0,0 +1,33 @@
+
+namespace jucey
+{
+    static std::atomic<bool> bonjourSessionIsSharedByDefault {false};
+
+    BonjourSession::BonjourSession()
+        : pimpl {std::make_unique<Pimpl>()}
+    {
+
+    }
+
+    BonjourSession::~BonjourSession()
+    {
+
+    }
+
+    juce::Result BonjourSession::getResult() const
+    {
+        return bonjourResult (pimpl->connection->getErrorCode());
+    }
+
+    void BonjourSession::setSharedByDefault (bool shouldShareByDefault)
+    {
+        bonjourSessionIsSharedByDefault = shouldShareByDefault;
+    }
+
+    bool BonjourSession::isSharedByDefault()
+    {
+        return bonjourSessionIsSharedByDefault.load();
+    }
+}
+
+#include "jucey_BonjourSessionTests.cpp"
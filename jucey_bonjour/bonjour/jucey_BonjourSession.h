@@ -0,0 +1,33 @@
+#pragma once
+
+namespace jucey
+{
+    // A single connection to the DNS service daemon that any number of
+    // operations can share, so they use one socket between them rather than
+    // one each. Pass a session to `BonjourService::setSession()` before
+    // starting an operation, or share by default to have every service
+    // without a session use one process-wide session instead. Operations
+    // keep the connection open so a session can be destroyed while they're
+    // still running.
+    class BonjourSession
+    {
+    public:
+        BonjourSession();
+        ~BonjourSession();
+
+        // Fails if the connection to the daemon couldn't be made, in which
+        // case any operation started with the session will fail too
+        juce::Result getResult() const;
+
+        static void setSharedByDefault (bool shouldShareByDefault);
+        static bool isSharedByDefault();
+
+    private:
+        friend class BonjourService;
+
+        struct Pimpl;
+        std::unique_ptr<Pimpl> pimpl;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BonjourSession)
+    };
+}
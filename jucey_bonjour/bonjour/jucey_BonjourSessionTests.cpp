@@ -0,0 +1,116 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourSessionTests : private juce::UnitTest
+{
+public:
+    BonjourSessionTests()
+        : juce::UnitTest ("BonjourSession", "Networking")
+    {
+
+    }
+
+    ~BonjourSessionTests()
+    {
+
+    }
+
+private:
+    void runSharedSessionTests (const juce::String& serviceTypeToTest)
+    {
+        beginTest ("Shared Session: " + serviceTypeToTest);
+
+        jucey::BonjourSession session;
+        expect (session.getResult());
+
+        jucey::BonjourService serviceToRegister {serviceTypeToTest, "JUCEY Session Test Service", "local"};
+        serviceToRegister.setSession (&session);
+
+        juce::WaitableEvent onServiceRegisteredEvent;
+
+        const auto onServiceRegistered = [&](const jucey::BonjourService&, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            onServiceRegisteredEvent.signal();
+        };
+
+        const auto portToRegister {getRandom().nextInt ({1, std::numeric_limits<uint16_t>::max()})};
+        expect (serviceToRegister.registerAsync (onServiceRegistered, portToRegister));
+        expect (onServiceRegisteredEvent.wait (10000));
+
+        // every browser shares the same connection, and they should all still
+        // see the service registered on it
+        std::atomic<int> numDiscovered {0};
+        juce::WaitableEvent onAllServicesDiscoveredEvent;
+        std::vector<jucey::BonjourService> servicesToDiscover (10, jucey::BonjourService {serviceTypeToTest});
+
+        const auto onServiceDiscovered = [&](const jucey::BonjourService& service,
+                                             bool isAvailable,
+                                             bool isMoreComing,
+                                             const juce::Result& result)
+        {
+            if (result.failed() || ! isAvailable || isMoreComing || service.getName() != serviceToRegister.getName())
+                return;
+
+            if (++numDiscovered == (int) servicesToDiscover.size())
+                onAllServicesDiscoveredEvent.signal();
+        };
+
+        for (auto& serviceToDiscover : servicesToDiscover)
+        {
+            serviceToDiscover.setSession (&session);
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+        }
+
+        expect (onAllServicesDiscoveredEvent.wait (10000));
+
+        // the operations keep the connection open after the session has gone
+        jucey::BonjourService serviceToResolve;
+
+        {
+            jucey::BonjourSession temporarySession;
+            serviceToResolve = jucey::BonjourService {serviceTypeToTest, serviceToRegister.getName(), "local."};
+            serviceToResolve.setSession (&temporarySession);
+        }
+
+        juce::WaitableEvent onServiceResolvedEvent;
+
+        const auto onServiceResolved = [&](const jucey::BonjourService&, const juce::String&, int port, const juce::Result& result)
+        {
+            expect (result.wasOk());
+            expect (port == portToRegister);
+            onServiceResolvedEvent.signal();
+        };
+
+        expect (serviceToResolve.resolveAsync (onServiceResolved));
+        expect (onServiceResolvedEvent.wait (10000));
+    }
+
+    void runSharedByDefaultTests (const juce::String& serviceTypeToTest)
+    {
+        beginTest ("Shared By Default: " + serviceTypeToTest);
+
+        const auto wasSharedByDefault {jucey::BonjourSession::isSharedByDefault()};
+        jucey::BonjourSession::setSharedByDefault (true);
+        expect (jucey::BonjourSession::isSharedByDefault());
+
+        const auto onServiceDiscovered = [](const jucey::BonjourService&, bool, bool, const juce::Result&) {};
+
+        std::vector<jucey::BonjourService> servicesToDiscover (100, jucey::BonjourService {serviceTypeToTest});
+
+        for (auto& serviceToDiscover : servicesToDiscover)
+            expect (serviceToDiscover.discoverAsync (onServiceDiscovered));
+
+        servicesToDiscover.clear();
+        jucey::BonjourSession::setSharedByDefault (wasSharedByDefault);
+    }
+
+    void runTest() override
+    {
+        runSharedSessionTests ("_test._udp");
+        runSharedByDefaultTests ("_test._udp");
+    }
+};
+
+static BonjourSessionTests bonjourSessionTests;
+
+#endif // JUCEY_UNIT_TESTS
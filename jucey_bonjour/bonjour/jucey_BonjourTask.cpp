@@ -0,0 +1,280 @@
+
+namespace jucey
+{
+    // The tasks a token has been passed to are only held weakly, so a token
+    // that's kept for a long time doesn't keep finished tasks alive
+    class BonjourCancellationToken::State
+    {
+    public:
+        struct Task
+        {
+            std::weak_ptr<void> owner;
+            std::function<void()> cancel {nullptr};
+        };
+
+        // Returns false if the token has already been cancelled
+        bool add (Task task)
+        {
+            const juce::ScopedLock lock {tasksLock};
+
+            if (isCancelled)
+                return false;
+
+            // Tasks that have gone are dropped whenever the number of tasks
+            // has doubled, so adding stays O(1) on average
+            if (tasks.size() >= numTasksAfterPruning * 2)
+            {
+                tasks.erase (std::remove_if (tasks.begin(), tasks.end(), [](const Task& other) { return other.owner.expired(); }),
+                             tasks.end());
+
+                numTasksAfterPruning = juce::jmax ((size_t) 8, tasks.size());
+            }
+
+            tasks.push_back (std::move (task));
+            return true;
+        }
+
+        void cancel()
+        {
+            std::vector<Task> tasksToCancel;
+
+            {
+                const juce::ScopedLock lock {tasksLock};
+                isCancelled = true;
+                std::swap (tasks, tasksToCancel);
+            }
+
+            // Called without the lock held so a task being cancelled can be
+            // finishing at the same time
+            for (const auto& task : tasksToCancel)
+                if (const auto owner {task.owner.lock()})
+                    task.cancel();
+        }
+
+        juce::CriticalSection tasksLock;
+        bool isCancelled {false};
+        std::vector<Task> tasks;
+        size_t numTasksAfterPruning {0};
+    };
+
+    BonjourCancellationToken::BonjourCancellationToken()
+        : state {std::make_shared<State>()}
+    {
+
+    }
+
+    BonjourCancellationToken::~BonjourCancellationToken()
+    {
+
+    }
+
+    void BonjourCancellationToken::cancel() const
+    {
+        state->cancel();
+    }
+
+    bool BonjourCancellationToken::isCancelled() const
+    {
+        const juce::ScopedLock lock {state->tasksLock};
+        return state->isCancelled;
+    }
+
+    const std::shared_ptr<BonjourCancellationToken::State>& BonjourCancellationToken::getState() const noexcept
+    {
+        return state;
+    }
+
+    // Everything is guarded by the event loop lock. A task finishes exactly
+    // once, whether that's with the operation's result, a timeout or a
+    // cancellation. Continuations are never called inside the operation's
+    // own callback, they're either posted to the event loop or handed to the
+    // dispatcher, and the operation is stopped the same way.
+    class BonjourTaskBase::State : public std::enable_shared_from_this<State>
+    {
+    public:
+        explicit State (BonjourService::CallbackDispatcher dispatcherToUse)
+            : dispatcher {std::move (dispatcherToUse)}
+        {
+
+        }
+
+        // Returns the value the task will finish with, which is only kept
+        // alive by the state until the task finishes. The operation's
+        // callbacks should hold it, and the state, weakly so a registration
+        // handed out as a value doesn't keep either alive. A copy of
+        // valueIfFailed, with its result set, is used if the task fails.
+        template <typename ValueType>
+        std::shared_ptr<std::optional<ValueType>> createValue (ValueType valueIfFailed)
+        {
+            auto value {std::make_shared<std::optional<ValueType>>()};
+
+            setFailedValue = [value, valueIfFailed = std::move (valueIfFailed)](const juce::Result& result)
+            {
+                *value = valueIfFailed;
+                (*value)->result = result;
+            };
+
+            return value;
+        }
+
+        // Must be called with the event loop lock held, once the operation
+        // has been started. The state keeps itself alive until it finishes.
+        void start (const BonjourTaskOptions& options)
+        {
+            if (isFinished)
+                return;
+
+            self = shared_from_this();
+
+            const auto timeoutMs {options.timeout.inMilliseconds()};
+
+            if (timeoutMs > 0)
+            {
+                timeoutTimerId = eventLoop->callAfterDelay ((int) juce::jmin (timeoutMs, (juce::int64) std::numeric_limits<int>::max()),
+                                                            [weakState = weak_from_this()]
+                                                            {
+                                                                if (const auto lockedState {weakState.lock()})
+                                                                {
+                                                                    lockedState->timeoutTimerId = 0;
+                                                                    lockedState->fail (juce::Result::fail ("The operation timed out"));
+                                                                }
+                                                            });
+            }
+
+            if (options.cancellationToken.has_value())
+            {
+                const auto weakState {weak_from_this()};
+                const auto isAdded {options.cancellationToken->getState()->add ({weakState, [weakState]
+                {
+                    if (const auto lockedState {weakState.lock()})
+                        lockedState->cancel();
+                }})};
+
+                if ( ! isAdded)
+                    fail (getCancelledResult());
+            }
+        }
+
+        // Must be called with the event loop lock held. The value is only set
+        // if the task hasn't already finished.
+        template <typename SetValue>
+        bool finish (SetValue&& setValue)
+        {
+            if (isFinished)
+                return false;
+
+            isFinished = true;
+            setValue();
+            setFailedValue = nullptr;
+
+            if (timeoutTimerId != 0)
+                eventLoop->cancelTimer (std::exchange (timeoutTimerId, 0));
+
+            // This may well be inside one of the operation's callbacks, so the
+            // operation is stopped later, always before the continuation is
+            // called
+            eventLoop->post ([keepAlive = shared_from_this(),
+                              operationToStop = std::move (operation),
+                              continuationToCall = std::exchange (continuation, nullptr)]() mutable
+            {
+                operationToStop = BonjourService{};
+
+                if (continuationToCall != nullptr)
+                    keepAlive->callLater (std::move (continuationToCall));
+            });
+
+            self.reset();
+            return true;
+        }
+
+        bool fail (const juce::Result& result)
+        {
+            return finish ([this, &result]
+            {
+                setFailedValue (result);
+            });
+        }
+
+        void cancel()
+        {
+            const juce::ScopedLock lock {eventLoop->getLock()};
+            fail (getCancelledResult());
+        }
+
+        void callLater (std::function<void()> function)
+        {
+            if (dispatcher != nullptr)
+                dispatcher (std::move (function));
+            else
+                eventLoop->post (std::move (function));
+        }
+
+        static juce::Result getCancelledResult()
+        {
+            return juce::Result::fail ("The operation was cancelled");
+        }
+
+        juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+        const BonjourService::CallbackDispatcher dispatcher {nullptr};
+        std::function<void(const juce::Result&)> setFailedValue {nullptr};
+        std::function<void()> continuation {nullptr};
+
+        // The service running the operation, if there is one, which is kept
+        // until the task finishes
+        BonjourService operation;
+
+        std::shared_ptr<State> self {nullptr};
+        BonjourEventLoop::TimerId timeoutTimerId {0};
+        bool isFinished {false};
+
+        JUCE_DECLARE_NON_COPYABLE (State)
+    };
+
+    BonjourTaskBase::BonjourTaskBase (std::shared_ptr<State> stateToUse)
+        : state {std::move (stateToUse)}
+    {
+
+    }
+
+    bool BonjourTaskBase::isValid() const noexcept
+    {
+        return state != nullptr;
+    }
+
+    bool BonjourTaskBase::isReady() const
+    {
+        if (state == nullptr)
+            return false;
+
+        const juce::ScopedLock lock {state->eventLoop->getLock()};
+        return state->isFinished;
+    }
+
+    void BonjourTaskBase::cancel() const
+    {
+        if (state != nullptr)
+            state->cancel();
+    }
+
+    bool BonjourTaskBase::setContinuation (std::function<void()> continuation) const
+    {
+        const juce::ScopedLock lock {state->eventLoop->getLock()};
+
+        // A task can only be waited for once!
+        jassert (state->continuation == nullptr);
+
+        if (state->isFinished)
+            return false;
+
+        state->continuation = std::move (continuation);
+        return true;
+    }
+
+    void BonjourTaskBase::callContinuationLater (std::function<void()> continuation) const
+    {
+        const juce::ScopedLock lock {state->eventLoop->getLock()};
+        state->callLater (std::move (continuation));
+    }
+}
+
+#include "jucey_BonjourTaskTests.cpp"
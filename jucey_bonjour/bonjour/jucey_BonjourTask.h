@@ -0,0 +1,136 @@
+#pragma once
+
+namespace jucey
+{
+    // Cancels every task it's passed to, from any thread. Copies share the
+    // same state so one token can cancel any number of tasks at once, and
+    // any task started with a token that's already been cancelled finishes
+    // straight away.
+    class BonjourCancellationToken
+    {
+    public:
+        BonjourCancellationToken();
+        ~BonjourCancellationToken();
+
+        void cancel() const;
+        bool isCancelled() const;
+
+        // Only used within the module
+        class State;
+        const std::shared_ptr<State>& getState() const noexcept;
+
+    private:
+        std::shared_ptr<State> state;
+    };
+
+    struct BonjourTaskOptions
+    {
+        // The task fails if it hasn't finished within this time, zero waits
+        // until it finishes or is cancelled
+        juce::RelativeTime timeout {};
+
+        std::optional<BonjourCancellationToken> cancellationToken {};
+    };
+
+    // The parts of a task that don't depend on what it finishes with
+    class BonjourTaskBase
+    {
+    public:
+        bool isValid() const noexcept;
+        bool isReady() const;
+
+        // Finishes the task with a failed result if it hasn't finished
+        // already, its continuation is still called
+        void cancel() const;
+
+        // Only used within the module
+        class State;
+
+    protected:
+        BonjourTaskBase() = default;
+        explicit BonjourTaskBase (std::shared_ptr<State> stateToUse);
+
+        // Returns false, without keeping the continuation, if the task has
+        // already finished
+        bool setContinuation (std::function<void()> continuation) const;
+        void callContinuationLater (std::function<void()> continuation) const;
+
+        std::shared_ptr<State> state;
+    };
+
+    // The single result of an operation. Wait for it by passing a
+    // continuation to then(), as a std::future, or with co_await in a C++20
+    // coroutine. None of these block a thread while the operation is in
+    // flight. Whichever is used is called on the event loop thread, or
+    // through the callback dispatcher of the service that started the
+    // operation, and each task can only be waited for once.
+    //
+    // The operation keeps running after the task is destroyed. Only a
+    // timeout or cancellation stops an operation that never finishes.
+    template <typename ValueType>
+    class BonjourTask : public BonjourTaskBase
+    {
+    public:
+        BonjourTask() = default;
+
+        void then (std::function<void(ValueType)> continuation)
+        {
+            // This task has no operation behind it!
+            jassert (isValid());
+
+            auto callContinuation = [value = value, continuation = std::move (continuation)]
+            {
+                continuation (std::move (**value));
+            };
+
+            if ( ! setContinuation (callContinuation))
+                callContinuationLater (std::move (callContinuation));
+        }
+
+        std::future<ValueType> getFuture()
+        {
+            auto promise {std::make_shared<std::promise<ValueType>>()};
+            auto future {promise->get_future()};
+
+            then ([promise](ValueType finishedValue)
+            {
+                promise->set_value (std::move (finishedValue));
+            });
+
+            return future;
+        }
+
+       #if JUCEY_HAS_COROUTINES
+        bool await_ready() const
+        {
+            return isReady();
+        }
+
+        bool await_suspend (std::coroutine_handle<> handle)
+        {
+            return setContinuation ([handle]
+            {
+                handle.resume();
+            });
+        }
+
+        ValueType await_resume()
+        {
+            return std::move (**value);
+        }
+       #endif
+
+    private:
+        friend class BonjourService;
+        friend class BonjourDiscoveryStream;
+
+        BonjourTask (std::shared_ptr<State> stateToUse, std::shared_ptr<std::optional<ValueType>> valueToUse)
+            : BonjourTaskBase {std::move (stateToUse)}
+            , value {std::move (valueToUse)}
+        {
+
+        }
+
+        std::shared_ptr<std::optional<ValueType>> value {nullptr};
+    };
+}
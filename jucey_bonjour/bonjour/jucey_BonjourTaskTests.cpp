@@ -0,0 +1,260 @@
+#if JUCEY_UNIT_TESTS
+
+class BonjourTaskTests : private juce::UnitTest
+{
+public:
+    BonjourTaskTests()
+        : juce::UnitTest ("BonjourTask", "Networking")
+    {
+
+    }
+
+    ~BonjourTaskTests()
+    {
+
+    }
+
+private:
+    template <typename ValueType>
+    static bool isReady (const std::future<ValueType>& future)
+    {
+        return future.wait_for (std::chrono::seconds (1)) == std::future_status::ready;
+    }
+
+    // Operations stopped on the event loop thread are released shortly after
+    void waitForOperationsToStop (const jucey::BonjourLoopbackResponder& responder)
+    {
+        for (auto attempt {0}; responder.getNumActiveOperations() > 0 && attempt < 100; ++attempt)
+            juce::Thread::sleep (10);
+
+        expect (responder.getNumActiveOperations() == 0);
+    }
+
+    void runContinuationTests()
+    {
+        beginTest ("Continuations");
+
+        jucey::BonjourService::clearResolveCache();
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            const jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Task Test Service", "local"};
+            std::optional<jucey::BonjourService::RegisterResult> registerResult;
+            juce::WaitableEvent onRegisteredEvent;
+
+            serviceToRegister.registerTask (12345).then ([&](jucey::BonjourService::RegisterResult result)
+            {
+                registerResult = std::move (result);
+                onRegisteredEvent.signal();
+            });
+
+            expect (onRegisteredEvent.wait (1000));
+            expect (registerResult->result.wasOk());
+            expect (registerResult->service.getName() == "JUCEY Task Test Service");
+
+            // the registration is handed over rather than left with the task
+            expect (responder.getNumRegisteredServices() == 1);
+
+            auto resolveFuture {registerResult->service.resolveTask().getFuture()};
+            expect (isReady (resolveFuture));
+
+            const auto resolveResult {resolveFuture.get()};
+            expect (resolveResult.result.wasOk());
+            expect (resolveResult.hostName == responder.getHostName());
+            expect (resolveResult.port == 12345);
+
+            // a task that's already finished still calls its continuation
+            auto resolveTask {registerResult->service.resolveTask()};
+
+            for (auto attempt {0}; ! resolveTask.isReady() && attempt < 100; ++attempt)
+                juce::Thread::sleep (10);
+
+            expect (resolveTask.isReady());
+
+            auto isContinuationCalled {false};
+            juce::WaitableEvent onResolvedEvent;
+
+            resolveTask.then ([&](jucey::BonjourService::ResolveResult result)
+            {
+                expect (result.port == 12345);
+                isContinuationCalled = true;
+                onResolvedEvent.signal();
+            });
+
+            expect (onResolvedEvent.wait (1000));
+            expect (isContinuationCalled);
+        }
+
+        waitForOperationsToStop (responder);
+        expect (responder.getNumRegisteredServices() == 0);
+    }
+
+    void runDispatcherTests()
+    {
+        beginTest ("Dispatcher");
+
+        jucey::BonjourService::clearResolveCache();
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            std::atomic<int> numDispatched {0};
+            jucey::BonjourService serviceToRegister {"_test._udp", "JUCEY Task Dispatcher Test Service", "local"};
+
+            serviceToRegister.setCallbackDispatcher ([&](std::function<void()> callback)
+            {
+                ++numDispatched;
+                callback();
+            });
+
+            auto registerFuture {serviceToRegister.registerTask (12345).getFuture()};
+            expect (isReady (registerFuture));
+
+            const auto registerResult {registerFuture.get()};
+            expect (registerResult.result.wasOk());
+
+            // only the continuation goes through the dispatcher, and the
+            // registration keeps it
+            expect (numDispatched == 1);
+            expect (registerResult.service.getCallbackDispatcher() != nullptr);
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runTimeoutTests()
+    {
+        beginTest ("Timeout");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            // nothing answers for this so it only finishes when it times out
+            const jucey::BonjourService missingService {"_missing._udp", "Missing Service", "local."};
+            auto resolveFuture {missingService.resolveTask ({juce::RelativeTime::milliseconds (50)}).getFuture()};
+            expect (isReady (resolveFuture));
+
+            const auto resolveResult {resolveFuture.get()};
+            expect (resolveResult.result.failed());
+            expect (resolveResult.result.getErrorMessage() == "The operation timed out");
+            expect (resolveResult.service.getName() == "Missing Service");
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+    void runCancellationTests()
+    {
+        beginTest ("Cancellation");
+
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            const jucey::BonjourService missingService {"_missing._udp", "Missing Service", "local."};
+
+            // cancelling the task itself
+            auto resolveTask {missingService.resolveTask()};
+            auto resolveFuture {resolveTask.getFuture()};
+            expect ( ! resolveTask.isReady());
+
+            resolveTask.cancel();
+            expect (isReady (resolveFuture));
+            expect (resolveFuture.get().result.getErrorMessage() == "The operation was cancelled");
+
+            // one token cancelling several tasks at once
+            jucey::BonjourCancellationToken token;
+            jucey::BonjourTaskOptions options;
+            options.cancellationToken = token;
+
+            std::vector<std::future<jucey::BonjourService::ResolveResult>> futures;
+
+            for (auto index {0}; index < 3; ++index)
+                futures.push_back (missingService.resolveTask (options).getFuture());
+
+            expect ( ! token.isCancelled());
+            token.cancel();
+            expect (token.isCancelled());
+
+            for (auto& future : futures)
+            {
+                expect (isReady (future));
+                expect (future.get().result.failed());
+            }
+
+            // tasks started with a cancelled token finish straight away
+            auto cancelledTask {missingService.resolveTask (options)};
+            expect (cancelledTask.isReady());
+            expect (cancelledTask.getFuture().get().result.failed());
+        }
+
+        waitForOperationsToStop (responder);
+    }
+
+   #if JUCEY_HAS_COROUTINES
+    // Starts running straight away and nothing waits for it to finish
+    struct DetachedCoroutine
+    {
+        struct promise_type
+        {
+            DetachedCoroutine get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    DetachedCoroutine registerAndResolve (jucey::BonjourService serviceToRegister,
+                                          std::promise<jucey::BonjourService::ResolveResult>& promise)
+    {
+        auto registerResult {co_await serviceToRegister.registerTask (12345)};
+        expect (registerResult.result.wasOk());
+
+        auto resolveResult {co_await registerResult.service.resolveTask()};
+        promise.set_value (std::move (resolveResult));
+    }
+
+    void runCoroutineTests()
+    {
+        beginTest ("Coroutines");
+
+        jucey::BonjourService::clearResolveCache();
+        jucey::BonjourLoopbackResponder responder;
+
+        {
+            std::promise<jucey::BonjourService::ResolveResult> promise;
+            auto future {promise.get_future()};
+            registerAndResolve ({"_test._udp", "JUCEY Coroutine Test Service", "local"}, promise);
+
+            expect (isReady (future));
+
+            const auto resolveResult {future.get()};
+            expect (resolveResult.result.wasOk());
+            expect (resolveResult.port == 12345);
+        }
+
+        // the registration goes once the coroutine has finished with it
+        waitForOperationsToStop (responder);
+        expect (responder.getNumRegisteredServices() == 0);
+    }
+   #endif
+
+    void runTest() override
+    {
+        // Tasks release what they hold on the event loop thread, keeping the
+        // loop alive stops the last of them taking it down from its own thread
+        const juce::SharedResourcePointer<BonjourEventLoop> eventLoop;
+
+        runContinuationTests();
+        runDispatcherTests();
+        runTimeoutTests();
+        runCancellationTests();
+
+       #if JUCEY_HAS_COROUTINES
+        runCoroutineTests();
+       #endif
+    }
+};
+
+static BonjourTaskTests bonjourTaskTests;
+
+#endif // JUCEY_UNIT_TESTS
@@ -2,4 +2,49 @@
 #include "jucey_bonjour.h"
 
 #include <dns_sd.h>
+#include <cstddef>
+#include <optional>
+
+#if JUCE_MODULE_AVAILABLE_juce_events
+ #include <juce_events/juce_events.h>
+#endif
+
+#if JUCE_WINDOWS
+ #include <winsock2.h>
+ #include <ws2tcpip.h>
+#else
+ #include <fcntl.h>
+ #include <netinet/in.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+#if JUCEY_NATIVE_MDNS && JUCE_LINUX
+ #include <arpa/inet.h>
+ #include <ifaddrs.h>
+ #include <net/if.h>
+ #include <sys/socket.h>
+#endif
+
+#if JUCEY_BENCHMARKS && JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+#include "bonjour/jucey_BonjourBackend.cpp"
+#include "bonjour/jucey_BonjourMetrics.cpp"
+#include "bonjour/jucey_BonjourPools.cpp"
+#include "bonjour/jucey_BonjourEventLoop.cpp"
+#include "bonjour/jucey_BonjourQueuedBackend.cpp"
+#include "bonjour/jucey_BonjourDnsMessage.cpp"
+#include "bonjour/jucey_BonjourMdnsBackend.cpp"
+#include "bonjour/jucey_BonjourTask.cpp"
+#include "bonjour/jucey_BonjourOperation.cpp"
 #include "bonjour/jucey_BonjourService.cpp"
+#include "bonjour/jucey_BonjourDiscoveryStream.cpp"
+#include "bonjour/jucey_BonjourBulkRegistration.cpp"
+#include "bonjour/jucey_BonjourSession.cpp"
+#include "bonjour/jucey_BonjourLoopbackResponder.cpp"
+#include "bonjour/jucey_BonjourCallbackQueue.cpp"
+#include "bonjour/jucey_BonjourServiceDirectory.cpp"
+#include "bonjour/jucey_BonjourServiceResolver.cpp"
+#include "bonjour/jucey_BonjourBenchmarks.cpp"
@@ -18,6 +18,17 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include <deque>
+#include <future>
+#include <optional>
+#include <string_view>
+
+#if defined (__cpp_impl_coroutine) && __has_include (<coroutine>)
+ #include <coroutine>
+ #define JUCEY_HAS_COROUTINES 1
+#else
+ #define JUCEY_HAS_COROUTINES 0
+#endif
 
 //==============================================================================
 /** Config: JUCEY_UNIT_TESTS
@@ -28,4 +39,34 @@
  #define JUCEY_UNIT_TESTS 0
 #endif // JUCE_UNIT_TESTS
 
+/** Config: JUCEY_NATIVE_MDNS
+
+    If enabled, on Linux, every operation is answered by the module itself
+    talking multicast DNS directly, rather than by a DNS-SD daemon. dns_sd.h is
+    still needed for its types but no library needs to be linked.
+ */
+#ifndef JUCEY_NATIVE_MDNS
+ #define JUCEY_NATIVE_MDNS 0
+#endif // JUCEY_NATIVE_MDNS
+
+/** Config: JUCEY_BENCHMARKS
+
+    If enabled this will add jucey::BonjourBenchmarks, which measures the
+    discovery, resolve and TXT record hot paths.
+ */
+#ifndef JUCEY_BENCHMARKS
+ #define JUCEY_BENCHMARKS 0
+#endif // JUCEY_BENCHMARKS
+
+#include "bonjour/jucey_BonjourMetrics.h"
+#include "bonjour/jucey_BonjourSession.h"
+#include "bonjour/jucey_BonjourTask.h"
+#include "bonjour/jucey_BonjourOperation.h"
 #include "bonjour/jucey_BonjourService.h"
+#include "bonjour/jucey_BonjourDiscoveryStream.h"
+#include "bonjour/jucey_BonjourBulkRegistration.h"
+#include "bonjour/jucey_BonjourCallbackQueue.h"
+#include "bonjour/jucey_BonjourServiceDirectory.h"
+#include "bonjour/jucey_BonjourServiceResolver.h"
+#include "bonjour/jucey_BonjourLoopbackResponder.h"
+#include "bonjour/jucey_BonjourBenchmarks.h"